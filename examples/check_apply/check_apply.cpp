@@ -0,0 +1,121 @@
+/* Regression check of the matrix-free Stokes operator: on random 2d and 3d geometries with solid and immersed boundary
+   voxels, hgf::models::stokes::apply must match a product with the assembled csr_array, operator_diagonal must match its
+   diagonal, and a model built without assembly must give the same apply and right-hand side. Build with included
+   CMakeLists.txt, and use:
+     check_apply
+   Prints the largest differences and returns nonzero if a check fails.
+*/
+
+#include <vector>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+
+#include "hgflow.hpp"
+
+#define TOL 1e-12
+
+/* Fills par with a random nx x ny x nz geometry, 15% solid and 5% immersed boundary voxels, without dead pores. */
+void
+random_geometry( parameters& par, int nx, int ny, int nz, unsigned seed )
+{
+  par.nx = nx;
+  par.ny = ny;
+  par.nz = nz;
+  par.dimension = nz ? 3 : 2;
+  par.length = 1.0;
+  par.width = 1.3;
+  par.height = nz ? 0.7 : 0.0;
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+  par.voxel_geometry.resize(nx * ny * (nz ? nz : 1));
+  for (int ii = 0; ii < (int)par.voxel_geometry.size(); ii++) {
+    double r = unif(gen);
+    par.voxel_geometry[ii] = (r < 0.15) ? 1 : ((r < 0.20) ? 2 : 0);
+  }
+  hgf::mesh::geo_sanity(par);
+  hgf::mesh::remove_dead_pores(par);
+}
+
+/* y = A x with the assembled system. */
+void
+csr_mult( const array_csr& array, const std::vector< double >& x, std::vector< double >& y )
+{
+  y.assign(array.n_rows, 0.0);
+  for (hgf_index row = 0; row < array.n_rows; row++) {
+    for (hgf_index pos = array.row_ptr[row]; pos < array.row_ptr[row + 1]; pos++) {
+      y[row] += array.value[pos] * x[array.col_index[pos]];
+    }
+  }
+}
+
+/* Runs the checks for one geometry, returns true if they pass. */
+bool
+check_geometry( int nx, int ny, int nz, unsigned seed )
+{
+  parameters par;
+  random_geometry(par, nx, ny, nz, seed);
+  hgf::mesh::voxel msh;
+  msh.build(par);
+
+  hgf::models::stokes assembled, matrix_free;
+  assembled.build(par, msh);
+  matrix_free.build(par, msh, 0);
+  hgf::models::stokes* models[2] = { &assembled, &matrix_free };
+  for (int mm = 0; mm < 2; mm++) {
+    models[mm]->setup_xflow_bc(par, msh, HGF_INFLOW_PARABOLIC);
+    models[mm]->immersed_boundary(par, 1e-3);
+  }
+
+  const array_csr& array = assembled.csr_array;
+  if (matrix_free.rhs.size() != assembled.rhs.size()) {
+    std::cout << "\nUnassembled model has " << matrix_free.rhs.size() << " rows instead of " << assembled.rhs.size() << "  FAILED\n";
+    return false;
+  }
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> unif(-0.5, 0.5);
+  std::vector< double > x(array.n_rows), y_csr, y_apply, y_free, diagonal;
+  for (hgf_index ii = 0; ii < array.n_rows; ii++) x[ii] = unif(gen);
+
+  csr_mult(array, x, y_csr);
+  assembled.apply(x, y_apply);
+  matrix_free.apply(x, y_free);
+  assembled.operator_diagonal(diagonal);
+
+  // operator_diagonal fills the zero pressure diagonal of the system with a Schur complement estimate, compare the rest
+  double scale = 0, apply_diff = 0, free_diff = 0, diagonal_diff = 0, rhs_scale = 0, rhs_diff = 0;
+  for (hgf_index row = 0; row < array.n_rows; row++) {
+    double entry = 0;
+    for (hgf_index pos = array.row_ptr[row]; pos < array.row_ptr[row + 1]; pos++) {
+      if (array.col_index[pos] == row) entry += array.value[pos];
+    }
+    if (entry != 0) diagonal_diff = std::max(diagonal_diff, fabs(entry - diagonal[row]) / fabs(entry));
+    scale = std::max(scale, fabs(y_csr[row]));
+    apply_diff = std::max(apply_diff, fabs(y_csr[row] - y_apply[row]));
+    free_diff = std::max(free_diff, fabs(y_apply[row] - y_free[row]));
+    rhs_scale = std::max(rhs_scale, fabs(assembled.rhs[row]));
+    rhs_diff = std::max(rhs_diff, fabs(assembled.rhs[row] - matrix_free.rhs[row]));
+  }
+  apply_diff /= scale;
+  free_diff /= scale;
+  if (rhs_scale > 0) rhs_diff /= rhs_scale;
+
+  bool pass = (apply_diff < TOL) && (free_diff < TOL) && (diagonal_diff < TOL) && (rhs_diff < TOL);
+  std::cout << "\n" << par.dimension << "d geometry, " << array.n_rows << " rows: apply vs csr " << apply_diff \
+            << ", unassembled apply " << free_diff << ", diagonal " << diagonal_diff << ", rhs " << rhs_diff \
+            << (pass ? "  passed\n" : "  FAILED\n");
+  return pass;
+}
+
+int
+main( int argc, const char* argv[] )
+{
+  std::cout << "\n//----Checking the matrix-free Stokes operator----//\n";
+  bool pass = true;
+  pass = check_geometry(24, 20, 0, 3) && pass;
+  pass = check_geometry(12, 10, 9, 5) && pass;
+  std::cout << (pass ? "\nAll checks passed.\n" : "\nSome checks FAILED.\n");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+FIND_PATH(PARALUTION_INCLUDE_DIR paralution.hpp ${PARALUTION_ROOT}/include ${PARALUTION_ROOT}/inc)
+IF(WIN32)
+  FIND_LIBRARY(PARALUTION_LIBRARY NAMES paralution PATHS ${PARALUTION_ROOT} ${PARALUTION_ROOT}/lib/x64 ${PARALUTION_ROOT}/lib)
+ELSE()
+  FIND_LIBRARY(PARALUTION_LIBRARY NAMES paralution PATHS ${PARALUTION_ROOT} ${PARALUTION_ROOT}/lib /usr/lib /usr/local/lib /usr/lib64 /usr/local/lib64)
+ENDIF()
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(PARALUTION DEFAULT_MSG PARALUTION_LIBRARY PARALUTION_INCLUDE_DIR)
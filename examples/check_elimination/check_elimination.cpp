@@ -0,0 +1,166 @@
+/* Regression check of immersed boundary elimination: on 2d and 3d channels with solid voxels and an immersed boundary
+   obstacle, a model reduced with hgf::models::stokes::eliminate_immersed_boundary keeps the penalty on faces between
+   immersed boundary and fluid cells, so its solution must approach the penalized one as the penalty 1 / eta grows.
+   Velocities and pressures away from the obstacle are compared at two values of eta, the difference must be small
+   and shrink with eta. The small systems are solved with a dense LU factorization, so the check does not depend on a
+   solver converging on the stiff penalized system.
+   Build with included CMakeLists.txt, and use:
+     check_elimination
+   Prints the differences and returns nonzero if a check fails.
+*/
+
+#include <vector>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+
+#include "hgflow.hpp"
+
+/* Fills par with an nx x ny x nz channel, 10% random solid voxels and a centered immersed boundary ball of radius ny / 4,
+   without dead pores. */
+void
+obstacle_geometry( parameters& par, int nx, int ny, int nz, unsigned seed )
+{
+  par.nx = nx;
+  par.ny = ny;
+  par.nz = nz;
+  par.dimension = nz ? 3 : 2;
+  par.length = 1.0;
+  par.width = 1.0 * ny / nx;
+  par.height = nz ? 1.0 * nz / nx : 0.0;
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+  int n_z = nz ? nz : 1;
+  double radius = 0.25 * ny;
+  par.voxel_geometry.resize(nx * ny * n_z);
+  for (int kk = 0; kk < n_z; kk++) {
+    for (int jj = 0; jj < ny; jj++) {
+      for (int ii = 0; ii < nx; ii++) {
+        double dx = ii + 0.5 - 0.5 * nx, dy = jj + 0.5 - 0.5 * ny, dz = nz ? kk + 0.5 - 0.5 * nz : 0.0;
+        unsigned long& voxel = par.voxel_geometry[ii + nx * (jj + ny * kk)];
+        if (dx * dx + dy * dy + dz * dz < radius * radius) voxel = 2;
+        else voxel = (unif(gen) < 0.1) ? 1 : 0;
+      }
+    }
+  }
+  hgf::mesh::geo_sanity(par);
+  hgf::mesh::remove_dead_pores(par);
+}
+
+/* Solves array * x = rhs with a dense LU factorization with partial pivoting. */
+void
+dense_solve( const array_csr& array, const std::vector< double >& rhs, std::vector< double >& x )
+{
+  size_t n = array.n_rows;
+  std::vector< double > lu(n * n, 0.0);
+  for (size_t row = 0; row < n; row++) {
+    for (hgf_index pos = array.row_ptr[row]; pos < array.row_ptr[row + 1]; pos++) {
+      lu[row * n + array.col_index[pos]] += array.value[pos];
+    }
+  }
+  x = rhs;
+  for (size_t kk = 0; kk < n; kk++) {
+    size_t pivot = kk;
+    for (size_t ii = kk + 1; ii < n; ii++) {
+      if (fabs(lu[ii * n + kk]) > fabs(lu[pivot * n + kk])) pivot = ii;
+    }
+    if (pivot != kk) {
+      for (size_t jj = 0; jj < n; jj++) std::swap(lu[kk * n + jj], lu[pivot * n + jj]);
+      std::swap(x[kk], x[pivot]);
+    }
+    for (size_t ii = kk + 1; ii < n; ii++) {
+      double factor = lu[ii * n + kk] / lu[kk * n + kk];
+      if (factor == 0) continue;
+      for (size_t jj = kk; jj < n; jj++) lu[ii * n + jj] -= factor * lu[kk * n + jj];
+      x[ii] -= factor * x[kk];
+    }
+  }
+  for (size_t kk = n; kk-- > 0; ) {
+    for (size_t jj = kk + 1; jj < n; jj++) x[kk] -= lu[kk * n + jj] * x[jj];
+    x[kk] /= lu[kk * n + kk];
+  }
+}
+
+/* Builds and solves the x-flow problem with an immersed boundary penalty 1 / eta, optionally eliminated. */
+void
+solve_model( const parameters& par, const hgf::mesh::voxel& msh, double eta, bool eliminate, hgf::models::stokes& stks )
+{
+  stks.build(par, msh);
+  stks.immersed_boundary(par, eta);
+  stks.setup_xflow_bc(par, msh, HGF_INFLOW_PARABOLIC);
+  if (eliminate) stks.eliminate_immersed_boundary();
+  dense_solve(stks.csr_array, stks.rhs, stks.solution_int);
+  stks.solution_build();
+}
+
+/* Largest velocity and pressure differences between two solutions outside the immersed boundary cells, relative to
+   the largest velocity and pressure of reference. */
+void
+compare( const hgf::models::stokes& reference, const hgf::models::stokes& stks, double& velocity_diff, double& pressure_diff )
+{
+  const dof_store* dofs[3] = { &reference.velocity_u(), &reference.velocity_v(), &reference.velocity_w() };
+  const std::vector< int >& ib = reference.pressure_ib_list;
+  double velocity_scale = 0, pressure_scale = 0;
+  velocity_diff = 0;
+  pressure_diff = 0;
+  size_t offset = 0;
+  for (int cc = 0; cc < 3; cc++) {
+    for (size_t ii = 0; ii < dofs[cc]->size(); ii++) {
+      int cell_0 = dofs[cc]->cell((int)ii, 0), cell_1 = dofs[cc]->cell((int)ii, 1);
+      if ((cell_0 > -1 && ib[cell_0]) || (cell_1 > -1 && ib[cell_1])) continue;
+      velocity_scale = std::max(velocity_scale, fabs(reference.solution[offset + ii]));
+      velocity_diff = std::max(velocity_diff, fabs(reference.solution[offset + ii] - stks.solution[offset + ii]));
+    }
+    offset += dofs[cc]->size();
+  }
+  for (size_t ii = 0; ii < reference.pressure().size(); ii++) {
+    if (ib[ii]) continue;
+    pressure_scale = std::max(pressure_scale, fabs(reference.solution[offset + ii]));
+    pressure_diff = std::max(pressure_diff, fabs(reference.solution[offset + ii] - stks.solution[offset + ii]));
+  }
+  velocity_diff /= velocity_scale;
+  pressure_diff /= pressure_scale;
+}
+
+/* Runs the check for one geometry, returns true if it passes. */
+bool
+check_geometry( int nx, int ny, int nz, unsigned seed )
+{
+  parameters par;
+  obstacle_geometry(par, nx, ny, nz, seed);
+  hgf::mesh::voxel msh;
+  msh.build(par);
+
+  // difference at each eta, penalized model first
+  double eta[2] = { 1e-4, 1e-6 }, velocity_diff[2], pressure_diff[2];
+  hgf::models::stokes eliminated[2];
+  for (int ee = 0; ee < 2; ee++) {
+    hgf::models::stokes penalized;
+    solve_model(par, msh, eta[ee], false, penalized);
+    solve_model(par, msh, eta[ee], true, eliminated[ee]);
+    compare(penalized, eliminated[ee], velocity_diff[ee], pressure_diff[ee]);
+  }
+
+  hgf_index n_u, n_v, n_w, n_p;
+  eliminated[1].block_sizes(n_u, n_v, n_w, n_p);
+  bool pass = (n_u + n_v + n_w + n_p == (hgf_index)eliminated[1].rhs.size()) \
+           && (velocity_diff[1] < 1e-4) && (pressure_diff[1] < 1e-4) \
+           && (velocity_diff[1] < 0.05 * velocity_diff[0]) && (pressure_diff[1] < 0.05 * pressure_diff[0]);
+  std::cout << "\n" << par.dimension << "d geometry, " << eliminated[1].rhs.size() << " rows after elimination: velocity difference " \
+            << velocity_diff[0] << " at eta " << eta[0] << ", " << velocity_diff[1] << " at eta " << eta[1] << "; pressure " \
+            << pressure_diff[0] << ", " << pressure_diff[1] << (pass ? "  passed\n" : "  FAILED\n");
+  return pass;
+}
+
+int
+main( int argc, const char* argv[] )
+{
+  std::cout << "\n//----Checking immersed boundary elimination----//\n";
+  bool pass = true;
+  pass = check_geometry(24, 16, 0, 3) && pass;
+  pass = check_geometry(10, 8, 8, 5) && pass;
+  std::cout << (pass ? "\nAll checks passed.\n" : "\nSome checks FAILED.\n");
+  return pass ? 0 : 1;
+}
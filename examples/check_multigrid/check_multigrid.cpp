@@ -0,0 +1,117 @@
+/* Regression check of the multigrid solver: the Poisson problem of the poisson example is solved with
+   hgf::solve::multigrid::solve on a random porous 2d and 3d geometry, refined uniformly to several resolutions.
+   Every solve must reach the relative tolerance, and the conjugate gradient iterations must stay close to independent
+   of the resolution. Build with included CMakeLists.txt, and use:
+     check_multigrid
+   Prints the iterations and residuals, and returns nonzero if a check fails.
+*/
+
+#include <vector>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+
+#include "hgflow.hpp"
+
+#define EPS 1e-10
+
+/* Dirichlet boundary on the left and right faces, zero flux elsewhere. */
+bool
+mixed_bc_heuristic( const parameters& par, int dof_num, double coords[3] ) {
+  return (coords[0] <= 0.0 + EPS) || (coords[0] >= par.length - EPS);
+}
+
+/* phi == 1 on the left face and phi == 0 on the right. */
+double
+dirichlet_bc_value( const parameters& par, int dof_num, double coords[3] ) {
+  return (coords[0] <= 0.0 + EPS) ? 1.0 : 0.0;
+}
+
+/* Fills par with a random nx x ny x nz geometry, 20% solid voxels, without dead pores. */
+void
+random_geometry( parameters& par, int nx, int ny, int nz, unsigned seed )
+{
+  par.nx = nx;
+  par.ny = ny;
+  par.nz = nz;
+  par.dimension = nz ? 3 : 2;
+  par.length = 1.2;
+  par.width = 1.0;
+  par.height = nz ? 0.9 : 0.0;
+  par.solver_absolute_tolerance = 0.0;
+  par.solver_relative_tolerance = 1e-8;
+  par.solver_max_iterations = 500;
+  par.solver_verbose = 0;
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+  par.voxel_geometry.resize(nx * ny * (nz ? nz : 1));
+  for (int ii = 0; ii < (int)par.voxel_geometry.size(); ii++) par.voxel_geometry[ii] = (unif(gen) < 0.2) ? 1 : 0;
+  hgf::mesh::geo_sanity(par);
+  hgf::mesh::remove_dead_pores(par);
+}
+
+/* Solves the Poisson problem on the geometry of par, returns the iterations and sets the relative residual. */
+int
+solve_poisson( parameters& par, double& residual )
+{
+  hgf::mesh::voxel msh;
+  msh.build(par);
+  hgf::models::poisson poiss;
+  poiss.build(par, msh);
+  poiss.set_constant_force(par, 0.0);
+  poiss.setup_mixed_bc(par, msh, mixed_bc_heuristic);
+  poiss.add_nonhomogeneous_bc(par, msh, dirichlet_bc_value);
+
+  int iterations = hgf::solve::multigrid::solve(par, poiss.coo_array, poiss.rhs, poiss.solution);
+
+  std::vector< double > r(poiss.rhs);
+  for (size_t ii = 0; ii < poiss.coo_array.size(); ii++) {
+    r[poiss.coo_array[ii].i_index] -= poiss.coo_array[ii].value * poiss.solution[poiss.coo_array[ii].j_index];
+  }
+  double r_norm = 0, b_norm = 0;
+  for (size_t ii = 0; ii < r.size(); ii++) {
+    r_norm += r[ii] * r[ii];
+    b_norm += poiss.rhs[ii] * poiss.rhs[ii];
+  }
+  residual = sqrt(r_norm / b_norm);
+  return iterations;
+}
+
+/* Runs the check for one base geometry refined by each factor in refine, returns true if it passes. */
+bool
+check_geometry( int nx, int ny, int nz, unsigned seed, const std::vector< int >& refine )
+{
+  parameters base;
+  random_geometry(base, nx, ny, nz, seed);
+  bool pass = true;
+  int reference = 0;
+  std::cout << "\n" << base.dimension << "d geometry:";
+  for (size_t ii = 0; ii < refine.size(); ii++) {
+    parameters par = base;
+    if (refine[ii] > 1) hgf::mesh::refine_voxel_uniform(par, refine[ii]);
+    double residual;
+    int iterations = solve_poisson(par, residual);
+    // the unrefined geometry may be solved directly on one level, growth is measured from the first refinement
+    if (ii == 1) reference = iterations;
+    pass = pass && (residual < 10 * par.solver_relative_tolerance) && (iterations <= 40);
+    if (ii > 1) pass = pass && (iterations <= 2 * reference);
+    std::cout << " " << par.nx << "x" << par.ny;
+    if (par.nz) std::cout << "x" << par.nz;
+    std::cout << " " << iterations << " iterations (residual " << residual << ");";
+  }
+  std::cout << (pass ? "  passed\n" : "  FAILED\n");
+  return pass;
+}
+
+int
+main( int argc, const char* argv[] )
+{
+  std::cout << "\n//----Checking the multigrid solver----//\n";
+  bool pass = true;
+  pass = check_geometry(16, 12, 0, 7, std::vector< int >{ 1, 2, 4, 8 }) && pass;
+  pass = check_geometry(8, 8, 8, 7, std::vector< int >{ 1, 2, 4 }) && pass;
+  std::cout << (pass ? "\nAll checks passed.\n" : "\nSome checks FAILED.\n");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+/* Regression check of periodic boundary conditions: on random periodic 2d and 3d geometries, Stokes flow driven by
+   HGF_PERIODIC_BODY_FORCE and by HGF_PERIODIC_PRESSURE_JUMP must give the same velocities and permeability, with
+   pressures that differ by the drive times x plus a constant. The Poisson model must show the same relation between
+   its two drives. Systems are solved with hgf::solve::matrix_free::gmres, so the check needs no external solver.
+   Build with included CMakeLists.txt, and use:
+     check_periodic
+   Prints the differences and returns nonzero if a check fails.
+*/
+
+#include <vector>
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+
+#include "hgflow.hpp"
+
+#define TOL 1e-8
+
+/* Fills par with a random periodic nx x ny x nz geometry with 25% solid voxels and tight solver tolerances. */
+void
+random_geometry( parameters& par, int nx, int ny, int nz, unsigned seed )
+{
+  par.nx = nx;
+  par.ny = ny;
+  par.nz = nz;
+  par.dimension = nz ? 3 : 2;
+  par.length = 1.2;
+  par.width = 1.0;
+  par.height = nz ? 0.9 : 0.0;
+  par.periodic = 1;
+  par.periodic_drive = 2.0;
+  par.solver_absolute_tolerance = 1e-14;
+  par.solver_relative_tolerance = 1e-12;
+  par.solver_max_iterations = 20000;
+  par.solver_verbose = 0;
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+  par.voxel_geometry.resize(nx * ny * (nz ? nz : 1));
+  for (int ii = 0; ii < (int)par.voxel_geometry.size(); ii++) par.voxel_geometry[ii] = (unif(gen) < 0.25) ? 1 : 0;
+}
+
+/* Largest spread max - min of a - b + drive * x within a region, zero when a and b differ by -drive * x plus a constant
+   in each region. */
+double
+linear_shift_spread( const std::vector< double >& a, const std::vector< double >& b, const std::vector< double >& x, \
+  const std::vector< int >& region, double drive )
+{
+  int n_regions = 1 + *std::max_element(region.begin(), region.end());
+  std::vector< double > low(n_regions, 1e300), high(n_regions, -1e300);
+  double spread = 0;
+  for (size_t ii = 0; ii < x.size(); ii++) {
+    double shift = a[ii] - b[ii] + drive * x[ii];
+    low[region[ii]] = std::min(low[region[ii]], shift);
+    high[region[ii]] = std::max(high[region[ii]], shift);
+  }
+  for (int rr = 0; rr < n_regions; rr++) spread = std::max(spread, high[rr] - low[rr]);
+  return spread;
+}
+
+/* Labels the connected regions of the unknowns coupled by array, whose levels are fixed separately. */
+void
+connected_regions( const std::vector< array_coo >& array, size_t n, std::vector< int >& region )
+{
+  std::vector< std::vector< int > > neighbors(n);
+  for (size_t ii = 0; ii < array.size(); ii++) {
+    if (array[ii].i_index != array[ii].j_index && array[ii].value != 0) neighbors[array[ii].i_index].push_back((int)array[ii].j_index);
+  }
+  region.assign(n, -1);
+  int n_regions = 0;
+  for (size_t seed = 0; seed < n; seed++) {
+    if (region[seed] != -1) continue;
+    std::vector< int > stack(1, (int)seed);
+    region[seed] = n_regions;
+    while (stack.size()) {
+      int cell = stack.back();
+      stack.pop_back();
+      for (size_t jj = 0; jj < neighbors[cell].size(); jj++) {
+        if (region[neighbors[cell][jj]] == -1) {
+          region[neighbors[cell][jj]] = n_regions;
+          stack.push_back(neighbors[cell][jj]);
+        }
+      }
+    }
+    n_regions++;
+  }
+}
+
+/* Runs the checks for one geometry, returns true if they pass. */
+bool
+check_geometry( int nx, int ny, int nz, unsigned seed )
+{
+  parameters par;
+  random_geometry(par, nx, ny, nz, seed);
+  hgf::mesh::voxel msh;
+  msh.build(par);
+  bool pass = true;
+
+  // Stokes, body force then pressure jump
+  hgf::models::stokes stks;
+  stks.build(par, msh);
+  size_t n_vel = stks.velocity_u().size() + stks.velocity_v().size() + stks.velocity_w().size();
+  std::vector< double > stokes_solution[2];
+  double permeability[2];
+  for (int drive = 0; drive < 2; drive++) {
+    hgf::models::stokes_bc bc;
+    stks.setup_periodic_bc(par, msh, 0, drive ? HGF_PERIODIC_PRESSURE_JUMP : HGF_PERIODIC_BODY_FORCE, bc);
+    std::vector< double > diagonal;
+    stks.operator_diagonal(diagonal);
+    stks.solution_int.clear();
+    hgf::solve::matrix_free::gmres(par, [&](const std::vector< double >& x, std::vector< double >& y) { stks.apply(x, y); }, \
+      diagonal, stks.rhs, stks.solution_int, 200);
+    stks.solution_build();
+    stokes_solution[drive] = stks.solution;
+    permeability[drive] = hgf::multiscale::flow::compute_permeability_x(par, stks.pressure_ib_list, \
+      stks.velocity_u(), stks.velocity_v(), stks.velocity_w(), stks.solution);
+  }
+  double velocity_scale = 0, velocity_diff = 0;
+  for (size_t ii = 0; ii < n_vel; ii++) {
+    velocity_scale = std::max(velocity_scale, fabs(stokes_solution[0][ii]));
+    velocity_diff = std::max(velocity_diff, fabs(stokes_solution[0][ii] - stokes_solution[1][ii]));
+  }
+  velocity_diff /= velocity_scale;
+  double permeability_diff = fabs(permeability[0] - permeability[1]) / fabs(permeability[0]);
+  pass = pass && (velocity_diff < TOL) && (permeability_diff < TOL);
+  std::cout << "\n" << par.dimension << "d Stokes, " << stks.rhs.size() << " rows: velocity difference " << velocity_diff \
+            << ", permeability " << permeability[0] << " and " << permeability[1];
+
+  // the pressure level is fixed per connected region, so the linear shift is only compared within one region
+  if (stks.topology->pressure_reference.size() == 1) {
+    std::vector< double > p_body(stokes_solution[0].begin() + n_vel, stokes_solution[0].end());
+    std::vector< double > p_jump(stokes_solution[1].begin() + n_vel, stokes_solution[1].end());
+    std::vector< double > x(p_body.size());
+    for (size_t ii = 0; ii < x.size(); ii++) x[ii] = stks.pressure().coord((int)ii, 0);
+    double spread = linear_shift_spread(p_jump, p_body, x, std::vector< int >(x.size(), 0), par.periodic_drive) \
+                  / (par.periodic_drive * par.length);
+    pass = pass && (spread < TOL);
+    std::cout << ", pressure shift spread " << spread;
+  }
+  std::cout << ((pass) ? "  passed\n" : "  FAILED\n");
+
+  // Poisson, body force then pressure jump
+  std::vector< double > poisson_solution[2], x;
+  std::vector< int > region;
+  for (int drive = 0; drive < 2; drive++) {
+    hgf::models::poisson poiss;
+    poiss.build(par, msh);
+    poiss.set_constant_force(par, 0.0);
+    poiss.setup_periodic_bc(par, msh, 0, drive ? HGF_PERIODIC_PRESSURE_JUMP : HGF_PERIODIC_BODY_FORCE);
+    std::vector< double > diagonal(poiss.rhs.size(), 0.0);
+    for (size_t ii = 0; ii < poiss.coo_array.size(); ii++) {
+      if (poiss.coo_array[ii].i_index == poiss.coo_array[ii].j_index) diagonal[poiss.coo_array[ii].i_index] += poiss.coo_array[ii].value;
+    }
+    hgf::solve::matrix_free::gmres(par, [&](const std::vector< double >& xx, std::vector< double >& y) {
+      y.assign(xx.size(), 0.0);
+      for (size_t ii = 0; ii < poiss.coo_array.size(); ii++) y[poiss.coo_array[ii].i_index] += poiss.coo_array[ii].value * xx[poiss.coo_array[ii].j_index];
+    }, diagonal, poiss.rhs, poisson_solution[drive], 200);
+    connected_regions(poiss.coo_array, poiss.rhs.size(), region);
+    x.resize(poiss.phi.size());
+    for (size_t ii = 0; ii < x.size(); ii++) x[ii] = poiss.phi[ii].coords[0];
+  }
+  double spread = linear_shift_spread(poisson_solution[1], poisson_solution[0], x, region, par.periodic_drive) \
+                / (par.periodic_drive * par.length);
+  bool poisson_pass = (spread < TOL);
+  std::cout << par.dimension << "d Poisson, " << x.size() << " cells in " << 1 + *std::max_element(region.begin(), region.end()) \
+            << " regions: potential shift spread " << spread \
+            << ((poisson_pass) ? "  passed\n" : "  FAILED\n");
+  return pass && poisson_pass;
+}
+
+int
+main( int argc, const char* argv[] )
+{
+  std::cout << "\n//----Checking periodic drives----//\n";
+  bool pass = true;
+  pass = check_geometry(16, 12, 0, 5) && pass;
+  pass = check_geometry(8, 8, 8, 5) && pass;
+  std::cout << (pass ? "\nAll checks passed.\n" : "\nSome checks FAILED.\n");
+  return pass ? 0 : 1;
+}
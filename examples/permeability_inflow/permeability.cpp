@@ -63,15 +63,15 @@ main( int argc, const char* argv[] )
   hgf::solve::paralution::init_solver();
   // block diagonal preconditioner for 3d problem
   if (par.dimension == 3) { 
-    hgf::solve::paralution::solve_ps_flow(par, x_stks.coo_array, x_stks.rhs, x_stks.solution_int, \
-      (int)std::accumulate(x_stks.interior_u.begin(), x_stks.interior_u.end(), 0), \
-      (int)std::accumulate(x_stks.interior_v.begin(), x_stks.interior_v.end(), 0), \
-      (int)std::accumulate(x_stks.interior_w.begin(), x_stks.interior_w.end(), 0), \
-      (int)x_stks.pressure.size());
+    hgf::solve::paralution::solve_ps_flow(par, x_stks.csr_array, x_stks.rhs, x_stks.solution_int, \
+      x_stks.interior_u().count(), \
+      x_stks.interior_v().count(), \
+      x_stks.interior_w().count(), \
+      (int)x_stks.pressure().size());
   }
   // simple GMRES + ILU for 2d
   else { 
-    hgf::solve::paralution::solve(par, x_stks.coo_array, x_stks.rhs, x_stks.solution_int);
+    hgf::solve::paralution::solve(par, x_stks.csr_array, x_stks.rhs, x_stks.solution_int);
   }
   hgf::solve::paralution::finalize_solver();
 
@@ -83,7 +83,7 @@ main( int argc, const char* argv[] )
 
   // compute permeability and print to console
   double permeability = hgf::multiscale::flow::compute_permeability_x( par, \
-    x_stks.pressure_ib_list, x_stks.velocity_u, x_stks.velocity_v, x_stks.velocity_w, x_stks.solution );
+    x_stks.pressure_ib_list, x_stks.velocity_u(), x_stks.velocity_v(), x_stks.velocity_w(), x_stks.solution );
   std::cout << "\nX permeability = " << permeability << "\n";
 
   // save the x-flow solution for visualization with paraview
@@ -43,66 +43,54 @@ main( int argc, const char* argv[] )
   rebegin = omp_get_wtime();
 
   //--- example stokes solve ---//
-  hgf::models::stokes x_stks;
+  hgf::models::stokes stks;
   // build the degrees of freedom and the array for interior cells and initializes viscosity to 1.0
-  x_stks.build(par, msh);
+  stks.build(par, msh);
   // if viscosity != 1, set after build
-  // x_stks.viscosity = 0.5;
+  // stks.viscosity = 0.5;
 
   // add penalty for immersed boundary cells
   double eta = 1e-5;
-  x_stks.immersed_boundary(par, eta);
+  stks.immersed_boundary(par, eta);
 
-  // create copies for y and z flows
-  hgf::models::stokes y_stks, z_stks;
-  y_stks = x_stks;
-  z_stks = x_stks;
-  // set up boundary conditions
+  // set up boundary conditions for each flow direction in one pass, all directions share the interior operator of stks
   HGF_INFLOW INFLOW = HGF_INFLOW_PARABOLIC;
-  x_stks.setup_xflow_bc(par, msh, INFLOW);
-  y_stks.setup_yflow_bc(par, msh, INFLOW);
-  if (par.dimension == 3) z_stks.setup_zflow_bc(par, msh, INFLOW);
+  std::vector< int > directions(par.dimension);
+  for (int dd = 0; dd < par.dimension; dd++) directions[dd] = dd;
+  std::vector< hgf::models::stokes_bc > flow_bc;
+  stks.setup_flow_bc(par, msh, directions, INFLOW, flow_bc);
 
   build_time = omp_get_wtime() - rebegin;
   rebegin = omp_get_wtime();
 
-  // Solve with Paralution
+  // Solve with Paralution, one direction at a time
+  std::vector< std::vector< double > > flow_solution(3);
   hgf::solve::paralution::init_solver();
-  if (par.dimension == 3) { // block diagonal preconditioner for 3d problem
-    hgf::solve::paralution::solve_ps_flow(par, x_stks.coo_array, x_stks.rhs, x_stks.solution_int, \
-      (int)std::accumulate(x_stks.interior_u.begin(), x_stks.interior_u.end(), 0), \
-      (int)std::accumulate(x_stks.interior_v.begin(), x_stks.interior_v.end(), 0), \
-      (int)std::accumulate(x_stks.interior_w.begin(), x_stks.interior_w.end(), 0), \
-      (int)x_stks.pressure.size());
-    hgf::solve::paralution::solve_ps_flow(par, y_stks.coo_array, y_stks.rhs, y_stks.solution_int, \
-      (int)std::accumulate(y_stks.interior_u.begin(), y_stks.interior_u.end(), 0), \
-      (int)std::accumulate(y_stks.interior_v.begin(), y_stks.interior_v.end(), 0), \
-      (int)std::accumulate(y_stks.interior_w.begin(), y_stks.interior_w.end(), 0), \
-      (int)y_stks.pressure.size());
-    hgf::solve::paralution::solve_ps_flow(par, z_stks.coo_array, z_stks.rhs, z_stks.solution_int, \
-      (int)std::accumulate(z_stks.interior_u.begin(), z_stks.interior_u.end(), 0), \
-      (int)std::accumulate(z_stks.interior_v.begin(), z_stks.interior_v.end(), 0), \
-      (int)std::accumulate(z_stks.interior_w.begin(), z_stks.interior_w.end(), 0), \
-      (int)x_stks.pressure.size());
-  }
-  else { // simple GMRES + ILU for 2d
-    hgf::solve::paralution::solve(par, x_stks.coo_array, x_stks.rhs, x_stks.solution_int);
-    hgf::solve::paralution::solve(par, y_stks.coo_array, y_stks.rhs, y_stks.solution_int);
+  for (int dd = 0; dd < par.dimension; dd++) {
+    stks.select_bc(flow_bc[dd]);
+    if (par.dimension == 3) { // block diagonal preconditioner for 3d problem
+      hgf::solve::paralution::solve_ps_flow(par, stks.csr_array, stks.rhs, stks.solution_int, \
+        stks.interior_u().count(), \
+        stks.interior_v().count(), \
+        stks.interior_w().count(), \
+        (int)stks.pressure().size());
+    }
+    else { // simple GMRES + ILU for 2d
+      hgf::solve::paralution::solve(par, stks.csr_array, stks.rhs, stks.solution_int);
+    }
+    stks.solution_build();  // fills in solution vector with solution of linear system + boundary values
+    flow_solution[dd] = stks.solution;
   }
   hgf::solve::paralution::finalize_solver();
 
   solve_time = omp_get_wtime() - rebegin;
   rebegin = omp_get_wtime();
 
-  x_stks.solution_build();  // fills in solution vector with solution of linear system + boundary values
-  y_stks.solution_build();
-  if (par.dimension == 3) z_stks.solution_build();
-
   // compute permeability and print to console
   std::vector< double > permeability;
   hgf::multiscale::flow::compute_permeability_tensor( par, \
-    x_stks.pressure_ib_list, x_stks.velocity_u, x_stks.velocity_v, x_stks.velocity_w, \
-    x_stks.solution, y_stks.solution, z_stks.solution, permeability);
+    stks.pressure_ib_list, stks.velocity_u(), stks.velocity_v(), stks.velocity_w(), \
+    flow_solution[0], flow_solution[1], flow_solution[2], permeability);
   std::cout << "Permeability Tensor=\n";
   for (int jj = 0; jj < par.dimension; jj++) {
     for (int ii = 0; ii < par.dimension; ii++)
@@ -115,7 +103,8 @@ main( int argc, const char* argv[] )
 
   // save the x-flow solution for visualization
   std::string file_name = "Solution_x_tensor";
-  x_stks.output_vtk(par, msh, file_name);
+  stks.solution = flow_solution[0];
+  stks.output_vtk(par, msh, file_name);
 
   postp_time = omp_get_wtime() - rebegin;
   total_time = omp_get_wtime() - begin;
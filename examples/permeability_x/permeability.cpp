@@ -56,6 +56,11 @@ main( int argc, const char* argv[] )
   HGF_INFLOW INFLOW = HGF_INFLOW_PARABOLIC;
   x_stks.setup_xflow_bc(par, msh, INFLOW);
 
+  // drop unknowns enclosed by the immersed boundary from the linear system
+  x_stks.eliminate_immersed_boundary();
+  hgf_index n_u, n_v, n_w, n_p;
+  x_stks.block_sizes(n_u, n_v, n_w, n_p);
+
   build_time = omp_get_wtime() - rebegin;
   rebegin = omp_get_wtime();
 
@@ -63,15 +68,12 @@ main( int argc, const char* argv[] )
   hgf::solve::paralution::init_solver();
   // block diagonal preconditioner for 3d problem
   if (par.dimension == 3) { 
-    hgf::solve::paralution::solve_ps_flow(par, x_stks.coo_array, x_stks.rhs, x_stks.solution_int, \
-      (int)std::accumulate(x_stks.interior_u.begin(), x_stks.interior_u.end(), 0), \
-      (int)std::accumulate(x_stks.interior_v.begin(), x_stks.interior_v.end(), 0), \
-      (int)std::accumulate(x_stks.interior_w.begin(), x_stks.interior_w.end(), 0), \
-      (int)x_stks.pressure.size());
+    hgf::solve::paralution::solve_ps_flow(par, x_stks.csr_array, x_stks.rhs, x_stks.solution_int, \
+      n_u, n_v, n_w, n_p);
   }
   // simple GMRES + ILU for 2d
   else { 
-    hgf::solve::paralution::solve(par, x_stks.coo_array, x_stks.rhs, x_stks.solution_int);
+    hgf::solve::paralution::solve(par, x_stks.csr_array, x_stks.rhs, x_stks.solution_int);
   }
   hgf::solve::paralution::finalize_solver();
 
@@ -83,7 +85,7 @@ main( int argc, const char* argv[] )
 
   // compute permeability and print to console
   double permeability = hgf::multiscale::flow::compute_permeability_x( par, \
-    x_stks.pressure_ib_list, x_stks.velocity_u, x_stks.velocity_v, x_stks.velocity_w, x_stks.solution );
+    x_stks.pressure_ib_list, x_stks.velocity_u(), x_stks.velocity_v(), x_stks.velocity_w(), x_stks.solution );
   std::cout << "\nX permeability = " << permeability << "\n";
 
   // save the x-flow solution for visualization with paraview
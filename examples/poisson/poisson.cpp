@@ -73,10 +73,8 @@ main( int argc, const char* argv[] )
   build_time = omp_get_wtime() - rebegin;
   rebegin = omp_get_wtime();
 
-  // solve with Paralution
-  hgf::solve::paralution::init_solver();
-  hgf::solve::paralution::solve(par, poiss.coo_array, poiss.rhs, poiss.solution);
-  hgf::solve::paralution::finalize_solver();
+  // solve with multigrid preconditioned conjugate gradients
+  hgf::solve::multigrid::solve(par, poiss.coo_array, poiss.rhs, poiss.solution);
 
   solve_time = omp_get_wtime() - rebegin;
   rebegin = omp_get_wtime();
@@ -3,6 +3,7 @@
 
 // system includes
 #include <vector>
+#include <string>
 
 namespace hgf
 {
@@ -21,6 +22,7 @@ namespace hgf
         std::vector< int > gtlNode;                         /**< Global to local node map. */
         void build( parameters& par);
         void printVTK(const parameters& par);
+        void output_vtk(const parameters& par, const std::vector< double >& cell_data, const std::string& data_name, std::string& file_name);
       private:
         void build_from_voxel_quad( parameters& par);
         void build_from_voxel_hex(parameters& par);
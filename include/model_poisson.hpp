@@ -23,8 +23,23 @@ namespace hgf
    */
   namespace models
   {
+    /** \brief Faces of a Poisson model on the domain boundary or a solid wall, where boundary conditions are set.
+     *
+     * Produced by hgf::models::poisson::boundary_faces, so boundary values can be computed for all faces in one call
+     * and passed to the array overloads of hgf::models::poisson::setup_mixed_bc and add_nonhomogeneous_bc.
+     */
+    struct poisson_boundary
+    {
+      std::vector< int > cell;                                      /**< Cell owning each boundary face. */
+      std::vector< int > face;                                      /**< Neighbor slot of each boundary face within its cell. */
+      std::vector< double > coords;                                 /**< Midpoint of each boundary face, 3 coordinates per face. */
+      std::vector< int > first;                                     /**< Faces of boundary_cells[i] are first[i] to first[i + 1] - 1. */
+      int size(void) const { return (int)cell.size(); }
+    };
+
     /** \brief Contains functionality for setup and post-processessing the solution of the Poisson equation in 2d or 3d.
-     * 
+     *
+     * Degrees of freedom and assembly loops use int indices, HGF_INDEX_64 only widens the entries of coo_array.
      */
     class poisson
     {
@@ -37,6 +52,7 @@ namespace hgf
         std::vector< double > solution;                               /**< Vector for storing full solution. */
         std::vector< std::vector< double > > alpha;                   /**< Coefficient tensor. */
         std::vector< std::vector< int > > bc_types;                   /**< Array of boundary types. */
+        std::vector< int > boundary_cells;                            /**< Cells with a face on the domain boundary or a solid wall, the only cells boundary conditions change. */
         void build(const parameters& par, const hgf::mesh::voxel& msh);
         void output_vtk(const parameters& par, const hgf::mesh::voxel& msh, std::string& file_name);
         void set_constant_force(const parameters& par, const double& force_in);
@@ -44,24 +60,79 @@ namespace hgf
         void set_constant_tensor_alpha(const parameters& par, const hgf::mesh::voxel& msh, const std::vector< double >& alpha_in);
         void setup_dirichlet_bc(const parameters& par, const hgf::mesh::voxel& msh);
         void setup_mixed_bc(const parameters& par, const hgf::mesh::voxel& msh, bool (*is_dirichlet)( const parameters& par, int dof_num, double coords[3] ));
+        void setup_mixed_bc(const parameters& par, const hgf::mesh::voxel& msh, const poisson_boundary& faces, const std::vector< int >& dirichlet);
+        template< typename IS_DIRICHLET >
+        void setup_mixed_bc(const parameters& par, const hgf::mesh::voxel& msh, IS_DIRICHLET is_dirichlet);
         void add_nonhomogeneous_bc(const parameters& par, const hgf::mesh::voxel& msh, double (*bc_value)( const parameters& par, int dof_num, double coords[3] ));
+        void add_nonhomogeneous_bc(const parameters& par, const hgf::mesh::voxel& msh, const poisson_boundary& faces, const std::vector< double >& values);
+        template< typename BC_VALUE >
+        void add_nonhomogeneous_bc(const parameters& par, const hgf::mesh::voxel& msh, BC_VALUE bc_value);
+        void boundary_faces(const parameters& par, const hgf::mesh::voxel& msh, poisson_boundary& faces) const;
+        void setup_periodic_bc(const parameters& par, const hgf::mesh::voxel& msh, int direction, const HGF_PERIODIC& DRIVE);
     
       private:
 
-        int NTHREADS, block_size;
+        int NTHREADS, block_size, boundary_block_size;
+        std::vector< int > reference_cells;  // one cell of each connected region of a periodic problem
         
         void build_degrees_of_freedom_2d(const parameters& par, const hgf::mesh::voxel& msh);
         void dof_neighbors_2d(const parameters& par, const hgf::mesh::voxel& msh);
         void build_array_2d(const parameters& par, const hgf::mesh::voxel& msh);
         void homogeneous_dirichlet_2d(const parameters& par, const hgf::mesh::voxel& msh);
-        void homogeneous_mixed_2d(const parameters& par, const hgf::mesh::voxel& msh, bool (*is_dirichlet)( const parameters& par, int dof_num, double coords[3] ));
 
         void build_degrees_of_freedom_3d(const parameters& par, const hgf::mesh::voxel& msh);
         void dof_neighbors_3d(const parameters& par, const hgf::mesh::voxel& msh);
         void build_array_3d(const parameters& par, const hgf::mesh::voxel& msh);
         void homogeneous_dirichlet_3d(const parameters& par, const hgf::mesh::voxel& msh);
-        void homogeneous_mixed_3d(const parameters& par, const hgf::mesh::voxel& msh, bool (*is_dirichlet)( const parameters& par, int dof_num, double coords[3] ));
     };
+
+    /** \brief hgf::models::poisson::setup_mixed_bc sets up mixed Dirichlet and Neumann boundary conditions from a function object.
+     *
+     * Same as the function pointer overload, but is_dirichlet may be any callable, e.g. a lambda, with the signature
+     * bool(const parameters& par, int dof_num, double coords[3]). It is called for all boundary faces in one parallel
+     * loop over the list of hgf::models::poisson::boundary_faces, where the compiler can inline it, so it must be thread safe.
+     * @param[in] par - parameters struct containing problem information.
+     * @param[in] msh - mesh object containing a quadrilateral or hexagonal representation of geometry from problem folder addressed in parameters& par.
+     * @param[in] is_dirichlet - returns true if the boundary face at coords has a Dirichlet condition, false for Neumann.
+     */
+    template< typename IS_DIRICHLET >
+    void
+    poisson::setup_mixed_bc(const parameters& par, const hgf::mesh::voxel& msh, IS_DIRICHLET is_dirichlet)
+    {
+      poisson_boundary faces;
+      boundary_faces(par, msh, faces);
+      std::vector< int > dirichlet(faces.size());
+#pragma omp parallel for schedule(static) num_threads(NTHREADS)
+      for (int ii = 0; ii < faces.size(); ii++) {
+        double coords[3] = { faces.coords[3 * ii], faces.coords[3 * ii + 1], faces.coords[3 * ii + 2] };
+        dirichlet[ii] = is_dirichlet(par, faces.cell[ii], coords) ? 1 : 0;
+      }
+      setup_mixed_bc(par, msh, faces, dirichlet);
+    }
+
+    /** \brief hgf::models::poisson::add_nonhomogeneous_bc adds nonhomogeneous Dirichlet and Neumann values from a function object to the force vector.
+     *
+     * Same as the function pointer overload, but bc_value may be any callable, e.g. a lambda, with the signature
+     * double(const parameters& par, int dof_num, double coords[3]). It is called for all boundary faces in one parallel
+     * loop over the list of hgf::models::poisson::boundary_faces, where the compiler can inline it, so it must be thread safe.
+     * @param[in] par - parameters struct containing problem information.
+     * @param[in] msh - mesh object containing a quadrilateral or hexagonal representation of geometry from problem folder addressed in parameters& par.
+     * @param[in] bc_value - returns the boundary value of the face at coords.
+     */
+    template< typename BC_VALUE >
+    void
+    poisson::add_nonhomogeneous_bc(const parameters& par, const hgf::mesh::voxel& msh, BC_VALUE bc_value)
+    {
+      poisson_boundary faces;
+      boundary_faces(par, msh, faces);
+      std::vector< double > values(faces.size());
+#pragma omp parallel for schedule(static) num_threads(NTHREADS)
+      for (int ii = 0; ii < faces.size(); ii++) {
+        double coords[3] = { faces.coords[3 * ii], faces.coords[3 * ii + 1], faces.coords[3 * ii + 2] };
+        values[ii] = bc_value(par, faces.cell[ii], coords);
+      }
+      add_nonhomogeneous_bc(par, msh, faces, values);
+    }
   }
 }
 
@@ -23,6 +23,7 @@ namespace hgf
 
         std::vector< degree_of_freedom > pressure;             /**< Degrees of freedom associated with the fluid pressure. */
         std::vector< double > permeability;                    /**< Vector of permeabilities in P-N model throats */
+        std::vector< int > boundary_pores;                     /**< Pores on the boundary of the network, the only rows boundary conditions set. */
         std::vector< array_coo > coo_array;                    /**< Linear system associated to the P-N problem stored in COO (coordinate) sparse format */
         std::vector< double > rhs;                             /**< Right-hand side vector (force). */
         std::vector< double > solution;                        /**< Vector for P-N solution */
@@ -36,6 +37,33 @@ namespace hgf
         void output_vtk(const parameters& par);
 
     };
+
+    /** \brief Contains functionality for extracting a porenetwork from a voxel geometry, and setup and post-processing of flow on that network.
+     *
+     */
+    class extracted_porenetwork
+    {
+
+      public:
+
+        std::vector< network_pore > pores;                     /**< Pores of the extracted network. */
+        std::vector< network_throat > throats;                 /**< Throats of the extracted network. */
+        std::vector< int > pore_throat_ptr;                    /**< Offsets into pore_throat_list, pore_throat_ptr[ii] is the first throat of pore ii. */
+        std::vector< int > pore_throat_list;                   /**< Throat numbers attached to each pore, grouped by pore. */
+        std::vector< int > boundary_pores;                     /**< Pores touching a domain face, the only rows boundary conditions set. */
+        std::vector< array_coo > coo_array;                    /**< Linear system associated to the P-N problem stored in COO (coordinate) sparse format */
+        std::vector< double > rhs;                             /**< Right-hand side vector (force). */
+        std::vector< double > solution;                        /**< Vector for P-N solution */
+        double viscosity = 1.0;                                /**< Viscosity of the fluid. Defaults to 1 */
+        void extract_network(const parameters& par);
+        void build(const parameters& par);
+        void setup_xflow_bc(const parameters& par);
+        void setup_yflow_bc(const parameters& par);
+        void setup_zflow_bc(const parameters& par);
+        double upscaled_permeability(const parameters& par, int direction);
+        void output_vtk(const parameters& par);
+
+    };
   }
 }
 
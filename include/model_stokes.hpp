@@ -11,6 +11,7 @@
 #include <math.h>
 #include <algorithm>
 #include <numeric>
+#include <memory>
 #include <boost/filesystem.hpp>
 
 namespace hgf
@@ -21,6 +22,46 @@ namespace hgf
    */
   namespace models
   {
+    /** \brief Boundary conditions of one flow direction, stored apart from the interior operator they modify.
+     *
+     * Produced by hgf::models::stokes::setup_flow_bc and made active with hgf::models::stokes::select_bc, so several
+     * flow directions can be solved with one interior operator instead of one copy of the model per direction.
+     */
+    struct stokes_bc
+    {
+      int direction = -1;                                           /**< Flow direction, 0, 1 or 2 for x, y or z. */
+      std::vector< array_coo > delta;                               /**< Entries added to the linear system by the boundary conditions. */
+      std::vector< double > rhs;                                    /**< Right-hand side vector (force) for this direction. */
+      std::vector< int > boundary_index;                            /**< Velocity degrees of freedom carrying a boundary value, in solution ordering. */
+      std::vector< boundary_nodes > boundary_value;                 /**< Boundary type and value of each degree of freedom in boundary_index. */
+    };
+
+    /** \brief Degrees of freedom and their numbering for a Stokes problem, fixed once built from a geometry.
+     *
+     * Held by hgf::models::stokes through a reference counted pointer, so copies of a model and models built with
+     * hgf::models::stokes::build(par, topology) share one topology and only duplicate their per-solve state.
+     */
+    struct stokes_topology
+    {
+      dof_store velocity_u;                                         /**< Degrees of freedom associated with the x-component of the fluid velocity. */
+      dof_store velocity_v;                                         /**< Degrees of freedom associated with the y-component of the fluid velocity. */
+      dof_store velocity_w;                                         /**< Degrees of freedom associated with the z-component of the fluid velocity. */
+      dof_store pressure;                                           /**< Degrees of freedom associated with the fluid pressure. */
+      bit_flags interior_u;                                         /**< If interior_u[i] == 1, then velocity_u[i] is an internal degree of freedom. */
+      bit_flags interior_v;                                         /**< If interior_v[i] == 1, then velocity_v[i] is an internal degree of freedom. */
+      bit_flags interior_w;                                         /**< If interior_w[i] == 1, then velocity_w[i] is an internal degree of freedom. */
+      std::vector< int > interior_u_nums;                           /**< Row of each velocity_u degree of freedom in the linear system, -1 if not interior. */
+      std::vector< int > interior_v_nums;                           /**< Row of each velocity_v degree of freedom among the v rows, -1 if not interior. */
+      std::vector< int > interior_w_nums;                           /**< Row of each velocity_w degree of freedom among the w rows, -1 if not interior. */
+      std::vector< int > ptv;                                       /**< Velocity degrees of freedom on the faces of each pressure cell, 2 * dimension per cell. */
+      std::vector< int > boundary_u;                                /**< Interior velocity_u degrees of freedom with a neighbor that is not interior, the only ones boundary conditions change. */
+      std::vector< int > boundary_v;                                /**< Interior velocity_v degrees of freedom with a neighbor that is not interior. */
+      std::vector< int > boundary_w;                                /**< Interior velocity_w degrees of freedom with a neighbor that is not interior. */
+      std::vector< int > boundary_pressure;                         /**< Pressure cells with a face velocity that is not interior. */
+      double period[3] = { 0, 0, 0 };                               /**< Extent of the domain along each axis if the topology is periodic, 0 otherwise. */
+      std::vector< int > pressure_reference;                        /**< One pressure cell of each connected fluid region of a periodic topology, where the pressure level is fixed. */
+    };
+
     /** \brief Contains functionality for setup and post-processessing the solution of Stokes fluid flow models in 2d or 3d.
      * 
      */
@@ -29,20 +70,25 @@ namespace hgf
 
       public:
       
-        std::vector< degree_of_freedom > velocity_u;                  /**< Degrees of freedom associated with the x-component of the fluid velocity. */
-        std::vector< degree_of_freedom > velocity_v;                  /**< Degrees of freedom associated with the y-component of the fluid velocity. */
-        std::vector< degree_of_freedom > velocity_w;                  /**< Degrees of freedom associated with the z-component of the fluid velocity. */
-        std::vector< degree_of_freedom > pressure;                    /**< Degrees of freedom associated with the fluid pressure. */
-        std::vector< int > interior_u;                                /**< If interior_u[i] == 1, then velocity_u[i] is an internal degree of freedom. */
-        std::vector< int > interior_v;                                /**< If interior_v[i] == 1, then velocity_v[i] is an internal degree of freedom. */
-        std::vector< int > interior_w;                                /**< If interior_w[i] == 1, then velocity_w[i] is an internal degree of freedom. */
+        std::shared_ptr< const stokes_topology > topology;            /**< Degrees of freedom, shared by models built on the same geometry. */
+        const dof_store& velocity_u(void) const { return topology->velocity_u; }
+        const dof_store& velocity_v(void) const { return topology->velocity_v; }
+        const dof_store& velocity_w(void) const { return topology->velocity_w; }
+        const dof_store& pressure(void) const { return topology->pressure; }
+        const bit_flags& interior_u(void) const { return topology->interior_u; }
+        const bit_flags& interior_v(void) const { return topology->interior_v; }
+        const bit_flags& interior_w(void) const { return topology->interior_w; }
         std::vector< int > pressure_ib_list;                          /**< If pressure_ib_list[i] == 1, then pressure[i] and it's associated staggered velocity components are immersed boundary cells */
-        std::vector< array_coo > coo_array;                           /**< Linear system associated to the Stokes' problem stored in COO (coordinate) sparse format */
+        array_csr csr_array;                                          /**< Linear system associated to the Stokes' problem stored in CSR (compressed sparse row) format */
         std::vector< double > rhs;                                    /**< Right-hand side vector (force). */
         std::vector< double > solution;                               /**< Vector for storing full solution, including interior and boundary DOFs. */
-        std::vector< double > solution_int;                           /**< Vector for storing solution for interior DOFs. Corresponds to produced coo_array and RHS, which are built with boundary DOFs eliminated. */
+        std::vector< double > solution_int;                           /**< Vector for storing solution for interior DOFs. Corresponds to produced csr_array and RHS, which are built with boundary DOFs eliminated. */
         double viscosity;                                             /**< Viscosity of the fluid. */
-        void build(const parameters& par, const hgf::mesh::voxel& msh);
+        void build(const parameters& par, const hgf::mesh::voxel& msh, int assemble = 1);
+        void build(const parameters& par, const std::shared_ptr< const stokes_topology >& shared_topology, int assemble = 1);
+        void apply(const std::vector< double >& x, std::vector< double >& y) const;
+        void operator_diagonal(std::vector< double >& diagonal) const;
+        void reassemble(double new_viscosity, double new_eta);
         void solution_build(void);
         void check_divergence(const parameters& par, const hgf::mesh::voxel& msh, int print, std::vector<double>& info, std::string& file_name);
         void output_vtk(const parameters& par, const hgf::mesh::voxel& msh, std::string& file_name);
@@ -51,32 +97,58 @@ namespace hgf
         void setup_xflow_bc(const parameters& par, const hgf::mesh::voxel& msh, const HGF_INFLOW& INFLOW_TYPE);
         void setup_yflow_bc(const parameters& par, const hgf::mesh::voxel& msh, const HGF_INFLOW& INFLOW_TYPE);
         void setup_zflow_bc(const parameters& par, const hgf::mesh::voxel& msh, const HGF_INFLOW& INFLOW_TYPE);
+        void setup_flow_bc(const parameters& par, const hgf::mesh::voxel& msh, int direction, const HGF_INFLOW& INFLOW_TYPE, stokes_bc& bc);
+        void setup_flow_bc(const parameters& par, const hgf::mesh::voxel& msh, const std::vector< int >& directions, const HGF_INFLOW& INFLOW_TYPE, std::vector< stokes_bc >& bc);
+        void setup_periodic_bc(const parameters& par, const hgf::mesh::voxel& msh, int direction, const HGF_PERIODIC& DRIVE);
+        void setup_periodic_bc(const parameters& par, const hgf::mesh::voxel& msh, int direction, const HGF_PERIODIC& DRIVE, stokes_bc& bc);
+        void select_bc(const stokes_bc& bc);
+        void clear_bc(void);
         void random_immersed_boundary(const parameters& par, double eta, double vol_frac);
         int random_immersed_boundary_clump(const parameters& par, double eta, double vol_frac, double likelihood);
         void immersed_boundary(const parameters& par, double eta);
+        void add_immersed_boundary(const std::vector< int >& cells, double eta);
+        void remove_immersed_boundary(const std::vector< int >& cells);
+        void eliminate_immersed_boundary(void);
+        void block_sizes(hgf_index& n_u, hgf_index& n_v, hgf_index& n_w, hgf_index& n_p) const;
         void import_immersed_boundary(parameters& par, std::vector< int >& input_ib, double eta);
+        void brinkman(const std::vector< double >& permeability);
+        void import_brinkman(const parameters& par, const std::string& file_name);
     
       private:
         
         std::vector< boundary_nodes > boundary;                    
-        std::vector< int > interior_u_nums, interior_v_nums, interior_w_nums;
-        std::vector< int > ptv;
-        void build_degrees_of_freedom_2d(const parameters& par, const hgf::mesh::voxel& msh);
-        void dof_neighbors_2d(const parameters& par, const hgf::mesh::voxel& msh);
-        void build_array_2d(const parameters& par, const hgf::mesh::voxel& msh);
+        enum { SRC_DIAGONAL = 6, SRC_PRESSURE_LOWER = 7, SRC_PRESSURE_UPPER = 8, SRC_CONTINUITY = 9, SRC_NONE = 15 };
+        std::vector< unsigned char > csr_source;  // interior stencil term behind each csr_array nonzero, neighbor slot 0-5 or SRC_*
+        array_csr operator_delta;
+        std::vector< array_coo > active_bc;
+        std::vector< double > ib_penalty;  // summed penalty of the immersed boundary cells penalizing each velocity row
+        std::vector< double > ib_cell_penalty;  // penalty 1/eta of each immersed boundary cell, zero for fluid cells
+        std::vector< double > brinkman_drag;  // Brinkman drag of each velocity row per unit viscosity, empty without Brinkman cells
+        std::vector< hgf_index > reduced_rows;  // row of each full system row after eliminate_immersed_boundary, -1 if eliminated
+        hgf_index reduced_block[4];
+        void require_full_system(const char* name) const;
+        void add_operator_entries(const std::vector< array_coo >& entries);
+        void add_bc_entries(const std::vector< array_coo >& entries);
+        void merge_bc(const stokes_bc& bc);
+        void penalize_cells(const std::vector< int >& cells, int sign);
+        void build_state(const parameters& par, int assemble);
+        void build_boundary_lists(stokes_topology& topo);
+        void build_degrees_of_freedom_2d(const parameters& par, const hgf::mesh::voxel& msh, stokes_topology& topo);
+        void dof_neighbors_2d(const parameters& par, const hgf::mesh::voxel& msh, stokes_topology& topo);
+        void build_array_2d(void);
         void momentum_2d(void);
         void continuity_2d(void);
         void xflow_2d(const parameters& par, const hgf::mesh::voxel& msh, const HGF_INFLOW& INFLOW_TYPE);
         void yflow_2d(const parameters& par, const hgf::mesh::voxel& msh, const HGF_INFLOW& INFLOW_TYPE);
 
-        void build_degrees_of_freedom_3d(const parameters& par, const hgf::mesh::voxel& msh);
-        void dof_neighbors_3d(const parameters& par, const hgf::mesh::voxel& msh);
-        void build_array_3d(const parameters& par, const hgf::mesh::voxel& msh);
+        void build_degrees_of_freedom_3d(const parameters& par, const hgf::mesh::voxel& msh, stokes_topology& topo);
+        void dof_neighbors_3d(const parameters& par, const hgf::mesh::voxel& msh, stokes_topology& topo);
+        void build_array_3d(void);
         void momentum_3d(void);
         void continuity_3d(void);
-        void xflow_3d(const parameters& par, const hgf::mesh::voxel& msh, const HGF_INFLOW& INFLOW_TYPE);
-        void yflow_3d(const parameters& par, const hgf::mesh::voxel& msh, const HGF_INFLOW& INFLOW_TYPE);
-        void zflow_3d(const parameters& par, const hgf::mesh::voxel& msh, const HGF_INFLOW& INFLOW_TYPE);
+        void flow_bc_3d(const parameters& par, const std::vector< int >& directions, const HGF_INFLOW& INFLOW_TYPE, std::vector< stokes_bc >& bc) const;
+        void flow_3d(const parameters& par, int direction, const HGF_INFLOW& INFLOW_TYPE);
+        void periodic_bc(const parameters& par, int direction, const HGF_PERIODIC& DRIVE, stokes_bc& bc) const;
 
     };
   }
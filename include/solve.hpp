@@ -3,5 +3,7 @@
 #define _SOLVE_H
 
 #include "solve_paralution.hpp"
+#include "solve_matrix_free.hpp"
+#include "solve_multigrid.hpp"
 
 #endif
@@ -0,0 +1,34 @@
+#ifndef _SOLVE_MATRIX_FREE_H
+#define _SOLVE_MATRIX_FREE_H
+
+#include "hgflow.hpp"
+
+// system includes
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#include <omp.h>
+
+namespace hgf
+{
+  namespace solve
+  {
+    /** \brief Contains Krylov solvers that only access the linear system through an operator apply.
+     * 
+     */
+    namespace matrix_free
+    {
+      typedef std::function< void(const std::vector< double >&, std::vector< double >&) > linear_operator; /**< Computes y = A x, resizing y if needed. */
+      int gmres(const parameters& par, \
+        const linear_operator& op, \
+        const std::vector< double >& diagonal, \
+        const std::vector< double >& rhs, \
+        std::vector< double >& solution, \
+        int restart = 30);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef _SOLVE_MULTIGRID_H
+#define _SOLVE_MULTIGRID_H
+
+#include "hgflow.hpp"
+
+// system includes
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#include <omp.h>
+
+namespace hgf
+{
+  namespace solve
+  {
+    /** \brief Contains a geometric multigrid solver for cell-centered systems on the voxel lattice, such as the Poisson model.
+     *
+     */
+    namespace multigrid
+    {
+      /** \brief Multigrid hierarchy of a cell-centered system with one unknown per non-solid voxel of par.voxel_geometry.
+       *
+       * Each coarse cell is the union of a 2x2(x2) block of lattice cells, and exists if any cell of the block is an unknown,
+       * so solid voxels coarsen away with the mask. Coarse operators are Galerkin products with piecewise constant
+       * interpolation, scaled by one half to match a rediscretization of a 5 or 7-point stencil. Levels are smoothed with
+       * red-black Gauss-Seidel, and the coarsest level is solved directly.
+       */
+      class hierarchy
+      {
+      public:
+        void build(const parameters& par, const std::vector< array_coo >& array);
+        void build(const parameters& par, const array_csr& array);
+        void vcycle(const std::vector< double >& residual, std::vector< double >& correction);
+        int solve(const parameters& par, const std::vector< double >& rhs, std::vector< double >& solution);
+        void clear(void);
+        int levels(void) const { return (int)grid.size(); } /**< Number of levels in the hierarchy, including the finest. */
+      private:
+        struct level
+        {
+          int lattice[3];                             /**< Number of lattice cells along each axis. */
+          array_csr op;                               /**< Operator of the level, rows sorted by column. */
+          std::vector< double > inv_diag;             /**< Inverse diagonal of op. */
+          std::vector< int32_t > position;            /**< Lattice index of each unknown, x fastest. */
+          std::vector< std::vector< int > > colors;   /**< Unknowns of each smoother color; no two unknowns of a color are coupled. */
+          std::vector< int > coarse;                  /**< Unknown of the next level containing each unknown, empty on the coarsest level. */
+          std::vector< int > aggregate_ptr;           /**< Unknowns in unknown I of the next level are aggregate[aggregate_ptr[I]] to aggregate[aggregate_ptr[I + 1] - 1]. */
+          std::vector< int > aggregate;               /**< Unknowns of this level grouped by the unknown of the next level containing them. */
+          std::vector< double > rhs;                  /**< Right-hand side of the level within a cycle. */
+          std::vector< double > sol;                  /**< Correction of the level within a cycle. */
+          std::vector< double > res;                  /**< Residual of the level within a cycle. */
+        };
+        std::vector< level > grid;                    /**< Levels from finest to coarsest. */
+        std::vector< double > lu;                     /**< Dense LU factors of the coarsest operator. */
+        std::vector< int > pivot;                     /**< Row pivots of the dense LU factors. */
+        void setup(const parameters& par);
+        void smooth(level& lvl, bool forward);
+        void cycle(int depth);
+      };
+
+      int solve(const parameters& par, \
+        const std::vector< array_coo >& array, \
+        const std::vector< double >& rhs, \
+        std::vector< double >& solution);
+    }
+  }
+}
+
+#endif
@@ -5,6 +5,8 @@
 
 // system includes
 #include <vector>
+#include <climits>
+#include <memory>
 #include <paralution.hpp>
 #include <omp.h>
 
@@ -26,11 +28,60 @@ namespace hgf
         const std::vector< array_coo >& array, \
         const std::vector< double >& rhs, \
         std::vector<double>& solution);
+      void solve(const parameters& par, \
+        const array_csr& array, \
+        const std::vector< double >& rhs, \
+        std::vector<double>& solution);
+      void solve(const parameters& par, \
+        array_csr& array, \
+        std::vector< double >& rhs, \
+        std::vector<double>& solution);
       void solve_ps_flow(const parameters& par, \
         const std::vector< array_coo >& array, \
         const std::vector< double >& rhs, \
         std::vector<double>& solution, \
-        int n_u, int n_v, int n_w, int n_p);
+        hgf_index n_u, hgf_index n_v, hgf_index n_w, hgf_index n_p);
+      void solve_ps_flow(const parameters& par, \
+        const array_csr& array, \
+        const std::vector< double >& rhs, \
+        std::vector<double>& solution, \
+        hgf_index n_u, hgf_index n_v, hgf_index n_w, hgf_index n_p);
+      void solve_ps_flow(const parameters& par, \
+        array_csr& array, \
+        std::vector< double >& rhs, \
+        std::vector<double>& solution, \
+        hgf_index n_u, hgf_index n_v, hgf_index n_w, hgf_index n_p);
+
+      /** \brief Keeps a PARALUTION operator and its built preconditioner alive across solves.
+       *
+       * Set up once with the solver strategy of hgf::solve::paralution::solve or solve_ps_flow, then call solve for each
+       * right-hand side, reusing the factorizations. When only the values of the matrix change, e.g. in a viscosity or
+       * penalty sweep with hgf::models::stokes::reassemble, update_values refreshes the operator and rebuilds the
+       * preconditioner numerically without a new setup, or in full in the mixed precision mode. Sessions must be cleared
+       * or destroyed before finalize_solver.
+       */
+      class solver_session
+      {
+
+        public:
+
+          solver_session(void);
+          ~solver_session(void);
+          void setup(const parameters& par, const array_csr& array);
+          void setup_ps_flow(const parameters& par, const array_csr& array, \
+            hgf_index n_u, hgf_index n_v, hgf_index n_w, hgf_index n_p);
+          void update_values(const array_csr& array);
+          void solve(const std::vector< double >& rhs, std::vector< double >& solution);
+          void clear(void);
+
+        private:
+
+          struct state;
+          std::unique_ptr< state > current;  // operator, vectors and built solver, empty before setup
+          solver_session(const solver_session&);
+          solver_session& operator=(const solver_session&);
+
+      };
     }
   }
 }
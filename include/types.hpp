@@ -2,6 +2,21 @@
 #define _TYPES_H
 
 #include <boost/filesystem.hpp>
+#include <vector>
+#include <stdint.h>
+
+/** \brief Integer type for rows, columns and nonzero offsets of assembled linear systems.
+ *
+ * 32-bit by default. Define HGF_INDEX_64 (cmake -DHGF_INDEX_64=ON) for systems with more than 2^31 - 1 unknowns or
+ * nonzeros. Only the Stokes model, array_coo / array_csr and hgf::solve::matrix_free::gmres use it: degree of freedom
+ * tables keep 32-bit entries, numbering each velocity component separately, and the mesh, the Poisson and porenetwork
+ * models, multigrid and the PARALUTION solvers keep int indices. Large Stokes systems must therefore be solved matrix-free.
+ */
+#ifdef HGF_INDEX_64
+typedef int64_t hgf_index;
+#else
+typedef int32_t hgf_index;
+#endif
 
 /** \brief Struct holding a variety of problem information.
  *
@@ -20,6 +35,10 @@ struct parameters
   double solver_absolute_tolerance;              /**< Specifies the absolute error tolerance for iterative solvers. */
   double solver_relative_tolerance;              /**< Specifies the relative error tolerance for iterative solvers. */
   int solver_verbose;                            /**< Specifies the level of console output produced by iterative solvers. */
+  int solver_mixed_precision = 0;                /**< If nonzero, iterative solvers run the inner solve in single precision inside a double precision defect correction, a speed option for bandwidth bound solves that needs more memory. Defaults to 0 */
+  int periodic = 0;                              /**< If nonzero, Stokes and Poisson models are built periodic across every face of the domain. Defaults to 0 */
+  double periodic_drive = 1.0;                   /**< Specifies the mean pressure gradient driving periodic problems. Defaults to 1 */
+  int solver_stokes_preconditioner = 0;          /**< Selects the preconditioner of Stokes solves: 0 block triangular with the additive Schur complement approximation of wall friction and scaled pressure mass matrix, 1 block triangular with the scaled pressure mass matrix only, 2 the saddle point preconditioner with multi-colored ILU(3) velocity blocks of earlier versions. Defaults to 0 */
   std::vector< unsigned long > voxel_geometry;   /**< Vector storing a voxel geometry read from the Geometry.dat input file. */
   boost::filesystem::path problem_path;          /**< Path to folder containing Geometry.dat and Parameters.dat input files */
 };
@@ -79,14 +98,147 @@ struct degree_of_freedom
   int neighbors[6];              /**< Array listing the global number of neighboring degrees of freedom, i.e. DOFs which interact with this DOF in the model. */
 };
 
+/** \brief Bit-packed flag vector, one bit per entry.
+ *
+ * Reads with operator[] return 0 or 1 like the std::vector< int > flag lists it replaces. set is safe to call from several threads.
+ */
+struct bit_flags
+{
+  std::vector< uint64_t > words;                /**< Packed flags, entry i is bit (i % 64) of words[i / 64]. */
+  size_t n = 0;                                 /**< Number of flags. */
+  size_t size(void) const { return n; }
+  void resize(size_t n_flags) { n = n_flags; words.assign((n_flags + 63) / 64, 0); }
+  int operator[](size_t i) const { return (int)((words[i >> 6] >> (i & 63)) & 1); }
+  void set(size_t i)
+  {
+    uint64_t bit = (uint64_t)1 << (i & 63);
+#pragma omp atomic
+    words[i >> 6] |= bit;
+  }
+  hgf_index count(void) const
+  {
+    hgf_index total = 0;
+    for (size_t ii = 0; ii < words.size(); ii++) total += __builtin_popcountll(words[ii]);
+    return total;
+  }
+};
+
+/** \brief Compact structure-of-arrays storage for the degrees of freedom of a staggered grid model.
+ *
+ * Neighbors and containing cells are kept in int32 tables. Coordinates are not stored, they are computed on demand
+ * from each degree of freedom's position in the lattice of faces normal to axis (or of cells when axis == -1), also
+ * an int32, so a lattice may hold at most 2^31 - 1 faces (about 1290^3 voxels) with or without HGF_INDEX_64.
+ */
+struct dof_store
+{
+  int axis = -1;                                /**< 0, 1 or 2 for face dofs normal to x, y or z, -1 for cell centered dofs. */
+  int dimension = 3;                            /**< Problem dimension, coordinates beyond it are 0. */
+  int n_neighbors = 6;                          /**< Stride of neighbor_table, 2 * dimension. */
+  int lattice[3] = { 0, 0, 0 };                 /**< Lattice extent in x, y and z, one larger than the mesh along axis. */
+  double spacing[3] = { 0, 0, 0 };              /**< Voxel length, width and height. */
+  std::vector< int32_t > position;              /**< Lattice index (z, y, x ordering, x fastest) of each degree of freedom. */
+  std::vector< int32_t > cell_table;            /**< Mesh cells containing each degree of freedom, 2 per dof, -1 if absent. */
+  std::vector< int32_t > neighbor_table;        /**< Neighboring degrees of freedom, n_neighbors per dof, -1 if absent. */
+
+  /** \brief Sets the lattice description for dofs of the given axis (-1 for cell centered dofs) on the geometry in par. */
+  void setup(const parameters& par, int dof_axis)
+  {
+    axis = dof_axis;
+    dimension = par.dimension;
+    n_neighbors = 2 * par.dimension;
+    lattice[0] = par.nx + (axis == 0);
+    lattice[1] = par.ny + (axis == 1);
+    lattice[2] = (par.dimension == 3) ? par.nz + (axis == 2) : 1;
+    spacing[0] = (double)par.length / par.nx;
+    spacing[1] = (double)par.width / par.ny;
+    spacing[2] = (par.dimension == 3) ? (double)par.height / par.nz : 0;
+  }
+  size_t size(void) const { return position.size(); }
+  void resize(size_t n_dofs)
+  {
+    position.assign(n_dofs, 0);
+    cell_table.assign(2 * n_dofs, -1);
+    neighbor_table.assign(n_neighbors * n_dofs, -1);
+  }
+  int32_t& cell(int dof, int k) { return cell_table[2 * (size_t)dof + k]; }
+  int32_t cell(int dof, int k) const { return cell_table[2 * (size_t)dof + k]; }
+  int32_t& neighbor(int dof, int k) { return neighbor_table[n_neighbors * (size_t)dof + k]; }
+  int32_t neighbor(int dof, int k) const { return neighbor_table[n_neighbors * (size_t)dof + k]; }
+  /** \brief Places dof at lattice location (zi, yi, xi), where the index along axis counts faces rather than cells. */
+  void set_position(int dof, int zi, int yi, int xi) { position[dof] = xi + lattice[0] * (yi + lattice[1] * zi); }
+  /** \brief Returns coordinate k of dof, the same face or cell midpoint the mesh vertices give. */
+  double coord(int dof, int k) const
+  {
+    if (k >= dimension) return 0;
+    int32_t p = position[dof];
+    int ii = (k == 0) ? p % lattice[0] : ((k == 1) ? (p / lattice[0]) % lattice[1] : p / (lattice[0] * lattice[1]));
+    if (k == axis) return ii * spacing[k];
+    return 0.5 * (ii * spacing[k] + (ii + 1) * spacing[k]);
+  }
+};
+
+/** \brief Struct describing a pore in a pore network extracted from a voxel geometry.
+ *
+ */
+struct network_pore
+{
+  double coords[3];              /**< Array of coordinates of the pore centroid. */
+  double radius;                 /**< Radius of the largest sphere (circle in 2d) inscribed in the pore. */
+  double volume;                 /**< Volume of the pore (area in 2d). */
+  int boundary;                  /**< Bitmask of domain faces touched by the pore: 1 x-, 2 x+, 4 y-, 8 y+, 16 z-, 32 z+. */
+  double boundary_conductance[6];/**< Conductance between the pore centroid and each domain face touched by the pore, ordered x-, x+, y-, y+, z-, z+. */
+};
+
+/** \brief Struct describing a throat connecting two pores in a pore network extracted from a voxel geometry.
+ *
+ */
+struct network_throat
+{
+  int pores[2];                  /**< Array of the two pore numbers connected by the throat, pores[0] < pores[1]. */
+  double radius;                 /**< Inscribed radius at the narrowest point of the throat. */
+  double area;                   /**< Area of the interface between the two pores (length in 2d). */
+  double length;                 /**< Distance between the centroids of the two pores. */
+  double conductance;            /**< Hydraulic conductance of the pore-throat-pore conduit. */
+};
+
+/** \brief Struct holding statistics of a voxel geometry gathered during preprocessing.
+ *
+ */
+struct geometry_statistics
+{
+  int nx;                        /**< x mesh dimension. */
+  int ny;                        /**< y mesh dimension. */
+  int nz;                        /**< z mesh dimension, 0 for a 2d geometry. */
+  long n_void;                   /**< Number of void voxels (value 0). */
+  long n_solid;                  /**< Number of solid voxels (value 1). */
+  long n_immersed;               /**< Number of immersed boundary voxels (value 2). */
+  double porosity;               /**< Fraction of voxels that are void. */
+  long sanity_changed;           /**< Number of void voxels made solid by the geo_sanity rule. */
+  long n_components;             /**< Number of connected void components before dead pores were removed. */
+  long pores_removed;            /**< Number of void components removed for not touching every face of the domain. */
+};
+
 /** \brief Struct for coordinate sparse data format.
  *
  */
 struct array_coo
 {
-  int i_index;     /**< Integer determining the row of the array entry. */
-  int j_index;     /**< Integer determining the column of the array entry. */
-  double value;    /**< Double precision value of the array entry. */
+  hgf_index i_index; /**< Integer determining the row of the array entry. */
+  hgf_index j_index; /**< Integer determining the column of the array entry. */
+  double value;      /**< Double precision value of the array entry. */
+};
+
+/** \brief Struct holding a sparse matrix in compressed sparse row (CSR) format.
+ *
+ * Column indices are sorted within each row and every (row, column) pair appears at most once.
+ */
+struct array_csr
+{
+  hgf_index n_rows = 0;                 /**< Number of rows in the array. */
+  hgf_index n_cols = 0;                 /**< Number of columns in the array. */
+  std::vector< hgf_index > row_ptr;     /**< Entries of row i are stored in positions row_ptr[i] to row_ptr[i + 1] - 1. */
+  std::vector< hgf_index > col_index;   /**< Column index of each stored entry. */
+  std::vector< double > value;          /**< Value of each stored entry. */
 };
 
 /** \brief Struct for sorting an array of degrees of freedom by x-coordinate then by y-coordinate (y increases fastest). 
@@ -188,4 +340,23 @@ enum HGF_INFLOW
   HGF_INFLOW_PARABOLIC,
   HGF_INFLOW_CONSTANT
 };
+
+/** \brief Enum for selecting how a periodic problem is driven.
+ *
+ */
+enum HGF_PERIODIC
+{
+  HGF_PERIODIC_BODY_FORCE,       /**< Uniform body force equal to the mean pressure gradient on every cell. */
+  HGF_PERIODIC_PRESSURE_JUMP     /**< Pressure jump of the mean gradient times the domain length across the periodic faces. */
+};
+
+/** \brief Enum for selecting the rule used when coarsening a voxel geometry.
+ *
+ */
+enum HGF_COARSEN
+{
+  HGF_COARSEN_MAJORITY,          /**< Coarse voxel is solid if most of its fine voxels are solid. */
+  HGF_COARSEN_ANY_FLUID,         /**< Coarse voxel is solid only if all of its fine voxels are solid. */
+  HGF_COARSEN_CONNECTIVITY       /**< Majority rule, but coarse voxels crossed by a fine void path between two opposite faces stay void. */
+};
 #endif
@@ -35,6 +35,9 @@ namespace hgf
     void
     import_voxel_geometry(parameters& par, const bfs::path& problem_path);
 
+    void
+    import_voxel_field(const parameters& par, const bfs::path& problem_path, const std::string& file_name, std::vector< double >& field);
+
     bool
     check_symmetry(std::vector< array_coo >& array);
 
@@ -43,6 +46,10 @@ namespace hgf
 
     void
     unique_array(std::vector< array_coo >& array);
+
+    void
+    csr_add_entries(array_csr& array, const std::vector< array_coo >& entries, \
+                    std::vector< unsigned char >* tags = NULL, unsigned char new_tag = 0);
   }
 
   namespace mesh
@@ -50,11 +57,26 @@ namespace hgf
     void
     refine_voxel_uniform(parameters& par, int refine_len);
 
+    void
+    coarsen_voxel_uniform(parameters& par, int coarsen_len, HGF_COARSEN rule);
+
     int
     geo_sanity(parameters& par);
 
     int
     remove_dead_pores(parameters& par);
+
+    void
+    distance_transform(const parameters& par, std::vector< double >& distance);
+
+    void
+    preprocess_geometry_stream(const bfs::path& input_file, const bfs::path& output_file, int slab_planes, geometry_statistics& stats);
+
+    void
+    voxel_to_cell_field(const parameters& par, const std::vector< double >& voxel_field, std::vector< double >& cell_field);
+
+    void
+    periodic_neighbors(const parameters& par, std::vector< int >& neighbors, std::vector< int >& regions);
   }
 }
 
@@ -0,0 +1,146 @@
+/* distance transform source */
+
+// system includes
+#include <vector>
+#include <limits>
+#include <math.h>
+#include <omp.h>
+
+#include "hgflow.hpp"
+
+// 1d->2d index
+#define idx2(i, j, ldi) ((i * ldi) + j)
+
+// 1d->3d index
+#define idx3(i, j, k, ldi1, ldi2) (k + (ldi2 * (j + ldi1 * i)))
+
+#define EDT_INF std::numeric_limits< double >::infinity()
+
+/* Exact 1d squared distance transform of a sampled function (Felzenszwalb & Huttenlocher).
+   f holds squared distances along the line, h is the physical spacing between samples.
+   v and z are scratch arrays of length n and n + 1. */
+static inline void
+edt_1d( const double *f, double *d, int n, double h, int *v, double *z )
+{
+  double h2 = h * h;
+  int k = -1;
+  double s;
+
+  // lower envelope of the parabolas rooted at samples with finite f
+  for (int q = 0; q < n; q++) {
+    if (f[q] == EDT_INF) continue;
+    if (k < 0) {
+      k = 0;
+      v[0] = q;
+      z[0] = -EDT_INF;
+      z[1] = EDT_INF;
+      continue;
+    }
+    do {
+      s = ((f[q] + h2 * q * q) - (f[v[k]] + h2 * v[k] * v[k])) / (2 * h2 * (q - v[k]));
+      if (s <= z[k]) k--;
+      else break;
+    } while (k >= 0);
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = EDT_INF;
+  }
+
+  // no finite samples on this line, nothing to propagate
+  if (k < 0) {
+    for (int q = 0; q < n; q++) d[q] = EDT_INF;
+    return;
+  }
+
+  // sample the envelope
+  k = 0;
+  for (int q = 0; q < n; q++) {
+    while (z[k + 1] < q) k++;
+    d[q] = h2 * (q - v[k]) * (q - v[k]) + f[v[k]];
+  }
+}
+
+/* Applies edt_1d to every line of the lattice along one axis.
+   stride is the distance between consecutive samples of a line, n_lines the number of lines,
+   and line_start maps a line number to the index of its first sample. */
+template< class LineStart >
+static void
+edt_pass( std::vector< double >& sq, int n, int stride, int n_lines, double h, LineStart line_start )
+{
+#pragma omp parallel
+  {
+    std::vector< double > f(n), d(n), z(n + 1);
+    std::vector< int > v(n);
+#pragma omp for schedule(static)
+    for (int line = 0; line < n_lines; line++) {
+      long first = line_start(line);
+      for (int q = 0; q < n; q++) f[q] = sq[first + (long)q * stride];
+      edt_1d(f.data(), d.data(), n, h, v.data(), z.data());
+      for (int q = 0; q < n; q++) sq[first + (long)q * stride] = d[q];
+    }
+  }
+}
+
+/** \brief Computes the exact Euclidean distance from each voxel center to the nearest solid voxel center.
+ *
+ * Uses the separable lower-envelope algorithm of Felzenszwalb and Huttenlocher, performing one pass per axis
+ * with the lines of each pass distributed across threads. Distances are in the physical units of par.length,
+ * par.width and par.height, so anisotropic voxels are handled exactly. Solid voxels (value 1) have distance 0,
+ * and the domain boundary is not treated as solid. If the geometry contains no solid voxels every distance is set to -1.
+ * @param[in] par - parameters struct containing the voxel geometry.
+ * @param[out] distance - distance for every voxel in par.voxel_geometry, in the same ordering.
+ */
+void
+hgf::mesh::distance_transform(const parameters& par, std::vector< double >& distance)
+{
+  int nx = par.nx;
+  int ny = par.ny;
+  int nz = (par.dimension == 3) ? par.nz : 1;
+  double dx = par.length / par.nx;
+  double dy = par.width / par.ny;
+  double dz = (par.dimension == 3) ? par.height / par.nz : 1.0;
+
+  distance.resize(par.voxel_geometry.size());
+
+#pragma omp parallel for schedule(static)
+  for (long ii = 0; ii < (long)distance.size(); ii++) {
+    distance[ii] = (par.voxel_geometry[ii] == 1) ? 0.0 : EDT_INF;
+  }
+
+  // x pass, lines are contiguous
+  edt_pass(distance, nx, 1, ny * nz, dx, \
+    [nx](int line) { return (long)line * nx; });
+
+  // y pass
+  edt_pass(distance, ny, nx, nx * nz, dy, \
+    [nx, ny](int line) { return (long)(line / nx) * nx * ny + (line % nx); });
+
+  // z pass
+  if (par.dimension == 3) {
+    edt_pass(distance, nz, nx * ny, nx * ny, dz, \
+      [](int line) { return (long)line; });
+  }
+
+#pragma omp parallel for schedule(static)
+  for (long ii = 0; ii < (long)distance.size(); ii++) {
+    distance[ii] = (distance[ii] == EDT_INF) ? -1.0 : sqrt(distance[ii]);
+  }
+}
+
+/** \brief Restricts a field defined on every voxel to the void cells of the mesh.
+ *
+ * The output is ordered like hgf::mesh::voxel::els, so it can be written with hgf::mesh::voxel::output_vtk.
+ * @param[in] par - parameters struct containing the voxel geometry.
+ * @param[in] voxel_field - field with one value per voxel in par.voxel_geometry.
+ * @param[out] cell_field - field with one value per void (non-solid) voxel.
+ */
+void
+hgf::mesh::voxel_to_cell_field(const parameters& par, const std::vector< double >& voxel_field, std::vector< double >& cell_field)
+{
+  cell_field.clear();
+  cell_field.reserve(voxel_field.size());
+  for (int ii = 0; ii < (int)par.voxel_geometry.size(); ii++) {
+    if (par.voxel_geometry[ii] != 1) cell_field.push_back(voxel_field[ii]);
+  }
+}
@@ -0,0 +1,434 @@
+/* slab streaming geometry preprocessing source */
+
+// system includes
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <stdlib.h>
+#include <algorithm>
+#include <omp.h>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include "hgflow.hpp"
+
+// 1d->2d index
+#define idx2(i, j, ldi) ((i * ldi) + j)
+
+// 1d->3d index
+#define idx3(i, j, k, ldi1, ldi2) (k + (ldi2 * (j + ldi1 * i)))
+
+// Geometry.dat opened for reading one z plane at a time
+struct geometry_stream
+{
+  bfs::ifstream ifs;
+  int nx, ny, nz;
+  int dimension;
+  int n_planes;
+  std::vector< std::string > lines;
+};
+
+static void
+open_geometry_stream(geometry_stream& gs, const bfs::path& file)
+{
+  gs.ifs.open(file);
+  if (!gs.ifs.good()) {
+    std::cout << "\nGeometry file " << file.string() << " could not be opened. Exiting.\n";
+    exit(0);
+  }
+  std::string line, str;
+  int *dims[3] = { &gs.nx, &gs.ny, &gs.nz };
+  for (int dir = 0; dir < 3; dir++) {
+    *dims[dir] = 0;
+    std::getline(gs.ifs, line);
+    std::istringstream iline(line);
+    iline >> str >> *dims[dir];
+  }
+  if (!gs.nx || !gs.ny) {
+    std::cout << "\nSomething went wrong reading mesh. Ensure correct formatting. Exiting.\n";
+    exit(0);
+  }
+  gs.dimension = gs.nz ? 3 : 2;
+  gs.n_planes = gs.nz ? gs.nz : 1;
+}
+
+/* Reads the next n z planes into data. Lines are gathered serially and parsed in parallel. */
+static void
+read_planes(geometry_stream& gs, int n, unsigned long *data)
+{
+  int n_lines = n * gs.ny;
+  gs.lines.resize(n_lines);
+  for (int pp = 0; pp < n; pp++) {
+    for (int row = 0; row < gs.ny; row++) {
+      std::getline(gs.ifs, gs.lines[idx2(pp, row, gs.ny)]);
+    }
+    // empty row between z slices
+    if (gs.dimension == 3) {
+      std::string blank;
+      std::getline(gs.ifs, blank);
+    }
+  }
+  int bad_rows = 0;
+#pragma omp parallel for schedule(static) reduction(+:bad_rows)
+  for (int ll = 0; ll < n_lines; ll++) {
+    const char *pos = gs.lines[ll].c_str();
+    char *end;
+    int count = 0;
+    while (count < gs.nx) {
+      unsigned long value = strtoul(pos, &end, 10);
+      if (end == pos) break;
+      data[(long)ll * gs.nx + count++] = value;
+      pos = end;
+    }
+    if (count != gs.nx) bad_rows++;
+  }
+  if (bad_rows) {
+    std::cout << "\nGeometry file ended early or has a row of the wrong length. Ensure correct formatting. Exiting.\n";
+    exit(0);
+  }
+}
+
+static void
+write_header(bfs::ofstream& ofs, const geometry_stream& gs)
+{
+  ofs << "nx= " << gs.nx << "\n";
+  ofs << "ny= " << gs.ny << "\n";
+  ofs << "nz= " << gs.nz << "\n";
+}
+
+/* Writes n z planes in the Geometry.dat layout. Rows are formatted in parallel and written serially. */
+static void
+write_planes(bfs::ofstream& ofs, const geometry_stream& gs, int n, const unsigned long *data, std::vector< std::string >& rows)
+{
+  int n_lines = n * gs.ny;
+  rows.resize(n_lines);
+#pragma omp parallel for schedule(static)
+  for (int ll = 0; ll < n_lines; ll++) {
+    std::string& row = rows[ll];
+    row.clear();
+    row.reserve(2 * gs.nx + 1);
+    for (int xi = 0; xi < gs.nx; xi++) {
+      row += std::to_string(data[(long)ll * gs.nx + xi]);
+      row += ' ';
+    }
+    row += '\n';
+  }
+  for (int pp = 0; pp < n; pp++) {
+    for (int row = 0; row < gs.ny; row++) ofs << rows[idx2(pp, row, gs.ny)];
+    if (gs.dimension == 3) ofs << "\n";
+  }
+}
+
+/* geo_sanity rule on a slab held in buf: plane 0 is the lower halo, planes 1..n the slab, plane n+1 the upper halo.
+   Iterates to a fixed point with Jacobi sweeps, returns the number of voxels turned solid. */
+static long
+sanity_slab(std::vector< unsigned long >& buf, const geometry_stream& gs, int z0, int n, bool& first_plane_changed)
+{
+  int nx = gs.nx;
+  int ny = gs.ny;
+  long plane_size = (long)nx * ny;
+  long slab_size = plane_size * n;
+  std::vector< unsigned char > flip(slab_size, 0);
+  long total = 0;
+  long changed;
+  long first_plane_changes = 0;
+  do {
+    changed = 0;
+#pragma omp parallel for schedule(static) reduction(+:changed)
+    for (long vv = 0; vv < slab_size; vv++) {
+      long ii = vv + plane_size;
+      if (buf[ii] == 1) continue;
+      int xi = (int)(vv % nx);
+      int yi = (int)((vv / nx) % ny);
+      int zi = z0 + (int)(vv / plane_size);
+      bool solid;
+      // xi sanity
+      if (xi == 0) solid = (buf[ii + 1] == 1);
+      else if (xi == nx - 1) solid = (buf[ii - 1] == 1);
+      else solid = (buf[ii + 1] == 1 && buf[ii - 1] == 1);
+      // yi sanity
+      if (yi == 0) solid = solid || (buf[ii + nx] == 1);
+      else if (yi == ny - 1) solid = solid || (buf[ii - nx] == 1);
+      else solid = solid || (buf[ii + nx] == 1 && buf[ii - nx] == 1);
+      // zi sanity
+      if (gs.dimension == 3) {
+        if (zi == 0) solid = solid || (buf[ii + plane_size] == 1);
+        else if (zi == gs.nz - 1) solid = solid || (buf[ii - plane_size] == 1);
+        else solid = solid || (buf[ii + plane_size] == 1 && buf[ii - plane_size] == 1);
+      }
+      if (solid) {
+        flip[vv] = 1;
+        changed++;
+      }
+    }
+#pragma omp parallel for schedule(static) reduction(+:first_plane_changes)
+    for (long vv = 0; vv < slab_size; vv++) {
+      if (flip[vv]) {
+        buf[vv + plane_size] = 1;
+        flip[vv] = 0;
+        if (vv < plane_size) first_plane_changes++;
+      }
+    }
+    total += changed;
+  } while (changed);
+  first_plane_changed = (first_plane_changes != 0);
+  return total;
+}
+
+/* One streaming geo_sanity pass from in_file to out_file. Sets again if a change may have
+   invalidated a plane already written, so that another pass is needed. */
+static long
+sanity_pass(const bfs::path& in_file, const bfs::path& out_file, int slab_planes, bool& again)
+{
+  geometry_stream gs;
+  open_geometry_stream(gs, in_file);
+  bfs::ofstream ofs(out_file);
+  write_header(ofs, gs);
+
+  long plane_size = (long)gs.nx * gs.ny;
+  std::vector< unsigned long > buf((slab_planes + 2) * plane_size);
+  std::vector< std::string > rows;
+  long total = 0;
+  again = false;
+
+  // slab plus one plane of lookahead
+  int loaded = std::min(slab_planes + 1, gs.n_planes);
+  read_planes(gs, loaded, &buf[plane_size]);
+  for (int z0 = 0; z0 < gs.n_planes; ) {
+    int n = std::min(slab_planes, gs.n_planes - z0);
+    bool first_plane_changed;
+    total += sanity_slab(buf, gs, z0, n, first_plane_changed);
+    if (z0 && first_plane_changed) again = true;
+    write_planes(ofs, gs, n, &buf[plane_size], rows);
+
+    // the last slab plane becomes the lower halo, the lookahead plane starts the next slab
+    z0 += n;
+    int remaining = gs.n_planes - z0;
+    if (!remaining) break;
+    std::copy(buf.begin() + n * plane_size, buf.begin() + (n + 1) * plane_size, buf.begin());
+    std::copy(buf.begin() + (n + 1) * plane_size, buf.begin() + (n + 2) * plane_size, buf.begin() + plane_size);
+    int to_read = std::min(slab_planes + 1, remaining) - 1;
+    if (to_read) read_planes(gs, to_read, &buf[2 * plane_size]);
+  }
+  ofs.close();
+  return total;
+}
+
+// union-find root with path halving
+static inline long
+uf_find(std::vector< long >& uf, long a)
+{
+  while (uf[a] != a) {
+    uf[a] = uf[uf[a]];
+    a = uf[a];
+  }
+  return a;
+}
+
+/* Labels the 4-connected void components of one z plane in raster order of first appearance.
+   labels is -1 on solid voxels. Returns the number of components. */
+static int
+label_plane(const unsigned long *plane, int nx, int ny, int *labels, std::vector< int >& uf)
+{
+  uf.clear();
+  for (int yi = 0; yi < ny; yi++) {
+    for (int xi = 0; xi < nx; xi++) {
+      int ii = idx2(yi, xi, nx);
+      if (plane[ii] == 1) {
+        labels[ii] = -1;
+        continue;
+      }
+      int left = xi ? labels[ii - 1] : -1;
+      int down = yi ? labels[ii - nx] : -1;
+      if (left < 0 && down < 0) {
+        labels[ii] = (int)uf.size();
+        uf.push_back((int)uf.size());
+      }
+      else if (left < 0 || down < 0) labels[ii] = std::max(left, down);
+      else {
+        while (uf[left] != left) left = uf[left];
+        while (uf[down] != down) down = uf[down];
+        labels[ii] = std::min(left, down);
+        uf[std::max(left, down)] = std::min(left, down);
+      }
+    }
+  }
+  // compact, roots always precede their members so one forward sweep resolves every label
+  int n_comp = 0;
+  for (int ll = 0; ll < (int)uf.size(); ll++) {
+    if (uf[ll] == ll) uf[ll] = -(++n_comp);
+    else uf[ll] = uf[uf[ll]];
+  }
+  for (int ii = 0; ii < nx * ny; ii++) {
+    if (labels[ii] >= 0) labels[ii] = -uf[labels[ii]] - 1;
+  }
+  return n_comp;
+}
+
+/* Labels every plane of a slab in parallel. plane_comps receives the component count of each plane. */
+static void
+label_slab(const unsigned long *data, const geometry_stream& gs, int n, std::vector< int >& labels, std::vector< int >& plane_comps)
+{
+  long plane_size = (long)gs.nx * gs.ny;
+  labels.resize(n * plane_size);
+  plane_comps.resize(n);
+#pragma omp parallel
+  {
+    std::vector< int > uf;
+#pragma omp for schedule(dynamic)
+    for (int pp = 0; pp < n; pp++) {
+      plane_comps[pp] = label_plane(data + pp * plane_size, gs.nx, gs.ny, &labels[pp * plane_size], uf);
+    }
+  }
+}
+
+/** \brief Cleans a voxel geometry file that need not fit in memory, streaming it in z slabs.
+ *
+ * Applies the equivalent of hgf::mesh::geo_sanity followed by hgf::mesh::remove_dead_pores, and gathers geometry statistics,
+ * holding at most a slab of slab_planes z planes plus a one plane halo on each side in memory. Each slab is parsed, cleaned,
+ * labeled and written in parallel. geo_sanity changes that reach back across a slab boundary trigger another streaming pass.
+ * Void components are labeled plane by plane and stitched across planes, with the component merges carried from slab to slab
+ * in a union-find over plane components; a second pass then removes components that do not touch every face of the domain.
+ * Intermediate passes are written next to output_file and removed afterwards. input_file and output_file may be the same.
+ *
+ * @param[in] input_file - voxel geometry in the Geometry.dat format.
+ * @param[in] output_file - cleaned voxel geometry, written in the Geometry.dat format.
+ * @param[in] slab_planes - number of z planes held in memory at once.
+ * @param[out] stats - statistics of the cleaned geometry.
+ */
+void
+hgf::mesh::preprocess_geometry_stream(const bfs::path& input_file, const bfs::path& output_file, int slab_planes, geometry_statistics& stats)
+{
+  if (slab_planes < 1) slab_planes = 1;
+  bfs::path pass_file[2] = { output_file.string() + ".sanity0", output_file.string() + ".sanity1" };
+
+  // geo_sanity, repeated while changes cross slab boundaries backwards
+  stats.sanity_changed = 0;
+  int pass = 0;
+  bool again = true;
+  while (again) {
+    stats.sanity_changed += sanity_pass(pass ? pass_file[(pass - 1) % 2] : input_file, pass_file[pass % 2], slab_planes, again);
+    pass++;
+  }
+  bfs::path clean_file = pass_file[(pass - 1) % 2];
+  if (pass > 1) bfs::remove(pass_file[pass % 2]);
+
+  // label void components and carry merges across planes and slabs
+  geometry_stream gs;
+  open_geometry_stream(gs, clean_file);
+  long plane_size = (long)gs.nx * gs.ny;
+  unsigned char all_faces = (gs.dimension == 3) ? 63 : 15;
+  std::vector< unsigned long > slab(slab_planes * plane_size);
+  std::vector< int > labels, plane_comps, prev_labels;
+  std::vector< long > plane_offset(1, 0);
+  std::vector< long > uf;
+  std::vector< unsigned char > faces;
+  for (int z0 = 0; z0 < gs.n_planes; z0 += slab_planes) {
+    int n = std::min(slab_planes, gs.n_planes - z0);
+    read_planes(gs, n, slab.data());
+    label_slab(slab.data(), gs, n, labels, plane_comps);
+    for (int pp = 0; pp < n; pp++) plane_offset.push_back(plane_offset.back() + plane_comps[pp]);
+    uf.resize(plane_offset.back());
+    faces.resize(plane_offset.back());
+    // faces touched by each plane component, plane components own disjoint label ranges
+#pragma omp parallel for schedule(dynamic)
+    for (int pp = 0; pp < n; pp++) {
+      int zi = z0 + pp;
+      long offset = plane_offset[zi];
+      for (int ll = 0; ll < plane_comps[pp]; ll++) {
+        uf[offset + ll] = offset + ll;
+        faces[offset + ll] = 0;
+        if (gs.dimension == 3 && zi == 0) faces[offset + ll] |= 16;
+        if (gs.dimension == 3 && zi == gs.nz - 1) faces[offset + ll] |= 32;
+      }
+      const int *lab = &labels[pp * plane_size];
+      for (int yi = 0; yi < gs.ny; yi++) {
+        for (int xi = 0; xi < gs.nx; xi++) {
+          int ll = lab[idx2(yi, xi, gs.nx)];
+          if (ll < 0) continue;
+          if (xi == 0) faces[offset + ll] |= 1;
+          if (xi == gs.nx - 1) faces[offset + ll] |= 2;
+          if (yi == 0) faces[offset + ll] |= 4;
+          if (yi == gs.ny - 1) faces[offset + ll] |= 8;
+        }
+      }
+    }
+    // stitch each plane to the one below it, the first plane of the slab to the halo of the previous slab
+    for (int pp = 0; pp < n; pp++) {
+      int zi = z0 + pp;
+      if (!zi) continue;
+      const int *lower = pp ? &labels[(pp - 1) * plane_size] : prev_labels.data();
+      const int *upper = &labels[pp * plane_size];
+      for (long ii = 0; ii < plane_size; ii++) {
+        if (lower[ii] < 0 || upper[ii] < 0) continue;
+        long a = uf_find(uf, plane_offset[zi - 1] + lower[ii]);
+        long b = uf_find(uf, plane_offset[zi] + upper[ii]);
+        if (a != b) uf[std::max(a, b)] = std::min(a, b);
+      }
+    }
+    prev_labels.assign(labels.begin() + (n - 1) * plane_size, labels.begin() + n * plane_size);
+  }
+  gs.ifs.close();
+
+  // a component is kept when it touches every face of the domain
+  stats.pores_removed = 0;
+  stats.n_components = 0;
+  for (long ll = 0; ll < (long)uf.size(); ll++) {
+    uf[ll] = uf_find(uf, ll);
+    faces[uf[ll]] |= faces[ll];
+  }
+  std::vector< unsigned char > keep(uf.size());
+  for (long ll = 0; ll < (long)uf.size(); ll++) {
+    if (uf[ll] == ll) {
+      stats.n_components++;
+      if (faces[ll] != all_faces) stats.pores_removed++;
+    }
+  }
+#pragma omp parallel for schedule(static)
+  for (long ll = 0; ll < (long)uf.size(); ll++) {
+    keep[ll] = (faces[uf[ll]] == all_faces);
+  }
+  std::vector< long >().swap(uf);
+  std::vector< unsigned char >().swap(faces);
+  std::vector< int >().swap(prev_labels);
+
+  // relabel, remove dead pores, gather statistics and write the result
+  geometry_stream gs_clean;
+  open_geometry_stream(gs_clean, clean_file);
+  bfs::ofstream ofs(output_file);
+  write_header(ofs, gs_clean);
+  std::vector< std::string > rows;
+  long n_void = 0, n_solid = 0, n_immersed = 0;
+  for (int z0 = 0; z0 < gs_clean.n_planes; z0 += slab_planes) {
+    int n = std::min(slab_planes, gs_clean.n_planes - z0);
+    read_planes(gs_clean, n, slab.data());
+    label_slab(slab.data(), gs_clean, n, labels, plane_comps);
+#pragma omp parallel for schedule(static) reduction(+:n_void,n_solid,n_immersed)
+    for (long vv = 0; vv < n * plane_size; vv++) {
+      if (labels[vv] >= 0 && !keep[plane_offset[z0 + vv / plane_size] + labels[vv]]) slab[vv] = 1;
+      if (slab[vv] == 0) n_void++;
+      else if (slab[vv] == 1) n_solid++;
+      else if (slab[vv] == 2) n_immersed++;
+    }
+    write_planes(ofs, gs_clean, n, slab.data(), rows);
+  }
+  gs_clean.ifs.close();
+  ofs.close();
+  bfs::remove(clean_file);
+
+  stats.nx = gs_clean.nx;
+  stats.ny = gs_clean.ny;
+  stats.nz = gs_clean.nz;
+  stats.n_void = n_void;
+  stats.n_solid = n_solid;
+  stats.n_immersed = n_immersed;
+  stats.porosity = (double)n_void / ((long)gs_clean.n_planes * plane_size);
+
+  if (stats.sanity_changed) {
+    std::cout << "\nWarning, input geometry was incompatible.\n";
+    std::cout << stats.sanity_changed << " cells, representing ";
+    std::cout << (double)100 * stats.sanity_changed / ((long)gs_clean.n_planes * plane_size);
+    std::cout << "% of the input geometry, with boundaries on opposite faces \nwere found and removed from void space.\n";
+  }
+}
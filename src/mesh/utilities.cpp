@@ -5,6 +5,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 #include <boost/filesystem.hpp>
 
 // 1d->2d index
@@ -82,6 +83,134 @@ hgf::mesh::refine_voxel_uniform(parameters& par, int refine_len)
 
 }
 
+/* Returns true if the void voxels of the block [x0,x1)x[y0,y1)x[z0,z1) of geometry connect two opposite faces of the block. */
+static bool
+block_crossed(const std::vector< unsigned long >& geometry, int nx, int ny, int x0, int x1, int y0, int y1, int z0, int z1, \
+  int dimension, std::vector< unsigned char >& visited, std::vector< int >& stack)
+{
+  int bx = x1 - x0;
+  int by = y1 - y0;
+  int bz = z1 - z0;
+  visited.assign(bx * by * bz, 0);
+  for (int start = 0; start < bx * by * bz; start++) {
+    int si = start % bx;
+    int sj = (start / bx) % by;
+    int sk = start / (bx * by);
+    if (visited[start] || geometry[idx3((long)(z0 + sk), (y0 + sj), (x0 + si), ny, nx)] == 1) continue;
+    // flood fill this component, tracking the block faces it touches
+    int faces = 0;
+    visited[start] = 1;
+    stack.assign(1, start);
+    while (stack.size()) {
+      int cur = stack.back();
+      stack.pop_back();
+      int ii = cur % bx;
+      int jj = (cur / bx) % by;
+      int kk = cur / (bx * by);
+      if (ii == 0) faces |= 1;
+      if (ii == bx - 1) faces |= 2;
+      if (jj == 0) faces |= 4;
+      if (jj == by - 1) faces |= 8;
+      if (dimension == 3 && kk == 0) faces |= 16;
+      if (dimension == 3 && kk == bz - 1) faces |= 32;
+      int nbrs[6] = { ii ? cur - 1 : -1, (ii < bx - 1) ? cur + 1 : -1, \
+                      jj ? cur - bx : -1, (jj < by - 1) ? cur + bx : -1, \
+                      kk ? cur - bx * by : -1, (kk < bz - 1) ? cur + bx * by : -1 };
+      for (int dir = 0; dir < 6; dir++) {
+        int nbr = nbrs[dir];
+        if (nbr < 0 || visited[nbr]) continue;
+        int ni = nbr % bx;
+        int nj = (nbr / bx) % by;
+        int nk = nbr / (bx * by);
+        if (geometry[idx3((long)(z0 + nk), (y0 + nj), (x0 + ni), ny, nx)] == 1) continue;
+        visited[nbr] = 1;
+        stack.push_back(nbr);
+      }
+    }
+    if ((faces & 3) == 3 || (faces & 12) == 12 || (faces & 48) == 48) return true;
+  }
+  return false;
+}
+
+/** \brief Uniformly coarsens a voxelated input, the inverse of hgf::mesh::refine_voxel_uniform.
+ *
+ * Each coarse voxel covers a block of coarsen_len voxels in each direction, so every mesh dimension must be a multiple
+ * of coarsen_len; a truncated block would become a full coarse voxel and stretch the geometry. A void coarse voxel is an
+ * immersed boundary voxel (2) if its block holds more immersed boundary voxels than void voxels. Coarse voxels are
+ * computed in parallel. geo_sanity and remove_dead_pores are applied to the coarse geometry, since coarsening can
+ * close channels and strand pores, so the result is ready for hgf::mesh::voxel::build.
+ *
+ * @param[in,out] par - parameters file containing mesh information, updated to the coarse geometry.
+ * @param[in] coarsen_len - integer controlling extent of geometry coarsening.
+ * @param[in] rule - rule deciding which coarse voxels are solid, see HGF_COARSEN.
+ */
+void
+hgf::mesh::coarsen_voxel_uniform(parameters& par, int coarsen_len, HGF_COARSEN rule)
+{
+  if (coarsen_len < 2) return;
+
+  int nx_old = par.nx;
+  int ny_old = par.ny;
+  int nz_old = par.nz ? par.nz : 1;
+  int cz_len = par.nz ? coarsen_len : 1;
+  if (nx_old % coarsen_len || ny_old % coarsen_len || nz_old % cz_len) {
+    std::cout << "\nMesh dimensions must be multiples of the coarsening length " << coarsen_len << ". Exiting.\n";
+    exit(0);
+  }
+  int nx_new = nx_old / coarsen_len;
+  int ny_new = ny_old / coarsen_len;
+  int nz_new = nz_old / cz_len;
+  int size_new = nx_new * ny_new * nz_new;
+  std::vector< unsigned long > voxel_geometry_old;
+  voxel_geometry_old.swap(par.voxel_geometry);
+  par.voxel_geometry.resize(size_new);
+
+#pragma omp parallel
+  {
+    std::vector< unsigned char > visited;
+    std::vector< int > stack;
+#pragma omp for schedule(dynamic, 64)
+    for (int cc = 0; cc < size_new; cc++) {
+      int xc = cc % nx_new;
+      int yc = (cc / nx_new) % ny_new;
+      int zc = cc / (nx_new * ny_new);
+      int x0 = xc * coarsen_len;
+      int y0 = yc * coarsen_len;
+      int z0 = zc * cz_len;
+      int x1 = x0 + coarsen_len;
+      int y1 = y0 + coarsen_len;
+      int z1 = z0 + cz_len;
+      int n_void = 0, n_solid = 0, n_immersed = 0;
+      for (int zi = z0; zi < z1; zi++) {
+        for (int yi = y0; yi < y1; yi++) {
+          for (int xi = x0; xi < x1; xi++) {
+            unsigned long value = voxel_geometry_old[idx3((long)zi, yi, xi, ny_old, nx_old)];
+            if (value == 1) n_solid++;
+            else if (value == 2) n_immersed++;
+            else n_void++;
+          }
+        }
+      }
+      int n_fine = n_void + n_solid + n_immersed;
+      bool solid;
+      if (rule == HGF_COARSEN_ANY_FLUID) solid = (n_solid == n_fine);
+      else solid = (2 * n_solid > n_fine);
+      if (solid && rule == HGF_COARSEN_CONNECTIVITY && n_solid < n_fine) {
+        solid = !block_crossed(voxel_geometry_old, nx_old, ny_old, x0, x1, y0, y1, z0, z1, par.dimension, visited, stack);
+      }
+      if (solid) par.voxel_geometry[cc] = 1;
+      else par.voxel_geometry[cc] = (n_immersed > n_void) ? 2 : 0;
+    }
+  }
+
+  par.nx = nx_new;
+  par.ny = ny_new;
+  if (par.nz) par.nz = nz_new;
+
+  geo_sanity(par);
+  remove_dead_pores(par);
+}
+
 /** \brief Function removes cells from a mesh that are boundaries in opposite directions. Returns number of cells removed.
  *
  * @param[in] par - parameters file containing mesh information.
@@ -458,3 +587,75 @@ hgf::mesh::remove_dead_pores(parameters& par)
 
   return pores_removed;
 }
+
+/** \brief Computes the neighbors of each mesh cell on the periodic lattice, wrapping across every face of the domain.
+ *
+ * Cells are the non-solid voxels in voxel order, as in hgf::mesh::voxel, and neighbors are listed in the face order
+ * of the mesh (y-, x+, y+, x- and, in 3d, z-, z+). Also lists one cell of each connected fluid region, the lowest numbered,
+ * so periodic models can fix the pressure level that the boundary conditions leave undetermined.
+ * @param[in] par - parameters struct containing geometry information.
+ * @param[out] neighbors - 2 * dimension neighbors per cell, -1 where the neighboring voxel is solid.
+ * @param[out] regions - lowest numbered cell of each connected region.
+ */
+void
+hgf::mesh::periodic_neighbors(const parameters& par, std::vector< int >& neighbors, std::vector< int >& regions)
+{
+  int nz = (par.dimension == 3) ? par.nz : 1;
+  int n_faces = 2 * par.dimension;
+  // with fewer than 3 voxels a cell would meet the same neighbor across both faces of an axis
+  if (par.nx < 3 || par.ny < 3 || (par.dimension == 3 && par.nz < 3)) {
+    std::cout << "\nPeriodic neighbors require at least 3 voxels along every axis. Exiting.\n";
+    exit(0);
+  }
+
+  // cell number of each voxel, -1 for solids
+  std::vector< int > voxel_cell(par.voxel_geometry.size(), -1);
+  int n_cells = 0;
+  for (int ii = 0; ii < (int)par.voxel_geometry.size(); ii++) {
+    if (par.voxel_geometry[ii] != 1) voxel_cell[ii] = n_cells++;
+  }
+
+  neighbors.assign(n_cells * n_faces, -1);
+#pragma omp parallel for schedule(static)
+  for (int zi = 0; zi < nz; zi++) {
+    for (int yi = 0; yi < par.ny; yi++) {
+      for (int xi = 0; xi < par.nx; xi++) {
+        int cell = voxel_cell[idx3(zi, yi, xi, par.ny, par.nx)];
+        if (cell == -1) continue;
+        int ym = (yi + par.ny - 1) % par.ny, yp = (yi + 1) % par.ny;
+        int xm = (xi + par.nx - 1) % par.nx, xp = (xi + 1) % par.nx;
+        neighbors[idx2(cell, 0, n_faces)] = voxel_cell[idx3(zi, ym, xi, par.ny, par.nx)];
+        neighbors[idx2(cell, 1, n_faces)] = voxel_cell[idx3(zi, yi, xp, par.ny, par.nx)];
+        neighbors[idx2(cell, 2, n_faces)] = voxel_cell[idx3(zi, yp, xi, par.ny, par.nx)];
+        neighbors[idx2(cell, 3, n_faces)] = voxel_cell[idx3(zi, yi, xm, par.ny, par.nx)];
+        if (par.dimension == 3) {
+          int zm = (zi + nz - 1) % nz, zp = (zi + 1) % nz;
+          neighbors[idx2(cell, 4, n_faces)] = voxel_cell[idx3(zm, yi, xi, par.ny, par.nx)];
+          neighbors[idx2(cell, 5, n_faces)] = voxel_cell[idx3(zp, yi, xi, par.ny, par.nx)];
+        }
+      }
+    }
+  }
+
+  // connected regions by a search from each unvisited cell
+  regions.clear();
+  std::vector< char > visited(n_cells, 0);
+  std::vector< int > search_queue;
+  for (int cell = 0; cell < n_cells; cell++) {
+    if (visited[cell]) continue;
+    regions.push_back(cell);
+    visited[cell] = 1;
+    search_queue.push_back(cell);
+    while (search_queue.size()) {
+      int current = search_queue.back();
+      search_queue.pop_back();
+      for (int ff = 0; ff < n_faces; ff++) {
+        int nbr = neighbors[idx2(current, ff, n_faces)];
+        if (nbr != -1 && !visited[nbr]) {
+          visited[nbr] = 1;
+          search_queue.push_back(nbr);
+        }
+      }
+    }
+  }
+}
@@ -1290,3 +1290,89 @@ hgf::mesh::voxel::printVTK(const parameters& par)
     }
   }
 }
+
+/** \brief Saves a scalar field defined on the mesh cells to a file for VTK visualization.
+ *
+ * @param[in] par - parameters struct containing problem information, including problem directory.
+ * @param[in] cell_data - one value per cell, ordered as els (see hgf::mesh::voxel_to_cell_field).
+ * @param[in] data_name - name given to the scalar field in the VTK file.
+ * @param[in,out] file_name - string used to name the output file, which is placed in the problem directory contained in parameters& par.
+ */
+void
+hgf::mesh::voxel::output_vtk(const parameters& par, const std::vector< double >& cell_data, const std::string& data_name, std::string& file_name)
+{
+  int nEls = (int)els.size();
+  int nVtx = (par.dimension == 3) ? 8 : 4;
+  int nNodes = (int)gtlNode.size() / nVtx;
+  // gtlNode slot -> local vertex holding the node, see build_from_voxel_hex/quad
+  int vtx_3d[8] = { 5, 4, 7, 6, 1, 0, 3, 2 };
+  int vtx_2d[4] = { 2, 3, 1, 0 };
+  int *local_vtx = (par.dimension == 3) ? vtx_3d : vtx_2d;
+
+  // build an exclusive nodes vector
+  std::vector<double> nodes(nNodes * 3, 0.0);
+#pragma omp parallel for
+  for (int ii = 0; ii < nNodes; ii++) {
+    for (int jj = 0; jj < nVtx; jj++) {
+      if (gtlNode[idx2(ii, jj, nVtx)]) {
+        for (int dir = 0; dir < par.dimension; dir++) {
+          nodes[idx2(ii, dir, 3)] = els[gtlNode[idx2(ii, jj, nVtx)] - 1].vtx[local_vtx[jj]].coords[dir];
+        }
+        break;
+      }
+    }
+  }
+
+  bfs::path output_path(par.problem_path / file_name.c_str());
+  output_path += ".vtk";
+  std::ofstream outstream;
+  outstream.open(output_path.string());
+  outstream << "# vtk DataFile Version 3.0\n";
+  outstream << "vtk output\n";
+  outstream << "ASCII\n\n";
+  outstream << "DATASET UNSTRUCTURED_GRID\n";
+  outstream << "POINTS " << nNodes << " double\n";
+  for (int row = 0; row < nNodes; row++) {
+    outstream << nodes[idx2(row, 0, 3)] << "\t";
+    outstream << nodes[idx2(row, 1, 3)] << "\t";
+    outstream << nodes[idx2(row, 2, 3)] << "\n";
+  }
+  outstream << "\n";
+  if (par.dimension == 3) {
+    outstream << "CELLS " << nEls << " " << 9 * nEls << "\n";
+    for (int row = 0; row < nEls; row++) {
+      outstream << 8 << "\t";
+      outstream << els[row].vtx[0].gnum << "\t";
+      outstream << els[row].vtx[1].gnum << "\t";
+      outstream << els[row].vtx[2].gnum << "\t";
+      outstream << els[row].vtx[3].gnum << "\t";
+      outstream << els[row].vtx[7].gnum << "\t";
+      outstream << els[row].vtx[6].gnum << "\t";
+      outstream << els[row].vtx[5].gnum << "\t";
+      outstream << els[row].vtx[4].gnum << "\n";
+    }
+  }
+  else {
+    outstream << "CELLS " << nEls << " " << 5 * nEls << "\n";
+    for (int row = 0; row < nEls; row++) {
+      outstream << 4 << "\t";
+      outstream << els[row].vtx[0].gnum << "\t";
+      outstream << els[row].vtx[1].gnum << "\t";
+      outstream << els[row].vtx[2].gnum << "\t";
+      outstream << els[row].vtx[3].gnum << "\n";
+    }
+  }
+  outstream << "\n";
+  outstream << "CELL_TYPES " << nEls << "\n";
+  for (int row = 0; row < nEls; row++) {
+    outstream << ((par.dimension == 3) ? 12 : 9) << "\n";
+  }
+  outstream << "\n";
+  outstream << "CELL_DATA " << nEls << "\n";
+  outstream << "SCALARS " << data_name << " double\n";
+  outstream << "LOOKUP_TABLE default\n";
+  for (int row = 0; row < nEls; row++) {
+    outstream << cell_data[row] << "\n";
+  }
+  outstream.close();
+}
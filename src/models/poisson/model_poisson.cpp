@@ -77,6 +77,18 @@ hgf::models::poisson::build(const parameters& par, const hgf::mesh::voxel& msh)
     build_array_3d(par, msh);
 
   }
+
+  // list the cells on the boundary once, boundary condition setup then only visits these
+  boundary_cells.clear();
+  for (int cell = 0; cell < (int)phi.size(); cell++) {
+    for (int jj = 0; jj < 2 * par.dimension; jj++) {
+      if (phi[cell].neighbors[jj] == -1) {
+        boundary_cells.push_back(cell);
+        break;
+      }
+    }
+  }
+  boundary_block_size = ((int)boundary_cells.size() % NTHREADS) ? (int)((boundary_cells.size() / NTHREADS) + 1) : (int)(boundary_cells.size() / NTHREADS);
 }
 
 /** \brief hgf::models::poisson::setup_dirichlet_bc setups up the boundary conditions for Dirichlet boundary conditions. If nothing is added to the force,
@@ -100,13 +112,14 @@ hgf::models::poisson::setup_dirichlet_bc(const parameters& par, const hgf::mesh:
  * Contributions to the linear system coo_array and the rhs vector are set by this function.
  * @param[in] par - parameters struct containing problem information.
  * @param[in] msh - mesh object containing a quadrilateral or hexagonal representation of geometry from problem folder addressed in parameters& par.
- * @param[in] f - pointer to heuristic function. Heuristic should take a cell index and coordinates as inputs, 
+ * A lambda or other function object may be passed instead, which lets the compiler inline it. is_dirichlet is called from
+ * several OpenMP threads at once, so it must be thread safe: no unsynchronized writes to shared state.
+ * @param[in] is_dirichlet - pointer to heuristic function. Heuristic should take a cell index and coordinates as inputs, 
  *                and return true if the location has a dirichlet bc or false if the location has a neumann bc.
  * 
  */
 void
 hgf::models::poisson::setup_mixed_bc(const parameters& par, const hgf::mesh::voxel& msh, bool (*is_dirichlet)( const parameters& par, int dof_num, double coords[3] ))
 {
-  if (par.dimension == 2) homogeneous_mixed_2d(par, msh, is_dirichlet);
-  else homogeneous_mixed_3d(par, msh, is_dirichlet);
+  setup_mixed_bc< bool (*)( const parameters&, int, double* ) >(par, msh, is_dirichlet);
 }
\ No newline at end of file
@@ -6,9 +6,13 @@
 // 1d->2d index
 #define idx2(i, j, ldi) ((i * ldi) + j)
 
-// simple distance formula
-#define distance(x1,y1,x2,y2) \
-  sqrt(pow((x1-x2),2) + pow((y1-y2),2))
+// difference of two coordinates along an axis, wrapped to the nearest image when the axis has a period
+#define periodic_difference(dx, period) \
+  ((period > 0 && fabs(dx) > 0.5 * period) ? ((dx > 0) ? (dx - period) : (dx + period)) : (dx))
+
+// simple distance formula, across the periodic faces of the domain where period is nonzero
+#define distance(x1,y1,x2,y2,period) \
+  sqrt(pow(periodic_difference((x1-x2), period[0]),2) + pow(periodic_difference((y1-y2), period[1]),2))
 
 void
 hgf::models::poisson::build_array_2d(const parameters& par, const hgf::mesh::voxel& msh)
@@ -19,6 +23,13 @@ hgf::models::poisson::build_array_2d(const parameters& par, const hgf::mesh::vox
   int maxp = block_size * 5;
   for (int ii = 0; ii < NTHREADS; ii++) temp_arrays[ii].reserve(maxp);
 
+  // neighbors across the periodic faces of the domain are measured the short way
+  double period[3] = { 0, 0, 0 };
+  if (par.periodic) {
+    period[0] = par.length;
+    period[1] = par.width;
+  }
+
   bool alpha_diag;
 
 #pragma omp parallel
@@ -47,14 +58,14 @@ hgf::models::poisson::build_array_2d(const parameters& par, const hgf::mesh::vox
         for (int jj = 0; jj < 4; jj++) {
           if (nbrs[jj] > -1) {
             d_dofs[jj] = distance(phi[ii].coords[0], phi[ii].coords[1], \
-              phi[nbrs[jj]].coords[0], phi[nbrs[jj]].coords[1]);
+              phi[nbrs[jj]].coords[0], phi[nbrs[jj]].coords[1], period);
           }
         }
         // compute edge distances
         for (int jj = 0; jj < 4; jj++) {
           int nn = (jj < 3) ? (jj + 1) : 0;
           d_edges[jj] = distance(msh.els[ii].vtx[jj].coords[0], msh.els[ii].vtx[jj].coords[1], \
-                                 msh.els[ii].vtx[nn].coords[0], msh.els[ii].vtx[nn].coords[1]);
+                                 msh.els[ii].vtx[nn].coords[0], msh.els[ii].vtx[nn].coords[1], period);
         }
 
         if (alpha_diag) {
@@ -6,9 +6,13 @@
 // 1d->2d index
 #define idx2(i, j, ldi) ((i * ldi) + j)
 
-// simple distance formula
-#define distance(x1,y1,z1,x2,y2,z2) \
-  sqrt(pow((x1-x2),2) + pow((y1-y2),2) + pow((z1-z2),2))
+// difference of two coordinates along an axis, wrapped to the nearest image when the axis has a period
+#define periodic_difference(dx, period) \
+  ((period > 0 && fabs(dx) > 0.5 * period) ? ((dx > 0) ? (dx - period) : (dx + period)) : (dx))
+
+// simple distance formula, across the periodic faces of the domain where period is nonzero
+#define distance(x1,y1,z1,x2,y2,z2,period) \
+  sqrt(pow(periodic_difference((x1-x2), period[0]),2) + pow(periodic_difference((y1-y2), period[1]),2) + pow(periodic_difference((z1-z2), period[2]),2))
 
 void
 hgf::models::poisson::build_array_3d(const parameters& par, const hgf::mesh::voxel& msh)
@@ -19,6 +23,14 @@ hgf::models::poisson::build_array_3d(const parameters& par, const hgf::mesh::vox
   int maxp = block_size * 7;
   for (int ii = 0; ii < NTHREADS; ii++) temp_arrays[ii].reserve(maxp);
 
+  // neighbors across the periodic faces of the domain are measured the short way
+  double period[3] = { 0, 0, 0 };
+  if (par.periodic) {
+    period[0] = par.length;
+    period[1] = par.width;
+    period[2] = par.height;
+  }
+
   bool alpha_diag;
 
 #pragma omp parallel
@@ -45,21 +57,20 @@ hgf::models::poisson::build_array_3d(const parameters& par, const hgf::mesh::vox
         for (int jj = 0; jj < 6; jj++) {
           if (nbrs[jj] > -1) {
             d_dofs[jj] = distance(phi[ii].coords[0], phi[ii].coords[1], phi[ii].coords[2], \
-              phi[nbrs[jj]].coords[0], phi[nbrs[jj]].coords[1], phi[nbrs[jj]].coords[2]);
+              phi[nbrs[jj]].coords[0], phi[nbrs[jj]].coords[1], phi[nbrs[jj]].coords[2], period);
           }
         }
 
-        // face dimensions
-        // temporarily uniform...
-        d_faces[0] = distance(msh.els[ii].vtx[0].coords[0], msh.els[ii].vtx[0].coords[1], msh.els[ii].vtx[0].coords[2], \
-                              msh.els[ii].vtx[1].coords[0], msh.els[ii].vtx[1].coords[1], msh.els[ii].vtx[1].coords[2]) \
-                   * distance(msh.els[ii].vtx[0].coords[0], msh.els[ii].vtx[0].coords[1], msh.els[ii].vtx[0].coords[2], \
-                              msh.els[ii].vtx[3].coords[0], msh.els[ii].vtx[3].coords[1], msh.els[ii].vtx[3].coords[2]);
-        d_faces[1] = d_faces[0];
+        // face areas, slots 0 and 2 are normal to y, 1 and 3 to x, 4 and 5 to z
+        double dx = msh.els[ii].vtx[1].coords[0] - msh.els[ii].vtx[0].coords[0];
+        double dy = msh.els[ii].vtx[2].coords[1] - msh.els[ii].vtx[1].coords[1];
+        double dz = msh.els[ii].vtx[7].coords[2] - msh.els[ii].vtx[0].coords[2];
+        d_faces[0] = dx * dz;
+        d_faces[1] = dy * dz;
         d_faces[2] = d_faces[0];
-        d_faces[3] = d_faces[0];
-        d_faces[4] = d_faces[0];
-        d_faces[5] = d_faces[0];
+        d_faces[3] = d_faces[1];
+        d_faces[4] = dx * dy;
+        d_faces[5] = d_faces[4];
 
         if (alpha_diag) {
           double alpha_cst; 
@@ -0,0 +1,82 @@
+/* poisson periodic bc source */
+
+// hgf includes
+#include "model_poisson.hpp"
+
+// neighbor slots on the lower and upper side of each axis
+static const int lower_slot[3] = { 3, 0, 4 };
+static const int upper_slot[3] = { 1, 2, 5 };
+
+/** \brief hgf::models::poisson::setup_periodic_bc sets up the boundary conditions of a periodic problem driven by a mean gradient along one axis.
+ *
+ * Requires a model built with par.periodic set, so that cells are connected across every face of the domain.
+ * Solid walls are zero flux (Neumann), the solution is driven by the mean gradient -par.periodic_drive along direction,
+ * and it is fixed to zero at one cell of each connected region. With HGF_PERIODIC_BODY_FORCE the solution is the
+ * periodic part of the potential, with HGF_PERIODIC_PRESSURE_JUMP it is the potential itself, dropping by the drive
+ * times the domain length across the periodic faces.
+ * Contributions to the linear system coo_array and the rhs vector are set by this function.
+ * @param[in] par - parameters struct containing problem information.
+ * @param[in] msh - not used, the periodic conditions only need the degrees of freedom; kept to match the other setup functions.
+ * @param[in] direction - axis of the mean gradient, 0, 1 or 2 for x, y or z.
+ * @param[in] DRIVE - body force or pressure jump drive.
+ */
+void
+hgf::models::poisson::setup_periodic_bc(const parameters& par, const hgf::mesh::voxel&, int direction, const HGF_PERIODIC& DRIVE)
+{
+  if (!par.periodic) {
+    std::cout << "\nPeriodic boundary conditions require a Poisson model built with par.periodic set. Exiting.\n";
+    exit(0);
+  }
+  if (direction < 0 || direction >= par.dimension) {
+    std::cout << "\nInvalid direction " << direction << " for a " << par.dimension << "d Poisson problem. Exiting.\n";
+    exit(0);
+  }
+
+  int n_slots = 2 * par.dimension;
+  int n_cells[3] = { par.nx, par.ny, par.nz };
+  double box[3] = { par.length, par.width, par.height };
+  double h[3], area[3];
+  for (int kk = 0; kk < par.dimension; kk++) h[kk] = box[kk] / n_cells[kk];
+  for (int kk = 0; kk < par.dimension; kk++) {
+    area[kk] = 1.0;
+    for (int ll = 0; ll < par.dimension; ll++) if (ll != kk) area[kk] *= h[ll];
+  }
+  int diag = direction * (par.dimension + 1);  // alpha entry along direction
+  int lower = lower_slot[direction];
+  int upper = upper_slot[direction];
+  double drive = par.periodic_drive;
+
+  // walls are zero flux, which adds nothing to the linear system
+  for (int ll = 0; ll < (int)boundary_cells.size(); ll++) {
+    int ii = boundary_cells[ll];
+    for (int jj = 0; jj < n_slots; jj++) if (phi[ii].neighbors[jj] == -1) bc_types[ii][jj] = 2;
+  }
+
+  // the mean gradient enters as a flux through each face normal to direction
+#pragma omp parallel for num_threads(NTHREADS)
+  for (int ii = 0; ii < (int)phi.size(); ii++) {
+    int layer = (int)(phi[ii].coords[direction] / h[direction]);
+    int nbr = phi[ii].neighbors[lower];
+    if (nbr != -1) {
+      double flux = mean_perm(alpha[ii][diag], alpha[nbr][diag]) * area[direction] * drive;
+      if (DRIVE == HGF_PERIODIC_BODY_FORCE) rhs[ii] += flux;
+      else if (layer == 0) rhs[ii] += flux * box[direction] / h[direction];
+    }
+    nbr = phi[ii].neighbors[upper];
+    if (nbr != -1) {
+      double flux = mean_perm(alpha[ii][diag], alpha[nbr][diag]) * area[direction] * drive;
+      if (DRIVE == HGF_PERIODIC_BODY_FORCE) rhs[ii] -= flux;
+      else if (layer == n_cells[direction] - 1) rhs[ii] -= flux * box[direction] / h[direction];
+    }
+  }
+
+  // periodic faces leave the level of each region free, fix it to zero at one cell of the region
+  array_coo temp_coo;
+  for (int ll = 0; ll < (int)reference_cells.size(); ll++) {
+    int ii = reference_cells[ll];
+    temp_coo.i_index = ii;
+    temp_coo.j_index = ii;
+    temp_coo.value = alpha[ii][diag] * area[direction] / h[direction];
+    coo_array.push_back(temp_coo);
+  }
+}
@@ -6,6 +6,11 @@
 void
 hgf::models::poisson::build_degrees_of_freedom_3d(const parameters& par, const hgf::mesh::voxel& msh)
 {
+  // periodic problems take the neighbors across the domain faces from the periodic lattice
+  std::vector< int > periodic_table;
+  reference_cells.clear();
+  if (par.periodic) hgf::mesh::periodic_neighbors(par, periodic_table, reference_cells);
+
 #pragma omp parallel for num_threads(NTHREADS)
   for (int cell = 0; cell < msh.els.size(); cell++) {
     degree_of_freedom dof_temp;
@@ -21,7 +26,9 @@ hgf::models::poisson::build_degrees_of_freedom_3d(const parameters& par, const h
     dof_temp.cell_numbers[0] = cell;
     dof_temp.cell_numbers[1] = -1;
     // neighbors
-    for (int nbr = 0; nbr < 6; nbr++) dof_temp.neighbors[nbr] = msh.els[cell].fac[nbr].neighbor;
+    for (int nbr = 0; nbr < 6; nbr++) {
+      dof_temp.neighbors[nbr] = periodic_table.size() ? periodic_table[cell * 6 + nbr] : msh.els[cell].fac[nbr].neighbor;
+    }
     // place phi dof
     phi[cell] = dof_temp;
   }
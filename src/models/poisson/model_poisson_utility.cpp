@@ -6,16 +6,161 @@
 // 1d->2d index
 #define idx2(i, j, ldi) ((i * ldi) + j)
 
-#define midpoint_2d( mid, first, last ) do { \
-  mid[0] = 0.5 * (first[0] + last[0]); \
-  mid[1] = 0.5 * (first[1] + last[1]); \
-} while(0)
+// lattice axis crossed by each neighbor slot (y-, x+, y+, x-, z-, z+), and the side of the cell it lies on
+static const int slot_axis[6] = { 1, 0, 1, 0, 2, 2 };
+static const double slot_side[6] = { -1, 1, 1, -1, -1, 1 };
 
-#define midpoint_3d( mid, first, second, third, fourth ) do { \
-  mid[0] = 0.25 * (first[0] + second[0] + third[0] + fourth[0]); \
-  mid[1] = 0.25 * (first[1] + second[1] + third[1] + fourth[1]); \
-  mid[2] = 0.25 * (first[2] + second[2] + third[2] + fourth[2]); \
-} while(0)
+// edge lengths of a cell, taken from its mesh vertices
+static inline void
+cell_spacing(const parameters& par, const hgf::mesh::voxel& msh, int cell, double h[3])
+{
+  h[0] = msh.els[cell].vtx[1].coords[0] - msh.els[cell].vtx[0].coords[0];
+  h[1] = msh.els[cell].vtx[3].coords[1] - msh.els[cell].vtx[0].coords[1];
+  h[2] = (par.dimension == 3) ? msh.els[cell].vtx[7].coords[2] - msh.els[cell].vtx[0].coords[2] : 0;
+}
+
+// true if the alpha tensor of a cell is diagonal, the only case boundary conditions handle so far
+static inline bool
+diagonal_alpha(const std::vector< double >& alpha_cell, int dim)
+{
+  for (int ii = 0; ii < dim * dim; ii++) if (ii % (dim + 1) && alpha_cell[ii] != 0.0) return false;
+  return true;
+}
+
+// diagonal coefficient of a Dirichlet condition on face slot jj, alpha times the face area over half the cell width
+static inline double
+dirichlet_coefficient(const std::vector< double >& alpha_cell, int dim, const double h[3], int jj)
+{
+  int aa = slot_axis[jj];
+  double area = 1.0;
+  for (int kk = 0; kk < dim; kk++) if (kk != aa) area *= h[kk];
+  return alpha_cell[aa * (dim + 1)] * area / (0.5 * h[aa]);
+}
+
+/** \brief hgf::models::poisson::boundary_faces lists the faces on the domain boundary or a solid wall, with their midpoints.
+ *
+ * Faces are grouped by cell in the order of boundary_cells, and within a cell ordered by neighbor slot. The list is the
+ * input of the array overloads of setup_mixed_bc and add_nonhomogeneous_bc, so boundary types and values can be
+ * computed for every face in one call, and may be kept for repeated solves on the same model.
+ * @param[in] par - parameters struct containing problem information.
+ * @param[in] msh - mesh object containing a quadrilateral or hexagonal representation of geometry from problem folder addressed in parameters& par.
+ * @param[out] faces - boundary faces of the model.
+ */
+void
+hgf::models::poisson::boundary_faces(const parameters& par, const hgf::mesh::voxel& msh, poisson_boundary& faces) const
+{
+  int n_slots = 2 * par.dimension;
+  int n_cells = (int)boundary_cells.size();
+
+  // count the faces of each boundary cell, then fill them in parallel
+  faces.first.assign(n_cells + 1, 0);
+#pragma omp parallel for schedule(static) num_threads(NTHREADS)
+  for (int ll = 0; ll < n_cells; ll++) {
+    int count = 0;
+    for (int jj = 0; jj < n_slots; jj++) if (phi[boundary_cells[ll]].neighbors[jj] == -1) count++;
+    faces.first[ll + 1] = count;
+  }
+  for (int ll = 0; ll < n_cells; ll++) faces.first[ll + 1] += faces.first[ll];
+  faces.cell.resize(faces.first[n_cells]);
+  faces.face.resize(faces.first[n_cells]);
+  faces.coords.resize(3 * faces.first[n_cells]);
+
+#pragma omp parallel for schedule(static) num_threads(NTHREADS)
+  for (int ll = 0; ll < n_cells; ll++) {
+    int cell = boundary_cells[ll];
+    double h[3];
+    cell_spacing(par, msh, cell, h);
+    int pos = faces.first[ll];
+    for (int jj = 0; jj < n_slots; jj++) {
+      if (phi[cell].neighbors[jj] != -1) continue;
+      faces.cell[pos] = cell;
+      faces.face[pos] = jj;
+      for (int kk = 0; kk < 3; kk++) faces.coords[idx2(pos, kk, 3)] = (kk < par.dimension) ? phi[cell].coords[kk] : 0;
+      faces.coords[idx2(pos, slot_axis[jj], 3)] += 0.5 * slot_side[jj] * h[slot_axis[jj]];
+      pos++;
+    }
+  }
+}
+
+/** \brief hgf::models::poisson::setup_mixed_bc sets up mixed Dirichlet and Neumann boundary conditions given on a list of boundary faces.
+ *
+ * Batched form of setup_mixed_bc: the boundary type of every face is computed by the caller, e.g. in one call for
+ * the whole list. Contributions to the linear system coo_array are set by this function.
+ * @param[in] par - parameters struct containing problem information.
+ * @param[in] msh - mesh object containing a quadrilateral or hexagonal representation of geometry from problem folder addressed in parameters& par.
+ * @param[in] faces - boundary faces from hgf::models::poisson::boundary_faces.
+ * @param[in] dirichlet - nonzero for each face with a Dirichlet condition, zero for a Neumann condition.
+ */
+void
+hgf::models::poisson::setup_mixed_bc(const parameters& par, const hgf::mesh::voxel& msh, const poisson_boundary& faces, const std::vector< int >& dirichlet)
+{
+  int dim = par.dimension;
+
+  // define temp coo arrays to store results in parallel region
+  std::vector< std::vector< array_coo > > temp_arrays(NTHREADS);
+
+#pragma omp parallel num_threads(NTHREADS)
+  {
+    int tid = omp_get_thread_num();
+    array_coo temp_coo;
+#pragma omp for schedule(static)
+    for (int ll = 0; ll < (int)boundary_cells.size(); ll++) {
+      int cell = boundary_cells[ll];
+      if (!diagonal_alpha(alpha[cell], dim)) continue;  // Nondiag alpha, TODO
+      double h[3];
+      cell_spacing(par, msh, cell, h);
+      double value = 0;
+      for (int ff = faces.first[ll]; ff < faces.first[ll + 1]; ff++) {
+        int jj = faces.face[ff];
+        if (dirichlet[ff]) {
+          bc_types[cell][jj] = 1;
+          value += dirichlet_coefficient(alpha[cell], dim, h, jj);
+        }
+        else bc_types[cell][jj] = 2;
+      }
+      if (value) {
+        temp_coo.i_index = cell;
+        temp_coo.j_index = cell;
+        temp_coo.value = value;
+        temp_arrays[tid].push_back(temp_coo);
+      }
+    }
+  }
+
+  // paste
+  for (int ii = 0; ii < NTHREADS; ii++) coo_array.insert(coo_array.end(), temp_arrays[ii].begin(), temp_arrays[ii].end());
+}
+
+/** \brief hgf::models::poisson::add_nonhomogeneous_bc adds to the force vector nonhomogeneous Dirichlet and Neumann values given on a list of boundary faces.
+ *
+ * Batched form of add_nonhomogeneous_bc: the value of every face is computed by the caller, e.g. in one call for the
+ * whole list. Should be called after the boundary types are set, as with the other overloads, and does not over-write
+ * existing values in the force vector. The Neumann condition includes the alpha coefficient.
+ * @param[in] par - parameters struct containing problem information.
+ * @param[in] msh - mesh object containing a quadrilateral or hexagonal representation of geometry from problem folder addressed in parameters& par.
+ * @param[in] faces - boundary faces from hgf::models::poisson::boundary_faces.
+ * @param[in] values - boundary value of each face.
+ */
+void
+hgf::models::poisson::add_nonhomogeneous_bc(const parameters& par, const hgf::mesh::voxel& msh, const poisson_boundary& faces, const std::vector< double >& values)
+{
+  int dim = par.dimension;
+
+#pragma omp parallel for schedule(static) num_threads(NTHREADS)
+  for (int ll = 0; ll < (int)boundary_cells.size(); ll++) {
+    int cell = boundary_cells[ll];
+    if (!diagonal_alpha(alpha[cell], dim)) continue;  // Nondiag alpha, TODO
+    double h[3];
+    cell_spacing(par, msh, cell, h);
+    double value = 0;
+    for (int ff = faces.first[ll]; ff < faces.first[ll + 1]; ff++) {
+      int jj = faces.face[ff];
+      if (bc_types[cell][jj] == 1) value += dirichlet_coefficient(alpha[cell], dim, h, jj) * values[ff];
+      else value += values[ff];
+    }
+    rhs[cell] += value;
+  }
+}
 
 /** \brief hgf::models::poisson::add_nonhomogeneous_bc adds to the force vector the values corersponding to a nonhomogeneous Dirichlet and Neumann boundary conditions.
  * 
@@ -24,6 +169,8 @@
  * edges (2d) or faces (3d) as Dirichlet or Neumann boundaries. 
  * The function adds values to the force vector according to the heuristic. It does not over-write existing values in the force vector. 
  * Note that the Neumann condition includes the alpha coefficient, i.e. the boundary condition that is imposed is "alpha grad u dot n = bc_value".
+ * A lambda or other function object may be passed instead, which lets the compiler inline it. bc_value is called from
+ * several OpenMP threads at once, so it must be thread safe: no unsynchronized writes to shared state.
  * @param[in] par - parameters struct containing problem information.
  * @param[in] msh - mesh object containing a quadrilateral or hexagonal representation of geometry from problem folder addressed in parameters& par.
  * @param[in] bc_value - pointer to heuristic function. Heuristic must take parameters struct, cell index, coordinates, and a bool which can be used to specific Dirichlet or Neuamnn outputs.
@@ -34,168 +181,7 @@ void
 hgf::models::poisson::add_nonhomogeneous_bc(const parameters& par, const hgf::mesh::voxel& msh, \
                                             double (*bc_value)( const parameters& par, int dof_num, double coords[3] ) )
 {
-
-  if (par.dimension == 2) {
-
-#pragma omp parallel for schedule(dynamic) num_threads(NTHREADS)
-    for (int kk = 0; kk < NTHREADS; kk++) { 
-      // loop over cells
-      for (int cell = kk*block_size; cell < std::min((kk + 1)*block_size, (int)phi.size()); cell++) {
-
-        bool alpha_diag;
-        double dx, dy; 
-        double value = 0;
-        double coords[3];
-        int nbrs[4];
-        int bc_contributor[4] = { 0, 0, 0, 0 };
-        int nnbr = 0;
-        for (int jj = 0; jj < 4; jj++) {
-          nbrs[jj] = phi[cell].neighbors[jj];
-          if (nbrs[jj] != -1) nnbr++;
-          else bc_contributor[jj] = 1;
-        }
-        if (nnbr == 4) goto bcexit2;
-
-        alpha_diag = (alpha[cell][1] == 0.0 && alpha[cell][2] == 0.0);
-
-        dx = msh.els[cell].vtx[1].coords[0] - msh.els[cell].vtx[0].coords[0];
-        dy = msh.els[cell].vtx[3].coords[1] - msh.els[cell].vtx[0].coords[1];
-
-        if (alpha_diag) {
-
-          // S neighbor?
-          if (bc_contributor[0]) {
-            midpoint_2d(coords, msh.els[cell].vtx[0].coords, msh.els[cell].vtx[1].coords);
-            if (bc_types[cell][0] == 1) value += 2 * alpha[cell][3] * bc_value( par, cell, coords ) * dx / dy;
-            else value += bc_value( par, cell, coords );
-          } 
-      
-          // E neighbor?
-          if (bc_contributor[1]) {
-            midpoint_2d(coords, msh.els[cell].vtx[1].coords, msh.els[cell].vtx[2].coords);
-            if (bc_types[cell][1] == 1) value += 2 * alpha[cell][0] * bc_value( par, cell, coords ) * dy / dx;
-            else value += bc_value( par, cell, coords );
-          }
-      
-          // N neighbor?
-          if (bc_contributor[2]) {
-            midpoint_2d(coords, msh.els[cell].vtx[2].coords, msh.els[cell].vtx[3].coords);
-            if (bc_types[cell][2] == 1) value += 2 * alpha[cell][3] * bc_value( par, cell, coords ) * dx / dy;
-            else value += bc_value( par, cell, coords );
-          }
-      
-          // W neighbor?
-          if (bc_contributor[3]) {
-            midpoint_2d(coords, msh.els[cell].vtx[0].coords, msh.els[cell].vtx[3].coords);
-            if (bc_types[cell][3] == 1) value += 2 * alpha[cell][0] * bc_value( par, cell, coords ) * dy / dx;
-            else value += bc_value( par, cell, coords );
-          }
-
-        }
-        else { // Nondiag alpha, TODO
-
-        }
-
-        rhs[cell] += value;
-
-      bcexit2:;
-      }
-    }
-
-  } else { // 3d
-
-#pragma omp parallel for schedule(dynamic) num_threads(NTHREADS)
-    for (int kk = 0; kk < NTHREADS; kk++) { 
-      // loop over cells
-      for (int cell = kk*block_size; cell < std::min((kk + 1)*block_size, (int)phi.size()); cell++) {
-        
-        bool alpha_diag;
-        double value = 0;
-        double coords[3];
-        int nbrs[6];
-        int bc_contributor[6] = { 0, 0, 0, 0, 0, 0 };
-        int nnbr = 0;
-        double dx, dy, dz;
-        for (int jj = 0; jj < 6; jj++) {
-          nbrs[jj] = phi[cell].neighbors[jj];
-          if (nbrs[jj] != -1) nnbr++;
-          else bc_contributor[jj] = 1;
-        }
-        if (nnbr == 6) goto bcexit3;
-
-        alpha_diag = (alpha[cell][1] == 0.0 && \
-          alpha[cell][2] == 0.0 && \
-          alpha[cell][3] == 0.0 && \
-          alpha[cell][5] == 0.0 && \
-          alpha[cell][6] == 0.0 && \
-          alpha[cell][7] == 0.0);
-
-        dx = msh.els[cell].vtx[1].coords[0] - msh.els[cell].vtx[0].coords[0];
-        dy = msh.els[cell].vtx[3].coords[1] - msh.els[cell].vtx[0].coords[1];
-        dz = msh.els[cell].vtx[7].coords[2] - msh.els[cell].vtx[0].coords[2];
-
-        if (alpha_diag) {
-  
-          // y- neighbor?
-          if (bc_contributor[0]) {
-            midpoint_3d(coords, msh.els[cell].vtx[0].coords, msh.els[cell].vtx[1].coords, \
-                                msh.els[cell].vtx[6].coords, msh.els[cell].vtx[7].coords);
-            if (bc_types[cell][0] == 1) value += 2 * alpha[cell][4] * bc_value( par, cell, coords ) * dx * dz / dy;
-            else value += bc_value( par, cell, coords );
-          }
-  
-          // x+ neighbor?
-          if (bc_contributor[1]) {
-            midpoint_3d(coords, msh.els[cell].vtx[1].coords, msh.els[cell].vtx[2].coords, \
-                                msh.els[cell].vtx[5].coords, msh.els[cell].vtx[6].coords);
-            if (bc_types[cell][1] == 1) value += 2 * alpha[cell][0] * bc_value( par, cell, coords ) * dy * dz / dx;
-            else value += bc_value( par, cell, coords );
-          }
-  
-          // y+ neighbor?
-          if (bc_contributor[2]) {
-            midpoint_3d(coords, msh.els[cell].vtx[2].coords, msh.els[cell].vtx[3].coords, \
-                                msh.els[cell].vtx[4].coords, msh.els[cell].vtx[5].coords);
-            if (bc_types[cell][2] == 1) value += 2 * alpha[cell][4] * bc_value( par, cell, coords ) * dx * dz / dy;
-            else value += bc_value( par, cell, coords );
-          }
-  
-          // x- neighbor?
-          if (bc_contributor[3]) {
-            midpoint_3d(coords, msh.els[cell].vtx[0].coords, msh.els[cell].vtx[3].coords, \
-                                msh.els[cell].vtx[4].coords, msh.els[cell].vtx[7].coords);
-            if (bc_types[cell][3] == 1) value += 2 * alpha[cell][0] * bc_value( par, cell, coords ) * dy * dz / dx;
-            else value += bc_value( par, cell, coords );
-          }
-  
-          // z- neighbor?
-          if (bc_contributor[4]) {
-            midpoint_3d(coords, msh.els[cell].vtx[0].coords, msh.els[cell].vtx[1].coords, \
-                                msh.els[cell].vtx[2].coords, msh.els[cell].vtx[3].coords);
-            if (bc_types[cell][4] == 1) value += 2 * alpha[cell][8] * bc_value( par, cell, coords ) * dx * dy / dz;
-            else value += bc_value( par, cell, coords );
-          }
-  
-          // z+ neighbor?
-          if (bc_contributor[5]) {
-            midpoint_3d(coords, msh.els[cell].vtx[4].coords, msh.els[cell].vtx[5].coords, \
-                                msh.els[cell].vtx[6].coords, msh.els[cell].vtx[7].coords);
-            if (bc_types[cell][5] == 1) value += 2 * alpha[cell][8] * bc_value( par, cell, coords ) * dx * dy / dz;
-            else value += bc_value( par, cell, coords );
-          }
-
-        }
-        else { // Nondiag alpha, TODO
-
-        }
-
-        rhs[cell] += value;
-
-      bcexit3:;
-      }
-    }
-  }
-   
+  add_nonhomogeneous_bc< double (*)( const parameters&, int, double* ) >(par, msh, bc_value);
 }
 
 /** \brief hgf::models::poisson::set_constant_force sets a constant value to the force (right hand side) in the Poisson model.
@@ -66,3 +66,35 @@ hgf::models::uniform_porenetwork::build(const parameters& par)
     }
   }
 }
+
+/** \brief hgf::models::extracted_porenetwork::build builds the linear system for the interior pores of an extracted porenetwork.
+ *
+ * It is assumed that the network has already been extracted. Rows for pores touching the domain boundary are set by the boundary condition functions,
+ * which call build themselves; the parameters are not needed and only kept to match uniform_porenetwork::build.
+ */
+void
+hgf::models::extracted_porenetwork::build(const parameters&)
+{
+  rhs.assign(pores.size(), 0.0);
+  solution.assign(pores.size(), 0.0);
+  coo_array.clear();
+  array_coo temp_coo;
+  for (int ii = 0; ii < (int)pores.size(); ii++) {
+    if (!pores[ii].boundary) {
+      double diag = 0;
+      for (int jj = pore_throat_ptr[ii]; jj < pore_throat_ptr[ii + 1]; jj++) {
+        const network_throat& throat = throats[pore_throat_list[jj]];
+        temp_coo.i_index = ii;
+        temp_coo.j_index = (throat.pores[0] == ii) ? throat.pores[1] : throat.pores[0];
+        temp_coo.value = -throat.conductance;
+        coo_array.push_back(temp_coo);
+        diag += throat.conductance;
+      }
+      // isolated pore, pin its pressure
+      temp_coo.i_index = ii;
+      temp_coo.j_index = ii;
+      temp_coo.value = diag ? diag : 1.0;
+      coo_array.push_back(temp_coo);
+    }
+  }
+}
@@ -17,7 +17,8 @@ hgf::models::uniform_porenetwork::setup_xflow_bc(const parameters& par)
   double pn_epsilon = 1E-12;
   int idx_swap[6] = { 2, 3, 0, 1, 5, 4 };
   int entries;
-  for (int ii = 0; ii < (int)pressure.size(); ii++) {
+  for (int ll = 0; ll < (int)boundary_pores.size(); ll++) {
+    int ii = boundary_pores[ll];
     entries = 0;
     if (pressure[ii].doftype) {
       // inflow
@@ -73,7 +74,8 @@ hgf::models::uniform_porenetwork::setup_yflow_bc(const parameters& par)
   double pn_epsilon = 1E-12;
   int idx_swap[6] = { 2, 3, 0, 1, 5, 4 };
   int entries;
-  for (int ii = 0; ii < (int)pressure.size(); ii++) {
+  for (int ll = 0; ll < (int)boundary_pores.size(); ll++) {
+    int ii = boundary_pores[ll];
     entries = 0;
     if (pressure[ii].doftype) {
       // inflow
@@ -134,7 +136,8 @@ hgf::models::uniform_porenetwork::setup_zflow_bc(const parameters& par)
   double pn_epsilon = 1E-12;
   int idx_swap[6] = { 2, 3, 0, 1, 5, 4 };
   int entries;
-  for (int ii = 0; ii < (int)pressure.size(); ii++) {
+  for (int ll = 0; ll < (int)boundary_pores.size(); ll++) {
+    int ii = boundary_pores[ll];
     entries = 0;
     if (pressure[ii].doftype) {
       // inflow
@@ -178,3 +181,82 @@ hgf::models::uniform_porenetwork::setup_zflow_bc(const parameters& par)
     }
   }
 }
+
+/* Boundary rows for an extracted network: pores touching the inflow face (bit inflow_bit) are connected
+   to a reservoir at pressure 1 and pores touching the opposite face to a reservoir at pressure 0,
+   through their boundary conductances. Other domain faces are walls. */
+static void
+extracted_flow_bc(hgf::models::extracted_porenetwork& pn, int inflow_bit)
+{
+  array_coo temp_coo;
+  int outflow_bit = inflow_bit << 1;
+  int inflow_face = (inflow_bit == 1) ? 0 : ((inflow_bit == 4) ? 2 : 4);
+  for (int ll = 0; ll < (int)pn.boundary_pores.size(); ll++) {
+    int ii = pn.boundary_pores[ll];
+    temp_coo.i_index = ii;
+    double diag = 0;
+    for (int jj = pn.pore_throat_ptr[ii]; jj < pn.pore_throat_ptr[ii + 1]; jj++) {
+      const network_throat& throat = pn.throats[pn.pore_throat_list[jj]];
+      temp_coo.j_index = (throat.pores[0] == ii) ? throat.pores[1] : throat.pores[0];
+      temp_coo.value = -throat.conductance;
+      pn.coo_array.push_back(temp_coo);
+      diag += throat.conductance;
+    }
+    // inflow
+    if (pn.pores[ii].boundary & inflow_bit) {
+      diag += pn.pores[ii].boundary_conductance[inflow_face];
+      pn.rhs[ii] += pn.pores[ii].boundary_conductance[inflow_face];
+    }
+    // outflow
+    if (pn.pores[ii].boundary & outflow_bit) {
+      diag += pn.pores[ii].boundary_conductance[inflow_face + 1];
+    }
+    temp_coo.j_index = ii;
+    temp_coo.value = diag ? diag : 1.0;
+    pn.coo_array.push_back(temp_coo);
+  }
+}
+
+/** \brief hgf::models::extracted_porenetwork::setup_xflow_bc sets boundary conditions in the linear system to induce flow in the x-direction.
+ *
+ * The interior rows are rebuilt first, so the network can be solved in several directions in turn.
+ *
+ * @param[in] par - parameters struct containing problem information.
+ */
+void
+hgf::models::extracted_porenetwork::setup_xflow_bc(const parameters& par)
+{
+  build(par);
+  extracted_flow_bc(*this, 1);
+}
+
+/** \brief hgf::models::extracted_porenetwork::setup_yflow_bc sets boundary conditions in the linear system to induce flow in the y-direction.
+ *
+ * The interior rows are rebuilt first, so the network can be solved in several directions in turn.
+ *
+ * @param[in] par - parameters struct containing problem information.
+ */
+void
+hgf::models::extracted_porenetwork::setup_yflow_bc(const parameters& par)
+{
+  build(par);
+  extracted_flow_bc(*this, 4);
+}
+
+/** \brief hgf::models::extracted_porenetwork::setup_zflow_bc sets boundary conditions in the linear system to induce flow in the z-direction.
+ *
+ * The interior rows are rebuilt first, so the network can be solved in several directions in turn.
+ *
+ * @param[in] par - parameters struct containing problem information.
+ */
+void
+hgf::models::extracted_porenetwork::setup_zflow_bc(const parameters& par)
+{
+  // quick exit
+  if (par.dimension == 2) {
+    std::cout << "\nError: zflow boundary conditions are not compatible with 2-dimensional problem. Exiting\n";
+    exit(1);
+  }
+  build(par);
+  extracted_flow_bc(*this, 16);
+}
@@ -0,0 +1,417 @@
+/* porenetwork extraction source */
+
+// hgf includes
+#include "model_porenetwork.hpp"
+
+// system includes
+#include <algorithm>
+#include <unordered_map>
+#include <math.h>
+#include <omp.h>
+
+// 1d->2d index
+#define idx2(i, j, ldi) ((i * ldi) + j)
+
+// 1d->3d index
+#define idx3(i, j, k, ldi1, ldi2) (k + (ldi2 * (j + ldi1 * i)))
+
+// interface between two regions, accumulated while scanning voxel faces
+struct region_interface
+{
+  double saddle;
+  double area;
+};
+
+// voxel count, coordinate sums and boundary faces of a pore, accumulated while scanning voxels
+struct pore_sums
+{
+  double count;
+  double x;
+  double y;
+  double z;
+  int boundary;
+};
+
+// union-find root with path halving
+static inline int
+uf_find(std::vector< int >& uf, int a)
+{
+  while (uf[a] != a) {
+    uf[a] = uf[uf[a]];
+    a = uf[a];
+  }
+  return a;
+}
+
+/* Hydraulic conductance per unit length of a duct with inscribed radius r:
+   Hagen-Poiseuille cylinder in 3d, plane Poiseuille slit (per unit depth) in 2d. */
+static inline double
+duct_conductance(int dimension, double r, double viscosity)
+{
+  if (dimension == 3) return 3.14159265358979323846 * r * r * r * r / (8.0 * viscosity);
+  else return 2.0 * r * r * r / (3.0 * viscosity);
+}
+
+/** \brief hgf::models::extracted_porenetwork::extract_network extracts pores and throats from the voxel geometry.
+ *
+ * The pore space is partitioned with a watershed of the Euclidean distance map (hgf::mesh::distance_transform):
+ * every void voxel follows its steepest ascent neighbor until it reaches a local maximum, with the ascent resolved
+ * in parallel by pointer jumping. Maxima on a common plateau are joined, and a maximum lying inside the maximal
+ * inscribed ball of a larger adjacent maximum is merged into it, which removes the over-segmentation typical of
+ * raw watersheds. Each remaining region is a pore, and each pair of face-adjacent regions is connected by a throat.
+ * Throat conductances model a pore-throat-pore conduit of ducts with the inscribed radii of the two pores and of the throat.
+ * Pores touching the domain boundary are connected to each face they touch by a duct running from the pore centroid to the face.
+ * Void regions not connected to the flow boundaries should be removed beforehand, see hgf::mesh::remove_dead_pores.
+ *
+ * @param[in] par - parameters struct containing problem information, including the voxel geometry.
+ */
+void
+hgf::models::extracted_porenetwork::extract_network(const parameters& par)
+{
+  int nx = par.nx;
+  int ny = par.ny;
+  int nz = (par.dimension == 3) ? par.nz : 1;
+  int zlo = (par.dimension == 3) ? -1 : 0;
+  int zhi = (par.dimension == 3) ? 1 : 0;
+  double dx = par.length / par.nx;
+  double dy = par.width / par.ny;
+  double dz = (par.dimension == 3) ? par.height / par.nz : 1.0;
+  long n_vox = (long)par.voxel_geometry.size();
+  int nthreads = omp_get_max_threads();
+
+  std::vector< double > dist;
+  hgf::mesh::distance_transform(par, dist);
+  // no solid at all: the whole void is a single pore
+  if (n_vox && dist[0] < 0) {
+    double r = 0.5 * std::min(par.length, par.width);
+    if (par.dimension == 3) r = std::min(r, 0.5 * par.height);
+    std::fill(dist.begin(), dist.end(), r);
+  }
+
+  // steepest ascent pointer for every void voxel, -1 for solid
+  std::vector< long > ascent(n_vox);
+#pragma omp parallel for schedule(static)
+  for (long ii = 0; ii < n_vox; ii++) {
+    if (par.voxel_geometry[ii] == 1) {
+      ascent[ii] = -1;
+      continue;
+    }
+    int xi = (int)(ii % nx);
+    int yi = (int)((ii / nx) % ny);
+    int zi = (int)(ii / ((long)nx * ny));
+    long best = ii;
+    double dbest = dist[ii];
+    for (int kk = zlo; kk <= zhi; kk++) {
+      if (zi + kk < 0 || zi + kk >= nz) continue;
+      for (int jj = -1; jj <= 1; jj++) {
+        if (yi + jj < 0 || yi + jj >= ny) continue;
+        for (int ll = -1; ll <= 1; ll++) {
+          if (xi + ll < 0 || xi + ll >= nx) continue;
+          long nbr = idx3((long)(zi + kk), (yi + jj), (xi + ll), ny, nx);
+          if (par.voxel_geometry[nbr] != 1 && dist[nbr] > dbest) {
+            best = nbr;
+            dbest = dist[nbr];
+          }
+        }
+      }
+    }
+    ascent[ii] = best;
+  }
+
+  // pointer jumping, every voxel ends up pointing at the maximum its ascent path reaches
+  {
+    std::vector< long > jump(n_vox);
+    int changed = 1;
+    while (changed) {
+      changed = 0;
+#pragma omp parallel for schedule(static) reduction(+:changed)
+      for (long ii = 0; ii < n_vox; ii++) {
+        if (ascent[ii] < 0) {
+          jump[ii] = -1;
+          continue;
+        }
+        jump[ii] = ascent[ascent[ii]];
+        if (jump[ii] != ascent[ii]) changed++;
+      }
+      ascent.swap(jump);
+    }
+  }
+
+  // number the maxima
+  std::vector< int > region(n_vox, -1);
+  std::vector< long > peak;
+  for (long ii = 0; ii < n_vox; ii++) {
+    if (ascent[ii] == ii) {
+      region[ii] = (int)peak.size();
+      peak.push_back(ii);
+    }
+  }
+  int n_peaks = (int)peak.size();
+
+  // join maxima sharing a plateau
+  std::vector< int > uf(n_peaks);
+  for (int ii = 0; ii < n_peaks; ii++) uf[ii] = ii;
+  for (int pp = 0; pp < n_peaks; pp++) {
+    long ii = peak[pp];
+    int xi = (int)(ii % nx);
+    int yi = (int)((ii / nx) % ny);
+    int zi = (int)(ii / ((long)nx * ny));
+    for (int kk = zlo; kk <= zhi; kk++) {
+      if (zi + kk < 0 || zi + kk >= nz) continue;
+      for (int jj = -1; jj <= 1; jj++) {
+        if (yi + jj < 0 || yi + jj >= ny) continue;
+        for (int ll = -1; ll <= 1; ll++) {
+          if (xi + ll < 0 || xi + ll >= nx) continue;
+          long nbr = idx3((long)(zi + kk), (yi + jj), (xi + ll), ny, nx);
+          if (ascent[nbr] == nbr && dist[nbr] == dist[ii]) {
+            int a = uf_find(uf, pp);
+            int b = uf_find(uf, region[nbr]);
+            if (a != b) uf[std::max(a, b)] = std::min(a, b);
+          }
+        }
+      }
+    }
+  }
+  for (int pp = 0; pp < n_peaks; pp++) uf_find(uf, pp);
+
+  // label the voxels draining to each maximum before relabeling the maxima themselves
+#pragma omp parallel for schedule(static)
+  for (long ii = 0; ii < n_vox; ii++) {
+    if (ascent[ii] >= 0 && ascent[ii] != ii) region[ii] = uf[region[ascent[ii]]];
+  }
+#pragma omp parallel for schedule(static)
+  for (int pp = 0; pp < n_peaks; pp++) {
+    region[peak[pp]] = uf[pp];
+  }
+  std::vector< long >().swap(ascent);
+
+  // scan voxel faces for region interfaces, per thread
+  std::vector< std::unordered_map< long long, region_interface > > thread_interfaces(nthreads);
+  double face_area[3] = { dy * dz, dx * dz, dx * dy };
+  if (par.dimension == 2) {
+    face_area[0] = dy;
+    face_area[1] = dx;
+  }
+#pragma omp parallel
+  {
+    std::unordered_map< long long, region_interface >& local = thread_interfaces[omp_get_thread_num()];
+#pragma omp for schedule(static)
+    for (long ii = 0; ii < n_vox; ii++) {
+      if (region[ii] < 0) continue;
+      int xi = (int)(ii % nx);
+      int yi = (int)((ii / nx) % ny);
+      int zi = (int)(ii / ((long)nx * ny));
+      long nbrs[3];
+      nbrs[0] = (xi < nx - 1) ? ii + 1 : -1;
+      nbrs[1] = (yi < ny - 1) ? ii + nx : -1;
+      nbrs[2] = (zi < nz - 1) ? ii + (long)nx * ny : -1;
+      for (int dir = 0; dir < par.dimension; dir++) {
+        if (nbrs[dir] < 0 || region[nbrs[dir]] < 0 || region[nbrs[dir]] == region[ii]) continue;
+        int a = std::min(region[ii], region[nbrs[dir]]);
+        int b = std::max(region[ii], region[nbrs[dir]]);
+        long long key = (long long)a * n_peaks + b;
+        double saddle = std::min(dist[ii], dist[nbrs[dir]]);
+        std::unordered_map< long long, region_interface >::iterator it = local.find(key);
+        if (it == local.end()) {
+          region_interface face_info = { saddle, face_area[dir] };
+          local.insert(std::make_pair(key, face_info));
+        }
+        else {
+          it->second.saddle = std::max(it->second.saddle, saddle);
+          it->second.area += face_area[dir];
+        }
+      }
+    }
+  }
+  for (int tt = 1; tt < nthreads; tt++) {
+    for (std::unordered_map< long long, region_interface >::iterator it = thread_interfaces[tt].begin(); \
+         it != thread_interfaces[tt].end(); ++it) {
+      std::unordered_map< long long, region_interface >::iterator jt = thread_interfaces[0].find(it->first);
+      if (jt == thread_interfaces[0].end()) thread_interfaces[0].insert(*it);
+      else {
+        jt->second.saddle = std::max(jt->second.saddle, it->second.saddle);
+        jt->second.area += it->second.area;
+      }
+    }
+    std::unordered_map< long long, region_interface >().swap(thread_interfaces[tt]);
+  }
+  std::unordered_map< long long, region_interface >& interfaces = thread_interfaces[0];
+
+  // maximal ball merging: a peak inside the inscribed ball of a larger adjacent peak belongs to the same pore
+  std::vector< std::pair< double, long long > > pairs;
+  pairs.reserve(interfaces.size());
+  for (std::unordered_map< long long, region_interface >::iterator it = interfaces.begin(); it != interfaces.end(); ++it) {
+    int a = (int)(it->first / n_peaks);
+    int b = (int)(it->first % n_peaks);
+    pairs.push_back(std::make_pair(std::max(dist[peak[a]], dist[peak[b]]), it->first));
+  }
+  std::sort(pairs.begin(), pairs.end());
+  std::vector< int > merge(n_peaks);
+  for (int ii = 0; ii < n_peaks; ii++) merge[ii] = ii;
+  for (int pp = (int)pairs.size() - 1; pp >= 0; pp--) {
+    int a = uf_find(merge, (int)(pairs[pp].second / n_peaks));
+    int b = uf_find(merge, (int)(pairs[pp].second % n_peaks));
+    if (a == b) continue;
+    if (dist[peak[a]] < dist[peak[b]] || (dist[peak[a]] == dist[peak[b]] && b < a)) std::swap(a, b);
+    long pa = peak[a];
+    long pb = peak[b];
+    double sep_x = dx * ((pa % nx) - (pb % nx));
+    double sep_y = dy * (((pa / nx) % ny) - ((pb / nx) % ny));
+    double sep_z = dz * ((pa / ((long)nx * ny)) - (pb / ((long)nx * ny)));
+    if (sqrt(sep_x * sep_x + sep_y * sep_y + sep_z * sep_z) < dist[pa]) merge[b] = a;
+  }
+
+  // final pore numbering
+  std::vector< int > pore_number(n_peaks, -1);
+  int n_pores = 0;
+  for (int ii = 0; ii < n_peaks; ii++) {
+    if (uf_find(merge, ii) == ii && uf[ii] == ii) pore_number[ii] = n_pores++;
+  }
+  for (int ii = 0; ii < n_peaks; ii++) {
+    if (uf[ii] == ii) pore_number[ii] = pore_number[uf_find(merge, ii)];
+  }
+
+  // pore properties, accumulated per thread over the pores its voxels touch
+  pores.resize(n_pores);
+  std::vector< std::unordered_map< int, pore_sums > > thread_pores(nthreads);
+#pragma omp parallel
+  {
+    std::unordered_map< int, pore_sums >& local = thread_pores[omp_get_thread_num()];
+    int last = -1;
+    pore_sums *sums = NULL;
+#pragma omp for schedule(static)
+    for (long ii = 0; ii < n_vox; ii++) {
+      if (region[ii] < 0) continue;
+      int pn = pore_number[region[ii]];
+      int xi = (int)(ii % nx);
+      int yi = (int)((ii / nx) % ny);
+      int zi = (int)(ii / ((long)nx * ny));
+      // consecutive voxels mostly share a pore, and map elements do not move on insertion
+      if (pn != last) {
+        sums = &local[pn];
+        last = pn;
+      }
+      sums->count += 1.0;
+      sums->x += dx * (xi + 0.5);
+      sums->y += dy * (yi + 0.5);
+      sums->z += (par.dimension == 3) ? dz * (zi + 0.5) : 0.0;
+      if (xi == 0) sums->boundary |= 1;
+      if (xi == nx - 1) sums->boundary |= 2;
+      if (yi == 0) sums->boundary |= 4;
+      if (yi == ny - 1) sums->boundary |= 8;
+      if (par.dimension == 3) {
+        if (zi == 0) sums->boundary |= 16;
+        if (zi == nz - 1) sums->boundary |= 32;
+      }
+    }
+  }
+  std::vector< pore_sums > totals(n_pores);
+  for (int tt = 0; tt < nthreads; tt++) {
+    for (std::unordered_map< int, pore_sums >::iterator it = thread_pores[tt].begin(); it != thread_pores[tt].end(); ++it) {
+      pore_sums& total = totals[it->first];
+      total.count += it->second.count;
+      total.x += it->second.x;
+      total.y += it->second.y;
+      total.z += it->second.z;
+      total.boundary |= it->second.boundary;
+    }
+    std::unordered_map< int, pore_sums >().swap(thread_pores[tt]);
+  }
+#pragma omp parallel for schedule(static)
+  for (int pn = 0; pn < n_pores; pn++) {
+    pores[pn].coords[0] = totals[pn].x / totals[pn].count;
+    pores[pn].coords[1] = totals[pn].y / totals[pn].count;
+    pores[pn].coords[2] = totals[pn].z / totals[pn].count;
+    pores[pn].volume = totals[pn].count * dx * dy * dz;
+    pores[pn].boundary = totals[pn].boundary;
+  }
+  for (int ii = 0; ii < n_peaks; ii++) {
+    if (uf[ii] == ii && uf_find(merge, ii) == ii) pores[pore_number[ii]].radius = dist[peak[ii]];
+  }
+
+  // boundary pores, listed once for the boundary condition setup
+  boundary_pores.clear();
+  for (int pn = 0; pn < n_pores; pn++) if (pores[pn].boundary) boundary_pores.push_back(pn);
+
+  // conductance from the centroid of each boundary pore to the domain faces it touches
+  double extent[3] = { par.length, par.width, (par.dimension == 3) ? par.height : 1.0 };
+  double spacing[3] = { dx, dy, dz };
+#pragma omp parallel for schedule(static)
+  for (int pn = 0; pn < n_pores; pn++) {
+    for (int face = 0; face < 6; face++) {
+      pores[pn].boundary_conductance[face] = 0.0;
+      if (!(pores[pn].boundary & (1 << face))) continue;
+      int dir = face / 2;
+      double len = (face % 2) ? extent[dir] - pores[pn].coords[dir] : pores[pn].coords[dir];
+      len = std::max(len, 0.5 * spacing[dir]);
+      pores[pn].boundary_conductance[face] = duct_conductance(par.dimension, pores[pn].radius, viscosity) / len;
+    }
+  }
+
+  // throats, interfaces of merged regions are combined
+  std::unordered_map< long long, region_interface > pore_interfaces;
+  for (std::unordered_map< long long, region_interface >::iterator it = interfaces.begin(); it != interfaces.end(); ++it) {
+    int a = pore_number[(int)(it->first / n_peaks)];
+    int b = pore_number[(int)(it->first % n_peaks)];
+    if (a == b) continue;
+    long long key = (long long)std::min(a, b) * n_pores + std::max(a, b);
+    std::unordered_map< long long, region_interface >::iterator jt = pore_interfaces.find(key);
+    if (jt == pore_interfaces.end()) pore_interfaces.insert(std::make_pair(key, it->second));
+    else {
+      jt->second.saddle = std::max(jt->second.saddle, it->second.saddle);
+      jt->second.area += it->second.area;
+    }
+  }
+  std::vector< long long > keys;
+  keys.reserve(pore_interfaces.size());
+  for (std::unordered_map< long long, region_interface >::iterator it = pore_interfaces.begin(); it != pore_interfaces.end(); ++it) {
+    keys.push_back(it->first);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  throats.resize(keys.size());
+#pragma omp parallel for schedule(static)
+  for (int tt = 0; tt < (int)keys.size(); tt++) {
+    const region_interface& face_info = pore_interfaces.find(keys[tt])->second;
+    int a = (int)(keys[tt] / n_pores);
+    int b = (int)(keys[tt] % n_pores);
+    throats[tt].pores[0] = a;
+    throats[tt].pores[1] = b;
+    throats[tt].radius = face_info.saddle;
+    throats[tt].area = face_info.area;
+    double len = 0;
+    for (int dir = 0; dir < par.dimension; dir++) {
+      len += (pores[a].coords[dir] - pores[b].coords[dir]) * (pores[a].coords[dir] - pores[b].coords[dir]);
+    }
+    len = sqrt(len);
+    throats[tt].length = len;
+    // conduit: half of each pore, at its inscribed radius, in series with the throat
+    double la = pores[a].radius;
+    double lb = pores[b].radius;
+    double lt = len - la - lb;
+    if (lt < 0.1 * len) {
+      double scale = 0.9 * len / (la + lb);
+      la *= scale;
+      lb *= scale;
+      lt = 0.1 * len;
+    }
+    double resistance = la / duct_conductance(par.dimension, pores[a].radius, viscosity) \
+                      + lt / duct_conductance(par.dimension, throats[tt].radius, viscosity) \
+                      + lb / duct_conductance(par.dimension, pores[b].radius, viscosity);
+    throats[tt].conductance = 1.0 / resistance;
+  }
+
+  // pore to throat connectivity
+  pore_throat_ptr.assign(n_pores + 1, 0);
+  for (int tt = 0; tt < (int)throats.size(); tt++) {
+    pore_throat_ptr[throats[tt].pores[0] + 1]++;
+    pore_throat_ptr[throats[tt].pores[1] + 1]++;
+  }
+  for (int ii = 0; ii < n_pores; ii++) pore_throat_ptr[ii + 1] += pore_throat_ptr[ii];
+  pore_throat_list.resize(pore_throat_ptr[n_pores]);
+  std::vector< int > fill(pore_throat_ptr.begin(), pore_throat_ptr.end() - 1);
+  for (int tt = 0; tt < (int)throats.size(); tt++) {
+    pore_throat_list[fill[throats[tt].pores[0]]++] = tt;
+    pore_throat_list[fill[throats[tt].pores[1]]++] = tt;
+  }
+}
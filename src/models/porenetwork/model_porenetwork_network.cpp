@@ -69,5 +69,10 @@ hgf::models::uniform_porenetwork::build_uniform_network(const parameters& par, i
 
   }
 
+
+  // boundary pores, listed once for the boundary condition setup
+  boundary_pores.clear();
+  for (int ii = 0; ii < (int)pressure.size(); ii++) if (pressure[ii].doftype) boundary_pores.push_back(ii);
+
 }
 
@@ -46,3 +46,30 @@ hgf::models::uniform_porenetwork::init_permeability_random(const parameters& par
     }
   }
 }
+
+/** \brief hgf::models::extracted_porenetwork::upscaled_permeability computes the permeability of the domain from the solved network.
+ *
+ * The total flux entering the network through the inflow face is converted with Darcy's law, using the unit pressure drop imposed by the boundary conditions.
+ * The solution must come from the boundary conditions matching direction.
+ *
+ * @param[in] par - parameters struct containing problem information.
+ * @param[in] direction - flow direction, 0 for x, 1 for y, 2 for z.
+ * @return permeability in the given direction.
+ */
+double
+hgf::models::extracted_porenetwork::upscaled_permeability(const parameters& par, int direction)
+{
+  int inflow_face = 2 * direction;
+  double flux = 0;
+  for (int ii = 0; ii < (int)pores.size(); ii++) {
+    if (pores[ii].boundary & (1 << inflow_face)) {
+      flux += pores[ii].boundary_conductance[inflow_face] * (1.0 - solution[ii]);
+    }
+  }
+  double extent[3] = { par.length, par.width, (par.dimension == 3) ? par.height : 1.0 };
+  double area = 1.0;
+  for (int dir = 0; dir < par.dimension; dir++) {
+    if (dir != direction) area *= extent[dir];
+  }
+  return flux * viscosity * extent[direction] / area;
+}
@@ -125,3 +125,62 @@ hgf::models::uniform_porenetwork::output_vtk(const parameters& par)
   }
 
 }
+
+/** \brief hgf::models::extracted_porenetwork::output_vtk saves the extracted network, and the flow solution if present, to a file for VTK visualiztion.
+ *
+ * @param[in] par - parameters struct containing problem information, including problem directory.
+ */
+void
+hgf::models::extracted_porenetwork::output_vtk(const parameters& par)
+{
+  int nlines = (int)throats.size();
+
+  // write to vtk file
+  bfs::path output_path(par.problem_path / "PN_Extracted.vtk");
+  std::ofstream outstream;
+  outstream.open(output_path.string());
+  outstream << "# vtk DataFile Version 3.0\n";
+  outstream << "vtk output\n";
+  outstream << "ASCII\n\n";
+  outstream << "DATASET POLYDATA\n";
+  outstream << "POINTS " << pores.size() << " double\n";
+  for (int row = 0; row < (int)pores.size(); row++) {
+    outstream << pores[row].coords[0] << "\t";
+    outstream << pores[row].coords[1] << "\t";
+    outstream << pores[row].coords[2] << "\n";
+  }
+  outstream << "\n";
+  outstream << "LINES " << nlines << " " << nlines * 3 << "\n";
+  for (int row = 0; row < nlines; row++) {
+    outstream << 2 << "\t" << throats[row].pores[0] << "\t" << throats[row].pores[1] << "\n";
+  }
+  outstream << "\n";
+  outstream << "POINT_DATA " << pores.size() << "\n";
+  outstream << "SCALARS pore_radius double\n";
+  outstream << "LOOKUP_TABLE default\n";
+  for (int ii = 0; ii < (int)pores.size(); ii++) {
+    outstream << pores[ii].radius << "\n";
+  }
+  if (solution.size() == pores.size()) {
+    outstream << "SCALARS pressure double\n";
+    outstream << "LOOKUP_TABLE default\n";
+    for (int ii = 0; ii < (int)pores.size(); ii++) {
+      outstream << solution[ii] << "\n";
+    }
+  }
+  outstream << "\n";
+  outstream << "CELL_DATA " << nlines << "\n";
+  outstream << "SCALARS throat_radius double\n";
+  outstream << "LOOKUP_TABLE default\n";
+  for (int row = 0; row < nlines; row++) {
+    outstream << throats[row].radius << "\n";
+  }
+  outstream << "SCALARS throat_conductance double\n";
+  outstream << "LOOKUP_TABLE default\n";
+  for (int row = 0; row < nlines; row++) {
+    outstream << throats[row].conductance << "\n";
+  }
+  outstream << "\n";
+
+  outstream.close();
+}
@@ -5,67 +5,152 @@
 #include "model_stokes.hpp"
 
 // 1d->2d index
-#define idx2(i, j, ldi) ((i * ldi) + j)
+#define idx2(i, j, ldi) (((hgf_index)i * ldi) + j)
 
 /** \brief hgf::models::stokes::build builds the degrees of freedom, initializes the solution and rhs vectors, and sets up the linear system for Stokes flow.
  *
  * Immersed boundary and boundary condition information are not set by this function.
+ * With assemble = 0 the interior stencil is never stored, csr_array stays empty, and the system is only available
+ * through hgf::models::stokes::apply, for use with matrix-free solvers.
  * @param[in] par - parameters struct containing problem information.
  * @param[in] msh - mesh object containing a quadrilateral or hexagonal representation of geometry from problem folder addressed in parameters& par.
+ * @param[in] assemble - if nonzero (default), the linear system is assembled into csr_array.
  */
 void
-hgf::models::stokes::build(const parameters& par, const hgf::mesh::voxel& msh)
+hgf::models::stokes::build(const parameters& par, const hgf::mesh::voxel& msh, int assemble)
 {
-  // seed rand in case of IB generation
-  srand(time(NULL));
-
-  // viscosity is initialized to 1.0
-  viscosity = 1.0;
+  // setup the degrees of freedom
+  std::shared_ptr< stokes_topology > topo = std::make_shared< stokes_topology >();
+  if (par.dimension == 2) build_degrees_of_freedom_2d(par, msh, *topo);
+  else build_degrees_of_freedom_3d(par, msh, *topo);
+  build_boundary_lists(*topo);
+  topology = topo;
 
-  if (par.dimension == 2) {
+  build_state(par, assemble);
+}
 
-    // setup the degrees of freedom
-    build_degrees_of_freedom_2d(par, msh);
+/** \brief hgf::models::stokes::build sets up a Stokes model on degrees of freedom already built by another model.
+ *
+ * The topology is shared, not copied, so many boundary condition, viscosity or immersed boundary variants can be
+ * solved on one geometry at the cost of their linear systems and vectors only. Immersed boundary and boundary
+ * condition information are not set by this function.
+ * @param[in] par - parameters struct containing problem information.
+ * @param[in] shared_topology - topology of a built model, e.g. other.topology.
+ * @param[in] assemble - if nonzero (default), the linear system is assembled into csr_array.
+ */
+void
+hgf::models::stokes::build(const parameters& par, const std::shared_ptr< const stokes_topology >& shared_topology, int assemble)
+{
+  topology = shared_topology;
 
-    // initialize solution and rhs
-    int nU = std::accumulate(interior_u.begin(), interior_u.end(), 0);
-    int nV = std::accumulate(interior_v.begin(), interior_v.end(), 0);
-    int nP = (int)pressure.size();
-    solution_int.resize(nU + nV + nP);
-    rhs.resize(nU + nV + nP);
-    pressure_ib_list.assign(nP, 0);
+  build_state(par, assemble);
+}
 
-    // setup the linear system
-    build_array_2d(par, msh);
+// lists the degrees of freedom touching the domain boundary or a solid wall, so boundary conditions
+// are set up in time proportional to the boundary rather than the whole geometry
+void
+hgf::models::stokes::build_boundary_lists(stokes_topology& topo)
+{
+  int n_comp = topo.velocity_u.dimension;
+  int dim_mult = 2 * n_comp;
+  const dof_store* dofs[3] = { &topo.velocity_u, &topo.velocity_v, &topo.velocity_w };
+  const bit_flags* interior[3] = { &topo.interior_u, &topo.interior_v, &topo.interior_w };
+  const std::vector< int >* nums[3] = { &topo.interior_u_nums, &topo.interior_v_nums, &topo.interior_w_nums };
+  std::vector< int >* lists[3] = { &topo.boundary_u, &topo.boundary_v, &topo.boundary_w };
 
+  // per thread lists in static order, so the concatenation is sorted
+  int NTHREADS = omp_get_max_threads();
+  std::vector< std::vector< int > > temp_lists(NTHREADS);
+  for (int cc = 0; cc < 4; cc++) {
+    if (cc < 3 && cc >= n_comp) {
+      lists[cc]->clear();
+      continue;
+    }
+    for (int tt = 0; tt < NTHREADS; tt++) temp_lists[tt].clear();
+#pragma omp parallel
+    {
+      std::vector< int >& temp = temp_lists[omp_get_thread_num()];
+      if (cc < 3) {
+#pragma omp for schedule(static)
+        for (int ii = 0; ii < (int)dofs[cc]->size(); ii++) {
+          if (!(*interior[cc])[ii]) continue;
+          for (int jj = 0; jj < dim_mult; jj++) {
+            int nbr = dofs[cc]->neighbor(ii, jj);
+            if (nbr == -1 || !(*interior[cc])[nbr]) {
+              temp.push_back(ii);
+              break;
+            }
+          }
+        }
+      }
+      else {
+#pragma omp for schedule(static)
+        for (int ii = 0; ii < (int)topo.pressure.size(); ii++) {
+          for (int ff = 0; ff < dim_mult; ff++) {
+            if ((*nums[ff / 2])[topo.ptv[idx2(ii, ff, dim_mult)]] == -1) {
+              temp.push_back(ii);
+              break;
+            }
+          }
+        }
+      }
+    }
+    std::vector< int >& list = (cc < 3) ? *lists[cc] : topo.boundary_pressure;
+    list.clear();
+    for (int tt = 0; tt < NTHREADS; tt++) list.insert(list.end(), temp_lists[tt].begin(), temp_lists[tt].end());
   }
-  else {
+}
 
-    // setup the degrees of freedom
-    build_degrees_of_freedom_3d(par, msh);
+// initializes the per-solve state (vectors, linear system, boundary information) on the current topology
+void
+hgf::models::stokes::build_state(const parameters& par, int assemble)
+{
+  // seed rand in case of IB generation
+  srand(time(NULL));
 
-    // initialize solution and rhs
-    int nU = std::accumulate(interior_u.begin(), interior_u.end(), 0);
-    int nV = std::accumulate(interior_v.begin(), interior_v.end(), 0);
-    int nW = std::accumulate(interior_w.begin(), interior_w.end(), 0);
-    int nP = (int)pressure.size();
-    solution_int.resize(nU + nV + nW + nP);
-    rhs.resize(nU + nV + nW + nP);
-    pressure_ib_list.assign(nP, 0);
+  // viscosity is initialized to 1.0
+  viscosity = 1.0;
 
-    // setup the linear system
-    build_array_3d(par, msh);
+  // initialize solution and rhs
+  hgf_index nU = topology->interior_u.count();
+  hgf_index nV = topology->interior_v.count();
+  hgf_index nW = (par.dimension == 3) ? topology->interior_w.count() : 0;
+  hgf_index nP = (hgf_index)topology->pressure.size();
+  solution_int.assign(nU + nV + nW + nP, 0.0);
+  rhs.assign(nU + nV + nW + nP, 0.0);
+  solution.clear();
+  pressure_ib_list.assign(nP, 0);
+  boundary.clear();
+  active_bc.clear();
+  ib_penalty.assign(nU + nV + nW, 0.0);
+  ib_cell_penalty.assign(nP, 0.0);
+  brinkman_drag.clear();
+  reduced_rows.clear();
 
+  // setup the linear system
+  csr_array = array_csr();
+  csr_source.clear();
+  if (assemble) {
+    if (par.dimension == 2) build_array_2d();
+    else build_array_3d();
   }
+
+  // boundary condition contributions, kept apart from the interior stencil
+  operator_delta = array_csr();
+  operator_delta.n_rows = (hgf_index)rhs.size();
+  operator_delta.n_cols = (hgf_index)rhs.size();
+  operator_delta.row_ptr.assign(rhs.size() + 1, 0);
 #ifdef _ARRAY_DEBUG
-  std::cout << "\nArray size = " << coo_array.size() << "\n";
-  std::cout << "\nnU = " << std::accumulate(interior_u.begin(), interior_u.end(), 0) << ",\tnV = " << std::accumulate(interior_v.begin(), interior_v.end(), 0);
+  std::cout << "\nArray size = " << csr_array.value.size() << "\n";
+  std::cout << "\nnU = " << topology->interior_u.count() << ",\tnV = " << topology->interior_v.count();
   if (par.dimension == 3) {
-    std::cout << ",\tNW = " << std::accumulate(interior_w.begin(), interior_w.end(), 0);
+    std::cout << ",\tNW = " << topology->interior_w.count();
   }
-  std::cout << ",\tnP = " << (int)pressure.size() << "\n";
-  for (int ii = 0; ii < coo_array.size(); ii++) {
-    std::cout << coo_array[ii].i_index << "\t" << coo_array[ii].j_index << "\t" << coo_array[ii].value << "\n";
+  std::cout << ",\tnP = " << (int)topology->pressure.size() << "\n";
+  for (int ii = 0; ii < csr_array.n_rows; ii++) {
+    for (hgf_index jj = csr_array.row_ptr[ii]; jj < csr_array.row_ptr[ii + 1]; jj++) {
+      std::cout << ii << "\t" << csr_array.col_index[jj] << "\t" << csr_array.value[jj] << "\n";
+    }
   }
   std::cout << "\n";
 #endif
@@ -73,7 +158,7 @@ hgf::models::stokes::build(const parameters& par, const hgf::mesh::voxel& msh)
 
 /** \brief hgf::models::stokes::setup_xflow_bc setups up the boundary conditions for a problem with flow in the positive direction along the x-axis.
  *
- * Contributions to the linear system coo_array and the rhs vector are set by this function.
+ * Contributions to the linear system csr_array and the rhs vector are set by this function.
  * @param[in] par - parameters struct containing problem information.
  * @param[in] msh - mesh object containing a quadrilateral or hexagonal representation of geometry from problem folder addressed in parameters& par.
  */
@@ -82,13 +167,13 @@ hgf::models::stokes::setup_xflow_bc(const parameters& par, const hgf::mesh::voxe
 {
 
   if (par.dimension == 2) xflow_2d(par, msh, INFLOW_TYPE);
-  else xflow_3d(par, msh, INFLOW_TYPE);
+  else flow_3d(par, 0, INFLOW_TYPE);
 
 }
 
 /** \brief hgf::models::stokes::setup_yflow_bc setups up the boundary conditions for a problem with flow in the positive direction along the y-axis.
  *
- * Contributions to the linear system coo_array and the rhs vector are set by this function.
+ * Contributions to the linear system csr_array and the rhs vector are set by this function.
  * @param[in] par - parameters struct containing problem information.
  * @param[in] msh - mesh object containing a quadrilateral or hexagonal representation of geometry from problem folder addressed in parameters& par.
  */
@@ -97,13 +182,13 @@ hgf::models::stokes::setup_yflow_bc(const parameters& par, const hgf::mesh::voxe
 {
 
   if (par.dimension == 2) yflow_2d(par, msh, INFLOW_TYPE);
-  else yflow_3d(par, msh, INFLOW_TYPE);
+  else flow_3d(par, 1, INFLOW_TYPE);
 
 }
 
 /** \brief hgf::models::stokes::setup_zflow_bc setups up the boundary conditions for a problem with flow in the positive direction along the z-axis.
  *
- * Contributions to the linear system coo_array and the rhs vector are set by this function.
+ * Contributions to the linear system csr_array and the rhs vector are set by this function.
  * @param[in] par - parameters struct containing problem information.
  * @param[in] msh - mesh object containing a quadrilateral or hexagonal representation of geometry from problem folder addressed in parameters& par.
  */
@@ -111,8 +196,125 @@ void
 hgf::models::stokes::setup_zflow_bc(const parameters& par, const hgf::mesh::voxel& msh, const HGF_INFLOW& INFLOW_TYPE)
 {
 
-  zflow_3d(par, msh, INFLOW_TYPE);
+  flow_3d(par, 2, INFLOW_TYPE);
 
 }
 
 
+
+/** \brief hgf::models::stokes::setup_flow_bc sets up the boundary conditions for flow in the positive direction along one axis and stores them in bc.
+ *
+ * Any boundary conditions already in the linear system are removed first, so after the call the system holds the
+ * interior operator, the immersed boundary and the boundary conditions of bc. Solving several directions with
+ * setup_flow_bc and select_bc on one model replaces building a copy of the model for each direction.
+ * @param[in] par - parameters struct containing problem information.
+ * @param[in] msh - mesh object containing a quadrilateral or hexagonal representation of geometry from problem folder addressed in parameters& par.
+ * @param[in] direction - flow direction, 0, 1 or 2 for x, y or z.
+ * @param[in] INFLOW_TYPE - inflow profile.
+ * @param[out] bc - boundary condition delta, rhs and boundary values for this direction.
+ */
+void
+hgf::models::stokes::setup_flow_bc(const parameters& par, const hgf::mesh::voxel& msh, int direction, const HGF_INFLOW& INFLOW_TYPE, stokes_bc& bc)
+{
+
+  clear_bc();
+  if (direction == 0) setup_xflow_bc(par, msh, INFLOW_TYPE);
+  else if (direction == 1) setup_yflow_bc(par, msh, INFLOW_TYPE);
+  else if (direction == 2 && par.dimension == 3) setup_zflow_bc(par, msh, INFLOW_TYPE);
+  else {
+    std::cout << "\nInvalid flow direction " << direction << " for a " << par.dimension << "d Stokes problem. Exiting.\n";
+    exit(0);
+  }
+
+  bc.direction = direction;
+  bc.delta = active_bc;
+  bc.rhs = rhs;
+  bc.boundary_index.clear();
+  bc.boundary_value.clear();
+  for (int ii = 0; ii < (int)boundary.size(); ii++) {
+    if (boundary[ii].type != 0 || boundary[ii].value != 0) {
+      bc.boundary_index.push_back(ii);
+      bc.boundary_value.push_back(boundary[ii]);
+    }
+  }
+
+}
+
+/** \brief hgf::models::stokes::setup_flow_bc sets up the boundary conditions for flow along each axis in directions and stores them in bc.
+ *
+ * In 3d the degrees of freedom touching the boundary are classified once and the boundary conditions of all
+ * directions are produced in a single pass, rather than one pass over all degrees of freedom per direction.
+ * Any boundary conditions already in the linear system are removed, afterwards the system holds those of the last direction.
+ * @param[in] par - parameters struct containing problem information.
+ * @param[in] msh - mesh object containing a quadrilateral or hexagonal representation of geometry from problem folder addressed in parameters& par.
+ * @param[in] directions - flow directions, each 0, 1 or 2 for x, y or z.
+ * @param[in] INFLOW_TYPE - inflow profile.
+ * @param[out] bc - boundary condition delta, rhs and boundary values of each direction, in the order of directions.
+ */
+void
+hgf::models::stokes::setup_flow_bc(const parameters& par, const hgf::mesh::voxel& msh, const std::vector< int >& directions, const HGF_INFLOW& INFLOW_TYPE, std::vector< stokes_bc >& bc)
+{
+
+  for (int dd = 0; dd < (int)directions.size(); dd++) {
+    if (directions[dd] < 0 || directions[dd] >= par.dimension) {
+      std::cout << "\nInvalid flow direction " << directions[dd] << " for a " << par.dimension << "d Stokes problem. Exiting.\n";
+      exit(0);
+    }
+  }
+
+  bc.resize(directions.size());
+  if (par.dimension == 2) {
+    for (int dd = 0; dd < (int)directions.size(); dd++) setup_flow_bc(par, msh, directions[dd], INFLOW_TYPE, bc[dd]);
+    return;
+  }
+
+  clear_bc();
+  flow_bc_3d(par, directions, INFLOW_TYPE, bc);
+  if (bc.size()) merge_bc(bc.back());
+
+}
+
+/** \brief hgf::models::stokes::select_bc replaces the boundary conditions in the linear system with those stored in bc.
+ *
+ * Only the boundary entries of csr_array change, the interior operator and immersed boundary are kept.
+ * @param[in] bc - boundary conditions produced by hgf::models::stokes::setup_flow_bc on this model.
+ */
+void
+hgf::models::stokes::select_bc(const stokes_bc& bc)
+{
+
+  require_full_system("select_bc");
+  clear_bc();
+  merge_bc(bc);
+
+}
+
+// adds the entries, rhs and boundary values of bc to those already in the linear system
+void
+hgf::models::stokes::merge_bc(const stokes_bc& bc)
+{
+
+  add_bc_entries(bc.delta);
+#pragma omp parallel for schedule(static)
+  for (hgf_index ii = 0; ii < (hgf_index)rhs.size(); ii++) rhs[ii] += bc.rhs[ii];
+  boundary.resize(topology->velocity_u.size() + topology->velocity_v.size() + topology->velocity_w.size());
+  for (int ii = 0; ii < (int)bc.boundary_index.size(); ii++) boundary[bc.boundary_index[ii]] = bc.boundary_value[ii];
+
+}
+
+/** \brief hgf::models::stokes::clear_bc removes all boundary condition contributions from the linear system and the rhs vector.
+ *
+ */
+void
+hgf::models::stokes::clear_bc(void)
+{
+
+  require_full_system("clear_bc");
+  for (hgf_index ii = 0; ii < (hgf_index)active_bc.size(); ii++) active_bc[ii].value = -active_bc[ii].value;
+  add_operator_entries(active_bc);
+  active_bc.clear();
+  rhs.assign(rhs.size(), 0.0);
+  boundary_nodes empty = { 0, 0.0 };
+  boundary.assign(boundary.size(), empty);
+
+}
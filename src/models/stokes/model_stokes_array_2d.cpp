@@ -4,16 +4,75 @@
 #include "model_stokes.hpp"
 
 // 1d->2d index
-#define idx2(i, j, ldi) ((i * ldi) + j)
+#define idx2(i, j, ldi) (((hgf_index)i * ldi) + j)
 
-// simple distance formula
-#define distance(x1,y1,x2,y2) \
-  sqrt(pow((x1-x2),2) + pow((y1-y2),2))
+// difference of two coordinates along an axis, wrapped to the nearest image when the axis has a period
+#define periodic_difference(dx, period) \
+  ((period > 0 && fabs(dx) > 0.5 * period) ? ((dx > 0) ? (dx - period) : (dx + period)) : (dx))
+
+// simple distance formula, across the periodic faces of the domain where period is nonzero
+#define distance(x1,y1,x2,y2,period) \
+  sqrt(pow(periodic_difference((x1-x2), period[0]),2) + pow(periodic_difference((y1-y2), period[1]),2))
+
+// places the entries of one row and their source codes into its csr slot, sorted by column
+static inline void
+place_row(array_csr& array, std::vector< unsigned char >& source, const array_coo* entries, const unsigned char* codes, int n_entries)
+{
+  hgf_index start = array.row_ptr[entries[0].i_index];
+  for (int jj = 0; jj < n_entries; jj++) {
+    hgf_index pos = start + jj;
+    while (pos > start && array.col_index[pos - 1] > entries[jj].j_index) {
+      array.col_index[pos] = array.col_index[pos - 1];
+      array.value[pos] = array.value[pos - 1];
+      source[pos] = source[pos - 1];
+      pos--;
+    }
+    array.col_index[pos] = entries[jj].j_index;
+    array.value[pos] = entries[jj].value;
+    source[pos] = codes[jj];
+  }
+}
 
 void
-hgf::models::stokes::build_array_2d(const parameters& par, const hgf::mesh::voxel& msh)
+hgf::models::stokes::build_array_2d(void)
 {
 
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index shift_p = shift_v + topology->interior_v.count();
+  hgf_index n_rows = shift_p + (hgf_index)topology->pressure.size();
+
+  // row sizes, a momentum row holds its interior neighbors, the diagonal and two pressures,
+  // a continuity row holds the interior velocities on the edges of its cell
+  csr_array.n_rows = n_rows;
+  csr_array.n_cols = n_rows;
+  csr_array.row_ptr.assign(n_rows + 1, 0);
+#pragma omp parallel
+  {
+#pragma omp for schedule(static) nowait
+    for (int ii = 0; ii < (int)topology->velocity_u.size(); ii++) {
+      if (topology->interior_u_nums[ii] == -1) continue;
+      int count = 3;
+      for (int jj = 0; jj < 4; jj++) count += (topology->velocity_u.neighbor(ii, jj) > -1 && topology->interior_u[topology->velocity_u.neighbor(ii, jj)]);
+      csr_array.row_ptr[topology->interior_u_nums[ii] + 1] = count;
+    }
+#pragma omp for schedule(static) nowait
+    for (int ii = 0; ii < (int)topology->velocity_v.size(); ii++) {
+      if (topology->interior_v_nums[ii] == -1) continue;
+      int count = 3;
+      for (int jj = 0; jj < 4; jj++) count += (topology->velocity_v.neighbor(ii, jj) > -1 && topology->interior_v[topology->velocity_v.neighbor(ii, jj)]);
+      csr_array.row_ptr[shift_v + topology->interior_v_nums[ii] + 1] = count;
+    }
+#pragma omp for schedule(static) nowait
+    for (int ii = 0; ii < (int)topology->pressure.size(); ii++) {
+      csr_array.row_ptr[shift_p + ii + 1] = (topology->interior_u_nums[topology->ptv[idx2(ii, 0, 4)]] != -1) + (topology->interior_u_nums[topology->ptv[idx2(ii, 1, 4)]] != -1) \
+                                          + (topology->interior_v_nums[topology->ptv[idx2(ii, 2, 4)]] != -1) + (topology->interior_v_nums[topology->ptv[idx2(ii, 3, 4)]] != -1);
+    }
+  }
+  for (hgf_index row = 0; row < n_rows; row++) csr_array.row_ptr[row + 1] += csr_array.row_ptr[row];
+  csr_array.col_index.resize(csr_array.row_ptr[n_rows]);
+  csr_array.value.resize(csr_array.row_ptr[n_rows]);
+  csr_source.resize(csr_array.row_ptr[n_rows]);
+
   // calls to set up 2nd order velocity terms
   momentum_2d();
 
@@ -26,25 +85,17 @@ void
 hgf::models::stokes::momentum_2d(void)
 {
 
-  int shift_v = std::accumulate(interior_u.begin(), interior_u.end(), 0);
-  int nV = std::accumulate(interior_v.begin(), interior_v.end(), 0);
-  int shift_p = shift_v + nV;
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index nV = topology->interior_v.count();
+  hgf_index shift_p = shift_v + nV;
 
   // setup threading parameters
   int NTHREADS = omp_get_max_threads();
 #ifdef _THREADS_DEBUG
   std::cout << "\nNTHREADS in DIFFUSION = " << NTHREADS << ".\n";
 #endif
-  int block_size_u = ((int)velocity_u.size() % NTHREADS) ? (int)((velocity_u.size() / NTHREADS) + 1) : (int)(velocity_u.size() / NTHREADS);
-  int block_size_v = ((int)velocity_v.size() % NTHREADS) ? (int)((velocity_v.size() / NTHREADS) + 1) : (int)(velocity_v.size() / NTHREADS);
-
-  // define temp coo arrays to store results in parallel region
-  std::vector< std::vector< array_coo > > temp_u_arrays, temp_v_arrays;
-  temp_u_arrays.resize(NTHREADS);
-  temp_v_arrays.resize(NTHREADS);
-  int maxu = block_size_u * 7;
-  int maxv = block_size_v * 7;
-  for (int ii = 0; ii < NTHREADS; ii++) { temp_u_arrays[ii].reserve(maxu); temp_v_arrays[ii].reserve(maxv); }
+  int block_size_u = ((int)topology->velocity_u.size() % NTHREADS) ? (int)((topology->velocity_u.size() / NTHREADS) + 1) : (int)(topology->velocity_u.size() / NTHREADS);
+  int block_size_v = ((int)topology->velocity_v.size() % NTHREADS) ? (int)((topology->velocity_v.size() / NTHREADS) + 1) : (int)(topology->velocity_v.size() / NTHREADS);
 
 #pragma omp parallel
   {
@@ -52,45 +103,47 @@ hgf::models::stokes::momentum_2d(void)
     for (int kk = 0; kk < NTHREADS; kk++) {
       int entries = 0;
       array_coo temp_coo[7] = { 0 };
+      unsigned char temp_src[7];
       double d_dofs[4], d_edges[4];
       int nbrs[4], pres[2];
-      for (int ii = kk*block_size_u; ii < std::min((kk + 1)*block_size_u, (int)interior_u_nums.size()); ii++) {
+      for (int ii = kk*block_size_u; ii < std::min((kk + 1)*block_size_u, (int)topology->interior_u_nums.size()); ii++) {
         // grab neighbor numbers
-        for (int jj = 0; jj < 4; jj++) { nbrs[jj] = velocity_u[ii].neighbors[jj]; }
+        for (int jj = 0; jj < 4; jj++) { nbrs[jj] = topology->velocity_u.neighbor(ii, jj); }
         // compute cell center distances
         for (int jj = 0; jj < 4; jj++) {
           if (nbrs[jj] > -1) {
-            d_dofs[jj] = distance(velocity_u[ii].coords[0], velocity_u[ii].coords[1], \
-              velocity_u[nbrs[jj]].coords[0], velocity_u[nbrs[jj]].coords[1]);
+            d_dofs[jj] = distance(topology->velocity_u.coord(ii, 0), topology->velocity_u.coord(ii, 1), \
+              topology->velocity_u.coord(nbrs[jj], 0), topology->velocity_u.coord(nbrs[jj], 1), topology->period);
           }
         }
         // compute edge distances
         int v[4]; // v cells surrounding the u cell
-        if (velocity_u[ii].cell_numbers[0] > -1) {
-          v[0] = ptv[idx2(velocity_u[ii].cell_numbers[0], 2, 4)];
-          v[3] = ptv[idx2(velocity_u[ii].cell_numbers[0], 3, 4)];
+        if (topology->velocity_u.cell(ii, 0) > -1) {
+          v[0] = topology->ptv[idx2(topology->velocity_u.cell(ii, 0), 2, 4)];
+          v[3] = topology->ptv[idx2(topology->velocity_u.cell(ii, 0), 3, 4)];
         }
         else goto uexit;
 
-        if (velocity_u[ii].cell_numbers[1] > -1) {
-          v[1] = ptv[idx2(velocity_u[ii].cell_numbers[1], 2, 4)];
-          v[2] = ptv[idx2(velocity_u[ii].cell_numbers[1], 3, 4)];
+        if (topology->velocity_u.cell(ii, 1) > -1) {
+          v[1] = topology->ptv[idx2(topology->velocity_u.cell(ii, 1), 2, 4)];
+          v[2] = topology->ptv[idx2(topology->velocity_u.cell(ii, 1), 3, 4)];
         }
         else goto uexit;
 
         for (int jj = 0; jj < 4; jj++) {
           int nn = (jj < 3) ? (jj + 1) : 0;
-          d_edges[jj] = distance(velocity_v[v[jj]].coords[0], velocity_v[v[jj]].coords[1], \
-            velocity_v[v[nn]].coords[0], velocity_v[v[nn]].coords[1]);
+          d_edges[jj] = distance(topology->velocity_v.coord(v[jj], 0), topology->velocity_v.coord(v[jj], 1), \
+            topology->velocity_v.coord(v[nn], 0), topology->velocity_v.coord(v[nn], 1), topology->period);
         }
 
         // off diagonal entries
         for (int jj = 0; jj < 4; jj++) {
-          if (nbrs[jj] > -1 && interior_u[nbrs[jj]]) {
+          if (nbrs[jj] > -1 && topology->interior_u[nbrs[jj]]) {
             entries++;
             temp_coo[entries - 1].value = -viscosity * d_edges[jj] / d_dofs[jj];
-            temp_coo[entries - 1].i_index = interior_u_nums[ii];
-            temp_coo[entries - 1].j_index = interior_u_nums[nbrs[jj]];
+            temp_coo[entries - 1].i_index = topology->interior_u_nums[ii];
+            temp_coo[entries - 1].j_index = topology->interior_u_nums[nbrs[jj]];
+            temp_src[entries - 1] = jj;
           }
         }
         // diagonal entry
@@ -99,24 +152,25 @@ hgf::models::stokes::momentum_2d(void)
         for (int jj = 0; jj < (entries - 1); jj++) {
           temp_coo[entries - 1].value -= temp_coo[jj].value;
         }
-        temp_coo[entries - 1].i_index = interior_u_nums[ii];
-        temp_coo[entries - 1].j_index = interior_u_nums[ii];
+        temp_coo[entries - 1].i_index = topology->interior_u_nums[ii];
+        temp_coo[entries - 1].j_index = topology->interior_u_nums[ii];
+        temp_src[entries - 1] = SRC_DIAGONAL;
 
         // pressure gradient
         entries += 2;
-        pres[0] = velocity_u[ii].cell_numbers[0];
-        pres[1] = velocity_u[ii].cell_numbers[1];
+        pres[0] = topology->velocity_u.cell(ii, 0);
+        pres[1] = topology->velocity_u.cell(ii, 1);
         temp_coo[entries - 2].value = -0.5 * (d_edges[1] + d_edges[3]);
-        temp_coo[entries - 2].i_index = interior_u_nums[ii];
+        temp_coo[entries - 2].i_index = topology->interior_u_nums[ii];
         temp_coo[entries - 2].j_index = pres[0] + shift_p;
+        temp_src[entries - 2] = SRC_PRESSURE_LOWER;
         temp_coo[entries - 1].value = 0.5 * (d_edges[1] + d_edges[3]);
-        temp_coo[entries - 1].i_index = interior_u_nums[ii];
+        temp_coo[entries - 1].i_index = topology->interior_u_nums[ii];
         temp_coo[entries - 1].j_index = pres[1] + shift_p;
+        temp_src[entries - 1] = SRC_PRESSURE_UPPER;
 
-        // place values into temporoary coo array
-        for (int jj = 0; jj < entries; jj++) {
-          temp_u_arrays[kk].push_back(temp_coo[jj]);
-        }
+        // place values into the csr row
+        place_row(csr_array, csr_source, temp_coo, temp_src, entries);
 
         // node is a physical boundary node
       uexit:
@@ -128,44 +182,46 @@ hgf::models::stokes::momentum_2d(void)
     for (int kk = 0; kk < NTHREADS; kk++) {
       int entries = 0;
       array_coo temp_coo[7] = { 0 };
+      unsigned char temp_src[7];
       double d_dofs[4], d_edges[4];
       int nbrs[4], pres[2];
-      for (int ii = kk*block_size_v; ii < std::min((kk + 1)*block_size_v, (int)interior_v_nums.size()); ii++) {
+      for (int ii = kk*block_size_v; ii < std::min((kk + 1)*block_size_v, (int)topology->interior_v_nums.size()); ii++) {
         // grab neighbor numbers
-        for (int jj = 0; jj < 4; jj++) { nbrs[jj] = velocity_v[ii].neighbors[jj]; }
+        for (int jj = 0; jj < 4; jj++) { nbrs[jj] = topology->velocity_v.neighbor(ii, jj); }
         // compute cell center distances
         for (int jj = 0; jj < 4; jj++) {
           if (nbrs[jj] > -1) {
-            d_dofs[jj] = distance(velocity_v[ii].coords[0], velocity_v[ii].coords[1], \
-              velocity_v[nbrs[jj]].coords[0], velocity_v[nbrs[jj]].coords[1]);
+            d_dofs[jj] = distance(topology->velocity_v.coord(ii, 0), topology->velocity_v.coord(ii, 1), \
+              topology->velocity_v.coord(nbrs[jj], 0), topology->velocity_v.coord(nbrs[jj], 1), topology->period);
           }
         }
         // compute edge distances
         int u[4];
-        if (velocity_v[ii].cell_numbers[0] > -1) {
-          u[0] = ptv[idx2(velocity_v[ii].cell_numbers[0], 0, 4)];
-          u[1] = ptv[idx2(velocity_v[ii].cell_numbers[0], 1, 4)];
+        if (topology->velocity_v.cell(ii, 0) > -1) {
+          u[0] = topology->ptv[idx2(topology->velocity_v.cell(ii, 0), 0, 4)];
+          u[1] = topology->ptv[idx2(topology->velocity_v.cell(ii, 0), 1, 4)];
         }
         else goto vexit;
-        if (velocity_v[ii].cell_numbers[1] > -1) {
-          u[2] = ptv[idx2(velocity_v[ii].cell_numbers[1], 1, 4)];
-          u[3] = ptv[idx2(velocity_v[ii].cell_numbers[1], 0, 4)];
+        if (topology->velocity_v.cell(ii, 1) > -1) {
+          u[2] = topology->ptv[idx2(topology->velocity_v.cell(ii, 1), 1, 4)];
+          u[3] = topology->ptv[idx2(topology->velocity_v.cell(ii, 1), 0, 4)];
         }
         else goto vexit;
 
         for (int jj = 0; jj < 4; jj++) {
           int nn = (jj < 3) ? (jj + 1) : 0;
-          d_edges[jj] = distance(velocity_u[u[jj]].coords[0], velocity_u[u[jj]].coords[1], \
-            velocity_u[u[nn]].coords[0], velocity_u[u[nn]].coords[1]);
+          d_edges[jj] = distance(topology->velocity_u.coord(u[jj], 0), topology->velocity_u.coord(u[jj], 1), \
+            topology->velocity_u.coord(u[nn], 0), topology->velocity_u.coord(u[nn], 1), topology->period);
         }
 
         // off diagonal entries
         for (int jj = 0; jj < 4; jj++) {
-          if (nbrs[jj] > -1 && interior_v[nbrs[jj]]) {
+          if (nbrs[jj] > -1 && topology->interior_v[nbrs[jj]]) {
             entries++;
             temp_coo[entries - 1].value = -viscosity * d_edges[jj] / d_dofs[jj];
-            temp_coo[entries - 1].i_index = interior_v_nums[ii]+shift_v;
-            temp_coo[entries - 1].j_index = interior_v_nums[nbrs[jj]]+shift_v;
+            temp_coo[entries - 1].i_index = topology->interior_v_nums[ii]+shift_v;
+            temp_coo[entries - 1].j_index = topology->interior_v_nums[nbrs[jj]]+shift_v;
+            temp_src[entries - 1] = jj;
           }
         }
         // diagonal entry
@@ -174,24 +230,25 @@ hgf::models::stokes::momentum_2d(void)
         for (int jj = 0; jj < (entries - 1); jj++) {
           temp_coo[entries - 1].value -= temp_coo[jj].value;
         }
-        temp_coo[entries - 1].i_index = interior_v_nums[ii]+shift_v;
-        temp_coo[entries - 1].j_index = interior_v_nums[ii]+shift_v;
+        temp_coo[entries - 1].i_index = topology->interior_v_nums[ii]+shift_v;
+        temp_coo[entries - 1].j_index = topology->interior_v_nums[ii]+shift_v;
+        temp_src[entries - 1] = SRC_DIAGONAL;
 
         // pressure gradient
         entries += 2;
-        pres[0] = velocity_v[ii].cell_numbers[0];
-        pres[1] = velocity_v[ii].cell_numbers[1];
+        pres[0] = topology->velocity_v.cell(ii, 0);
+        pres[1] = topology->velocity_v.cell(ii, 1);
         temp_coo[entries - 2].value = -0.5 * (d_edges[0] + d_edges[2]);
-        temp_coo[entries - 2].i_index = interior_v_nums[ii] + shift_v;
+        temp_coo[entries - 2].i_index = topology->interior_v_nums[ii] + shift_v;
         temp_coo[entries - 2].j_index = pres[0] + shift_p;
+        temp_src[entries - 2] = SRC_PRESSURE_LOWER;
         temp_coo[entries - 1].value = 0.5 * (d_edges[0] + d_edges[2]);
-        temp_coo[entries - 1].i_index = interior_v_nums[ii] + shift_v;
+        temp_coo[entries - 1].i_index = topology->interior_v_nums[ii] + shift_v;
         temp_coo[entries - 1].j_index = pres[1] + shift_p;
+        temp_src[entries - 1] = SRC_PRESSURE_UPPER;
 
-        // place values into temporoary coo array
-        for (int jj = 0; jj < entries; jj++) {
-          temp_v_arrays[kk].push_back(temp_coo[jj]);
-        }
+        // place values into the csr row
+        place_row(csr_array, csr_source, temp_coo, temp_src, entries);
 
         // node is a physical boundary node
       vexit:
@@ -200,40 +257,22 @@ hgf::models::stokes::momentum_2d(void)
       }
     }
   }
-  
-    // paste
-    for (int ii = 0; ii < NTHREADS; ii++) {
-      for (int jj = 0; jj < temp_u_arrays[ii].size(); jj++) {
-        coo_array.push_back(temp_u_arrays[ii][jj]);
-      }
-    }
-    for (int ii = 0; ii < NTHREADS; ii++) {
-      for (int jj = 0; jj < temp_v_arrays[ii].size(); jj++) {
-        coo_array.push_back(temp_v_arrays[ii][jj]);
-      }
-    }
 
 }
 
 void
 hgf::models::stokes::continuity_2d(void)
 {
-  int shift_v = std::accumulate(interior_u.begin(), interior_u.end(), 0);
-  int nV = std::accumulate(interior_v.begin(), interior_v.end(), 0);
-  int shift_rows = shift_v + nV;
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index nV = topology->interior_v.count();
+  hgf_index shift_rows = shift_v + nV;
 
   // setup threading parameters
   int NTHREADS = omp_get_max_threads();
 #ifdef _THREADS_DEBUG
   std::cout << "\nNTHREADS in DIFFUSION = " << NTHREADS << ".\n";
 #endif
-  int block_size_p = ((int)pressure.size() % NTHREADS) ? (int)((pressure.size() / NTHREADS) + 1) : (int)(pressure.size() / NTHREADS);
-
-  // define temp coo arrays to store results in parallel region
-  std::vector< std::vector< array_coo > > temp_arrays;
-  temp_arrays.resize(NTHREADS);
-  int maxp = block_size_p * 4;
-  for (int ii = 0; ii < NTHREADS; ii++) temp_arrays[ii].reserve(maxp);
+  int block_size_p = ((int)topology->pressure.size() % NTHREADS) ? (int)((topology->pressure.size() / NTHREADS) + 1) : (int)(topology->pressure.size() / NTHREADS);
 
 #pragma omp parallel
   {
@@ -241,41 +280,42 @@ hgf::models::stokes::continuity_2d(void)
     for (int kk = 0; kk < NTHREADS; kk++) {
       double dxy[2];
       array_coo temp_array[4];
-      for (int ii = kk*block_size_p; ii < std::min((kk + 1)*block_size_p, (int)pressure.size()); ii++) {
+      unsigned char temp_src[4];
+      int entries;
+      for (int ii = kk*block_size_p; ii < std::min((kk + 1)*block_size_p, (int)topology->pressure.size()); ii++) {
 
-        dxy[0] = distance(velocity_u[ptv[idx2(ii, 0, 4)]].coords[0], velocity_u[ptv[idx2(ii, 0, 4)]].coords[1], \
-                   velocity_u[ptv[idx2(ii, 1, 4)]].coords[0], velocity_u[ptv[idx2(ii, 1, 4)]].coords[1]);
-        dxy[1] = distance(velocity_v[ptv[idx2(ii, 2, 4)]].coords[0], velocity_v[ptv[idx2(ii, 2, 4)]].coords[1], \
-                   velocity_v[ptv[idx2(ii, 3, 4)]].coords[0], velocity_v[ptv[idx2(ii, 3, 4)]].coords[1]);
+        dxy[0] = distance(topology->velocity_u.coord(topology->ptv[idx2(ii, 0, 4)], 0), topology->velocity_u.coord(topology->ptv[idx2(ii, 0, 4)], 1), \
+                   topology->velocity_u.coord(topology->ptv[idx2(ii, 1, 4)], 0), topology->velocity_u.coord(topology->ptv[idx2(ii, 1, 4)], 1), topology->period);
+        dxy[1] = distance(topology->velocity_v.coord(topology->ptv[idx2(ii, 2, 4)], 0), topology->velocity_v.coord(topology->ptv[idx2(ii, 2, 4)], 1), \
+                   topology->velocity_v.coord(topology->ptv[idx2(ii, 3, 4)], 0), topology->velocity_v.coord(topology->ptv[idx2(ii, 3, 4)], 1), topology->period);
 
         // ux
         temp_array[0].i_index = shift_rows + ii;
-        temp_array[0].j_index = interior_u_nums[ptv[idx2(ii, 0, 4)]];
+        temp_array[0].j_index = topology->interior_u_nums[topology->ptv[idx2(ii, 0, 4)]];
         temp_array[0].value = dxy[1];
         
         temp_array[1].i_index = shift_rows + ii;
-        temp_array[1].j_index = interior_u_nums[ptv[idx2(ii, 1, 4)]];
+        temp_array[1].j_index = topology->interior_u_nums[topology->ptv[idx2(ii, 1, 4)]];
         temp_array[1].value = -dxy[1];
         
         // vy
         temp_array[2].i_index = shift_rows + ii;
-        temp_array[2].j_index = (interior_v_nums[ptv[idx2(ii, 2, 4)]] != -1) ? (shift_v + interior_v_nums[ptv[idx2(ii, 2, 4)]]) : interior_v_nums[ptv[idx2(ii, 2, 4)]];
+        temp_array[2].j_index = (topology->interior_v_nums[topology->ptv[idx2(ii, 2, 4)]] != -1) ? (shift_v + topology->interior_v_nums[topology->ptv[idx2(ii, 2, 4)]]) : topology->interior_v_nums[topology->ptv[idx2(ii, 2, 4)]];
         temp_array[2].value = dxy[0];
 
         temp_array[3].i_index = shift_rows + ii;
-        temp_array[3].j_index = (interior_v_nums[ptv[idx2(ii, 3, 4)]] != -1) ? (shift_v + interior_v_nums[ptv[idx2(ii, 3, 4)]]) : interior_v_nums[ptv[idx2(ii, 3, 4)]];
+        temp_array[3].j_index = (topology->interior_v_nums[topology->ptv[idx2(ii, 3, 4)]] != -1) ? (shift_v + topology->interior_v_nums[topology->ptv[idx2(ii, 3, 4)]]) : topology->interior_v_nums[topology->ptv[idx2(ii, 3, 4)]];
         temp_array[3].value = -dxy[0];
 
+        entries = 0;
         for (int jj = 0; jj < 4; jj++) {
-          if (temp_array[jj].j_index != -1) temp_arrays[kk].push_back(temp_array[jj]);
+          if (temp_array[jj].j_index != -1) {
+            temp_src[entries] = SRC_CONTINUITY + jj;
+            temp_array[entries++] = temp_array[jj];
+          }
         }
+        if (entries) place_row(csr_array, csr_source, temp_array, temp_src, entries);
       }
     }
   }
-  // paste
-  for (int ii = 0; ii < NTHREADS; ii++) {
-    for (int jj = 0; jj < temp_arrays[ii].size(); jj++) {
-      coo_array.push_back(temp_arrays[ii][jj]);
-    }
-  }
 }
@@ -4,24 +4,92 @@
 #include "model_stokes.hpp"
 
 // 1d->2d index
-#define idx2(i, j, ldi) ((i * ldi) + j)
+#define idx2(i, j, ldi) (((hgf_index)i * ldi) + j)
 
-// simple distance formula
-#define distance(x1,y1,z1,x2,y2,z2) \
-  sqrt(pow((x1-x2),2) + pow((y1-y2),2) + pow((z1-z2),2))
+// difference of two coordinates along an axis, wrapped to the nearest image when the axis has a period
+#define periodic_difference(dx, period) \
+  ((period > 0 && fabs(dx) > 0.5 * period) ? ((dx > 0) ? (dx - period) : (dx + period)) : (dx))
+
+// simple distance formula, across the periodic faces of the domain where period is nonzero
+#define distance(x1,y1,z1,x2,y2,z2,period) \
+  sqrt(pow(periodic_difference((x1-x2), period[0]),2) + pow(periodic_difference((y1-y2), period[1]),2) + pow(periodic_difference((z1-z2), period[2]),2))
+
+// places the entries of one row and their source codes into its csr slot, sorted by column
+static inline void
+place_row(array_csr& array, std::vector< unsigned char >& source, const array_coo* entries, const unsigned char* codes, int n_entries)
+{
+  hgf_index start = array.row_ptr[entries[0].i_index];
+  for (int jj = 0; jj < n_entries; jj++) {
+    hgf_index pos = start + jj;
+    while (pos > start && array.col_index[pos - 1] > entries[jj].j_index) {
+      array.col_index[pos] = array.col_index[pos - 1];
+      array.value[pos] = array.value[pos - 1];
+      source[pos] = source[pos - 1];
+      pos--;
+    }
+    array.col_index[pos] = entries[jj].j_index;
+    array.value[pos] = entries[jj].value;
+    source[pos] = codes[jj];
+  }
+}
 
 // dof distasnce
-static inline double dof_distance( const degree_of_freedom dof1, const degree_of_freedom dof2 )
+static inline double dof_distance( const dof_store& dofs, const double* period, int dof1, int dof2 )
 {
    
-  return distance(dof1.coords[0], dof1.coords[1], dof1.coords[2], \
-                  dof2.coords[0], dof2.coords[1], dof2.coords[2]);
+  return distance(dofs.coord(dof1, 0), dofs.coord(dof1, 1), dofs.coord(dof1, 2), \
+                  dofs.coord(dof2, 0), dofs.coord(dof2, 1), dofs.coord(dof2, 2), period);
 }
 
 void
-hgf::models::stokes::build_array_3d(const parameters& par, const hgf::mesh::voxel& msh)
+hgf::models::stokes::build_array_3d(void)
 {
 
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index shift_w = shift_v + topology->interior_v.count();
+  hgf_index shift_p = shift_w + topology->interior_w.count();
+  hgf_index n_rows = shift_p + (hgf_index)topology->pressure.size();
+
+  // row sizes, a momentum row holds its interior neighbors, the diagonal and two pressures,
+  // a continuity row holds the interior velocities on the faces of its cell
+  csr_array.n_rows = n_rows;
+  csr_array.n_cols = n_rows;
+  csr_array.row_ptr.assign(n_rows + 1, 0);
+#pragma omp parallel
+  {
+#pragma omp for schedule(static) nowait
+    for (int ii = 0; ii < (int)topology->velocity_u.size(); ii++) {
+      if (topology->interior_u_nums[ii] == -1) continue;
+      int count = 3;
+      for (int jj = 0; jj < 6; jj++) count += (topology->velocity_u.neighbor(ii, jj) > -1 && topology->interior_u[topology->velocity_u.neighbor(ii, jj)]);
+      csr_array.row_ptr[topology->interior_u_nums[ii] + 1] = count;
+    }
+#pragma omp for schedule(static) nowait
+    for (int ii = 0; ii < (int)topology->velocity_v.size(); ii++) {
+      if (topology->interior_v_nums[ii] == -1) continue;
+      int count = 3;
+      for (int jj = 0; jj < 6; jj++) count += (topology->velocity_v.neighbor(ii, jj) > -1 && topology->interior_v[topology->velocity_v.neighbor(ii, jj)]);
+      csr_array.row_ptr[shift_v + topology->interior_v_nums[ii] + 1] = count;
+    }
+#pragma omp for schedule(static) nowait
+    for (int ii = 0; ii < (int)topology->velocity_w.size(); ii++) {
+      if (topology->interior_w_nums[ii] == -1) continue;
+      int count = 3;
+      for (int jj = 0; jj < 6; jj++) count += (topology->velocity_w.neighbor(ii, jj) > -1 && topology->interior_w[topology->velocity_w.neighbor(ii, jj)]);
+      csr_array.row_ptr[shift_w + topology->interior_w_nums[ii] + 1] = count;
+    }
+#pragma omp for schedule(static) nowait
+    for (int ii = 0; ii < (int)topology->pressure.size(); ii++) {
+      csr_array.row_ptr[shift_p + ii + 1] = (topology->interior_u_nums[topology->ptv[idx2(ii, 0, 6)]] != -1) + (topology->interior_u_nums[topology->ptv[idx2(ii, 1, 6)]] != -1) \
+                                          + (topology->interior_v_nums[topology->ptv[idx2(ii, 2, 6)]] != -1) + (topology->interior_v_nums[topology->ptv[idx2(ii, 3, 6)]] != -1) \
+                                          + (topology->interior_w_nums[topology->ptv[idx2(ii, 4, 6)]] != -1) + (topology->interior_w_nums[topology->ptv[idx2(ii, 5, 6)]] != -1);
+    }
+  }
+  for (hgf_index row = 0; row < n_rows; row++) csr_array.row_ptr[row + 1] += csr_array.row_ptr[row];
+  csr_array.col_index.resize(csr_array.row_ptr[n_rows]);
+  csr_array.value.resize(csr_array.row_ptr[n_rows]);
+  csr_source.resize(csr_array.row_ptr[n_rows]);
+
   // momentum equation entries
   momentum_3d();
 
@@ -34,25 +102,15 @@ void
 hgf::models::stokes::momentum_3d(void)
 {
 
-  int shift_v = std::accumulate(interior_u.begin(), interior_u.end(), 0);
-  int shift_w = std::accumulate(interior_v.begin(), interior_v.end(), shift_v);
-  int shift_p = std::accumulate(interior_w.begin(), interior_w.end(), shift_w);
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index shift_w = shift_v + topology->interior_v.count();
+  hgf_index shift_p = shift_w + topology->interior_w.count();
 
   // threading parameters
   int NTHREADS = omp_get_max_threads();
-  int block_size_u = ((int)velocity_u.size() % NTHREADS) ? (int)((velocity_u.size() / NTHREADS) + 1) : (int)(velocity_u.size() / NTHREADS);
-  int block_size_v = ((int)velocity_v.size() % NTHREADS) ? (int)((velocity_v.size() / NTHREADS) + 1) : (int)(velocity_v.size() / NTHREADS);
-  int block_size_w = ((int)velocity_w.size() % NTHREADS) ? (int)((velocity_w.size() / NTHREADS) + 1) : (int)(velocity_w.size() / NTHREADS);
-
-  // define temp coo arrays to store results in parallel region
-  std::vector< std::vector< array_coo > > temp_u_arrays, temp_v_arrays, temp_w_arrays;
-  temp_u_arrays.resize(NTHREADS);
-  temp_v_arrays.resize(NTHREADS);
-  temp_w_arrays.resize(NTHREADS);
-  int maxu = block_size_u * 9;
-  int maxv = block_size_v * 9;
-  int maxw = block_size_w * 9;
-  for (int ii = 0; ii < NTHREADS; ii++) { temp_u_arrays[ii].reserve(maxu); temp_v_arrays[ii].reserve(maxv); temp_w_arrays[ii].reserve(maxw); }
+  int block_size_u = ((int)topology->velocity_u.size() % NTHREADS) ? (int)((topology->velocity_u.size() / NTHREADS) + 1) : (int)(topology->velocity_u.size() / NTHREADS);
+  int block_size_v = ((int)topology->velocity_v.size() % NTHREADS) ? (int)((topology->velocity_v.size() / NTHREADS) + 1) : (int)(topology->velocity_v.size() / NTHREADS);
+  int block_size_w = ((int)topology->velocity_w.size() % NTHREADS) ? (int)((topology->velocity_w.size() / NTHREADS) + 1) : (int)(topology->velocity_w.size() / NTHREADS);
 
 #pragma omp parallel
   {
@@ -61,18 +119,19 @@ hgf::models::stokes::momentum_3d(void)
       
       int entries = 0;
       array_coo temp_coo[9] = { 0 };
+      unsigned char temp_src[9];
       double d_dofs[6], d_faces[6];
       int nbrs[6], pres[2];
       double height, width;
 
-      for (int ii = kk*block_size_u; ii < std::min((kk + 1)*block_size_u, (int)interior_u_nums.size()); ii++) {
+      for (int ii = kk*block_size_u; ii < std::min((kk + 1)*block_size_u, (int)topology->interior_u_nums.size()); ii++) {
 
         // cell center distances
-        for (int jj = 0; jj < 6; jj++) nbrs[jj] = velocity_u[ii].neighbors[jj];
+        for (int jj = 0; jj < 6; jj++) nbrs[jj] = topology->velocity_u.neighbor(ii, jj);
         for (int jj = 0; jj < 6; jj++) {
           if (nbrs[jj] > -1) {
-            d_dofs[jj] = distance(velocity_u[ii].coords[0], velocity_u[ii].coords[1], velocity_u[ii].coords[2], \
-              velocity_u[nbrs[jj]].coords[0], velocity_u[nbrs[jj]].coords[1], velocity_u[nbrs[jj]].coords[2]);
+            d_dofs[jj] = distance(topology->velocity_u.coord(ii, 0), topology->velocity_u.coord(ii, 1), topology->velocity_u.coord(ii, 2), \
+              topology->velocity_u.coord(nbrs[jj], 0), topology->velocity_u.coord(nbrs[jj], 1), topology->velocity_u.coord(nbrs[jj], 2), topology->period);
           }
         }
 
@@ -80,34 +139,35 @@ hgf::models::stokes::momentum_3d(void)
         // currently set to uniform griding, come back and extend later
         int v[4]; // v cells surrounding the u cell
         int w[4]; // w cells surrounding the u cell
-        if (velocity_u[ii].cell_numbers[0] > -1) {
-          v[0] = ptv[idx2(velocity_u[ii].cell_numbers[0], 2, 6)];
-          v[3] = ptv[idx2(velocity_u[ii].cell_numbers[0], 3, 6)];
-          w[0] = ptv[idx2(velocity_u[ii].cell_numbers[0], 4, 6)];
-          w[3] = ptv[idx2(velocity_u[ii].cell_numbers[0], 5, 6)];
+        if (topology->velocity_u.cell(ii, 0) > -1) {
+          v[0] = topology->ptv[idx2(topology->velocity_u.cell(ii, 0), 2, 6)];
+          v[3] = topology->ptv[idx2(topology->velocity_u.cell(ii, 0), 3, 6)];
+          w[0] = topology->ptv[idx2(topology->velocity_u.cell(ii, 0), 4, 6)];
+          w[3] = topology->ptv[idx2(topology->velocity_u.cell(ii, 0), 5, 6)];
         }
         else goto uexit;
-        if (velocity_u[ii].cell_numbers[1] > -1) {
-          v[1] = ptv[idx2(velocity_u[ii].cell_numbers[1], 2, 6)];
-          v[2] = ptv[idx2(velocity_u[ii].cell_numbers[1], 3, 6)];
-          w[1] = ptv[idx2(velocity_u[ii].cell_numbers[1], 4, 6)];
-          w[2] = ptv[idx2(velocity_u[ii].cell_numbers[1], 5, 6)];
+        if (topology->velocity_u.cell(ii, 1) > -1) {
+          v[1] = topology->ptv[idx2(topology->velocity_u.cell(ii, 1), 2, 6)];
+          v[2] = topology->ptv[idx2(topology->velocity_u.cell(ii, 1), 3, 6)];
+          w[1] = topology->ptv[idx2(topology->velocity_u.cell(ii, 1), 4, 6)];
+          w[2] = topology->ptv[idx2(topology->velocity_u.cell(ii, 1), 5, 6)];
         }
         else goto uexit;
-        width = 0.5 * (dof_distance(velocity_v[v[0]], velocity_v[v[3]]) + \
-                       dof_distance(velocity_v[v[1]], velocity_v[v[2]]));
-        height = 0.5 * (dof_distance(velocity_w[w[0]], velocity_w[w[3]]) + \
-                        dof_distance(velocity_w[w[1]], velocity_w[w[2]]));
+        width = 0.5 * (dof_distance(topology->velocity_v, topology->period, v[0], v[3]) + \
+                       dof_distance(topology->velocity_v, topology->period, v[1], v[2]));
+        height = 0.5 * (dof_distance(topology->velocity_w, topology->period, w[0], w[3]) + \
+                        dof_distance(topology->velocity_w, topology->period, w[1], w[2]));
         d_faces[0] = width*height;
         for (int jj = 0; jj < 5; jj++) d_faces[jj + 1] = d_faces[0];
       
         // off diagonal entries
         for (int jj = 0; jj < 6; jj++) {
-          if (nbrs[jj] > -1 && interior_u[nbrs[jj]]) {
+          if (nbrs[jj] > -1 && topology->interior_u[nbrs[jj]]) {
             entries++;
             temp_coo[entries - 1].value = -viscosity * d_faces[jj] / d_dofs[jj];
-            temp_coo[entries - 1].i_index = interior_u_nums[ii];
-            temp_coo[entries - 1].j_index = interior_u_nums[nbrs[jj]];
+            temp_coo[entries - 1].i_index = topology->interior_u_nums[ii];
+            temp_coo[entries - 1].j_index = topology->interior_u_nums[nbrs[jj]];
+            temp_src[entries - 1] = jj;
           }
         }
 
@@ -117,24 +177,25 @@ hgf::models::stokes::momentum_3d(void)
         for (int jj = 0; jj < (entries - 1); jj++) {
           temp_coo[entries - 1].value -= temp_coo[jj].value;
         }
-        temp_coo[entries - 1].i_index = interior_u_nums[ii];
-        temp_coo[entries - 1].j_index = interior_u_nums[ii];
+        temp_coo[entries - 1].i_index = topology->interior_u_nums[ii];
+        temp_coo[entries - 1].j_index = topology->interior_u_nums[ii];
+        temp_src[entries - 1] = SRC_DIAGONAL;
 
         // pressure gradient
         entries += 2;
-        pres[0] = velocity_u[ii].cell_numbers[0];
-        pres[1] = velocity_u[ii].cell_numbers[1];
+        pres[0] = topology->velocity_u.cell(ii, 0);
+        pres[1] = topology->velocity_u.cell(ii, 1);
         temp_coo[entries - 2].value = -height * width;
-        temp_coo[entries - 2].i_index = interior_u_nums[ii];
+        temp_coo[entries - 2].i_index = topology->interior_u_nums[ii];
         temp_coo[entries - 2].j_index = pres[0] + shift_p;
+        temp_src[entries - 2] = SRC_PRESSURE_LOWER;
         temp_coo[entries - 1].value = height * width;
-        temp_coo[entries - 1].i_index = interior_u_nums[ii];
+        temp_coo[entries - 1].i_index = topology->interior_u_nums[ii];
         temp_coo[entries - 1].j_index = pres[1] + shift_p;
+        temp_src[entries - 1] = SRC_PRESSURE_UPPER;
 
-        // place values into temporoary coo array
-        for (int jj = 0; jj < entries; jj++) {
-          temp_u_arrays[kk].push_back(temp_coo[jj]);
-        }
+        // place values into the csr row
+        place_row(csr_array, csr_source, temp_coo, temp_src, entries);
 
         // exit
       uexit:
@@ -147,18 +208,19 @@ hgf::models::stokes::momentum_3d(void)
 
       int entries = 0;
       array_coo temp_coo[9] = { 0 };
+      unsigned char temp_src[9];
       double d_dofs[6], d_faces[6];
       int nbrs[6], pres[2];
       double length, height;
 
-      for (int ii = kk*block_size_v; ii < std::min((kk + 1)*block_size_v, (int)interior_v_nums.size()); ii++) {
+      for (int ii = kk*block_size_v; ii < std::min((kk + 1)*block_size_v, (int)topology->interior_v_nums.size()); ii++) {
 
         // cell center distances
-        for (int jj = 0; jj < 6; jj++) nbrs[jj] = velocity_v[ii].neighbors[jj];
+        for (int jj = 0; jj < 6; jj++) nbrs[jj] = topology->velocity_v.neighbor(ii, jj);
         for (int jj = 0; jj < 6; jj++) {
           if (nbrs[jj] > -1) {
-            d_dofs[jj] = distance(velocity_v[ii].coords[0], velocity_v[ii].coords[1], velocity_v[ii].coords[2], \
-              velocity_v[nbrs[jj]].coords[0], velocity_v[nbrs[jj]].coords[1], velocity_v[nbrs[jj]].coords[2]);
+            d_dofs[jj] = distance(topology->velocity_v.coord(ii, 0), topology->velocity_v.coord(ii, 1), topology->velocity_v.coord(ii, 2), \
+              topology->velocity_v.coord(nbrs[jj], 0), topology->velocity_v.coord(nbrs[jj], 1), topology->velocity_v.coord(nbrs[jj], 2), topology->period);
           }
         }
 
@@ -166,34 +228,35 @@ hgf::models::stokes::momentum_3d(void)
         // currently set to uniform griding, come back and extend later
         int u[4]; // u cells surrounding the u cell
         int w[4]; // w cells surrounding the u cell
-        if (velocity_v[ii].cell_numbers[0] > -1) {
-          u[0] = ptv[idx2(velocity_v[ii].cell_numbers[0], 0, 6)];
-          u[3] = ptv[idx2(velocity_v[ii].cell_numbers[0], 1, 6)];
-          w[0] = ptv[idx2(velocity_v[ii].cell_numbers[0], 4, 6)];
-          w[3] = ptv[idx2(velocity_v[ii].cell_numbers[0], 5, 6)];
+        if (topology->velocity_v.cell(ii, 0) > -1) {
+          u[0] = topology->ptv[idx2(topology->velocity_v.cell(ii, 0), 0, 6)];
+          u[3] = topology->ptv[idx2(topology->velocity_v.cell(ii, 0), 1, 6)];
+          w[0] = topology->ptv[idx2(topology->velocity_v.cell(ii, 0), 4, 6)];
+          w[3] = topology->ptv[idx2(topology->velocity_v.cell(ii, 0), 5, 6)];
         }
         else goto vexit;
-        if (velocity_v[ii].cell_numbers[1] > -1) {
-          u[1] = ptv[idx2(velocity_v[ii].cell_numbers[1], 0, 6)];
-          u[2] = ptv[idx2(velocity_v[ii].cell_numbers[1], 1, 6)];
-          w[1] = ptv[idx2(velocity_v[ii].cell_numbers[1], 4, 6)];
-          w[2] = ptv[idx2(velocity_v[ii].cell_numbers[1], 5, 6)];
+        if (topology->velocity_v.cell(ii, 1) > -1) {
+          u[1] = topology->ptv[idx2(topology->velocity_v.cell(ii, 1), 0, 6)];
+          u[2] = topology->ptv[idx2(topology->velocity_v.cell(ii, 1), 1, 6)];
+          w[1] = topology->ptv[idx2(topology->velocity_v.cell(ii, 1), 4, 6)];
+          w[2] = topology->ptv[idx2(topology->velocity_v.cell(ii, 1), 5, 6)];
         }
         else goto vexit;
-        height = 0.5 * (dof_distance(velocity_w[w[0]], velocity_w[w[3]]) + \
-                        dof_distance(velocity_w[w[1]], velocity_w[w[2]]));
-        length = 0.5 * (dof_distance(velocity_u[u[0]], velocity_u[u[3]]) + \
-                        dof_distance(velocity_u[u[1]], velocity_u[u[2]]));
+        height = 0.5 * (dof_distance(topology->velocity_w, topology->period, w[0], w[3]) + \
+                        dof_distance(topology->velocity_w, topology->period, w[1], w[2]));
+        length = 0.5 * (dof_distance(topology->velocity_u, topology->period, u[0], u[3]) + \
+                        dof_distance(topology->velocity_u, topology->period, u[1], u[2]));
         d_faces[0] = length*height;
         for (int jj = 0; jj < 5; jj++) d_faces[jj + 1] = d_faces[0];
 
         // off diagonal entries
         for (int jj = 0; jj < 6; jj++) {
-          if (nbrs[jj] > -1 && interior_v[nbrs[jj]]) {
+          if (nbrs[jj] > -1 && topology->interior_v[nbrs[jj]]) {
             entries++;
             temp_coo[entries - 1].value = -viscosity * d_faces[jj] / d_dofs[jj];
-            temp_coo[entries - 1].i_index = interior_v_nums[ii] + shift_v;
-            temp_coo[entries - 1].j_index = interior_v_nums[nbrs[jj]] + shift_v;
+            temp_coo[entries - 1].i_index = topology->interior_v_nums[ii] + shift_v;
+            temp_coo[entries - 1].j_index = topology->interior_v_nums[nbrs[jj]] + shift_v;
+            temp_src[entries - 1] = jj;
           }
         }
 
@@ -203,24 +266,25 @@ hgf::models::stokes::momentum_3d(void)
         for (int jj = 0; jj < (entries - 1); jj++) {
           temp_coo[entries - 1].value -= temp_coo[jj].value;
         }
-        temp_coo[entries - 1].i_index = interior_v_nums[ii] + shift_v;
-        temp_coo[entries - 1].j_index = interior_v_nums[ii] + shift_v;
+        temp_coo[entries - 1].i_index = topology->interior_v_nums[ii] + shift_v;
+        temp_coo[entries - 1].j_index = topology->interior_v_nums[ii] + shift_v;
+        temp_src[entries - 1] = SRC_DIAGONAL;
 
         // pressure gradient
         entries += 2;
-        pres[0] = velocity_v[ii].cell_numbers[0];
-        pres[1] = velocity_v[ii].cell_numbers[1];
+        pres[0] = topology->velocity_v.cell(ii, 0);
+        pres[1] = topology->velocity_v.cell(ii, 1);
         temp_coo[entries - 2].value = -length * height;
-        temp_coo[entries - 2].i_index = interior_v_nums[ii] + shift_v;
+        temp_coo[entries - 2].i_index = topology->interior_v_nums[ii] + shift_v;
         temp_coo[entries - 2].j_index = pres[0] + shift_p;
+        temp_src[entries - 2] = SRC_PRESSURE_LOWER;
         temp_coo[entries - 1].value = length * height;
-        temp_coo[entries - 1].i_index = interior_v_nums[ii] + shift_v;
+        temp_coo[entries - 1].i_index = topology->interior_v_nums[ii] + shift_v;
         temp_coo[entries - 1].j_index = pres[1] + shift_p;
+        temp_src[entries - 1] = SRC_PRESSURE_UPPER;
 
-        // place values into temporoary coo array
-        for (int jj = 0; jj < entries; jj++) {
-          temp_v_arrays[kk].push_back(temp_coo[jj]);
-        }
+        // place values into the csr row
+        place_row(csr_array, csr_source, temp_coo, temp_src, entries);
 
         // exit
       vexit:
@@ -232,18 +296,19 @@ hgf::models::stokes::momentum_3d(void)
     for (int kk = 0; kk < NTHREADS; kk++) { // w blocks
       int entries = 0;
       array_coo temp_coo[9] = { 0 };
+      unsigned char temp_src[9];
       double d_dofs[6], d_faces[6];
       int nbrs[6], pres[2];
       double length, width;
 
-      for (int ii = kk*block_size_w; ii < std::min((kk + 1)*block_size_w, (int)interior_w_nums.size()); ii++) {
+      for (int ii = kk*block_size_w; ii < std::min((kk + 1)*block_size_w, (int)topology->interior_w_nums.size()); ii++) {
 
         // cell center distances
-        for (int jj = 0; jj < 6; jj++) nbrs[jj] = velocity_w[ii].neighbors[jj];
+        for (int jj = 0; jj < 6; jj++) nbrs[jj] = topology->velocity_w.neighbor(ii, jj);
         for (int jj = 0; jj < 6; jj++) {
           if (nbrs[jj] > -1) {
-            d_dofs[jj] = distance(velocity_w[ii].coords[0], velocity_w[ii].coords[1], velocity_w[ii].coords[2], \
-              velocity_w[nbrs[jj]].coords[0], velocity_w[nbrs[jj]].coords[1], velocity_w[nbrs[jj]].coords[2]);
+            d_dofs[jj] = distance(topology->velocity_w.coord(ii, 0), topology->velocity_w.coord(ii, 1), topology->velocity_w.coord(ii, 2), \
+              topology->velocity_w.coord(nbrs[jj], 0), topology->velocity_w.coord(nbrs[jj], 1), topology->velocity_w.coord(nbrs[jj], 2), topology->period);
           }
         }
 
@@ -251,34 +316,35 @@ hgf::models::stokes::momentum_3d(void)
         // currently set to uniform griding, come back and extend later
         int u[4]; // u cells surrounding the w cell
         int v[4]; // v cells surrounding the w cell
-        if (velocity_w[ii].cell_numbers[0] > -1) {
-          u[0] = ptv[idx2(velocity_w[ii].cell_numbers[0], 0, 6)];
-          u[3] = ptv[idx2(velocity_w[ii].cell_numbers[0], 1, 6)];
-          v[0] = ptv[idx2(velocity_w[ii].cell_numbers[0], 2, 6)];
-          v[3] = ptv[idx2(velocity_w[ii].cell_numbers[0], 3, 6)];
+        if (topology->velocity_w.cell(ii, 0) > -1) {
+          u[0] = topology->ptv[idx2(topology->velocity_w.cell(ii, 0), 0, 6)];
+          u[3] = topology->ptv[idx2(topology->velocity_w.cell(ii, 0), 1, 6)];
+          v[0] = topology->ptv[idx2(topology->velocity_w.cell(ii, 0), 2, 6)];
+          v[3] = topology->ptv[idx2(topology->velocity_w.cell(ii, 0), 3, 6)];
         }
         else goto wexit;
-        if (velocity_w[ii].cell_numbers[1] > -1) {
-          u[1] = ptv[idx2(velocity_w[ii].cell_numbers[1], 0, 6)];
-          u[2] = ptv[idx2(velocity_w[ii].cell_numbers[1], 1, 6)];
-          v[1] = ptv[idx2(velocity_w[ii].cell_numbers[1], 2, 6)];
-          v[2] = ptv[idx2(velocity_w[ii].cell_numbers[1], 3, 6)];
+        if (topology->velocity_w.cell(ii, 1) > -1) {
+          u[1] = topology->ptv[idx2(topology->velocity_w.cell(ii, 1), 0, 6)];
+          u[2] = topology->ptv[idx2(topology->velocity_w.cell(ii, 1), 1, 6)];
+          v[1] = topology->ptv[idx2(topology->velocity_w.cell(ii, 1), 2, 6)];
+          v[2] = topology->ptv[idx2(topology->velocity_w.cell(ii, 1), 3, 6)];
         }
         else goto wexit;
-        length = 0.5 * (dof_distance(velocity_u[u[0]], velocity_u[u[3]]) + \
-                        dof_distance(velocity_u[u[1]], velocity_u[u[2]]));
-        width = 0.5 * (dof_distance(velocity_v[v[0]], velocity_v[v[3]]) + \
-                       dof_distance(velocity_v[v[1]], velocity_v[v[2]]));
+        length = 0.5 * (dof_distance(topology->velocity_u, topology->period, u[0], u[3]) + \
+                        dof_distance(topology->velocity_u, topology->period, u[1], u[2]));
+        width = 0.5 * (dof_distance(topology->velocity_v, topology->period, v[0], v[3]) + \
+                       dof_distance(topology->velocity_v, topology->period, v[1], v[2]));
         d_faces[0] = length*width;
         for (int jj = 0; jj < 5; jj++) d_faces[jj + 1] = d_faces[0];
 
         // off diagonal entries
         for (int jj = 0; jj < 6; jj++) {
-          if (nbrs[jj] > -1 && interior_w[nbrs[jj]]) {
+          if (nbrs[jj] > -1 && topology->interior_w[nbrs[jj]]) {
             entries++;
             temp_coo[entries - 1].value = -viscosity * d_faces[jj] / d_dofs[jj];
-            temp_coo[entries - 1].i_index = interior_w_nums[ii] + shift_w;
-            temp_coo[entries - 1].j_index = interior_w_nums[nbrs[jj]] + shift_w;
+            temp_coo[entries - 1].i_index = topology->interior_w_nums[ii] + shift_w;
+            temp_coo[entries - 1].j_index = topology->interior_w_nums[nbrs[jj]] + shift_w;
+            temp_src[entries - 1] = jj;
           }
         }
 
@@ -288,24 +354,25 @@ hgf::models::stokes::momentum_3d(void)
         for (int jj = 0; jj < (entries - 1); jj++) {
           temp_coo[entries - 1].value -= temp_coo[jj].value;
         }
-        temp_coo[entries - 1].i_index = interior_w_nums[ii] + shift_w;
-        temp_coo[entries - 1].j_index = interior_w_nums[ii] + shift_w;
+        temp_coo[entries - 1].i_index = topology->interior_w_nums[ii] + shift_w;
+        temp_coo[entries - 1].j_index = topology->interior_w_nums[ii] + shift_w;
+        temp_src[entries - 1] = SRC_DIAGONAL;
 
         // pressure gradient
         entries += 2;
-        pres[0] = velocity_w[ii].cell_numbers[0];
-        pres[1] = velocity_w[ii].cell_numbers[1];
+        pres[0] = topology->velocity_w.cell(ii, 0);
+        pres[1] = topology->velocity_w.cell(ii, 1);
         temp_coo[entries - 2].value = -length * width;
-        temp_coo[entries - 2].i_index = interior_w_nums[ii] + shift_w;
+        temp_coo[entries - 2].i_index = topology->interior_w_nums[ii] + shift_w;
         temp_coo[entries - 2].j_index = pres[0] + shift_p;
+        temp_src[entries - 2] = SRC_PRESSURE_LOWER;
         temp_coo[entries - 1].value = length * width;
-        temp_coo[entries - 1].i_index = interior_w_nums[ii] + shift_w;
+        temp_coo[entries - 1].i_index = topology->interior_w_nums[ii] + shift_w;
         temp_coo[entries - 1].j_index = pres[1] + shift_p;
+        temp_src[entries - 1] = SRC_PRESSURE_UPPER;
 
-        // place values into temporoary coo array
-        for (int jj = 0; jj < entries; jj++) {
-          temp_w_arrays[kk].push_back(temp_coo[jj]);
-        }
+        // place values into the csr row
+        place_row(csr_array, csr_source, temp_coo, temp_src, entries);
 
         // exit
       wexit:
@@ -313,41 +380,19 @@ hgf::models::stokes::momentum_3d(void)
       }
     }
   }
-  // paste
-  for (int ii = 0; ii < NTHREADS; ii++) {
-    for (int jj = 0; jj < temp_u_arrays[ii].size(); jj++) {
-      coo_array.push_back(temp_u_arrays[ii][jj]);
-    }
-  }
-  for (int ii = 0; ii < NTHREADS; ii++) {
-    for (int jj = 0; jj < temp_v_arrays[ii].size(); jj++) {
-      coo_array.push_back(temp_v_arrays[ii][jj]);
-    }
-  }
-  for (int ii = 0; ii < NTHREADS; ii++) {
-    for (int jj = 0; jj < temp_w_arrays[ii].size(); jj++) {
-      coo_array.push_back(temp_w_arrays[ii][jj]);
-    }
-  }
 
 }
 
 void
 hgf::models::stokes::continuity_3d(void)
 {
-  int shift_v = std::accumulate(interior_u.begin(), interior_u.end(), 0);
-  int shift_w = std::accumulate(interior_v.begin(), interior_v.end(), shift_v);
-  int shift_rows = std::accumulate(interior_w.begin(), interior_w.end(), shift_w);
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index shift_w = shift_v + topology->interior_v.count();
+  hgf_index shift_rows = shift_w + topology->interior_w.count();
 
   // threading
   int NTHREADS = omp_get_max_threads();
-  int block_size_p = ((int)pressure.size() % NTHREADS) ? (int)((pressure.size() / NTHREADS) + 1) : (int)(pressure.size() / NTHREADS);
-
-  // temp coo arrays for parallel regions
-  std::vector< std::vector< array_coo > > temp_arrays;
-  temp_arrays.resize(NTHREADS);
-  int maxp = block_size_p * 6;
-  for (int ii = 0; ii < NTHREADS; ii++) temp_arrays[ii].reserve(maxp);
+  int block_size_p = ((int)topology->pressure.size() % NTHREADS) ? (int)((topology->pressure.size() / NTHREADS) + 1) : (int)(topology->pressure.size() / NTHREADS);
 
 #pragma omp parallel
   {
@@ -355,52 +400,53 @@ hgf::models::stokes::continuity_3d(void)
     for (int kk = 0; kk < NTHREADS; kk++) {
       double dxyz[3];
       array_coo temp_array[6];
-      for (int ii = kk*block_size_p; ii < std::min((kk + 1)*block_size_p, (int)pressure.size()); ii++) {
+      unsigned char temp_src[6];
+      int entries;
+      for (int ii = kk*block_size_p; ii < std::min((kk + 1)*block_size_p, (int)topology->pressure.size()); ii++) {
 
-        dxyz[0] = distance(velocity_u[ptv[idx2(ii, 0, 6)]].coords[0], velocity_u[ptv[idx2(ii, 0, 6)]].coords[1], velocity_u[ptv[idx2(ii, 0, 6)]].coords[2], \
-          velocity_u[ptv[idx2(ii, 1, 6)]].coords[0], velocity_u[ptv[idx2(ii, 1, 6)]].coords[1], velocity_u[ptv[idx2(ii, 1, 6)]].coords[2]);
-        dxyz[1] = distance(velocity_v[ptv[idx2(ii, 2, 6)]].coords[0], velocity_v[ptv[idx2(ii, 2, 6)]].coords[1], velocity_v[ptv[idx2(ii, 2, 6)]].coords[2], \
-          velocity_v[ptv[idx2(ii, 3, 6)]].coords[0], velocity_v[ptv[idx2(ii, 3, 6)]].coords[1], velocity_v[ptv[idx2(ii, 3, 6)]].coords[2]);
-        dxyz[2] = distance(velocity_w[ptv[idx2(ii, 4, 6)]].coords[0], velocity_w[ptv[idx2(ii, 4, 6)]].coords[1], velocity_w[ptv[idx2(ii, 4, 6)]].coords[2], \
-          velocity_w[ptv[idx2(ii, 5, 6)]].coords[0], velocity_w[ptv[idx2(ii, 5, 6)]].coords[1], velocity_w[ptv[idx2(ii, 5, 6)]].coords[2]);
+        dxyz[0] = distance(topology->velocity_u.coord(topology->ptv[idx2(ii, 0, 6)], 0), topology->velocity_u.coord(topology->ptv[idx2(ii, 0, 6)], 1), topology->velocity_u.coord(topology->ptv[idx2(ii, 0, 6)], 2), \
+          topology->velocity_u.coord(topology->ptv[idx2(ii, 1, 6)], 0), topology->velocity_u.coord(topology->ptv[idx2(ii, 1, 6)], 1), topology->velocity_u.coord(topology->ptv[idx2(ii, 1, 6)], 2), topology->period);
+        dxyz[1] = distance(topology->velocity_v.coord(topology->ptv[idx2(ii, 2, 6)], 0), topology->velocity_v.coord(topology->ptv[idx2(ii, 2, 6)], 1), topology->velocity_v.coord(topology->ptv[idx2(ii, 2, 6)], 2), \
+          topology->velocity_v.coord(topology->ptv[idx2(ii, 3, 6)], 0), topology->velocity_v.coord(topology->ptv[idx2(ii, 3, 6)], 1), topology->velocity_v.coord(topology->ptv[idx2(ii, 3, 6)], 2), topology->period);
+        dxyz[2] = distance(topology->velocity_w.coord(topology->ptv[idx2(ii, 4, 6)], 0), topology->velocity_w.coord(topology->ptv[idx2(ii, 4, 6)], 1), topology->velocity_w.coord(topology->ptv[idx2(ii, 4, 6)], 2), \
+          topology->velocity_w.coord(topology->ptv[idx2(ii, 5, 6)], 0), topology->velocity_w.coord(topology->ptv[idx2(ii, 5, 6)], 1), topology->velocity_w.coord(topology->ptv[idx2(ii, 5, 6)], 2), topology->period);
 
         // ux
         temp_array[0].i_index = shift_rows + ii;
-        temp_array[0].j_index = interior_u_nums[ptv[idx2(ii, 0, 6)]];
+        temp_array[0].j_index = topology->interior_u_nums[topology->ptv[idx2(ii, 0, 6)]];
         temp_array[0].value = dxyz[1] * dxyz[2];
 
         temp_array[1].i_index = shift_rows + ii;
-        temp_array[1].j_index = interior_u_nums[ptv[idx2(ii, 1, 6)]];
+        temp_array[1].j_index = topology->interior_u_nums[topology->ptv[idx2(ii, 1, 6)]];
         temp_array[1].value = -dxyz[1] * dxyz[2];
 
         // vy
         temp_array[2].i_index = shift_rows + ii;
-        temp_array[2].j_index = (interior_v_nums[ptv[idx2(ii, 2, 6)]] != -1) ? (shift_v + interior_v_nums[ptv[idx2(ii, 2, 6)]]) : interior_v_nums[ptv[idx2(ii, 2, 6)]];
+        temp_array[2].j_index = (topology->interior_v_nums[topology->ptv[idx2(ii, 2, 6)]] != -1) ? (shift_v + topology->interior_v_nums[topology->ptv[idx2(ii, 2, 6)]]) : topology->interior_v_nums[topology->ptv[idx2(ii, 2, 6)]];
         temp_array[2].value = dxyz[0] * dxyz[2];
 
         temp_array[3].i_index = shift_rows + ii;
-        temp_array[3].j_index = (interior_v_nums[ptv[idx2(ii, 3, 6)]] != -1) ? (shift_v + interior_v_nums[ptv[idx2(ii, 3, 6)]]) : interior_v_nums[ptv[idx2(ii, 3, 6)]];
+        temp_array[3].j_index = (topology->interior_v_nums[topology->ptv[idx2(ii, 3, 6)]] != -1) ? (shift_v + topology->interior_v_nums[topology->ptv[idx2(ii, 3, 6)]]) : topology->interior_v_nums[topology->ptv[idx2(ii, 3, 6)]];
         temp_array[3].value = -dxyz[0] * dxyz[2];
 
         // wz
         temp_array[4].i_index = shift_rows + ii;
-        temp_array[4].j_index = (interior_w_nums[ptv[idx2(ii, 4, 6)]] != -1) ? (shift_w + interior_w_nums[ptv[idx2(ii, 4, 6)]]) : interior_w_nums[ptv[idx2(ii, 4, 6)]];
+        temp_array[4].j_index = (topology->interior_w_nums[topology->ptv[idx2(ii, 4, 6)]] != -1) ? (shift_w + topology->interior_w_nums[topology->ptv[idx2(ii, 4, 6)]]) : topology->interior_w_nums[topology->ptv[idx2(ii, 4, 6)]];
         temp_array[4].value = dxyz[0] * dxyz[1];
 
         temp_array[5].i_index = shift_rows + ii;
-        temp_array[5].j_index = (interior_w_nums[ptv[idx2(ii, 5, 6)]] != -1) ? (shift_w + interior_w_nums[ptv[idx2(ii, 5, 6)]]) : interior_w_nums[ptv[idx2(ii, 5, 6)]];
+        temp_array[5].j_index = (topology->interior_w_nums[topology->ptv[idx2(ii, 5, 6)]] != -1) ? (shift_w + topology->interior_w_nums[topology->ptv[idx2(ii, 5, 6)]]) : topology->interior_w_nums[topology->ptv[idx2(ii, 5, 6)]];
         temp_array[5].value = -dxyz[0] * dxyz[1];
 
+        entries = 0;
         for (int jj = 0; jj < 6; jj++) {
-          if (temp_array[jj].j_index != -1) temp_arrays[kk].push_back(temp_array[jj]);
+          if (temp_array[jj].j_index != -1) {
+            temp_src[entries] = SRC_CONTINUITY + jj;
+            temp_array[entries++] = temp_array[jj];
+          }
         }
+        if (entries) place_row(csr_array, csr_source, temp_array, temp_src, entries);
       }
     }
   }
-  // paste
-  for (int ii = 0; ii < NTHREADS; ii++) {
-    for (int jj = 0; jj < temp_arrays[ii].size(); jj++) {
-      coo_array.push_back(temp_arrays[ii][jj]);
-    }
-  }
 }
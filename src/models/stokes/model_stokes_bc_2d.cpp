@@ -8,23 +8,23 @@
   sqrt(pow((x1-x2),2) + pow((y1-y2),2))
 
 // 1d->2d index
-#define idx2(i, j, ldi) ((i * ldi) + j)
+#define idx2(i, j, ldi) (((hgf_index)i * ldi) + j)
 
 void
 hgf::models::stokes::xflow_2d(const parameters& par, const hgf::mesh::voxel& msh, const HGF_INFLOW& INFLOW)
 {
   
-  boundary.resize(velocity_u.size() + velocity_v.size());
+  boundary.resize(topology->velocity_u.size() + topology->velocity_v.size());
 
-  int shift_v = std::accumulate(interior_u.begin(), interior_u.end(), 0);
-  int nV = std::accumulate(interior_v.begin(), interior_v.end(), 0);
-  int shift_rows = shift_v + nV;
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index nV = topology->interior_v.count();
+  hgf_index shift_rows = shift_v + nV;
 
   // setup threading parameters
   int NTHREADS = omp_get_max_threads();
-  int block_size_u = ((int)velocity_u.size() % NTHREADS) ? (int)((velocity_u.size() / NTHREADS) + 1) : (int)(velocity_u.size() / NTHREADS);
-  int block_size_v = ((int)velocity_v.size() % NTHREADS) ? (int)((velocity_v.size() / NTHREADS) + 1) : (int)(velocity_v.size() / NTHREADS);
-  int block_size_p = ((int)pressure.size() % NTHREADS) ? (int)((pressure.size() / NTHREADS) + 1) : (int)(pressure.size() / NTHREADS);
+  int block_size_u = ((int)topology->boundary_u.size() % NTHREADS) ? (int)((topology->boundary_u.size() / NTHREADS) + 1) : (int)(topology->boundary_u.size() / NTHREADS);
+  int block_size_v = ((int)topology->boundary_v.size() % NTHREADS) ? (int)((topology->boundary_v.size() / NTHREADS) + 1) : (int)(topology->boundary_v.size() / NTHREADS);
+  int block_size_p = ((int)topology->boundary_pressure.size() % NTHREADS) ? (int)((topology->boundary_pressure.size() / NTHREADS) + 1) : (int)(topology->boundary_pressure.size() / NTHREADS);
 
   // define temp coo arrays to store results in parallel region
   std::vector< std::vector< array_coo > > temp_u_arrays, temp_v_arrays, temp_p_arrays;
@@ -55,25 +55,26 @@ hgf::models::stokes::xflow_2d(const parameters& par, const hgf::mesh::voxel& msh
       array_coo temp_coo, temp_p_coo;
       double dx, dy;
 
-      for (int ii = kk*block_size_u; ii < std::min((kk + 1)*block_size_u, (int)interior_u_nums.size()); ii++) {
+      for (int ll = kk*block_size_u; ll < std::min((kk + 1)*block_size_u, (int)topology->boundary_u.size()); ll++) {
+        int ii = topology->boundary_u[ll];
         double value = 0;
         int bc_contributor[4] = { 0, 0, 0, 0 };
         int nnbr = 0;
-        if (!interior_u[ii]) goto uexit;
+        if (!topology->interior_u[ii]) goto uexit;
         for (int jj = 0; jj < 4; jj++) {
-          nbrs[jj] = velocity_u[ii].neighbors[jj];
-          if (nbrs[jj] != -1 && interior_u[nbrs[jj]]) nnbr++;
+          nbrs[jj] = topology->velocity_u.neighbor(ii, jj);
+          if (nbrs[jj] != -1 && topology->interior_u[nbrs[jj]]) nnbr++;
           else bc_contributor[jj] = 1;
         }
         if (nnbr == 4) goto uexit;
 
-        dx = (velocity_u[ii].cell_numbers[0] != -1) ? \
-          (2 * (velocity_u[ii].coords[0] - pressure[velocity_u[ii].cell_numbers[0]].coords[0])) : \
-          (2 * (pressure[velocity_u[ii].cell_numbers[1]].coords[0] - velocity_u[ii].coords[0]));
+        dx = (topology->velocity_u.cell(ii, 0) != -1) ? \
+          (2 * (topology->velocity_u.coord(ii, 0) - topology->pressure.coord(topology->velocity_u.cell(ii, 0), 0))) : \
+          (2 * (topology->pressure.coord(topology->velocity_u.cell(ii, 1), 0) - topology->velocity_u.coord(ii, 0)));
           
-        dy = (velocity_u[ii].cell_numbers[0] != -1) ? \
-          (2 * (velocity_v[ptv[idx2(velocity_u[ii].cell_numbers[0], 3, 4)]].coords[1] - velocity_u[ii].coords[1])) : \
-          (2 * (velocity_v[ptv[idx2(velocity_u[ii].cell_numbers[1], 3, 4)]].coords[1] - velocity_u[ii].coords[1]));
+        dy = (topology->velocity_u.cell(ii, 0) != -1) ? \
+          (2 * (topology->velocity_v.coord(topology->ptv[idx2(topology->velocity_u.cell(ii, 0), 3, 4)], 1) - topology->velocity_u.coord(ii, 1))) : \
+          (2 * (topology->velocity_v.coord(topology->ptv[idx2(topology->velocity_u.cell(ii, 1), 3, 4)], 1) - topology->velocity_u.coord(ii, 1)));
 
         // S neighbor?
         if (bc_contributor[0]) {
@@ -84,15 +85,15 @@ hgf::models::stokes::xflow_2d(const parameters& par, const hgf::mesh::voxel& msh
         // E neighbor?
         if (bc_contributor[1]) {
           // Type Dirichlet?
-          if (velocity_u[ii].coords[0] + dx <= xmax - eps) {
+          if (topology->velocity_u.coord(ii, 0) + dx <= xmax - eps) {
             value += viscosity * dx / dy;
             boundary[nbrs[1]].type = 1;
             boundary[nbrs[1]].value = 0.0;
           }
           // Type Neumann?
           else {
-            temp_p_coo.i_index = interior_u_nums[ii];
-            temp_p_coo.j_index = shift_rows + ((velocity_u[ii].cell_numbers[1] != -1) ? velocity_u[ii].cell_numbers[1] : velocity_u[ii].cell_numbers[0]);
+            temp_p_coo.i_index = topology->interior_u_nums[ii];
+            temp_p_coo.j_index = shift_rows + ((topology->velocity_u.cell(ii, 1) != -1) ? topology->velocity_u.cell(ii, 1) : topology->velocity_u.cell(ii, 0));
             temp_p_coo.value = viscosity * dy;
             temp_u_arrays[kk].push_back(temp_p_coo);
             boundary[nbrs[1]].type = 2;
@@ -113,20 +114,20 @@ hgf::models::stokes::xflow_2d(const parameters& par, const hgf::mesh::voxel& msh
           boundary[nbrs[3]].type = 1;
           boundary[nbrs[3]].value = 0.0;
           // is it an inflow bdr?
-          if (velocity_u[ii].coords[0] - dx < xmin + eps) {
+          if (topology->velocity_u.coord(ii, 0) - dx < xmin + eps) {
             double bvalue;
             switch (INFLOW) {
-              case HGF_INFLOW_PARABOLIC: bvalue = inflow_max/pow((ymax-ymin)/2.0,2)*(velocity_u[ii].coords[1] - ymin) * (ymax - velocity_u[ii].coords[1]); break;
+              case HGF_INFLOW_PARABOLIC: bvalue = inflow_max/pow((ymax-ymin)/2.0,2)*(topology->velocity_u.coord(ii, 1) - ymin) * (ymax - topology->velocity_u.coord(ii, 1)); break;
               case HGF_INFLOW_CONSTANT: bvalue = inflow_max; break;
               default: std::cout << INFLOW << " is not a valid HGF_INFLOW. See include/types.hpp." << std::endl;
             }
-            rhs[interior_u_nums[ii]] += bvalue * viscosity * dy / dx;
+            rhs[topology->interior_u_nums[ii]] += bvalue * viscosity * dy / dx;
             boundary[nbrs[3]].value += bvalue;
           }
         }
 
-        temp_coo.i_index = interior_u_nums[ii];
-        temp_coo.j_index = interior_u_nums[ii];
+        temp_coo.i_index = topology->interior_u_nums[ii];
+        temp_coo.j_index = topology->interior_u_nums[ii];
         temp_coo.value = value;
 
         temp_u_arrays[kk].push_back(temp_coo);
@@ -141,42 +142,43 @@ hgf::models::stokes::xflow_2d(const parameters& par, const hgf::mesh::voxel& msh
       array_coo temp_coo, temp_p_coo;
       double dx, dy;
 
-      for (int ii = kk*block_size_v; ii < std::min((kk + 1)*block_size_v, (int)interior_v_nums.size()); ii++) {
+      for (int ll = kk*block_size_v; ll < std::min((kk + 1)*block_size_v, (int)topology->boundary_v.size()); ll++) {
+        int ii = topology->boundary_v[ll];
         double value = 0;
         int bc_contributor[4] = { 0, 0, 0, 0 };
         int nnbr = 0;
-        if (!interior_v[ii]) goto vexit;
+        if (!topology->interior_v[ii]) goto vexit;
         for (int jj = 0; jj < 4; jj++) {
-          nbrs[jj] = velocity_v[ii].neighbors[jj];
-          if (nbrs[jj] != -1 && interior_v[nbrs[jj]]) nnbr++;
+          nbrs[jj] = topology->velocity_v.neighbor(ii, jj);
+          if (nbrs[jj] != -1 && topology->interior_v[nbrs[jj]]) nnbr++;
           else bc_contributor[jj] = 1;
         }
         if (nnbr == 4) goto vexit;
 
-        dx = (velocity_v[ii].cell_numbers[0] != -1) ? \
-          (2 * (velocity_u[ptv[idx2(velocity_v[ii].cell_numbers[0], 1, 4)]].coords[0] - velocity_v[ii].coords[0])) : \
-          (2 * (velocity_u[ptv[idx2(velocity_v[ii].cell_numbers[1], 1, 4)]].coords[0] - velocity_v[ii].coords[0]));
-        dy = (velocity_v[ii].cell_numbers[0] != -1) ? \
-          (2 * (velocity_v[ii].coords[1] - pressure[velocity_v[ii].cell_numbers[0]].coords[1])) : \
-          (2 * (pressure[velocity_v[ii].cell_numbers[1]].coords[1] - velocity_v[ii].coords[1]));
+        dx = (topology->velocity_v.cell(ii, 0) != -1) ? \
+          (2 * (topology->velocity_u.coord(topology->ptv[idx2(topology->velocity_v.cell(ii, 0), 1, 4)], 0) - topology->velocity_v.coord(ii, 0))) : \
+          (2 * (topology->velocity_u.coord(topology->ptv[idx2(topology->velocity_v.cell(ii, 1), 1, 4)], 0) - topology->velocity_v.coord(ii, 0)));
+        dy = (topology->velocity_v.cell(ii, 0) != -1) ? \
+          (2 * (topology->velocity_v.coord(ii, 1) - topology->pressure.coord(topology->velocity_v.cell(ii, 0), 1))) : \
+          (2 * (topology->pressure.coord(topology->velocity_v.cell(ii, 1), 1) - topology->velocity_v.coord(ii, 1)));
 
 
         // S neighbor?
         if (bc_contributor[0]) {
           // Type Dirichlet
-          boundary[nbrs[0] + velocity_u.size()].type = 1;
-          boundary[nbrs[0] + velocity_u.size()].value = 0.0;
+          boundary[nbrs[0] + topology->velocity_u.size()].type = 1;
+          boundary[nbrs[0] + topology->velocity_u.size()].value = 0.0;
           value += viscosity * dy / dx;
         }
 
         // E neighbor?
         if (bc_contributor[1]) {
           // Type Dirichlet?
-          if (velocity_v[ii].coords[0] + 0.5*dx <= xmax - eps) value += viscosity * dy / (0.5*dx);
+          if (topology->velocity_v.coord(ii, 0) + 0.5*dx <= xmax - eps) value += viscosity * dy / (0.5*dx);
           // Type Neumann?
           else {
-            temp_p_coo.i_index = shift_v + interior_v_nums[ii];
-            temp_p_coo.j_index = shift_rows + ((velocity_v[ii].cell_numbers[1] != -1) ? velocity_v[ii].cell_numbers[1] : velocity_v[ii].cell_numbers[0]);
+            temp_p_coo.i_index = shift_v + topology->interior_v_nums[ii];
+            temp_p_coo.j_index = shift_rows + ((topology->velocity_v.cell(ii, 1) != -1) ? topology->velocity_v.cell(ii, 1) : topology->velocity_v.cell(ii, 0));
             temp_p_coo.value = viscosity * dy;
             temp_v_arrays[kk].push_back(temp_p_coo);
 	  } 
@@ -185,8 +187,8 @@ hgf::models::stokes::xflow_2d(const parameters& par, const hgf::mesh::voxel& msh
         // N neighbor?
         if (bc_contributor[2]) {
           // Type Dirichlet
-          boundary[nbrs[2] + velocity_u.size()].type = 1;
-          boundary[nbrs[2] + velocity_u.size()].value = 0.0;
+          boundary[nbrs[2] + topology->velocity_u.size()].type = 1;
+          boundary[nbrs[2] + topology->velocity_u.size()].value = 0.0;
           value += viscosity * dy / dx;
         }
 
@@ -196,8 +198,8 @@ hgf::models::stokes::xflow_2d(const parameters& par, const hgf::mesh::voxel& msh
           value += viscosity * dy / (0.5*dx);
         }
 
-        temp_coo.i_index = shift_v + interior_v_nums[ii];
-        temp_coo.j_index = shift_v + interior_v_nums[ii];
+        temp_coo.i_index = shift_v + topology->interior_v_nums[ii];
+        temp_coo.j_index = shift_v + topology->interior_v_nums[ii];
         temp_coo.value = value;
 
         temp_v_arrays[kk].push_back(temp_coo);
@@ -211,20 +213,21 @@ hgf::models::stokes::xflow_2d(const parameters& par, const hgf::mesh::voxel& msh
       array_coo temp_coo_p;
       double dxy[2], uval;
       int i_index;
-      for (int ii = kk*block_size_p; ii < std::min((kk + 1)*block_size_p, (int)pressure.size()); ii++) {
+      for (int ll = kk*block_size_p; ll < std::min((kk + 1)*block_size_p, (int)topology->boundary_pressure.size()); ll++) {
+        int ii = topology->boundary_pressure[ll];
 
-        dxy[0] = distance(velocity_u[ptv[idx2(ii, 0, 4)]].coords[0], velocity_u[ptv[idx2(ii, 0, 4)]].coords[1], \
-          velocity_u[ptv[idx2(ii, 1, 4)]].coords[0], velocity_u[ptv[idx2(ii, 1, 4)]].coords[1]);
-        dxy[1] = distance(velocity_v[ptv[idx2(ii, 2, 4)]].coords[0], velocity_v[ptv[idx2(ii, 2, 4)]].coords[1], \
-          velocity_v[ptv[idx2(ii, 3, 4)]].coords[0], velocity_v[ptv[idx2(ii, 3, 4)]].coords[1]);
+        dxy[0] = distance(topology->velocity_u.coord(topology->ptv[idx2(ii, 0, 4)], 0), topology->velocity_u.coord(topology->ptv[idx2(ii, 0, 4)], 1), \
+          topology->velocity_u.coord(topology->ptv[idx2(ii, 1, 4)], 0), topology->velocity_u.coord(topology->ptv[idx2(ii, 1, 4)], 1));
+        dxy[1] = distance(topology->velocity_v.coord(topology->ptv[idx2(ii, 2, 4)], 0), topology->velocity_v.coord(topology->ptv[idx2(ii, 2, 4)], 1), \
+          topology->velocity_v.coord(topology->ptv[idx2(ii, 3, 4)], 0), topology->velocity_v.coord(topology->ptv[idx2(ii, 3, 4)], 1));
 
         // ux
         // inflow boundary
-        if (interior_u_nums[ptv[idx2(ii, 0, 4)]] == -1) {
-          if (pressure[ii].coords[0] - 0.5*dxy[0] < xmin + eps) {
+        if (topology->interior_u_nums[topology->ptv[idx2(ii, 0, 4)]] == -1) {
+          if (topology->pressure.coord(ii, 0) - 0.5*dxy[0] < xmin + eps) {
             i_index = shift_rows + ii;
             switch (INFLOW) {
-              case HGF_INFLOW_PARABOLIC: uval = inflow_max/pow((ymax-ymin)/2.0,2)*(velocity_u[ptv[idx2(ii, 0, 4)]].coords[1] - ymin) * (ymax - velocity_u[ptv[idx2(ii, 0, 4)]].coords[1]); break;
+              case HGF_INFLOW_PARABOLIC: uval = inflow_max/pow((ymax-ymin)/2.0,2)*(topology->velocity_u.coord(topology->ptv[idx2(ii, 0, 4)], 1) - ymin) * (ymax - topology->velocity_u.coord(topology->ptv[idx2(ii, 0, 4)], 1)); break;
               case HGF_INFLOW_CONSTANT: uval = inflow_max; break;
               default: std::cout << INFLOW << " is not a valid HGF_INFLOW. See include/types.hpp." << std::endl;
             }
@@ -233,12 +236,12 @@ hgf::models::stokes::xflow_2d(const parameters& par, const hgf::mesh::voxel& msh
         }
 
         // outflow boundary
-        if (interior_u_nums[ptv[idx2(ii, 1, 4)]] == -1) {
-          if (pressure[ii].coords[0] + 0.5*dxy[0] > xmax - eps) {
+        if (topology->interior_u_nums[topology->ptv[idx2(ii, 1, 4)]] == -1) {
+          if (topology->pressure.coord(ii, 0) + 0.5*dxy[0] > xmax - eps) {
             // U contribution
             i_index = shift_rows + ii;
             temp_coo_u.i_index = i_index;
-            temp_coo_u.j_index = interior_u_nums[ptv[idx2(ii, 0, 4)]];
+            temp_coo_u.j_index = topology->interior_u_nums[topology->ptv[idx2(ii, 0, 4)]];
             temp_coo_u.value = -dxy[1];
 
             // P contribution
@@ -253,38 +256,40 @@ hgf::models::stokes::xflow_2d(const parameters& par, const hgf::mesh::voxel& msh
       }
     }
   }
-  // paste
+  // add the boundary contributions to the linear system
+  std::vector< array_coo > bc_array;
   for (int ii = 0; ii < NTHREADS; ii++) {
     for (int jj = 0; jj < temp_u_arrays[ii].size(); jj++) {
-      coo_array.push_back(temp_u_arrays[ii][jj]);
+      bc_array.push_back(temp_u_arrays[ii][jj]);
     }
   }
   for (int ii = 0; ii < NTHREADS; ii++) {
     for (int jj = 0; jj < temp_v_arrays[ii].size(); jj++) {
-      coo_array.push_back(temp_v_arrays[ii][jj]);
+      bc_array.push_back(temp_v_arrays[ii][jj]);
     }
   }
   for (int ii = 0; ii < NTHREADS; ii++) {
     for (int jj = 0; jj < temp_p_arrays[ii].size(); jj++) {
-      coo_array.push_back(temp_p_arrays[ii][jj]);
+      bc_array.push_back(temp_p_arrays[ii][jj]);
     }
   }
+  add_bc_entries(bc_array);
 }
 
 void
 hgf::models::stokes::yflow_2d(const parameters& par, const hgf::mesh::voxel& msh, const HGF_INFLOW& INFLOW)
 {
-  boundary.resize(velocity_u.size() + velocity_v.size());
+  boundary.resize(topology->velocity_u.size() + topology->velocity_v.size());
 
-  int shift_v = std::accumulate(interior_u.begin(), interior_u.end(), 0);
-  int nV = std::accumulate(interior_v.begin(), interior_v.end(), 0);
-  int shift_rows = shift_v + nV;
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index nV = topology->interior_v.count();
+  hgf_index shift_rows = shift_v + nV;
 
   // setup threading parameters
   int NTHREADS = omp_get_max_threads();
-  int block_size_u = ((int)velocity_u.size() % NTHREADS) ? (int)((velocity_u.size() / NTHREADS) + 1) : (int)(velocity_u.size() / NTHREADS);
-  int block_size_v = ((int)velocity_v.size() % NTHREADS) ? (int)((velocity_v.size() / NTHREADS) + 1) : (int)(velocity_v.size() / NTHREADS);
-  int block_size_p = ((int)pressure.size() % NTHREADS) ? (int)((pressure.size() / NTHREADS) + 1) : (int)(pressure.size() / NTHREADS);
+  int block_size_u = ((int)topology->boundary_u.size() % NTHREADS) ? (int)((topology->boundary_u.size() / NTHREADS) + 1) : (int)(topology->boundary_u.size() / NTHREADS);
+  int block_size_v = ((int)topology->boundary_v.size() % NTHREADS) ? (int)((topology->boundary_v.size() / NTHREADS) + 1) : (int)(topology->boundary_v.size() / NTHREADS);
+  int block_size_p = ((int)topology->boundary_pressure.size() % NTHREADS) ? (int)((topology->boundary_pressure.size() / NTHREADS) + 1) : (int)(topology->boundary_pressure.size() / NTHREADS);
 
   // define temp coo arrays to store results in parallel region
   std::vector< std::vector< array_coo > > temp_u_arrays, temp_v_arrays, temp_p_arrays;
@@ -316,25 +321,26 @@ hgf::models::stokes::yflow_2d(const parameters& par, const hgf::mesh::voxel& msh
       array_coo temp_p_coo;
       double dx, dy;
 
-      for (int ii = kk*block_size_u; ii < std::min((kk + 1)*block_size_u, (int)interior_u_nums.size()); ii++) {
+      for (int ll = kk*block_size_u; ll < std::min((kk + 1)*block_size_u, (int)topology->boundary_u.size()); ll++) {
+        int ii = topology->boundary_u[ll];
         double value = 0;
         int bc_contributor[4] = { 0, 0, 0, 0 };
         int nnbr = 0;
-        if (!interior_u[ii]) goto uexit;
+        if (!topology->interior_u[ii]) goto uexit;
         for (int jj = 0; jj < 4; jj++) {
-          nbrs[jj] = velocity_u[ii].neighbors[jj];
-          if (nbrs[jj] != -1 && interior_u[nbrs[jj]]) nnbr++;
+          nbrs[jj] = topology->velocity_u.neighbor(ii, jj);
+          if (nbrs[jj] != -1 && topology->interior_u[nbrs[jj]]) nnbr++;
           else bc_contributor[jj] = 1;
         }
         if (nnbr == 4) goto uexit;
 
-        dx = (velocity_u[ii].cell_numbers[0] != -1) ? \
-          (2 * (velocity_u[ii].coords[0] - pressure[velocity_u[ii].cell_numbers[0]].coords[0])) : \
-          (2 * (pressure[velocity_u[ii].cell_numbers[1]].coords[0] - velocity_u[ii].coords[0]));
+        dx = (topology->velocity_u.cell(ii, 0) != -1) ? \
+          (2 * (topology->velocity_u.coord(ii, 0) - topology->pressure.coord(topology->velocity_u.cell(ii, 0), 0))) : \
+          (2 * (topology->pressure.coord(topology->velocity_u.cell(ii, 1), 0) - topology->velocity_u.coord(ii, 0)));
 
-        dy = (velocity_u[ii].cell_numbers[0] != -1) ? \
-          (2 * (velocity_v[ptv[idx2(velocity_u[ii].cell_numbers[0], 3, 4)]].coords[1] - velocity_u[ii].coords[1])) : \
-          (2 * (velocity_v[ptv[idx2(velocity_u[ii].cell_numbers[1], 3, 4)]].coords[1] - velocity_u[ii].coords[1]));
+        dy = (topology->velocity_u.cell(ii, 0) != -1) ? \
+          (2 * (topology->velocity_v.coord(topology->ptv[idx2(topology->velocity_u.cell(ii, 0), 3, 4)], 1) - topology->velocity_u.coord(ii, 1))) : \
+          (2 * (topology->velocity_v.coord(topology->ptv[idx2(topology->velocity_u.cell(ii, 1), 3, 4)], 1) - topology->velocity_u.coord(ii, 1)));
 
         // S neighbor?
         if (bc_contributor[0]) {
@@ -353,11 +359,11 @@ hgf::models::stokes::yflow_2d(const parameters& par, const hgf::mesh::voxel& msh
         // N neighbor?
         if (bc_contributor[2]) {
           // Type Dirichlet?
-          if (velocity_u[ii].coords[1] + 0.5*dy <= ymax - eps) value += viscosity * dx / (0.5*dy);
+          if (topology->velocity_u.coord(ii, 1) + 0.5*dy <= ymax - eps) value += viscosity * dx / (0.5*dy);
           // Type Neumann
           else {
-            temp_p_coo.i_index = interior_u_nums[ii];
-            temp_p_coo.j_index = shift_rows + ((velocity_u[ii].cell_numbers[1] != -1) ? velocity_u[ii].cell_numbers[1] : velocity_u[ii].cell_numbers[0]);
+            temp_p_coo.i_index = topology->interior_u_nums[ii];
+            temp_p_coo.j_index = shift_rows + ((topology->velocity_u.cell(ii, 1) != -1) ? topology->velocity_u.cell(ii, 1) : topology->velocity_u.cell(ii, 0));
             temp_p_coo.value = viscosity * dx;
             temp_u_arrays[kk].push_back(temp_p_coo);
           }
@@ -371,8 +377,8 @@ hgf::models::stokes::yflow_2d(const parameters& par, const hgf::mesh::voxel& msh
           boundary[nbrs[3]].value = 0.0;
         }
 
-        temp_coo.i_index = interior_u_nums[ii];
-        temp_coo.j_index = interior_u_nums[ii];
+        temp_coo.i_index = topology->interior_u_nums[ii];
+        temp_coo.j_index = topology->interior_u_nums[ii];
         temp_coo.value = value;
 
         temp_u_arrays[kk].push_back(temp_coo);
@@ -388,42 +394,43 @@ hgf::models::stokes::yflow_2d(const parameters& par, const hgf::mesh::voxel& msh
       array_coo temp_p_coo;
       double dx, dy;
 
-      for (int ii = kk*block_size_v; ii < std::min((kk + 1)*block_size_v, (int)interior_v_nums.size()); ii++) {
+      for (int ll = kk*block_size_v; ll < std::min((kk + 1)*block_size_v, (int)topology->boundary_v.size()); ll++) {
+        int ii = topology->boundary_v[ll];
         double value = 0;
         int bc_contributor[4] = { 0, 0, 0, 0 };
         int nnbr = 0;
-        if (!interior_v[ii]) goto vexit;
+        if (!topology->interior_v[ii]) goto vexit;
         for (int jj = 0; jj < 4; jj++) {
-          nbrs[jj] = velocity_v[ii].neighbors[jj];
-          if (nbrs[jj] != -1 && interior_v[nbrs[jj]]) nnbr++;
+          nbrs[jj] = topology->velocity_v.neighbor(ii, jj);
+          if (nbrs[jj] != -1 && topology->interior_v[nbrs[jj]]) nnbr++;
           else bc_contributor[jj] = 1;
         }
         if (nnbr == 4) goto vexit;
 
-        dx = (velocity_v[ii].cell_numbers[0] != -1) ? \
-          (2 * (velocity_u[ptv[idx2(velocity_v[ii].cell_numbers[0], 1, 4)]].coords[0] - velocity_v[ii].coords[0])) : \
-          (2 * (velocity_u[ptv[idx2(velocity_v[ii].cell_numbers[1], 1, 4)]].coords[0] - velocity_v[ii].coords[0]));
-        dy = (velocity_v[ii].cell_numbers[0] != -1) ? \
-          (2 * (velocity_v[ii].coords[1] - pressure[velocity_v[ii].cell_numbers[0]].coords[1])) : \
-          (2 * (pressure[velocity_v[ii].cell_numbers[1]].coords[1] - velocity_v[ii].coords[1]));
+        dx = (topology->velocity_v.cell(ii, 0) != -1) ? \
+          (2 * (topology->velocity_u.coord(topology->ptv[idx2(topology->velocity_v.cell(ii, 0), 1, 4)], 0) - topology->velocity_v.coord(ii, 0))) : \
+          (2 * (topology->velocity_u.coord(topology->ptv[idx2(topology->velocity_v.cell(ii, 1), 1, 4)], 0) - topology->velocity_v.coord(ii, 0)));
+        dy = (topology->velocity_v.cell(ii, 0) != -1) ? \
+          (2 * (topology->velocity_v.coord(ii, 1) - topology->pressure.coord(topology->velocity_v.cell(ii, 0), 1))) : \
+          (2 * (topology->pressure.coord(topology->velocity_v.cell(ii, 1), 1) - topology->velocity_v.coord(ii, 1)));
 
 
         // S neighbor?
         if (bc_contributor[0]) {
           // Type Dirichlet
-          boundary[nbrs[0] + velocity_u.size()].type = 1;
-          boundary[nbrs[0] + velocity_u.size()].value = 0.0;
+          boundary[nbrs[0] + topology->velocity_u.size()].type = 1;
+          boundary[nbrs[0] + topology->velocity_u.size()].value = 0.0;
           value += viscosity * dx / dy;
           // is this an inflow boundary?
-          if (velocity_v[ii].coords[1] - dy < ymin + eps) {
+          if (topology->velocity_v.coord(ii, 1) - dy < ymin + eps) {
             double bvalue; 
             switch (INFLOW) {
-              case HGF_INFLOW_PARABOLIC: bvalue = inflow_max/pow((xmax-xmin)/2.0,2)*(velocity_v[ii].coords[0] - xmin) * (xmax - velocity_v[ii].coords[0]); break;
+              case HGF_INFLOW_PARABOLIC: bvalue = inflow_max/pow((xmax-xmin)/2.0,2)*(topology->velocity_v.coord(ii, 0) - xmin) * (xmax - topology->velocity_v.coord(ii, 0)); break;
               case HGF_INFLOW_CONSTANT: bvalue = inflow_max; break;
               default: std::cout << INFLOW << " is not a valid HGF_INFLOW. See include/types.hpp." << std::endl;
             }
-            rhs[interior_v_nums[ii] + shift_v] += bvalue * viscosity * dx / dy;
-            boundary[nbrs[0] + velocity_u.size()].value += bvalue;
+            rhs[topology->interior_v_nums[ii] + shift_v] += bvalue * viscosity * dx / dy;
+            boundary[nbrs[0] + topology->velocity_u.size()].value += bvalue;
           }
         }
 
@@ -436,18 +443,18 @@ hgf::models::stokes::yflow_2d(const parameters& par, const hgf::mesh::voxel& msh
         // N neighbor?
         if (bc_contributor[2]) {
           // Type Dirichlet?
-          if (velocity_v[ii].coords[1] + dy <= ymin - eps) {
-            boundary[nbrs[2] + velocity_u.size()].type = 1;
-            boundary[nbrs[2] + velocity_u.size()].value = 0.0;
+          if (topology->velocity_v.coord(ii, 1) + dy <= ymin - eps) {
+            boundary[nbrs[2] + topology->velocity_u.size()].type = 1;
+            boundary[nbrs[2] + topology->velocity_u.size()].value = 0.0;
             value += viscosity * dx / dy;
           }
           else {// nothing to do... outflow is 0 neumann 
-            temp_p_coo.i_index = shift_v + interior_v_nums[ii];
-            temp_p_coo.j_index = shift_rows + ((velocity_v[ii].cell_numbers[1] != -1) ? velocity_v[ii].cell_numbers[1] : velocity_v[ii].cell_numbers[0]);
+            temp_p_coo.i_index = shift_v + topology->interior_v_nums[ii];
+            temp_p_coo.j_index = shift_rows + ((topology->velocity_v.cell(ii, 1) != -1) ? topology->velocity_v.cell(ii, 1) : topology->velocity_v.cell(ii, 0));
             temp_p_coo.value = viscosity * dx;
             temp_v_arrays[kk].push_back(temp_p_coo);
-            boundary[nbrs[2] + velocity_u.size()].type = 2;
-            boundary[nbrs[2] + velocity_u.size()].value = 0.0;
+            boundary[nbrs[2] + topology->velocity_u.size()].type = 2;
+            boundary[nbrs[2] + topology->velocity_u.size()].value = 0.0;
           }
         }
 
@@ -457,8 +464,8 @@ hgf::models::stokes::yflow_2d(const parameters& par, const hgf::mesh::voxel& msh
           value += viscosity * dy / (0.5*dx);
         }
 
-        temp_coo.i_index = shift_v + interior_v_nums[ii];
-        temp_coo.j_index = shift_v + interior_v_nums[ii];
+        temp_coo.i_index = shift_v + topology->interior_v_nums[ii];
+        temp_coo.j_index = shift_v + topology->interior_v_nums[ii];
         temp_coo.value = value;
 
         temp_v_arrays[kk].push_back(temp_coo);
@@ -472,19 +479,20 @@ hgf::models::stokes::yflow_2d(const parameters& par, const hgf::mesh::voxel& msh
       array_coo temp_coo_p;
       double dxy[2], vval;
       int i_index;
-      for (int ii = kk*block_size_p; ii < std::min((kk + 1)*block_size_p, (int)pressure.size()); ii++) {
+      for (int ll = kk*block_size_p; ll < std::min((kk + 1)*block_size_p, (int)topology->boundary_pressure.size()); ll++) {
+        int ii = topology->boundary_pressure[ll];
 
-        dxy[0] = distance(velocity_u[ptv[idx2(ii, 0, 4)]].coords[0], velocity_u[ptv[idx2(ii, 0, 4)]].coords[1], \
-          velocity_u[ptv[idx2(ii, 1, 4)]].coords[0], velocity_u[ptv[idx2(ii, 1, 4)]].coords[1]);
-        dxy[1] = distance(velocity_v[ptv[idx2(ii, 2, 4)]].coords[0], velocity_v[ptv[idx2(ii, 2, 4)]].coords[1], \
-          velocity_v[ptv[idx2(ii, 3, 4)]].coords[0], velocity_v[ptv[idx2(ii, 3, 4)]].coords[1]);
+        dxy[0] = distance(topology->velocity_u.coord(topology->ptv[idx2(ii, 0, 4)], 0), topology->velocity_u.coord(topology->ptv[idx2(ii, 0, 4)], 1), \
+          topology->velocity_u.coord(topology->ptv[idx2(ii, 1, 4)], 0), topology->velocity_u.coord(topology->ptv[idx2(ii, 1, 4)], 1));
+        dxy[1] = distance(topology->velocity_v.coord(topology->ptv[idx2(ii, 2, 4)], 0), topology->velocity_v.coord(topology->ptv[idx2(ii, 2, 4)], 1), \
+          topology->velocity_v.coord(topology->ptv[idx2(ii, 3, 4)], 0), topology->velocity_v.coord(topology->ptv[idx2(ii, 3, 4)], 1));
 
         // vy
-        if (interior_v_nums[ptv[idx2(ii, 2, 4)]] == -1) {
-          if (pressure[ii].coords[1] - 0.5*dxy[1] < ymin + eps) {
+        if (topology->interior_v_nums[topology->ptv[idx2(ii, 2, 4)]] == -1) {
+          if (topology->pressure.coord(ii, 1) - 0.5*dxy[1] < ymin + eps) {
             i_index = shift_rows + ii;
             switch (INFLOW) {
-              case HGF_INFLOW_PARABOLIC: vval = inflow_max/pow((xmax-xmin)/2.0,2)*(velocity_v[ptv[idx2(ii, 2, 4)]].coords[0] - xmin) * (xmax - velocity_v[ptv[idx2(ii, 2, 4)]].coords[0]); break;
+              case HGF_INFLOW_PARABOLIC: vval = inflow_max/pow((xmax-xmin)/2.0,2)*(topology->velocity_v.coord(topology->ptv[idx2(ii, 2, 4)], 0) - xmin) * (xmax - topology->velocity_v.coord(topology->ptv[idx2(ii, 2, 4)], 0)); break;
               case HGF_INFLOW_CONSTANT: vval = inflow_max; break;
               default: std::cout << INFLOW << " is not a valid HGF_INFLOW. See include/types.hpp." << std::endl;
             }
@@ -492,11 +500,11 @@ hgf::models::stokes::yflow_2d(const parameters& par, const hgf::mesh::voxel& msh
           }
         }
 
-        if (interior_v_nums[ptv[idx2(ii, 3, 4)]] == -1) {
-          if (pressure[ii].coords[1] + 0.5*dxy[1] > ymax - eps) {
+        if (topology->interior_v_nums[topology->ptv[idx2(ii, 3, 4)]] == -1) {
+          if (topology->pressure.coord(ii, 1) + 0.5*dxy[1] > ymax - eps) {
             i_index = shift_rows + ii;
             temp_coo_v.i_index = i_index;
-            temp_coo_v.j_index = shift_v + interior_v_nums[ptv[idx2(ii, 2, 4)]];
+            temp_coo_v.j_index = shift_v + topology->interior_v_nums[topology->ptv[idx2(ii, 2, 4)]];
             temp_coo_v.value = -dxy[0];
 
             // P contribution
@@ -512,20 +520,22 @@ hgf::models::stokes::yflow_2d(const parameters& par, const hgf::mesh::voxel& msh
     }
 
   } // omp parallel
-  // paste
+  // add the boundary contributions to the linear system
+  std::vector< array_coo > bc_array;
   for (int ii = 0; ii < NTHREADS; ii++) {
     for (int jj = 0; jj < temp_u_arrays[ii].size(); jj++) {
-      coo_array.push_back(temp_u_arrays[ii][jj]);
+      bc_array.push_back(temp_u_arrays[ii][jj]);
     }
   }
   for (int ii = 0; ii < NTHREADS; ii++) {
     for (int jj = 0; jj < temp_v_arrays[ii].size(); jj++) {
-      coo_array.push_back(temp_v_arrays[ii][jj]);
+      bc_array.push_back(temp_v_arrays[ii][jj]);
     }
   }
   for (int ii = 0; ii < NTHREADS; ii++) {
     for (int jj = 0; jj < temp_p_arrays[ii].size(); jj++) {
-      coo_array.push_back(temp_p_arrays[ii][jj]);
+      bc_array.push_back(temp_p_arrays[ii][jj]);
     }
   }
+  add_bc_entries(bc_array);
 }
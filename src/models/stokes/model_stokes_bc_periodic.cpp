@@ -0,0 +1,201 @@
+/* stokes periodic bc source */
+
+// hgf includes
+#include "model_stokes.hpp"
+
+// lattice axis crossed by each neighbor slot (y-, x+, y+, x-, z-, z+)
+static const int slot_axis[6] = { 1, 0, 1, 0, 2, 2 };
+
+// lattice index of a degree of freedom along axis k, counting faces along the axis of face dofs
+static inline int
+lattice_index(const dof_store& dofs, int dof, int k)
+{
+  int32_t p = dofs.position[dof];
+  if (k == 0) return p % dofs.lattice[0];
+  if (k == 1) return (p / dofs.lattice[0]) % dofs.lattice[1];
+  return p / (dofs.lattice[0] * dofs.lattice[1]);
+}
+
+// area of a lattice face normal to axis aa
+static inline double
+face_area(const dof_store& dofs, int aa)
+{
+  const double* h = dofs.spacing;
+  return (dofs.dimension == 2) ? h[1 - aa] : h[(aa + 1) % 3] * h[(aa + 2) % 3];
+}
+
+// wall terms of one velocity degree of freedom of a periodic topology, where the only boundaries left are solid walls.
+// Faces normal to the component hit a zero wall velocity one cell away, other faces are no-slip walls half a cell away.
+static void
+periodic_bc_velocity(const hgf::models::stokes_topology& topo, int component, int ii, double viscosity, \
+  const hgf_index shift[4], hgf::models::stokes_bc& out)
+{
+  const dof_store* dofs[3] = { &topo.velocity_u, &topo.velocity_v, &topo.velocity_w };
+  const bit_flags* interior[3] = { &topo.interior_u, &topo.interior_v, &topo.interior_w };
+  const std::vector< int >* nums[3] = { &topo.interior_u_nums, &topo.interior_v_nums, &topo.interior_w_nums };
+  const dof_store& dof = *dofs[component];
+  const double* h = dof.spacing;
+  hgf_index row = shift[component] + (*nums[component])[ii];
+  double value = 0;
+  array_coo temp_coo;
+
+  for (int jj = 0; jj < dof.n_neighbors; jj++) {
+    int nbr = dof.neighbor(ii, jj);
+    if (nbr != -1 && (*interior[component])[nbr]) continue;
+    int aa = slot_axis[jj];
+    if (aa == component) value += viscosity * face_area(dof, aa) / h[aa];
+    else value += viscosity * face_area(dof, aa) / (0.5 * h[aa]);
+  }
+
+  temp_coo.i_index = row;
+  temp_coo.j_index = row;
+  temp_coo.value = value;
+  out.delta.push_back(temp_coo);
+}
+
+// computes the boundary conditions of a periodic topology for flow in the positive direction along one axis into bc,
+// without changing the linear system: no-slip solid walls, the drive, and the pressure level of each fluid region.
+// The drive is a mean pressure gradient G = par.periodic_drive, entering the momentum equations of the flow component
+// either as a body force on every degree of freedom, or as the pressure jump G * L across the periodic faces only.
+void
+hgf::models::stokes::periodic_bc(const parameters& par, int direction, const HGF_PERIODIC& DRIVE, stokes_bc& bc) const
+{
+  const dof_store* dofs[3] = { &topology->velocity_u, &topology->velocity_v, &topology->velocity_w };
+  const bit_flags* interior[3] = { &topology->interior_u, &topology->interior_v, &topology->interior_w };
+  const std::vector< int >* nums[3] = { &topology->interior_u_nums, &topology->interior_v_nums, &topology->interior_w_nums };
+  const std::vector< int >* lists[3] = { &topology->boundary_u, &topology->boundary_v, &topology->boundary_w };
+  int n_comp = topology->velocity_u.dimension;
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index shift_w = shift_v + topology->interior_v.count();
+  hgf_index shift[4] = { 0, shift_v, shift_w, shift_w + ((n_comp == 3) ? topology->interior_w.count() : 0) };
+  const dof_store& flow = *dofs[direction];
+  double drive = par.periodic_drive;
+  double volume = 1.0;
+  for (int kk = 0; kk < n_comp; kk++) volume *= flow.spacing[kk];
+  int offset[3] = { 0, (int)topology->velocity_u.size(), (int)(topology->velocity_u.size() + topology->velocity_v.size()) };
+  boundary_nodes bnode = { 1, 0.0 };
+  int NTHREADS = omp_get_max_threads();
+
+  bc.direction = direction;
+  bc.rhs.assign(rhs.size(), 0.0);
+  std::vector< stokes_bc > temp_bc(NTHREADS);
+#pragma omp parallel
+  {
+    int tid = omp_get_thread_num();
+    for (int cc = 0; cc < n_comp; cc++) {
+#pragma omp for schedule(static) nowait
+      for (int kk = 0; kk < (int)lists[cc]->size(); kk++) {
+        periodic_bc_velocity(*topology, cc, (*lists[cc])[kk], viscosity, shift, temp_bc[tid]);
+      }
+    }
+
+    // with no domain boundary left, every velocity that is not interior is on a solid wall
+    for (int cc = 0; cc < n_comp; cc++) {
+#pragma omp for schedule(static) nowait
+      for (int ii = 0; ii < (int)dofs[cc]->size(); ii++) {
+        if (!(*interior[cc])[ii]) {
+          temp_bc[tid].boundary_index.push_back(offset[cc] + ii);
+          temp_bc[tid].boundary_value.push_back(bnode);
+        }
+      }
+    }
+
+    // the drive acts on the flow component only
+    if (DRIVE == HGF_PERIODIC_BODY_FORCE) {
+#pragma omp for schedule(static)
+      for (int ii = 0; ii < (int)flow.size(); ii++) {
+        if ((*interior[direction])[ii]) bc.rhs[shift[direction] + (*nums[direction])[ii]] += drive * volume;
+      }
+    }
+    else {
+      double jump = drive * topology->period[direction] * face_area(flow, direction);
+      int wrap = flow.lattice[direction] - 1;
+#pragma omp for schedule(static)
+      for (int ii = 0; ii < (int)flow.size(); ii++) {
+        if ((*interior[direction])[ii] && lattice_index(flow, ii, direction) == wrap) {
+          bc.rhs[shift[direction] + (*nums[direction])[ii]] += jump;
+        }
+      }
+    }
+  }
+
+  // gather the per thread contributions
+  bc.delta.clear();
+  bc.boundary_index.clear();
+  bc.boundary_value.clear();
+  for (int tt = 0; tt < NTHREADS; tt++) {
+    bc.delta.insert(bc.delta.end(), temp_bc[tt].delta.begin(), temp_bc[tt].delta.end());
+    bc.boundary_index.insert(bc.boundary_index.end(), temp_bc[tt].boundary_index.begin(), temp_bc[tt].boundary_index.end());
+    bc.boundary_value.insert(bc.boundary_value.end(), temp_bc[tt].boundary_value.begin(), temp_bc[tt].boundary_value.end());
+  }
+
+  // periodic faces leave the pressure level of each region free, fix it to zero at one cell of the region
+  array_coo temp_coo;
+  for (int ii = 0; ii < (int)topology->pressure_reference.size(); ii++) {
+    temp_coo.i_index = shift[3] + topology->pressure_reference[ii];
+    temp_coo.j_index = shift[3] + topology->pressure_reference[ii];
+    temp_coo.value = -volume;
+    bc.delta.push_back(temp_coo);
+  }
+}
+
+/** \brief hgf::models::stokes::setup_periodic_bc sets up the boundary conditions for periodic flow in the positive direction along one axis.
+ *
+ * Requires a model built with par.periodic set, so that the degrees of freedom wrap across every face of the domain.
+ * Solid walls are no-slip, the flow is driven by the mean pressure gradient par.periodic_drive, and the pressure is
+ * fixed to zero at one cell of each connected fluid region. With HGF_PERIODIC_BODY_FORCE the pressure in the solution
+ * is the periodic part of the pressure, with HGF_PERIODIC_PRESSURE_JUMP it is the pressure itself, dropping by the
+ * drive times the domain length across the periodic faces. Like the inflow terms, the drive is rescaled by hgf::models::stokes::reassemble.
+ * Contributions to the linear system csr_array and the rhs vector are set by this function.
+ * @param[in] par - parameters struct containing problem information.
+ * @param[in] msh - not used, the periodic conditions only need the model topology; kept to match setup_flow_bc.
+ * @param[in] direction - flow direction, 0, 1 or 2 for x, y or z.
+ * @param[in] DRIVE - body force or pressure jump drive.
+ */
+void
+hgf::models::stokes::setup_periodic_bc(const parameters& par, const hgf::mesh::voxel&, int direction, const HGF_PERIODIC& DRIVE)
+{
+
+  stokes_bc bc;
+  if (direction < 0 || direction >= par.dimension) {
+    std::cout << "\nInvalid flow direction " << direction << " for a " << par.dimension << "d Stokes problem. Exiting.\n";
+    exit(0);
+  }
+  if (topology->period[direction] == 0) {
+    std::cout << "\nPeriodic boundary conditions require a Stokes model built with par.periodic set. Exiting.\n";
+    exit(0);
+  }
+  periodic_bc(par, direction, DRIVE, bc);
+  merge_bc(bc);
+
+}
+
+/** \brief hgf::models::stokes::setup_periodic_bc sets up the boundary conditions for periodic flow in the positive direction along one axis and stores them in bc.
+ *
+ * Any boundary conditions already in the linear system are removed first, as in hgf::models::stokes::setup_flow_bc,
+ * and bc may be made active again later with hgf::models::stokes::select_bc.
+ * @param[in] par - parameters struct containing problem information.
+ * @param[in] msh - mesh object containing a quadrilateral or hexagonal representation of geometry from problem folder addressed in parameters& par.
+ * @param[in] direction - flow direction, 0, 1 or 2 for x, y or z.
+ * @param[in] DRIVE - body force or pressure jump drive.
+ * @param[out] bc - boundary condition delta, rhs and boundary values for this direction.
+ */
+void
+hgf::models::stokes::setup_periodic_bc(const parameters& par, const hgf::mesh::voxel& msh, int direction, const HGF_PERIODIC& DRIVE, stokes_bc& bc)
+{
+
+  clear_bc();
+  setup_periodic_bc(par, msh, direction, DRIVE);
+  bc.direction = direction;
+  bc.delta = active_bc;
+  bc.rhs = rhs;
+  bc.boundary_index.clear();
+  bc.boundary_value.clear();
+  for (int ii = 0; ii < (int)boundary.size(); ii++) {
+    if (boundary[ii].type != 0 || boundary[ii].value != 0) {
+      bc.boundary_index.push_back(ii);
+      bc.boundary_value.push_back(boundary[ii]);
+    }
+  }
+
+}
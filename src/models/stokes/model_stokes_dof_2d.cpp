@@ -4,221 +4,252 @@
 #include "model_stokes.hpp"
 
 // 1d->2d index
-#define idx2(i, j, ldi) ((i * ldi) + j)
+#define idx2(i, j, ldi) (((hgf_index)i * ldi) + j)
+
+/* Neighbor of a cell across one of its edges, from the periodic neighbor table when the topology is periodic. */
+static inline int
+cell_neighbor(const hgf::mesh::voxel& msh, const std::vector< int >& periodic_table, int cell, int edge)
+{
+  return periodic_table.size() ? periodic_table[idx2(cell, edge, 4)] : msh.els[cell].edg[edge].neighbor;
+}
+
+/* Numbers the entries of an interior flag vector with per-thread counts and offsets. */
+static void
+number_interior(const bit_flags& interior, std::vector< int >& interior_nums)
+{
+  int size = (int)interior.size();
+  interior_nums.assign(size, -1);
+  std::vector< int > thread_offset(omp_get_max_threads() + 1, 0);
+#pragma omp parallel
+  {
+    int tid = omp_get_thread_num();
+    int nthreads = omp_get_num_threads();
+    int chunk = (size + nthreads - 1) / nthreads;
+    int first = std::min(size, tid * chunk);
+    int last = std::min(size, first + chunk);
+    int count = 0;
+    for (int ii = first; ii < last; ii++) count += (interior[ii] != 0);
+    thread_offset[tid + 1] = count;
+#pragma omp barrier
+#pragma omp single
+    {
+      for (int tt = 0; tt < nthreads; tt++) thread_offset[tt + 1] += thread_offset[tt];
+    }
+    int num = thread_offset[tid];
+    for (int ii = first; ii < last; ii++) {
+      if (interior[ii]) interior_nums[ii] = num++;
+    }
+  }
+}
 
 void
-hgf::models::stokes::build_degrees_of_freedom_2d(const parameters& par, const hgf::mesh::voxel& msh)
+hgf::models::stokes::build_degrees_of_freedom_2d(const parameters& par, const hgf::mesh::voxel& msh, stokes_topology& topo)
 {
   // this functions sets degrees of freedom for the velocity components and pressure in 2d
-  velocity_u.reserve((par.nx + 1)*par.ny);
-  velocity_v.reserve((par.ny + 1)*par.nx);
-  pressure.reserve(msh.els.size());
+  // u dofs follow the cell order, v dofs are ordered by x column so that the 2nd block of the linear system is a standard Poisson array.
+  // each thread counts the dofs of a block of cells (u) or columns (v), offsets from those counts give every dof its final index.
+  int n_cells = (int)msh.els.size();
+  std::vector< int > column_cells(n_cells);
+  std::vector< int > cell_voxel(n_cells);
+  std::vector< int > column_start(par.nx + 1, 0);
+  std::vector< int > lower_u(n_cells), upper_u(n_cells), lower_v(n_cells), upper_v(n_cells);
+  std::vector< int > thread_offset_u(omp_get_max_threads() + 1, 0);
+  std::vector< int > thread_offset_v(omp_get_max_threads() + 1, 0);
+  std::vector< int > periodic_table;
+
+  // periodic topologies wrap the cell neighbors across the domain edges
+  topo.pressure_reference.clear();
+  for (int kk = 0; kk < 3; kk++) topo.period[kk] = 0;
+  if (par.periodic) {
+    hgf::mesh::periodic_neighbors(par, periodic_table, topo.pressure_reference);
+    topo.period[0] = par.length;
+    topo.period[1] = par.width;
+  }
+
+  // cells of each x column in y order, cells are the non-solid voxels in voxel order
+  for (int yi = 0; yi < par.ny; yi++) {
+    for (int xi = 0; xi < par.nx; xi++) {
+      if (par.voxel_geometry[idx2(yi, xi, par.nx)] != 1) column_start[xi + 1]++;
+    }
+  }
+  for (int xi = 0; xi < par.nx; xi++) column_start[xi + 1] += column_start[xi];
+  {
+    std::vector< int > fill(column_start.begin(), column_start.end() - 1);
+    int cell = 0;
+    for (int yi = 0; yi < par.ny; yi++) {
+      for (int xi = 0; xi < par.nx; xi++) {
+        if (par.voxel_geometry[idx2(yi, xi, par.nx)] != 1) {
+          cell_voxel[cell] = idx2(yi, xi, par.nx);
+          column_cells[fill[xi]++] = cell++;
+        }
+      }
+    }
+  }
+
+  topo.velocity_u.setup(par, 0);
+  topo.velocity_v.setup(par, 1);
+  topo.pressure.setup(par, -1);
 
 #pragma omp parallel
   {
-#pragma omp sections
+    int tid = omp_get_thread_num();
+    int nthreads = omp_get_num_threads();
+    int chunk = (n_cells + nthreads - 1) / nthreads;
+    int first_cell = std::min(n_cells, tid * chunk);
+    int last_cell = std::min(n_cells, first_cell + chunk);
+    int col_chunk = (par.nx + nthreads - 1) / nthreads;
+    int first_col = std::min(par.nx, tid * col_chunk);
+    int last_col = std::min(par.nx, first_col + col_chunk);
+
+    // per-thread counts
+    int count_u = 0;
+    for (int cell = first_cell; cell < last_cell; cell++) {
+      count_u += (cell_neighbor(msh, periodic_table, cell, 3) == -1) ? 2 : 1;
+    }
+    int count_v = 0;
+    for (int cc = column_start[first_col]; cc < column_start[last_col]; cc++) {
+      count_v += (cell_neighbor(msh, periodic_table, column_cells[cc], 0) == -1) ? 2 : 1;
+    }
+    thread_offset_u[tid + 1] = count_u;
+    thread_offset_v[tid + 1] = count_v;
+#pragma omp barrier
+#pragma omp single
     {
-#pragma omp section
-      { // u section
-        degree_of_freedom dof_temp;
-        for (int cell = 0; cell < msh.els.size(); cell++) {
-          // if there's no neighbor cell to the left, then we have 2 new dofs for u
-          if (msh.els[cell].edg[3].neighbor == -1) {
-            //--- dof on edge 3 ---//
-            // coordinates
-            dof_temp.coords[0] = 0.5 * \
-              (msh.els[cell].vtx[0].coords[0] + msh.els[cell].vtx[3].coords[0]);
-            dof_temp.coords[1] = 0.5 * \
-              (msh.els[cell].vtx[0].coords[1] + msh.els[cell].vtx[3].coords[1]);
-            dof_temp.coords[2] = 0;
-            // doftype
-            dof_temp.doftype = 1;
-            // cell_numbers
-            dof_temp.cell_numbers[1] = cell;
-            dof_temp.cell_numbers[0] = -1;
-            // push_back
-            velocity_u.push_back(dof_temp);
-          }
-          //--- dof on edge 1 ---//
-          // coordinates
-          dof_temp.coords[0] = 0.5 * \
-            (msh.els[cell].vtx[1].coords[0] + msh.els[cell].vtx[2].coords[0]);
-          dof_temp.coords[1] = 0.5 * \
-            (msh.els[cell].vtx[1].coords[1] + msh.els[cell].vtx[2].coords[1]);
-          dof_temp.coords[2] = 0;
-          // doftype
-          dof_temp.doftype = 1;
-          // cell_numbers
-          dof_temp.cell_numbers[0] = cell;
-          dof_temp.cell_numbers[1] = msh.els[cell].edg[1].neighbor;
-          // push_back
-          velocity_u.push_back(dof_temp);
-        }
+      for (int tt = 0; tt < nthreads; tt++) {
+        thread_offset_u[tt + 1] += thread_offset_u[tt];
+        thread_offset_v[tt + 1] += thread_offset_v[tt];
       }
-#pragma omp section
-      { // v section
-        degree_of_freedom dof_temp;
-        for (int cell = 0; cell < msh.els.size(); cell++) {
-          // if there's no neighbor cell below, then we have 2 new dofs for v
-          if (msh.els[cell].edg[0].neighbor == -1) {
-            //--- dof on edge 0 ---//
-            // coordinates
-            dof_temp.coords[0] = 0.5 * \
-              (msh.els[cell].vtx[0].coords[0] + msh.els[cell].vtx[1].coords[0]);
-            dof_temp.coords[1] = 0.5 * \
-              (msh.els[cell].vtx[0].coords[1] + msh.els[cell].vtx[1].coords[1]);
-            dof_temp.coords[2] = 0;
-            // doftype
-            dof_temp.doftype = 1;
-            // cell_numbers
-            dof_temp.cell_numbers[1] = cell;
-            dof_temp.cell_numbers[0] = -1;
-            // push_back
-            velocity_v.push_back(dof_temp);
-          }
-          //--- dof on edge 2 ---//
-          // coordinates
-          dof_temp.coords[0] = 0.5 * \
-            (msh.els[cell].vtx[3].coords[0] + msh.els[cell].vtx[2].coords[0]);
-          dof_temp.coords[1] = 0.5 * \
-            (msh.els[cell].vtx[3].coords[1] + msh.els[cell].vtx[2].coords[1]);
-          dof_temp.coords[2] = 0;
-          // doftype
-          dof_temp.doftype = 1;
-          // cell_numbers
-          dof_temp.cell_numbers[0] = cell;
-          dof_temp.cell_numbers[1] = msh.els[cell].edg[2].neighbor;
-          // push_back
-          velocity_v.push_back(dof_temp);
-        }
+      topo.velocity_u.resize(thread_offset_u[nthreads]);
+      topo.velocity_v.resize(thread_offset_v[nthreads]);
+      topo.pressure.resize(n_cells);
+      topo.ptv.resize(topo.pressure.size() * 4, -1);
+    }
+
+    // per-thread numbering from the offsets
+    int dof = thread_offset_u[tid];
+    for (int cell = first_cell; cell < last_cell; cell++) {
+      lower_u[cell] = (cell_neighbor(msh, periodic_table, cell, 3) == -1) ? dof++ : -1;
+      upper_u[cell] = dof++;
+    }
+    dof = thread_offset_v[tid];
+    for (int cc = column_start[first_col]; cc < column_start[last_col]; cc++) {
+      int cell = column_cells[cc];
+      lower_v[cell] = (cell_neighbor(msh, periodic_table, cell, 0) == -1) ? dof++ : -1;
+      upper_v[cell] = dof++;
+    }
+#pragma omp barrier
+
+#pragma omp for schedule(static)
+    for (int cell = 0; cell < n_cells; cell++) {
+      int xi = cell_voxel[cell] % par.nx;
+      int yi = cell_voxel[cell] / par.nx;
+
+      // u section
+      if (lower_u[cell] != -1) {
+        // if there's no neighbor cell to the left, then we have 2 new dofs for u
+        //--- dof on edge 3 ---//
+        topo.velocity_u.set_position(lower_u[cell], 0, yi, xi);
+        topo.velocity_u.cell(lower_u[cell], 1) = cell;
       }
-#pragma omp section
-      { // pressure section
-        degree_of_freedom dof_temp;
-        for (int cell = 0; cell < msh.els.size(); cell++) {
-          // coordinates
-          dof_temp.coords[0] = 0.25 * \
-            (msh.els[cell].vtx[0].coords[0] + msh.els[cell].vtx[1].coords[0] + \
-              msh.els[cell].vtx[2].coords[0] + msh.els[cell].vtx[3].coords[0]);
-          dof_temp.coords[1] = 0.25 * \
-            (msh.els[cell].vtx[0].coords[1] + msh.els[cell].vtx[1].coords[1] + \
-              msh.els[cell].vtx[2].coords[1] + msh.els[cell].vtx[3].coords[1]);
-          // doftype
-          dof_temp.doftype = 0;
-          // cell numbers
-          dof_temp.cell_numbers[0] = cell;
-          dof_temp.cell_numbers[1] = -1;
-          // neighbors
-          for (int nbr = 0; nbr < 4; nbr++) {
-            dof_temp.neighbors[nbr] = msh.els[cell].edg[nbr].neighbor;
-          }
-          // push_back
-          pressure.push_back(dof_temp);
-        }
+      //--- dof on edge 1 ---//
+      topo.velocity_u.set_position(upper_u[cell], 0, yi, xi + 1);
+      topo.velocity_u.cell(upper_u[cell], 0) = cell;
+      topo.velocity_u.cell(upper_u[cell], 1) = cell_neighbor(msh, periodic_table, cell, 1);
+
+      // v section
+      if (lower_v[cell] != -1) {
+        // if there's no neighbor cell below, then we have 2 new dofs for v
+        //--- dof on edge 0 ---//
+        topo.velocity_v.set_position(lower_v[cell], 0, yi, xi);
+        topo.velocity_v.cell(lower_v[cell], 1) = cell;
       }
+      //--- dof on edge 2 ---//
+      topo.velocity_v.set_position(upper_v[cell], 0, yi + 1, xi);
+      topo.velocity_v.cell(upper_v[cell], 0) = cell;
+      topo.velocity_v.cell(upper_v[cell], 1) = cell_neighbor(msh, periodic_table, cell, 2);
+
+      // pressure section
+      topo.pressure.set_position(cell, 0, yi, xi);
+      topo.pressure.cell(cell, 0) = cell;
+      for (int nbr = 0; nbr < 4; nbr++) {
+        topo.pressure.neighbor(cell, nbr) = cell_neighbor(msh, periodic_table, cell, nbr);
+      }
+
+      // pressure to velocity relationships, a lower edge dof owned by the neighbor is its upper edge dof
+      topo.ptv[idx2(cell, 0, 4)] = (lower_u[cell] != -1) ? lower_u[cell] : upper_u[cell_neighbor(msh, periodic_table, cell, 3)];
+      topo.ptv[idx2(cell, 1, 4)] = upper_u[cell];
+      topo.ptv[idx2(cell, 2, 4)] = (lower_v[cell] != -1) ? lower_v[cell] : upper_v[cell_neighbor(msh, periodic_table, cell, 0)];
+      topo.ptv[idx2(cell, 3, 4)] = upper_v[cell];
     }
   }
 
-  // sort the v component so that 2nd block of linear system is a standard Poisson array
-  std::sort(velocity_v.begin(), velocity_v.end(), byXbyY());
-
 #ifdef _DOF_SORT_DEBUG
   std::cout << "\nChecking velocity sort U:\n";
-  for (int ii = 0; ii < velocity_u.size(); ii++) {
-    std::cout << velocity_u[ii].coords[0] << "\t" << velocity_u[ii].coords[1] << "\n";
+  for (int ii = 0; ii < topo.velocity_u.size(); ii++) {
+    std::cout << topo.velocity_u.coord(ii, 0) << "\t" << topo.velocity_u.coord(ii, 1) << "\n";
   }
   std::cout << "\nChecking velocity sort V:\n";
-  for (int ii = 0; ii < velocity_v.size(); ii++) {
-    std::cout << velocity_v[ii].coords[0] << "\t" << velocity_v[ii].coords[1] << "\n";
+  for (int ii = 0; ii < topo.velocity_v.size(); ii++) {
+    std::cout << topo.velocity_v.coord(ii, 0) << "\t" << topo.velocity_v.coord(ii, 1) << "\n";
   }
 #endif
 
-  // pressure to velocity relationships
-  ptv.resize(pressure.size() * 4, -1);
-#pragma omp parallel
-  {
-#pragma omp for schedule(static,1) nowait
-    for (int ii = 0; ii < velocity_u.size(); ii++) {
-      // pressure cells should know who u cells are
-      if (velocity_u[ii].cell_numbers[0] != -1) ptv[idx2(velocity_u[ii].cell_numbers[0], 1, 4)] = ii;
-      if (velocity_u[ii].cell_numbers[1] != -1) ptv[idx2(velocity_u[ii].cell_numbers[1], 0, 4)] = ii;
-    }
-#pragma omp for schedule(static,1) nowait
-    for (int ii = 0; ii < velocity_v.size(); ii++) {
-      // pressure cells should know who v cells are
-      if (velocity_v[ii].cell_numbers[0] != -1) ptv[idx2(velocity_v[ii].cell_numbers[0], 3, 4)] = ii;
-      if (velocity_v[ii].cell_numbers[1] != -1) ptv[idx2(velocity_v[ii].cell_numbers[1], 2, 4)] = ii;
-    }
-  }
-
   // set neighbors for velocity components
-  dof_neighbors_2d(par, msh);
+  dof_neighbors_2d(par, msh, topo);
 
-  interior_u.resize(velocity_u.size());
-  interior_v.resize(velocity_v.size());
+  topo.interior_u.resize(topo.velocity_u.size());
+  topo.interior_v.resize(topo.velocity_v.size());
 
 #pragma omp parallel
   {
     // determine boundary and interior cells
-#pragma omp for schedule(static,1) nowait
-    for (int ii = 0; ii < velocity_u.size(); ii++) {
-      if (velocity_u[ii].neighbors[1] != -1 && velocity_u[ii].neighbors[3] != -1) {
-        interior_u[ii] = 1;
+#pragma omp for schedule(static) nowait
+    for (int ii = 0; ii < topo.velocity_u.size(); ii++) {
+      if (topo.velocity_u.neighbor(ii, 1) != -1 && topo.velocity_u.neighbor(ii, 3) != -1) {
+        topo.interior_u.set(ii);
       }
     }
-#pragma omp for schedule(static,1) nowait
-    for (int ii = 0; ii < velocity_v.size(); ii++) {
-      if (velocity_v[ii].neighbors[0] != -1 && velocity_v[ii].neighbors[2] != -1) {
-        interior_v[ii] = 1;
+#pragma omp for schedule(static) nowait
+    for (int ii = 0; ii < topo.velocity_v.size(); ii++) {
+      if (topo.velocity_v.neighbor(ii, 0) != -1 && topo.velocity_v.neighbor(ii, 2) != -1) {
+        topo.interior_v.set(ii);
       }
     }
   }
 
-  interior_u_nums.resize(interior_u.size(), -1);
-  interior_v_nums.resize(interior_v.size(), -1);
-  int cell = -1;
-  for (int ii = 0; ii < interior_u.size(); ii++)
-    if (interior_u[ii]) {
-      cell++;
-      interior_u_nums[ii] = cell;
-    }
-  cell = -1;
-  for (int ii = 0; ii < interior_v.size(); ii++)
-    if (interior_v[ii]) {
-      cell++;
-      interior_v_nums[ii] = cell;
-    }
+  number_interior(topo.interior_u, topo.interior_u_nums);
+  number_interior(topo.interior_v, topo.interior_v_nums);
 
 #ifdef _DOF_NEIGHBOR_DEBUG
-  std::cout << "\nVelocity numbers in each pressure cell:\n";
-  for (int ii = 0; ii < (ptv.size()/4); ii++) {
+  std::cout << "\nVelocity numbers in each topo.pressure cell:\n";
+  for (int ii = 0; ii < (topo.ptv.size()/4); ii++) {
     std::cout << ii << "\t";
     for (int jj = 0; jj < 4; jj++) {
-      std::cout << "\t" << ptv[idx2(ii, jj, 4)];
+      std::cout << "\t" << topo.ptv[idx2(ii, jj, 4)];
     }
     std::cout << "\n";
   }
   std::cout << "\nU velocity neighbor lists:\n";
-  for (int ii = 0; ii < velocity_u.size(); ii++) {
+  for (int ii = 0; ii < topo.velocity_u.size(); ii++) {
     std::cout << ii << "\t";
     for (int jj = 0; jj < 4; jj++) {
-      std::cout << "\t" << velocity_u[ii].neighbors[jj];
+      std::cout << "\t" << topo.velocity_u.neighbor(ii, jj);
     }
     std::cout << "\n";
   }
   std::cout << "\nV velocity neighbor lists:\n";
-  for (int ii = 0; ii < velocity_v.size(); ii++) {
+  for (int ii = 0; ii < topo.velocity_v.size(); ii++) {
     std::cout << ii << "\t";
     for (int jj = 0; jj < 4; jj++) {
-      std::cout << "\t" << velocity_v[ii].neighbors[jj];
+      std::cout << "\t" << topo.velocity_v.neighbor(ii, jj);
     }
     std::cout << "\n";
   }
   std::cout << "\npressure neighbor lists:\n";
-  for (int ii = 0; ii < pressure.size(); ii++) {
+  for (int ii = 0; ii < topo.pressure.size(); ii++) {
     std::cout << ii << "\t";
     for (int jj = 0; jj < 4; jj++) {
-      std::cout << "\t" << pressure[ii].neighbors[jj];
+      std::cout << "\t" << topo.pressure.neighbor(ii, jj);
     }
     std::cout << "\n";
   }
@@ -226,112 +257,112 @@ hgf::models::stokes::build_degrees_of_freedom_2d(const parameters& par, const hg
 }
 
 void
-hgf::models::stokes::dof_neighbors_2d(const parameters& par, const hgf::mesh::voxel& msh)
+hgf::models::stokes::dof_neighbors_2d(const parameters& par, const hgf::mesh::voxel& msh, stokes_topology& topo)
 {
 
 #pragma omp parallel
   {
-#pragma omp for schedule(static,1)
-    for (int ii = 0; ii < velocity_u.size(); ii++) {
+#pragma omp for schedule(static)
+    for (int ii = 0; ii < topo.velocity_u.size(); ii++) {
       int no_neighbor_u[4] = { 1, 1, 1, 1 };
       //-- neighbor 0 --//
-      if (velocity_u[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_u[ii].cell_numbers[0]].neighbors[0] != -1) {
+      if (topo.velocity_u.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_u.cell(ii, 0), 0) != -1) {
           // lower neighbor exists through pressure on the left
           no_neighbor_u[0] = 0;
-          int pcell = pressure[velocity_u[ii].cell_numbers[0]].neighbors[0];
-          velocity_u[ii].neighbors[0] = ptv[idx2(pcell, 1, 4)];
+          int pcell = topo.pressure.neighbor(topo.velocity_u.cell(ii, 0), 0);
+          topo.velocity_u.neighbor(ii, 0) = topo.ptv[idx2(pcell, 1, 4)];
         }
-      if (no_neighbor_u[0] && velocity_u[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_u[ii].cell_numbers[1]].neighbors[0] != -1) {
+      if (no_neighbor_u[0] && topo.velocity_u.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_u.cell(ii, 1), 0) != -1) {
           // lower neighbor exists through pressure on the right
           no_neighbor_u[0] = 0;
-          int pcell = pressure[velocity_u[ii].cell_numbers[1]].neighbors[0];
-          velocity_u[ii].neighbors[0] = ptv[idx2(pcell, 0, 4)];
+          int pcell = topo.pressure.neighbor(topo.velocity_u.cell(ii, 1), 0);
+          topo.velocity_u.neighbor(ii, 0) = topo.ptv[idx2(pcell, 0, 4)];
         }
-      if (no_neighbor_u[0]) velocity_u[ii].neighbors[0] = -1;
+      if (no_neighbor_u[0]) topo.velocity_u.neighbor(ii, 0) = -1;
 
       //-- neighbor 1 --//
-      if (velocity_u[ii].cell_numbers[1] != -1) {
+      if (topo.velocity_u.cell(ii, 1) != -1) {
         no_neighbor_u[1] = 0;
-        velocity_u[ii].neighbors[1] = ptv[idx2(velocity_u[ii].cell_numbers[1], 1, 4)];
+        topo.velocity_u.neighbor(ii, 1) = topo.ptv[idx2(topo.velocity_u.cell(ii, 1), 1, 4)];
       }
-      if (no_neighbor_u[1]) velocity_u[ii].neighbors[1] = -1;
+      if (no_neighbor_u[1]) topo.velocity_u.neighbor(ii, 1) = -1;
 
       //-- neighbor 2 --//
-      if (velocity_u[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_u[ii].cell_numbers[0]].neighbors[2] != -1) {
+      if (topo.velocity_u.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_u.cell(ii, 0), 2) != -1) {
           // upper neighbor exists through pressure on left
           no_neighbor_u[2] = 0;
-          int pcell = pressure[velocity_u[ii].cell_numbers[0]].neighbors[2];
-          velocity_u[ii].neighbors[2] = ptv[idx2(pcell, 1, 4)];
+          int pcell = topo.pressure.neighbor(topo.velocity_u.cell(ii, 0), 2);
+          topo.velocity_u.neighbor(ii, 2) = topo.ptv[idx2(pcell, 1, 4)];
         }
-      if (no_neighbor_u[2] && velocity_u[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_u[ii].cell_numbers[1]].neighbors[2] != -1) {
+      if (no_neighbor_u[2] && topo.velocity_u.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_u.cell(ii, 1), 2) != -1) {
           // upper neighbor exists through pressure on right
           no_neighbor_u[2] = 0;
-          int pcell = pressure[velocity_u[ii].cell_numbers[1]].neighbors[2];
-          velocity_u[ii].neighbors[2] = ptv[idx2(pcell, 0, 4)];
+          int pcell = topo.pressure.neighbor(topo.velocity_u.cell(ii, 1), 2);
+          topo.velocity_u.neighbor(ii, 2) = topo.ptv[idx2(pcell, 0, 4)];
         }
-      if (no_neighbor_u[2]) velocity_u[ii].neighbors[2] = -1;
+      if (no_neighbor_u[2]) topo.velocity_u.neighbor(ii, 2) = -1;
 
       //-- neighbor 3 --//
-      if (velocity_u[ii].cell_numbers[0] != -1) {
+      if (topo.velocity_u.cell(ii, 0) != -1) {
         no_neighbor_u[3] = 0;
-        velocity_u[ii].neighbors[3] = ptv[idx2(velocity_u[ii].cell_numbers[0], 0, 4)];
+        topo.velocity_u.neighbor(ii, 3) = topo.ptv[idx2(topo.velocity_u.cell(ii, 0), 0, 4)];
       }
-      if (no_neighbor_u[3]) velocity_u[ii].neighbors[3] = -1;
+      if (no_neighbor_u[3]) topo.velocity_u.neighbor(ii, 3) = -1;
     }
-#pragma omp for schedule(static,1) nowait
-    for (int ii = 0; ii < velocity_v.size(); ii++) {
+#pragma omp for schedule(static) nowait
+    for (int ii = 0; ii < topo.velocity_v.size(); ii++) {
       int no_neighbor_v[4] = { 1, 1, 1, 1 };
       //-- neighbor 0 --//
-      if (velocity_v[ii].cell_numbers[0] != -1) {
+      if (topo.velocity_v.cell(ii, 0) != -1) {
         no_neighbor_v[0] = 0;
-        velocity_v[ii].neighbors[0] = ptv[idx2(velocity_v[ii].cell_numbers[0], 2, 4)];
+        topo.velocity_v.neighbor(ii, 0) = topo.ptv[idx2(topo.velocity_v.cell(ii, 0), 2, 4)];
       }
-      if (no_neighbor_v[0]) velocity_v[ii].neighbors[0] = -1;
+      if (no_neighbor_v[0]) topo.velocity_v.neighbor(ii, 0) = -1;
 
       //-- neighbor 1 --//
-      if (velocity_v[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_v[ii].cell_numbers[0]].neighbors[1] != -1) {
+      if (topo.velocity_v.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_v.cell(ii, 0), 1) != -1) {
           // right neighbor exists through pressure below
           no_neighbor_v[1] = 0;
-          int pcell = pressure[velocity_v[ii].cell_numbers[0]].neighbors[1];
-          velocity_v[ii].neighbors[1] = ptv[idx2(pcell, 3, 4)];
+          int pcell = topo.pressure.neighbor(topo.velocity_v.cell(ii, 0), 1);
+          topo.velocity_v.neighbor(ii, 1) = topo.ptv[idx2(pcell, 3, 4)];
         }
-      if (no_neighbor_v[1] && velocity_v[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_v[ii].cell_numbers[1]].neighbors[1] != -1) {
+      if (no_neighbor_v[1] && topo.velocity_v.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_v.cell(ii, 1), 1) != -1) {
           // right neighbor exists through pressure above
           no_neighbor_v[1] = 0;
-          int pcell = pressure[velocity_v[ii].cell_numbers[1]].neighbors[1];
-          velocity_v[ii].neighbors[1] = ptv[idx2(pcell, 2, 4)];
+          int pcell = topo.pressure.neighbor(topo.velocity_v.cell(ii, 1), 1);
+          topo.velocity_v.neighbor(ii, 1) = topo.ptv[idx2(pcell, 2, 4)];
         }
-      if (no_neighbor_v[1]) velocity_v[ii].neighbors[1] = -1;
+      if (no_neighbor_v[1]) topo.velocity_v.neighbor(ii, 1) = -1;
 
       //-- neighbor 2 --//
-      if (velocity_v[ii].cell_numbers[1] != -1) {
+      if (topo.velocity_v.cell(ii, 1) != -1) {
         no_neighbor_v[2] = 0;
-        velocity_v[ii].neighbors[2] = ptv[idx2(velocity_v[ii].cell_numbers[1], 3, 4)];
+        topo.velocity_v.neighbor(ii, 2) = topo.ptv[idx2(topo.velocity_v.cell(ii, 1), 3, 4)];
       }
-      if (no_neighbor_v[2]) velocity_v[ii].neighbors[2] = -1;
+      if (no_neighbor_v[2]) topo.velocity_v.neighbor(ii, 2) = -1;
 
       //-- neighbor 3 --//
-      if (velocity_v[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_v[ii].cell_numbers[0]].neighbors[3] != -1) {
+      if (topo.velocity_v.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_v.cell(ii, 0), 3) != -1) {
           // left neighbor exists through pressure below
           no_neighbor_v[3] = 0;
-          int pcell = pressure[velocity_v[ii].cell_numbers[0]].neighbors[3];
-          velocity_v[ii].neighbors[3] = ptv[idx2(pcell, 3, 4)];
+          int pcell = topo.pressure.neighbor(topo.velocity_v.cell(ii, 0), 3);
+          topo.velocity_v.neighbor(ii, 3) = topo.ptv[idx2(pcell, 3, 4)];
         }
-      if (no_neighbor_v[3] && velocity_v[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_v[ii].cell_numbers[1]].neighbors[3] != -1) {
+      if (no_neighbor_v[3] && topo.velocity_v.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_v.cell(ii, 1), 3) != -1) {
           // left neighbor exists through pressure above
           no_neighbor_v[3] = 0;
-          int pcell = pressure[velocity_v[ii].cell_numbers[1]].neighbors[3];
-          velocity_v[ii].neighbors[3] = ptv[idx2(pcell, 2, 4)];
+          int pcell = topo.pressure.neighbor(topo.velocity_v.cell(ii, 1), 3);
+          topo.velocity_v.neighbor(ii, 3) = topo.ptv[idx2(pcell, 2, 4)];
         }
-      if (no_neighbor_v[3]) velocity_v[ii].neighbors[3] = -1;
+      if (no_neighbor_v[3]) topo.velocity_v.neighbor(ii, 3) = -1;
     }
   }
 
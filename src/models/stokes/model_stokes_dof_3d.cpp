@@ -4,333 +4,339 @@
 #include "model_stokes.hpp"
 
 // 1d->2d index
-#define idx2(i, j, ldi) ((i * ldi) + j)
+#define idx2(i, j, ldi) (((hgf_index)i * ldi) + j)
+
+// 1d->3d index
+#define idx3(i, j, k, ldi1, ldi2) (k + (ldi2 * (j + ldi1 * i)))
+
+/* Neighbor of a cell across one of its faces, from the periodic neighbor table when the topology is periodic. */
+static inline int
+cell_neighbor(const hgf::mesh::voxel& msh, const std::vector< int >& periodic_table, int cell, int face)
+{
+  return periodic_table.size() ? periodic_table[idx2(cell, face, 6)] : msh.els[cell].fac[face].neighbor;
+}
+
+/* Numbers the velocity DOFs normal to one axis (0: u, 1: v, 2: w) directly from the voxel grid.
+   DOFs are ordered by line of voxels along the axis, lines ordered (z, y) for u, (z, x) for v and (y, x) for w,
+   and by position along each line. Every cell owns the DOF on its upper face, and the DOF on its lower face when
+   it has no neighbor there, wrapping across the domain in periodic topologies; lower_dof[cell] is -1 otherwise.
+   Returns the number of DOFs. */
+static int
+number_face_dofs(const parameters& par, const hgf::mesh::voxel& msh, const std::vector< int >& periodic_table, \
+  const std::vector< int >& voxel_cell, int axis, std::vector< int >& lower_dof, std::vector< int >& upper_dof)
+{
+  int lower_face[3] = { 3, 0, 4 };
+  int line_len[3] = { par.nx, par.ny, par.nz };
+  long stride[3] = { 1, par.nx, (long)par.nx * par.ny };
+  int n_lines = (int)(par.voxel_geometry.size() / line_len[axis]);
+  int len = line_len[axis];
+  int face = lower_face[axis];
+
+  // first voxel of each line
+  std::vector< long > line_start(n_lines);
+  std::vector< int > line_offset(n_lines + 1, 0);
+#pragma omp parallel for schedule(static)
+  for (int line = 0; line < n_lines; line++) {
+    if (axis == 0) line_start[line] = (long)line * par.nx;
+    else if (axis == 1) line_start[line] = (long)(line / par.nx) * par.nx * par.ny + (line % par.nx);
+    else line_start[line] = line;
+    int count = 0;
+    for (int tt = 0; tt < len; tt++) {
+      int cell = voxel_cell[line_start[line] + tt * stride[axis]];
+      if (cell < 0) continue;
+      count += (cell_neighbor(msh, periodic_table, cell, face) == -1) ? 2 : 1;
+    }
+    line_offset[line + 1] = count;
+  }
+  for (int line = 0; line < n_lines; line++) line_offset[line + 1] += line_offset[line];
+
+  lower_dof.resize(msh.els.size());
+  upper_dof.resize(msh.els.size());
+#pragma omp parallel for schedule(static)
+  for (int line = 0; line < n_lines; line++) {
+    int dof = line_offset[line];
+    for (int tt = 0; tt < len; tt++) {
+      int cell = voxel_cell[line_start[line] + tt * stride[axis]];
+      if (cell < 0) continue;
+      lower_dof[cell] = (cell_neighbor(msh, periodic_table, cell, face) == -1) ? dof++ : -1;
+      upper_dof[cell] = dof++;
+    }
+  }
+  return line_offset[n_lines];
+}
+
+/* Numbers the entries of an interior flag vector with per-thread counts and offsets. */
+static void
+number_interior(const bit_flags& interior, std::vector< int >& interior_nums)
+{
+  int size = (int)interior.size();
+  interior_nums.assign(size, -1);
+  std::vector< int > thread_offset(omp_get_max_threads() + 1, 0);
+#pragma omp parallel
+  {
+    int tid = omp_get_thread_num();
+    int nthreads = omp_get_num_threads();
+    int chunk = (size + nthreads - 1) / nthreads;
+    int first = std::min(size, tid * chunk);
+    int last = std::min(size, first + chunk);
+    int count = 0;
+    for (int ii = first; ii < last; ii++) count += (interior[ii] != 0);
+    thread_offset[tid + 1] = count;
+#pragma omp barrier
+#pragma omp single
+    {
+      for (int tt = 0; tt < nthreads; tt++) thread_offset[tt + 1] += thread_offset[tt];
+    }
+    int num = thread_offset[tid];
+    for (int ii = first; ii < last; ii++) {
+      if (interior[ii]) interior_nums[ii] = num++;
+    }
+  }
+}
 
 void
-hgf::models::stokes::build_degrees_of_freedom_3d(const parameters& par, const hgf::mesh::voxel& msh)
+hgf::models::stokes::build_degrees_of_freedom_3d(const parameters& par, const hgf::mesh::voxel& msh, stokes_topology& topo)
 {
   // this function sets the degrees of freedom for the velocity components and pressure in 3d
-  velocity_u.reserve((par.nx + 1)*par.ny*par.nz);
-  velocity_v.reserve((par.ny + 1)*par.nz*par.nx);
-  velocity_w.reserve((par.nz + 1)*par.nx*par.ny);
-  pressure.resize(msh.els.size());
+  // velocity dofs are numbered directly from the voxel grid, in the order needed for matrix condition #
+  int n_cells = (int)msh.els.size();
+  long n_voxels = (long)par.voxel_geometry.size();
+  std::vector< int > voxel_cell(n_voxels);
+  std::vector< int > cell_voxel(n_cells);
+  std::vector< int > lower_u, upper_u, lower_v, upper_v, lower_w, upper_w;
+  std::vector< int > periodic_table;
+
+  // periodic topologies wrap the cell neighbors across the domain faces
+  topo.pressure_reference.clear();
+  for (int kk = 0; kk < 3; kk++) topo.period[kk] = 0;
+  if (par.periodic) {
+    hgf::mesh::periodic_neighbors(par, periodic_table, topo.pressure_reference);
+    topo.period[0] = par.length;
+    topo.period[1] = par.width;
+    topo.period[2] = par.height;
+  }
 
+  // voxel to cell map, cells are the non-solid voxels in voxel order
+  std::vector< int > chunk_offset(omp_get_max_threads() + 1, 0);
 #pragma omp parallel
   {
-#pragma omp sections
+    int tid = omp_get_thread_num();
+    int nthreads = omp_get_num_threads();
+    long chunk = (n_voxels + nthreads - 1) / nthreads;
+    long first = std::min(n_voxels, tid * chunk);
+    long last = std::min(n_voxels, first + chunk);
+    int count = 0;
+    for (long vv = first; vv < last; vv++) {
+      if (par.voxel_geometry[vv] != 1) count++;
+    }
+    chunk_offset[tid + 1] = count;
+#pragma omp barrier
+#pragma omp single
     {
-#pragma omp section
-      { // u section
-        degree_of_freedom dof_temp;
-        for (int cell = 0; cell < msh.els.size(); cell++) {
-          if (msh.els[cell].fac[3].neighbor == -1) {
-            // if there's no neighbor cell backwards in x, then we have 2 new dofs for u
-            dof_temp.coords[0] = 0.5 * \
-              (msh.els[cell].vtx[0].coords[0] + msh.els[cell].vtx[3].coords[0]);
-            dof_temp.coords[1] = 0.5 * \
-              (msh.els[cell].vtx[0].coords[1] + msh.els[cell].vtx[3].coords[1]);
-            dof_temp.coords[2] = 0.5 * \
-              (msh.els[cell].vtx[0].coords[2] + msh.els[cell].vtx[7].coords[2]);
-            // doftype
-            dof_temp.doftype = 1;
-            // cell numbers
-            dof_temp.cell_numbers[1] = cell;
-            dof_temp.cell_numbers[0] = -1;
-            // push back
-            velocity_u.push_back(dof_temp);
-          }
-          // -- dof on face 1 --//
-          // coordinates
-          dof_temp.coords[0] = 0.5 * \
-            (msh.els[cell].vtx[1].coords[0] + msh.els[cell].vtx[2].coords[0]);
-          dof_temp.coords[1] = 0.5 * \
-            (msh.els[cell].vtx[1].coords[1] + msh.els[cell].vtx[2].coords[1]);
-          dof_temp.coords[2] = 0.5 * \
-            (msh.els[cell].vtx[1].coords[2] + msh.els[cell].vtx[6].coords[2]);
-          // doftype
-          dof_temp.doftype = 1;
-          // cell_numbers
-          dof_temp.cell_numbers[0] = cell;
-          dof_temp.cell_numbers[1] = msh.els[cell].fac[1].neighbor;
-          // push_back
-          velocity_u.push_back(dof_temp);
-        }
-      }
-#pragma omp section
-      { // v section
-
-        degree_of_freedom dof_temp;
-        for (int cell = 0; cell < msh.els.size(); cell++) {
-          if (msh.els[cell].fac[0].neighbor == -1) {
-            // if there's no neighbor back in y, then we have 2 new dofs for v
-            //--- dof on face 0 ---//
-            // coordinates
-            dof_temp.coords[0] = 0.5 * \
-              (msh.els[cell].vtx[0].coords[0] + msh.els[cell].vtx[1].coords[0]);
-            dof_temp.coords[1] = 0.5 * \
-              (msh.els[cell].vtx[0].coords[1] + msh.els[cell].vtx[1].coords[1]);
-            dof_temp.coords[2] = 0.5 * \
-              (msh.els[cell].vtx[0].coords[2] + msh.els[cell].vtx[7].coords[2]);
-            // doftype
-            dof_temp.doftype = 1;
-            // cell_numbers
-            dof_temp.cell_numbers[1] = cell;
-            dof_temp.cell_numbers[0] = -1;
-            // push_back
-            velocity_v.push_back(dof_temp);
-          }
-          //--- dof on face 2 ---//
-          // coordinates
-          dof_temp.coords[0] = 0.5 * \
-            (msh.els[cell].vtx[3].coords[0] + msh.els[cell].vtx[2].coords[0]);
-          dof_temp.coords[1] = 0.5 * \
-            (msh.els[cell].vtx[3].coords[1] + msh.els[cell].vtx[2].coords[1]);
-          dof_temp.coords[2] = 0.5 * \
-            (msh.els[cell].vtx[3].coords[2] + msh.els[cell].vtx[4].coords[2]);
-          // doftype
-          dof_temp.doftype = 1;
-          // cell_numbers
-          dof_temp.cell_numbers[0] = cell;
-          dof_temp.cell_numbers[1] = msh.els[cell].fac[2].neighbor;
-          // push_back
-          velocity_v.push_back(dof_temp);
-        }
-      }
-#pragma omp section
-      { // w section
-        degree_of_freedom dof_temp;
-        for (int cell = 0; cell < msh.els.size(); cell++) {
-          if (msh.els[cell].fac[4].neighbor == -1) {
-            // if there's no neighbor back in z, then we have 2 new dofs for w
-            //--- dof on face 4 ---//
-            // coordinates
-            dof_temp.coords[0] = 0.5 * \
-              (msh.els[cell].vtx[0].coords[0] + msh.els[cell].vtx[1].coords[0]);
-            dof_temp.coords[1] = 0.5 * \
-              (msh.els[cell].vtx[0].coords[1] + msh.els[cell].vtx[3].coords[1]);
-            dof_temp.coords[2] = 0.5 * \
-              (msh.els[cell].vtx[0].coords[2] + msh.els[cell].vtx[3].coords[2]);
-            // doftype
-            dof_temp.doftype = 1;
-            // cell_numbers
-            dof_temp.cell_numbers[1] = cell;
-            dof_temp.cell_numbers[0] = -1;
-            // push back
-            velocity_w.push_back(dof_temp);
-          }
-          //--- dof on face 5 ---//
-          // coordinates
-          dof_temp.coords[0] = 0.5 * \
-            (msh.els[cell].vtx[7].coords[0] + msh.els[cell].vtx[6].coords[0]);
-          dof_temp.coords[1] = 0.5 * \
-            (msh.els[cell].vtx[7].coords[1] + msh.els[cell].vtx[4].coords[1]);
-          dof_temp.coords[2] = 0.5 * \
-            (msh.els[cell].vtx[7].coords[2] + msh.els[cell].vtx[4].coords[2]);
-          // doftype
-          dof_temp.doftype = 1;
-          // cell_numbers
-          dof_temp.cell_numbers[0] = cell;
-          dof_temp.cell_numbers[1] = msh.els[cell].fac[5].neighbor;
-          // push back
-          velocity_w.push_back(dof_temp);
-        }
-      }
+      for (int tt = 0; tt < nthreads; tt++) chunk_offset[tt + 1] += chunk_offset[tt];
     }
-#pragma omp for // pressure section can be done in parallel and doesn't need to wait for the velocities
-    for (int cell = 0; cell < msh.els.size(); cell++) {
-      // p section
-      degree_of_freedom dof_temp;
-      // coordinates
-      for (int dir = 0; dir < 3; dir++) {
-        dof_temp.coords[dir] = 0;
-        for (int ii = 0; ii < 8; ii++) dof_temp.coords[dir] += msh.els[cell].vtx[ii].coords[dir];
-        dof_temp.coords[dir] = dof_temp.coords[dir] / 8;
+    int cell = chunk_offset[tid];
+    for (long vv = first; vv < last; vv++) {
+      if (par.voxel_geometry[vv] != 1) {
+        cell_voxel[cell] = (int)vv;
+        voxel_cell[vv] = cell++;
       }
-      // doftype
-      dof_temp.doftype = 0;
-      // cell numbers
-      dof_temp.cell_numbers[0] = cell;
-      dof_temp.cell_numbers[1] = -1;
-      // neighbors
-      for (int nbr = 0; nbr < 6; nbr++) dof_temp.neighbors[nbr] = msh.els[cell].fac[nbr].neighbor;
-      // place pressure dof
-      pressure[cell] = dof_temp;
+      else voxel_cell[vv] = -1;
     }
   }
-  // sort the v component for matrix condition #
-  std::sort(velocity_v.begin(), velocity_v.end(), byZbyXbyY());
 
-  // sort the w component for matrix condition #
-  std::sort(velocity_w.begin(), velocity_w.end(), byYbyXbyZ());
+  topo.velocity_u.setup(par, 0);
+  topo.velocity_v.setup(par, 1);
+  topo.velocity_w.setup(par, 2);
+  topo.pressure.setup(par, -1);
+  topo.velocity_u.resize(number_face_dofs(par, msh, periodic_table, voxel_cell, 0, lower_u, upper_u));
+  topo.velocity_v.resize(number_face_dofs(par, msh, periodic_table, voxel_cell, 1, lower_v, upper_v));
+  topo.velocity_w.resize(number_face_dofs(par, msh, periodic_table, voxel_cell, 2, lower_w, upper_w));
+  topo.pressure.resize(n_cells);
+  topo.ptv.resize(topo.pressure.size() * 6, -1);
+
+#pragma omp parallel for schedule(static)
+  for (int cell = 0; cell < n_cells; cell++) {
+    int xi = cell_voxel[cell] % par.nx;
+    int yi = (cell_voxel[cell] / par.nx) % par.ny;
+    int zi = cell_voxel[cell] / (par.nx * par.ny);
+
+    // u section
+    if (lower_u[cell] != -1) {
+      // if there's no neighbor cell backwards in x, then we have 2 new dofs for u
+      topo.velocity_u.set_position(lower_u[cell], zi, yi, xi);
+      topo.velocity_u.cell(lower_u[cell], 1) = cell;
+    }
+    //-- dof on face 1 --//
+    topo.velocity_u.set_position(upper_u[cell], zi, yi, xi + 1);
+    topo.velocity_u.cell(upper_u[cell], 0) = cell;
+    topo.velocity_u.cell(upper_u[cell], 1) = cell_neighbor(msh, periodic_table, cell, 1);
+
+    // v section
+    if (lower_v[cell] != -1) {
+      // if there's no neighbor back in y, then we have 2 new dofs for v
+      //--- dof on face 0 ---//
+      topo.velocity_v.set_position(lower_v[cell], zi, yi, xi);
+      topo.velocity_v.cell(lower_v[cell], 1) = cell;
+    }
+    //--- dof on face 2 ---//
+    topo.velocity_v.set_position(upper_v[cell], zi, yi + 1, xi);
+    topo.velocity_v.cell(upper_v[cell], 0) = cell;
+    topo.velocity_v.cell(upper_v[cell], 1) = cell_neighbor(msh, periodic_table, cell, 2);
+
+    // w section
+    if (lower_w[cell] != -1) {
+      // if there's no neighbor back in z, then we have 2 new dofs for w
+      //--- dof on face 4 ---//
+      topo.velocity_w.set_position(lower_w[cell], zi, yi, xi);
+      topo.velocity_w.cell(lower_w[cell], 1) = cell;
+    }
+    //--- dof on face 5 ---//
+    topo.velocity_w.set_position(upper_w[cell], zi + 1, yi, xi);
+    topo.velocity_w.cell(upper_w[cell], 0) = cell;
+    topo.velocity_w.cell(upper_w[cell], 1) = cell_neighbor(msh, periodic_table, cell, 5);
+
+    // p section
+    topo.pressure.set_position(cell, zi, yi, xi);
+    topo.pressure.cell(cell, 0) = cell;
+    for (int nbr = 0; nbr < 6; nbr++) topo.pressure.neighbor(cell, nbr) = cell_neighbor(msh, periodic_table, cell, nbr);
+
+    // pressure to velocity relationships, a lower face dof owned by the neighbor is its upper face dof
+    topo.ptv[idx2(cell, 0, 6)] = (lower_u[cell] != -1) ? lower_u[cell] : upper_u[cell_neighbor(msh, periodic_table, cell, 3)];
+    topo.ptv[idx2(cell, 1, 6)] = upper_u[cell];
+    topo.ptv[idx2(cell, 2, 6)] = (lower_v[cell] != -1) ? lower_v[cell] : upper_v[cell_neighbor(msh, periodic_table, cell, 0)];
+    topo.ptv[idx2(cell, 3, 6)] = upper_v[cell];
+    topo.ptv[idx2(cell, 4, 6)] = (lower_w[cell] != -1) ? lower_w[cell] : upper_w[cell_neighbor(msh, periodic_table, cell, 4)];
+    topo.ptv[idx2(cell, 5, 6)] = upper_w[cell];
+  }
 
 #ifdef _DOF_SORT_DEBUG
   std::cout << "\nChecking velocity sort U:\n";
-  for (int ii = 0; ii < velocity_u.size(); ii++) {
-    std::cout << velocity_u[ii].coords[0] << "\t" << velocity_u[ii].coords[1] << "\t" << velocity_u[ii].coords[2] << "\n";
+  for (int ii = 0; ii < topo.velocity_u.size(); ii++) {
+    std::cout << topo.velocity_u.coord(ii, 0) << "\t" << topo.velocity_u.coord(ii, 1) << "\t" << topo.velocity_u.coord(ii, 2) << "\n";
   }
   std::cout << "\nChecking velocity sort V:\n";
-  for (int ii = 0; ii < velocity_v.size(); ii++) {
-    std::cout << velocity_v[ii].coords[0] << "\t" << velocity_v[ii].coords[1] << "\t" << velocity_v[ii].coords[2] << "\n";
+  for (int ii = 0; ii < topo.velocity_v.size(); ii++) {
+    std::cout << topo.velocity_v.coord(ii, 0) << "\t" << topo.velocity_v.coord(ii, 1) << "\t" << topo.velocity_v.coord(ii, 2) << "\n";
   }
   std::cout << "\nChecking velocity sort W:\n";
-  for (int ii = 0; ii < velocity_w.size(); ii++) {
-    std::cout << velocity_w[ii].coords[0] << "\t" << velocity_w[ii].coords[1] << "\t" << velocity_w[ii].coords[2] << "\n";
+  for (int ii = 0; ii < topo.velocity_w.size(); ii++) {
+    std::cout << topo.velocity_w.coord(ii, 0) << "\t" << topo.velocity_w.coord(ii, 1) << "\t" << topo.velocity_w.coord(ii, 2) << "\n";
   }
 #endif
 
 #ifdef _DOF_CELL_NUMBERS_DEBUG
   std::cout << "\nChecking U Pressure Numbers:\n";
-  for (int ii = 0; ii < velocity_u.size(); ii++) {
-    std::cout << velocity_u[ii].cell_numbers[0] << "\t" << velocity_u[ii].cell_numbers[1] << "\n";
+  for (int ii = 0; ii < topo.velocity_u.size(); ii++) {
+    std::cout << topo.velocity_u.cell(ii, 0) << "\t" << topo.velocity_u.cell(ii, 1) << "\n";
   }
   std::cout << "\nChecking V Pressure Numbers:\n";
-  for (int ii = 0; ii < velocity_v.size(); ii++) {
-    std::cout << velocity_v[ii].cell_numbers[0] << "\t" << velocity_v[ii].cell_numbers[1] << "\n";
+  for (int ii = 0; ii < topo.velocity_v.size(); ii++) {
+    std::cout << topo.velocity_v.cell(ii, 0) << "\t" << topo.velocity_v.cell(ii, 1) << "\n";
   }
   std::cout << "\nChecking W Pressure Numbers:\n";
-  for (int ii = 0; ii < velocity_w.size(); ii++) {
-    std::cout << velocity_w[ii].cell_numbers[0] << "\t" << velocity_w[ii].cell_numbers[1] << "\n";
+  for (int ii = 0; ii < topo.velocity_w.size(); ii++) {
+    std::cout << topo.velocity_w.cell(ii, 0) << "\t" << topo.velocity_w.cell(ii, 1) << "\n";
   }
 #endif
 
-  // pressure to velocity relationships
-  ptv.resize(pressure.size() * 6, -1);
-#pragma omp parallel
-  {
-#pragma omp for schedule(static,1) nowait
-    for (int ii = 0; ii < velocity_u.size(); ii++) {
-      // pressure cells should know who u cells are
-      if (velocity_u[ii].cell_numbers[0] != -1) ptv[idx2(velocity_u[ii].cell_numbers[0], 1, 6)] = ii;
-      if (velocity_u[ii].cell_numbers[1] != -1) ptv[idx2(velocity_u[ii].cell_numbers[1], 0, 6)] = ii;
-    }
-#pragma omp for schedule(static,1) nowait
-    for (int ii = 0; ii < velocity_v.size(); ii++) {
-      // pressure cells should know who v cells are
-      if (velocity_v[ii].cell_numbers[0] != -1) ptv[idx2(velocity_v[ii].cell_numbers[0], 3, 6)] = ii;
-      if (velocity_v[ii].cell_numbers[1] != -1) ptv[idx2(velocity_v[ii].cell_numbers[1], 2, 6)] = ii;
-    }
-#pragma omp for schedule(static,1) nowait
-    for (int ii = 0; ii < velocity_w.size(); ii++) {
-      // pressure cells should know who w cells are
-      if (velocity_w[ii].cell_numbers[0] != -1) ptv[idx2(velocity_w[ii].cell_numbers[0], 5, 6)] = ii;
-      if (velocity_w[ii].cell_numbers[1] != -1) ptv[idx2(velocity_w[ii].cell_numbers[1], 4, 6)] = ii;
-    }
-  }
 #ifdef _DOF_PTV_DEBUG
   std::cout << "\nChecking PTV Array:\n";
-  for (int ii = 0; ii < ptv.size() / 6; ii++) {
+  for (int ii = 0; ii < topo.ptv.size() / 6; ii++) {
     for (int jj = 0; jj < 6; jj++) {
-      std::cout << ptv[idx2(ii, jj, 6)] << "\t";
+      std::cout << topo.ptv[idx2(ii, jj, 6)] << "\t";
     }
     std::cout << "\n";
   }
 #endif
 
   // set neighbors for velocity components
-  dof_neighbors_3d(par, msh);
+  dof_neighbors_3d(par, msh, topo);
 
   // determine boundary and interior cells
-  interior_u.resize(velocity_u.size());
-  interior_v.resize(velocity_v.size());
-  interior_w.resize(velocity_w.size());
+  topo.interior_u.resize(topo.velocity_u.size());
+  topo.interior_v.resize(topo.velocity_v.size());
+  topo.interior_w.resize(topo.velocity_w.size());
 #pragma omp parallel
   {
     // determine boundary and interior cells
-#pragma omp for schedule(static,1) nowait
-    for (int ii = 0; ii < velocity_u.size(); ii++) {
-      if (velocity_u[ii].neighbors[1] != -1 && velocity_u[ii].neighbors[3] != -1) {
-        interior_u[ii] = 1;
+#pragma omp for schedule(static) nowait
+    for (int ii = 0; ii < topo.velocity_u.size(); ii++) {
+      if (topo.velocity_u.neighbor(ii, 1) != -1 && topo.velocity_u.neighbor(ii, 3) != -1) {
+        topo.interior_u.set(ii);
       }
     }
-#pragma omp for schedule(static,1) nowait
-    for (int ii = 0; ii < velocity_v.size(); ii++) {
-      if (velocity_v[ii].neighbors[0] != -1 && velocity_v[ii].neighbors[2] != -1) {
-        interior_v[ii] = 1;
+#pragma omp for schedule(static) nowait
+    for (int ii = 0; ii < topo.velocity_v.size(); ii++) {
+      if (topo.velocity_v.neighbor(ii, 0) != -1 && topo.velocity_v.neighbor(ii, 2) != -1) {
+        topo.interior_v.set(ii);
       }
     }
-#pragma omp for schedule(static,1) nowait
-    for (int ii = 0; ii < velocity_w.size(); ii++) {
-      if (velocity_w[ii].neighbors[4] != -1 && velocity_w[ii].neighbors[5] != -1) {
-        interior_w[ii] = 1;
+#pragma omp for schedule(static) nowait
+    for (int ii = 0; ii < topo.velocity_w.size(); ii++) {
+      if (topo.velocity_w.neighbor(ii, 4) != -1 && topo.velocity_w.neighbor(ii, 5) != -1) {
+        topo.interior_w.set(ii);
       }
     }
   }
 
 #ifdef _INTERIOR_DEBUG
   std::cout << "\nInterior U Lists:\n";
-  for (int ii = 0; ii < interior_u.size(); ii++) {
-    std::cout << interior_u[ii] << "\n";
+  for (int ii = 0; ii < topo.interior_u.size(); ii++) {
+    std::cout << topo.interior_u[ii] << "\n";
   }
   std::cout << "\nInterior V Lists:\n";
-  for (int ii = 0; ii < interior_v.size(); ii++) {
-    std::cout << interior_v[ii] << "\n";
+  for (int ii = 0; ii < topo.interior_v.size(); ii++) {
+    std::cout << topo.interior_v[ii] << "\n";
   }
   std::cout << "\nInterior W Lists:\n";
-  for (int ii = 0; ii < interior_w.size(); ii++) {
-    std::cout << interior_w[ii] << "\n";
+  for (int ii = 0; ii < topo.interior_w.size(); ii++) {
+    std::cout << topo.interior_w[ii] << "\n";
   }
 #endif
 
-  interior_u_nums.resize(interior_u.size(), -1);
-  interior_v_nums.resize(interior_v.size(), -1);
-  interior_w_nums.resize(interior_w.size(), -1);
-  int cell = -1;
-  for (int ii = 0; ii < interior_u.size(); ii++)
-    if (interior_u[ii]) {
-      cell++;
-      interior_u_nums[ii] = cell;
-    }
-  cell = -1;
-  for (int ii = 0; ii < interior_v.size(); ii++)
-    if (interior_v[ii]) {
-      cell++;
-      interior_v_nums[ii] = cell;
-    }
-  cell = -1;
-  for (int ii = 0; ii < interior_w.size(); ii++)
-    if (interior_w[ii]) {
-      cell++;
-      interior_w_nums[ii] = cell;
-    }
+  number_interior(topo.interior_u, topo.interior_u_nums);
+  number_interior(topo.interior_v, topo.interior_v_nums);
+  number_interior(topo.interior_w, topo.interior_w_nums);
 
 #ifdef _DOF_NEIGHBOR_DEBUG
-  std::cout << "\nVelocity numbers in each pressure cell:\n";
-  for (int ii = 0; ii < (ptv.size() / 6); ii++) {
+  std::cout << "\nVelocity numbers in each topo.pressure cell:\n";
+  for (int ii = 0; ii < (topo.ptv.size() / 6); ii++) {
     std::cout << ii << "\t";
     for (int jj = 0; jj < 6; jj++) {
-      std::cout << "\t" << ptv[idx2(ii, jj, 6)];
+      std::cout << "\t" << topo.ptv[idx2(ii, jj, 6)];
     }
     std::cout << "\n";
   }
   std::cout << "\nU velocity neighbor lists:\n";
-  for (int ii = 0; ii < velocity_u.size(); ii++) {
+  for (int ii = 0; ii < topo.velocity_u.size(); ii++) {
     std::cout << ii << "\t";
     for (int jj = 0; jj < 6; jj++) {
-      std::cout << "\t" << velocity_u[ii].neighbors[jj];
+      std::cout << "\t" << topo.velocity_u.neighbor(ii, jj);
     }
     std::cout << "\n";
   }
   std::cout << "\nV velocity neighbor lists:\n";
-  for (int ii = 0; ii < velocity_v.size(); ii++) {
+  for (int ii = 0; ii < topo.velocity_v.size(); ii++) {
     std::cout << ii << "\t";
     for (int jj = 0; jj < 6; jj++) {
-      std::cout << "\t" << velocity_v[ii].neighbors[jj];
+      std::cout << "\t" << topo.velocity_v.neighbor(ii, jj);
     }
     std::cout << "\n";
   }
   std::cout << "\nW velocity neighbor lists:\n";
-  for (int ii = 0; ii < velocity_w.size(); ii++) {
+  for (int ii = 0; ii < topo.velocity_w.size(); ii++) {
     std::cout << ii << "\t";
     for (int jj = 0; jj < 6; jj++) {
-      std::cout << "\t" << velocity_w[ii].neighbors[jj];
+      std::cout << "\t" << topo.velocity_w.neighbor(ii, jj);
     }
     std::cout << "\n";
   }
   std::cout << "\npressure neighbor lists:\n";
-  for (int ii = 0; ii < pressure.size(); ii++) {
+  for (int ii = 0; ii < topo.pressure.size(); ii++) {
     std::cout << ii << "\t";
     for (int jj = 0; jj < 6; jj++) {
-      std::cout << "\t" << pressure[ii].neighbors[jj];
+      std::cout << "\t" << topo.pressure.neighbor(ii, jj);
     }
     std::cout << "\n";
   }
@@ -339,262 +345,262 @@ hgf::models::stokes::build_degrees_of_freedom_3d(const parameters& par, const hg
 }
 
 void
-hgf::models::stokes::dof_neighbors_3d(const parameters& par, const hgf::mesh::voxel& msh)
+hgf::models::stokes::dof_neighbors_3d(const parameters& par, const hgf::mesh::voxel& msh, stokes_topology& topo)
 {
 #pragma omp parallel
   {
 
-#pragma omp for schedule(static,1) nowait // u loop
-    for (int ii = 0; ii < velocity_u.size(); ii++) {
+#pragma omp for schedule(static) nowait // u loop
+    for (int ii = 0; ii < topo.velocity_u.size(); ii++) {
       int no_neighbor_u[6] = { 1, 1, 1, 1, 1, 1 };
       //-- neighbor 0 (y- direction) --//
-      if (velocity_u[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_u[ii].cell_numbers[0]].neighbors[0] != -1) {
+      if (topo.velocity_u.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_u.cell(ii, 0), 0) != -1) {
           // y- neighbor exists through pressure in x- direction
           no_neighbor_u[0] = 0;
-          int pcell = pressure[velocity_u[ii].cell_numbers[0]].neighbors[0];
-          velocity_u[ii].neighbors[0] = ptv[idx2(pcell, 1, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_u.cell(ii, 0), 0);
+          topo.velocity_u.neighbor(ii, 0) = topo.ptv[idx2(pcell, 1, 6)];
         }
-      if (no_neighbor_u[0] && velocity_u[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_u[ii].cell_numbers[1]].neighbors[0] != -1) {
+      if (no_neighbor_u[0] && topo.velocity_u.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_u.cell(ii, 1), 0) != -1) {
           // y- neighbor exists through pressure in x+ direction
           no_neighbor_u[0] = 0;
-          int pcell = pressure[velocity_u[ii].cell_numbers[1]].neighbors[0];
-          velocity_u[ii].neighbors[0] = ptv[idx2(pcell, 0, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_u.cell(ii, 1), 0);
+          topo.velocity_u.neighbor(ii, 0) = topo.ptv[idx2(pcell, 0, 6)];
         }
-      if (no_neighbor_u[0]) velocity_u[ii].neighbors[0] = -1;
+      if (no_neighbor_u[0]) topo.velocity_u.neighbor(ii, 0) = -1;
 
       //-- neighbor 1 (x+ direction) --//
-      if (velocity_u[ii].cell_numbers[1] != -1) {
+      if (topo.velocity_u.cell(ii, 1) != -1) {
         // x+ neighbor exists through pressure on right
         no_neighbor_u[1] = 0;
-        velocity_u[ii].neighbors[1] = ptv[idx2(velocity_u[ii].cell_numbers[1], 1, 6)];
+        topo.velocity_u.neighbor(ii, 1) = topo.ptv[idx2(topo.velocity_u.cell(ii, 1), 1, 6)];
       }
-      if (no_neighbor_u[1]) velocity_u[ii].neighbors[1] = -1;
+      if (no_neighbor_u[1]) topo.velocity_u.neighbor(ii, 1) = -1;
 
       //-- neighbor 2 (y+ direction) --//
-      if (velocity_u[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_u[ii].cell_numbers[0]].neighbors[2] != -1) {
+      if (topo.velocity_u.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_u.cell(ii, 0), 2) != -1) {
           // y+ neighbor exists through pressure on left
           no_neighbor_u[2] = 0;
-          int pcell = pressure[velocity_u[ii].cell_numbers[0]].neighbors[2];
-          velocity_u[ii].neighbors[2] = ptv[idx2(pcell, 1, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_u.cell(ii, 0), 2);
+          topo.velocity_u.neighbor(ii, 2) = topo.ptv[idx2(pcell, 1, 6)];
         }
-      if (no_neighbor_u[2] && velocity_u[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_u[ii].cell_numbers[1]].neighbors[2] != -1) {
+      if (no_neighbor_u[2] && topo.velocity_u.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_u.cell(ii, 1), 2) != -1) {
           // y+ neighbor exists through pressure on right
           no_neighbor_u[2] = 0;
-          int pcell = pressure[velocity_u[ii].cell_numbers[1]].neighbors[2];
-          velocity_u[ii].neighbors[2] = ptv[idx2(pcell, 0, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_u.cell(ii, 1), 2);
+          topo.velocity_u.neighbor(ii, 2) = topo.ptv[idx2(pcell, 0, 6)];
         }
-      if (no_neighbor_u[2]) velocity_u[ii].neighbors[2] = -1;
+      if (no_neighbor_u[2]) topo.velocity_u.neighbor(ii, 2) = -1;
 
       //-- neighbor 3 (x- direction) --//
-      if (velocity_u[ii].cell_numbers[0] != -1) {
+      if (topo.velocity_u.cell(ii, 0) != -1) {
         no_neighbor_u[3] = 0;
-        velocity_u[ii].neighbors[3] = ptv[idx2(velocity_u[ii].cell_numbers[0], 0, 6)];
+        topo.velocity_u.neighbor(ii, 3) = topo.ptv[idx2(topo.velocity_u.cell(ii, 0), 0, 6)];
       }
-      if (no_neighbor_u[3]) velocity_u[ii].neighbors[3] = -1;
+      if (no_neighbor_u[3]) topo.velocity_u.neighbor(ii, 3) = -1;
 
       //-- neighbor 4 (z- direction) --//
-      if (velocity_u[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_u[ii].cell_numbers[0]].neighbors[4] != -1) {
+      if (topo.velocity_u.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_u.cell(ii, 0), 4) != -1) {
           // z- neighbor exists through pressure on left
           no_neighbor_u[4] = 0;
-          int pcell = pressure[velocity_u[ii].cell_numbers[0]].neighbors[4];
-          velocity_u[ii].neighbors[4] = ptv[idx2(pcell, 1, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_u.cell(ii, 0), 4);
+          topo.velocity_u.neighbor(ii, 4) = topo.ptv[idx2(pcell, 1, 6)];
         }
-      if (no_neighbor_u[4] && velocity_u[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_u[ii].cell_numbers[1]].neighbors[4] != -1) {
+      if (no_neighbor_u[4] && topo.velocity_u.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_u.cell(ii, 1), 4) != -1) {
           // z- neighbor exists through pressure on the right
           no_neighbor_u[4] = 0;
-          int pcell = pressure[velocity_u[ii].cell_numbers[1]].neighbors[4];
-          velocity_u[ii].neighbors[4] = ptv[idx2(pcell, 0, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_u.cell(ii, 1), 4);
+          topo.velocity_u.neighbor(ii, 4) = topo.ptv[idx2(pcell, 0, 6)];
         }
-      if (no_neighbor_u[4]) velocity_u[ii].neighbors[4] = -1;
+      if (no_neighbor_u[4]) topo.velocity_u.neighbor(ii, 4) = -1;
 
       //-- neighbor 5 (z+ direction) --//
-      if (velocity_u[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_u[ii].cell_numbers[0]].neighbors[5] != -1) {
+      if (topo.velocity_u.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_u.cell(ii, 0), 5) != -1) {
           // z+ neighbor exists through pressure on the left
           no_neighbor_u[5] = 0;
-          int pcell = pressure[velocity_u[ii].cell_numbers[0]].neighbors[5];
-          velocity_u[ii].neighbors[5] = ptv[idx2(pcell, 1, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_u.cell(ii, 0), 5);
+          topo.velocity_u.neighbor(ii, 5) = topo.ptv[idx2(pcell, 1, 6)];
         }
-      if (no_neighbor_u[5] && velocity_u[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_u[ii].cell_numbers[1]].neighbors[5] != -1) {
+      if (no_neighbor_u[5] && topo.velocity_u.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_u.cell(ii, 1), 5) != -1) {
           // z+ neighbor exists through pressure on the right
           no_neighbor_u[5] = 0;
-          int pcell = pressure[velocity_u[ii].cell_numbers[1]].neighbors[5];
-          velocity_u[ii].neighbors[5] = ptv[idx2(pcell, 0, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_u.cell(ii, 1), 5);
+          topo.velocity_u.neighbor(ii, 5) = topo.ptv[idx2(pcell, 0, 6)];
         }
-      if (no_neighbor_u[5]) velocity_u[ii].neighbors[5] = -1;
+      if (no_neighbor_u[5]) topo.velocity_u.neighbor(ii, 5) = -1;
 
     }
 
-#pragma omp for schedule(static,1) nowait // v loop
-    for (int ii = 0; ii < velocity_v.size(); ii++) {
+#pragma omp for schedule(static) nowait // v loop
+    for (int ii = 0; ii < topo.velocity_v.size(); ii++) {
       int no_neighbor_v[6] = { 1, 1, 1, 1, 1, 1 };
       //-- neighbor 0 --//
-      if (velocity_v[ii].cell_numbers[0] != -1) {
+      if (topo.velocity_v.cell(ii, 0) != -1) {
         no_neighbor_v[0] = 0;
-        velocity_v[ii].neighbors[0] = ptv[idx2(velocity_v[ii].cell_numbers[0], 2, 6)];
+        topo.velocity_v.neighbor(ii, 0) = topo.ptv[idx2(topo.velocity_v.cell(ii, 0), 2, 6)];
       }
-      if (no_neighbor_v[0]) velocity_v[ii].neighbors[0] = -1;
+      if (no_neighbor_v[0]) topo.velocity_v.neighbor(ii, 0) = -1;
 
       //-- neighbor 1 --//
-      if (velocity_v[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_v[ii].cell_numbers[0]].neighbors[1] != -1) {
+      if (topo.velocity_v.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_v.cell(ii, 0), 1) != -1) {
           // x+ neighbor exists through pressure in y- direction
           no_neighbor_v[1] = 0;
-          int pcell = pressure[velocity_v[ii].cell_numbers[0]].neighbors[1];
-          velocity_v[ii].neighbors[1] = ptv[idx2(pcell, 3, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_v.cell(ii, 0), 1);
+          topo.velocity_v.neighbor(ii, 1) = topo.ptv[idx2(pcell, 3, 6)];
         }
-      if (no_neighbor_v[1] && velocity_v[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_v[ii].cell_numbers[1]].neighbors[1] != -1) {
+      if (no_neighbor_v[1] && topo.velocity_v.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_v.cell(ii, 1), 1) != -1) {
           // x+ neighbor exists through pressure in y+ direction
           no_neighbor_v[1] = 0;
-          int pcell = pressure[velocity_v[ii].cell_numbers[1]].neighbors[1];
-          velocity_v[ii].neighbors[1] = ptv[idx2(pcell, 2, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_v.cell(ii, 1), 1);
+          topo.velocity_v.neighbor(ii, 1) = topo.ptv[idx2(pcell, 2, 6)];
         }
-      if (no_neighbor_v[1]) velocity_v[ii].neighbors[1] = -1;
+      if (no_neighbor_v[1]) topo.velocity_v.neighbor(ii, 1) = -1;
 
       //-- neighbor 2 --//
-      if (velocity_v[ii].cell_numbers[1] != -1) {
+      if (topo.velocity_v.cell(ii, 1) != -1) {
         no_neighbor_v[2] = 0;
-        velocity_v[ii].neighbors[2] = ptv[idx2(velocity_v[ii].cell_numbers[1], 3, 6)];
+        topo.velocity_v.neighbor(ii, 2) = topo.ptv[idx2(topo.velocity_v.cell(ii, 1), 3, 6)];
       }
-      if (no_neighbor_v[2]) velocity_v[ii].neighbors[2] = -1;
+      if (no_neighbor_v[2]) topo.velocity_v.neighbor(ii, 2) = -1;
 
       //-- neighbor 3 --//
-      if (velocity_v[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_v[ii].cell_numbers[0]].neighbors[3] != -1) {
+      if (topo.velocity_v.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_v.cell(ii, 0), 3) != -1) {
           // x- neighbor exists through pressure in y- direction
           no_neighbor_v[3] = 0;
-          int pcell = pressure[velocity_v[ii].cell_numbers[0]].neighbors[3];
-          velocity_v[ii].neighbors[3] = ptv[idx2(pcell, 3, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_v.cell(ii, 0), 3);
+          topo.velocity_v.neighbor(ii, 3) = topo.ptv[idx2(pcell, 3, 6)];
         }
-      if (no_neighbor_v[3] && velocity_v[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_v[ii].cell_numbers[1]].neighbors[3] != -1) {
+      if (no_neighbor_v[3] && topo.velocity_v.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_v.cell(ii, 1), 3) != -1) {
           // x- neighbor exists through pressure in y+ direction
           no_neighbor_v[3] = 0;
-          int pcell = pressure[velocity_v[ii].cell_numbers[1]].neighbors[3];
-          velocity_v[ii].neighbors[3] = ptv[idx2(pcell, 2, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_v.cell(ii, 1), 3);
+          topo.velocity_v.neighbor(ii, 3) = topo.ptv[idx2(pcell, 2, 6)];
         }
-      if (no_neighbor_v[3]) velocity_v[ii].neighbors[3] = -1;
+      if (no_neighbor_v[3]) topo.velocity_v.neighbor(ii, 3) = -1;
 
       //-- neighbor 4 --//
-      if (velocity_v[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_v[ii].cell_numbers[0]].neighbors[4] != -1) {
+      if (topo.velocity_v.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_v.cell(ii, 0), 4) != -1) {
           // z- neighbor exists through pressure in y- direction
           no_neighbor_v[4] = 0;
-          int pcell = pressure[velocity_v[ii].cell_numbers[0]].neighbors[4];
-          velocity_v[ii].neighbors[4] = ptv[idx2(pcell, 3, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_v.cell(ii, 0), 4);
+          topo.velocity_v.neighbor(ii, 4) = topo.ptv[idx2(pcell, 3, 6)];
         }
-      if (no_neighbor_v[4] && velocity_v[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_v[ii].cell_numbers[1]].neighbors[4] != -1) {
+      if (no_neighbor_v[4] && topo.velocity_v.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_v.cell(ii, 1), 4) != -1) {
           // z- neighbor exists through pressure in y+ direction
           no_neighbor_v[4] = 0;
-          int pcell = pressure[velocity_v[ii].cell_numbers[1]].neighbors[4];
-          velocity_v[ii].neighbors[4] = ptv[idx2(pcell, 2, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_v.cell(ii, 1), 4);
+          topo.velocity_v.neighbor(ii, 4) = topo.ptv[idx2(pcell, 2, 6)];
         }
-      if (no_neighbor_v[4]) velocity_v[ii].neighbors[4] = -1;
+      if (no_neighbor_v[4]) topo.velocity_v.neighbor(ii, 4) = -1;
 
       //-- neighbor 5 --//
-      if (velocity_v[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_v[ii].cell_numbers[0]].neighbors[5] != -1) {
+      if (topo.velocity_v.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_v.cell(ii, 0), 5) != -1) {
           // z+ neighbor exists through pressure in y- direction
-          no_neighbor_v[4] = 0;
-          int pcell = pressure[velocity_v[ii].cell_numbers[0]].neighbors[5];
-          velocity_v[ii].neighbors[5] = ptv[idx2(pcell, 3, 6)];
+          no_neighbor_v[5] = 0;
+          int pcell = topo.pressure.neighbor(topo.velocity_v.cell(ii, 0), 5);
+          topo.velocity_v.neighbor(ii, 5) = topo.ptv[idx2(pcell, 3, 6)];
         }
-      if (no_neighbor_v[5] && velocity_v[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_v[ii].cell_numbers[1]].neighbors[5] != -1) {
+      if (no_neighbor_v[5] && topo.velocity_v.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_v.cell(ii, 1), 5) != -1) {
           // z+ neighbor exists through pressure in y+ direction
           no_neighbor_v[5] = 0;
-          int pcell = pressure[velocity_v[ii].cell_numbers[1]].neighbors[5];
-          velocity_v[ii].neighbors[5] = ptv[idx2(pcell, 2, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_v.cell(ii, 1), 5);
+          topo.velocity_v.neighbor(ii, 5) = topo.ptv[idx2(pcell, 2, 6)];
         }
-      if (no_neighbor_v[5]) velocity_v[ii].neighbors[5] = -1;
+      if (no_neighbor_v[5]) topo.velocity_v.neighbor(ii, 5) = -1;
 
     }
 
-#pragma omp for schedule(static,1) nowait // w loop
-    for (int ii = 0; ii < velocity_w.size(); ii++) {
+#pragma omp for schedule(static) nowait // w loop
+    for (int ii = 0; ii < topo.velocity_w.size(); ii++) {
       int no_neighbor_w[6] = { 1, 1, 1, 1, 1, 1 };
       //-- neighbor 0 (y- direction) --//
-      if (velocity_w[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_w[ii].cell_numbers[0]].neighbors[0] != -1) {
+      if (topo.velocity_w.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_w.cell(ii, 0), 0) != -1) {
           no_neighbor_w[0] = 0;
-          int pcell = pressure[velocity_w[ii].cell_numbers[0]].neighbors[0];
-          velocity_w[ii].neighbors[0] = ptv[idx2(pcell, 5, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_w.cell(ii, 0), 0);
+          topo.velocity_w.neighbor(ii, 0) = topo.ptv[idx2(pcell, 5, 6)];
         }
-      if (no_neighbor_w[0] && velocity_w[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_w[ii].cell_numbers[1]].neighbors[0] != -1) {
+      if (no_neighbor_w[0] && topo.velocity_w.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_w.cell(ii, 1), 0) != -1) {
           no_neighbor_w[0] = 0;
-          int pcell = pressure[velocity_w[ii].cell_numbers[1]].neighbors[0];
-          velocity_w[ii].neighbors[0] = ptv[idx2(pcell, 4, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_w.cell(ii, 1), 0);
+          topo.velocity_w.neighbor(ii, 0) = topo.ptv[idx2(pcell, 4, 6)];
         }
-      if (no_neighbor_w[0]) velocity_w[ii].neighbors[0] = -1;
+      if (no_neighbor_w[0]) topo.velocity_w.neighbor(ii, 0) = -1;
 
       //-- neighbor 1 (x+ direction) --//
-      if (velocity_w[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_w[ii].cell_numbers[0]].neighbors[1] != -1) {
+      if (topo.velocity_w.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_w.cell(ii, 0), 1) != -1) {
           no_neighbor_w[1] = 0;
-          int pcell = pressure[velocity_w[ii].cell_numbers[0]].neighbors[1];
-          velocity_w[ii].neighbors[1] = ptv[idx2(pcell, 5, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_w.cell(ii, 0), 1);
+          topo.velocity_w.neighbor(ii, 1) = topo.ptv[idx2(pcell, 5, 6)];
         }
-      if (no_neighbor_w[1] && velocity_w[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_w[ii].cell_numbers[1]].neighbors[1] != -1) {
+      if (no_neighbor_w[1] && topo.velocity_w.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_w.cell(ii, 1), 1) != -1) {
           no_neighbor_w[1] = 0;
-          int pcell = pressure[velocity_w[ii].cell_numbers[1]].neighbors[1];
-          velocity_w[ii].neighbors[1] = ptv[idx2(pcell, 4, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_w.cell(ii, 1), 1);
+          topo.velocity_w.neighbor(ii, 1) = topo.ptv[idx2(pcell, 4, 6)];
         }
-      if (no_neighbor_w[1]) velocity_w[ii].neighbors[1] = -1;
+      if (no_neighbor_w[1]) topo.velocity_w.neighbor(ii, 1) = -1;
 
       //-- neighbor 2 (y+ direction) --//
-      if (velocity_w[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_w[ii].cell_numbers[0]].neighbors[2] != -1) {
+      if (topo.velocity_w.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_w.cell(ii, 0), 2) != -1) {
           no_neighbor_w[2] = 0;
-          int pcell = pressure[velocity_w[ii].cell_numbers[0]].neighbors[2];
-          velocity_w[ii].neighbors[2] = ptv[idx2(pcell, 5, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_w.cell(ii, 0), 2);
+          topo.velocity_w.neighbor(ii, 2) = topo.ptv[idx2(pcell, 5, 6)];
         }
-      if (no_neighbor_w[2] && velocity_w[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_w[ii].cell_numbers[1]].neighbors[2] != -1) {
+      if (no_neighbor_w[2] && topo.velocity_w.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_w.cell(ii, 1), 2) != -1) {
           no_neighbor_w[2] = 0;
-          int pcell = pressure[velocity_w[ii].cell_numbers[1]].neighbors[2];
-          velocity_w[ii].neighbors[2] = ptv[idx2(pcell, 4, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_w.cell(ii, 1), 2);
+          topo.velocity_w.neighbor(ii, 2) = topo.ptv[idx2(pcell, 4, 6)];
         }
-      if (no_neighbor_w[2]) velocity_w[ii].neighbors[2] = -1;
+      if (no_neighbor_w[2]) topo.velocity_w.neighbor(ii, 2) = -1;
 
       //-- neighbor 3 (x- direction) --//
-      if (velocity_w[ii].cell_numbers[0] != -1)
-        if (pressure[velocity_w[ii].cell_numbers[0]].neighbors[3] != -1) {
+      if (topo.velocity_w.cell(ii, 0) != -1)
+        if (topo.pressure.neighbor(topo.velocity_w.cell(ii, 0), 3) != -1) {
           no_neighbor_w[3] = 0;
-          int pcell = pressure[velocity_w[ii].cell_numbers[0]].neighbors[3];
-          velocity_w[ii].neighbors[3] = ptv[idx2(pcell, 5, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_w.cell(ii, 0), 3);
+          topo.velocity_w.neighbor(ii, 3) = topo.ptv[idx2(pcell, 5, 6)];
         }
-      if (no_neighbor_w[3] && velocity_w[ii].cell_numbers[1] != -1)
-        if (pressure[velocity_w[ii].cell_numbers[1]].neighbors[3] != -1) {
+      if (no_neighbor_w[3] && topo.velocity_w.cell(ii, 1) != -1)
+        if (topo.pressure.neighbor(topo.velocity_w.cell(ii, 1), 3) != -1) {
           no_neighbor_w[3] = 0;
-          int pcell = pressure[velocity_w[ii].cell_numbers[1]].neighbors[3];
-          velocity_w[ii].neighbors[3] = ptv[idx2(pcell, 4, 6)];
+          int pcell = topo.pressure.neighbor(topo.velocity_w.cell(ii, 1), 3);
+          topo.velocity_w.neighbor(ii, 3) = topo.ptv[idx2(pcell, 4, 6)];
         }
-      if (no_neighbor_w[3]) velocity_w[ii].neighbors[3] = -1;
+      if (no_neighbor_w[3]) topo.velocity_w.neighbor(ii, 3) = -1;
 
       //-- neighbor 4 (z- direction) --//
-      if (velocity_w[ii].cell_numbers[0] != -1) {
+      if (topo.velocity_w.cell(ii, 0) != -1) {
         no_neighbor_w[4] = 0;
-        velocity_w[ii].neighbors[4] = ptv[idx2(velocity_w[ii].cell_numbers[0], 4, 6)];
+        topo.velocity_w.neighbor(ii, 4) = topo.ptv[idx2(topo.velocity_w.cell(ii, 0), 4, 6)];
       }
-      if (no_neighbor_w[4]) velocity_w[ii].neighbors[4] = -1;
+      if (no_neighbor_w[4]) topo.velocity_w.neighbor(ii, 4) = -1;
 
       //-- neighbor 5 (z+ direction) --//
-      if (velocity_w[ii].cell_numbers[1] != -1) {
+      if (topo.velocity_w.cell(ii, 1) != -1) {
         no_neighbor_w[5] = 0;
-        velocity_w[ii].neighbors[5] = ptv[idx2(velocity_w[ii].cell_numbers[1], 5, 6)];
+        topo.velocity_w.neighbor(ii, 5) = topo.ptv[idx2(topo.velocity_w.cell(ii, 1), 5, 6)];
       }
-      if (no_neighbor_w[5]) velocity_w[ii].neighbors[5] = -1;
+      if (no_neighbor_w[5]) topo.velocity_w.neighbor(ii, 5) = -1;
 
     }
   }
@@ -1,74 +1,183 @@
 #include "model_stokes.hpp"
 
 // 1d->2d index
-#define idx2(i, j, ldi) ((i * ldi) + j)
+#define idx2(i, j, ldi) (((hgf_index)i * ldi) + j)
 
 // 1d->3d index
 #define idx3(i, j, k, ldi1, ldi2) (k + (ldi2 * (j + ldi1 * i)))
 
+// position of the diagonal entry of a momentum row, columns are sorted within each row
+static inline hgf_index
+csr_diagonal(const array_csr& array, hgf_index row)
+{
+  const hgf_index* first = array.col_index.data() + array.row_ptr[row];
+  const hgf_index* last = array.col_index.data() + array.row_ptr[row + 1];
+  return (hgf_index)(std::lower_bound(first, last, row) - array.col_index.data());
+}
+
+// adds (sign = 1) or removes (sign = -1) the penalty ib_cell_penalty of the given pressure cells on their interior
+// velocity faces. A face shared by two cells in the list is penalized by both, as with the entries the penalization replaces.
+void
+hgf::models::stokes::penalize_cells(const std::vector< int >& cells, int sign)
+{
+  int n_comp = topology->velocity_u.dimension;
+  int dim_mult = 2 * n_comp;
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index shift_w = shift_v + topology->interior_v.count();
+  const bit_flags* interior[3] = { &topology->interior_u, &topology->interior_v, &topology->interior_w };
+  const std::vector< int >* nums[3] = { &topology->interior_u_nums, &topology->interior_v_nums, &topology->interior_w_nums };
+  hgf_index shift[3] = { 0, shift_v, shift_w };
+  int assembled = csr_array.n_rows;
+
+#pragma omp parallel for schedule(static)
+  for (int ii = 0; ii < (int)cells.size(); ii++) {
+    double penalty = sign * ib_cell_penalty[cells[ii]];
+    for (int jj = 0; jj < dim_mult; jj++) {
+      int dof = topology->ptv[idx2(cells[ii], jj, dim_mult)];
+      if (!(*interior[jj / 2])[dof]) continue;
+      int row = shift[jj / 2] + (*nums[jj / 2])[dof];
+#pragma omp atomic
+      ib_penalty[row] += penalty;
+      if (assembled) {
+        hgf_index pos = csr_diagonal(csr_array, row);
+#pragma omp atomic
+        csr_array.value[pos] += penalty;
+      }
+    }
+  }
+}
+
+/** \brief hgf::models::stokes::add_immersed_boundary turns pressure cells into immersed boundary cells.
+ *
+ * The penalization is added in parallel to the diagonal entries of the assembled csr_array, so the sparsity
+ * pattern does not change and the cost is proportional to the number of cells. Each cell keeps the penalty 1/eta
+ * it was added with, so cells added earlier with another eta are unchanged.
+ * @param[in] cells - pressure cells to convert, given by their index in pressure.
+ * @param[in] eta - penalization parameter for the immersed boundary.
+ */
+void
+hgf::models::stokes::add_immersed_boundary(const std::vector< int >& cells, double eta)
+{
+  require_full_system("add_immersed_boundary");
+  for (int ii = 0; ii < (int)cells.size(); ii++) {
+    pressure_ib_list[cells[ii]] = 1;
+    ib_cell_penalty[cells[ii]] = (double)1 / eta;
+  }
+  penalize_cells(cells, 1);
+}
+
+/** \brief hgf::models::stokes::remove_immersed_boundary returns immersed boundary cells to the fluid.
+ *
+ * Reverses hgf::models::stokes::add_immersed_boundary in place; cells must have been added once each.
+ * @param[in] cells - pressure cells to convert, given by their index in pressure.
+ */
+void
+hgf::models::stokes::remove_immersed_boundary(const std::vector< int >& cells)
+{
+  require_full_system("remove_immersed_boundary");
+  penalize_cells(cells, -1);
+  for (int ii = 0; ii < (int)cells.size(); ii++) {
+    pressure_ib_list[cells[ii]] = 0;
+    ib_cell_penalty[cells[ii]] = 0;
+  }
+}
+
+/** \brief hgf::models::stokes::brinkman applies a Stokes-Brinkman drag with a permeability given on each pressure cell.
+ *
+ * Cells with a positive permeability k model unresolved micro-porosity: the momentum equation of each interior
+ * velocity face gains the drag viscosity * u / k integrated over the half of each neighboring cell the face control
+ * volume covers. The drag is added in parallel to the diagonal of the assembled csr_array, replacing any field applied
+ * before, and follows the viscosity in hgf::models::stokes::reassemble. Cells with a permeability of zero or less are
+ * resolved fluid without drag, and an empty permeability removes the drag.
+ * @param[in] permeability - permeability of each pressure cell, ordered as pressure.
+ */
+void
+hgf::models::stokes::brinkman(const std::vector< double >& permeability)
+{
+  require_full_system("brinkman");
+  int n_comp = topology->velocity_u.dimension;
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index shift_w = shift_v + topology->interior_v.count();
+  hgf_index shift_p = (n_comp == 3) ? shift_w + topology->interior_w.count() : shift_w;
+  const dof_store* dofs[3] = { &topology->velocity_u, &topology->velocity_v, &topology->velocity_w };
+  const std::vector< int >* nums[3] = { &topology->interior_u_nums, &topology->interior_v_nums, &topology->interior_w_nums };
+  hgf_index shift[3] = { 0, shift_v, shift_w };
+
+  if (permeability.size() && permeability.size() != topology->pressure.size()) {
+    std::cout << "\nBrinkman permeability has " << permeability.size() << " values for " << topology->pressure.size() << " pressure cells. Exiting.\n";
+    exit(0);
+  }
+
+  // drag per unit viscosity, half a cell volume over the permeability of each cell next to the face
+  double half_volume = 0.5;
+  for (int kk = 0; kk < n_comp; kk++) half_volume *= topology->pressure.spacing[kk];
+  std::vector< double > drag;
+  if (permeability.size()) {
+    drag.assign(shift_p, 0.0);
+    for (int cc = 0; cc < n_comp; cc++) {
+#pragma omp parallel for schedule(static)
+      for (int ii = 0; ii < (int)dofs[cc]->size(); ii++) {
+        if ((*nums[cc])[ii] == -1) continue;
+        double sum = 0;
+        for (int ss = 0; ss < 2; ss++) {
+          int cell = dofs[cc]->cell(ii, ss);
+          if (cell != -1 && permeability[cell] > 0) sum += half_volume / permeability[cell];
+        }
+        drag[shift[cc] + (*nums[cc])[ii]] = sum;
+      }
+    }
+  }
+
+  // update the assembled diagonal by the change from the previous field
+  if (csr_array.n_rows) {
+#pragma omp parallel for schedule(static)
+    for (hgf_index row = 0; row < shift_p; row++) {
+      double delta = (drag.size() ? drag[row] : 0.0) - (brinkman_drag.size() ? brinkman_drag[row] : 0.0);
+      if (delta != 0) csr_array.value[csr_diagonal(csr_array, row)] += viscosity * delta;
+    }
+  }
+  brinkman_drag.swap(drag);
+}
+
+/** \brief hgf::models::stokes::import_brinkman applies a Stokes-Brinkman drag with a permeability map read from the problem folder.
+ *
+ * The map holds one permeability per voxel in the layout of Geometry.dat (see hgf::utility::import_voxel_field), in the
+ * length units of the geometry squared. Values on solid voxels are ignored, and zero marks resolved fluid.
+ * @param[in] par - parameters struct containing problem information.
+ * @param[in] file_name - name of the permeability map in par.problem_path, e.g. "Permeability.dat".
+ */
+void
+hgf::models::stokes::import_brinkman(const parameters& par, const std::string& file_name)
+{
+  std::vector< double > voxel_permeability, permeability;
+  hgf::utility::import_voxel_field(par, par.problem_path, file_name, voxel_permeability);
+  hgf::mesh::voxel_to_cell_field(par, voxel_permeability, permeability);
+  brinkman(permeability);
+}
+
 /** \brief hgf::models::stokes::immersed_boundary applies the immersed boundary given in the input geometry file to the Stokes linear system.
  *
+ * Cells that are already immersed boundary cells, e.g. from an earlier call or add_immersed_boundary, keep their penalty.
  * @param[in] par - parameters struct containing problem information.
  * @param[in] eta - penalization parameter for the immersed boundary. 
  */
 void
 hgf::models::stokes::immersed_boundary(const parameters& par, double eta)
 {
-
-  array_coo temp_coo;
-  temp_coo.value = (double)1 / eta;
-  int dim_mult = 2 * par.dimension;
-  int n_u = std::accumulate(interior_u.begin(), interior_u.end(), 0);
-  int n_v = std::accumulate(interior_v.begin(), interior_v.end(), 0);
+  std::vector< int > ib_cells;
 
   int void_node = -1;
   for (int ii = 0; ii < (int)par.voxel_geometry.size(); ii++) {
     if (par.voxel_geometry[ii] != 1) void_node++;
     if (par.voxel_geometry[ii] == 2) pressure_ib_list[void_node] = 1;
   }
-
-  for (int ib = 0; ib < (int)pressure.size(); ib++) {
-    if (pressure_ib_list[ib]) {
-      // u component
-      if (interior_u[ptv[idx2(ib, 0, dim_mult)]]) {
-        temp_coo.i_index = interior_u_nums[ptv[idx2(ib, 0, dim_mult)]];
-        temp_coo.j_index = interior_u_nums[ptv[idx2(ib, 0, dim_mult)]];
-        coo_array.push_back(temp_coo);
-      }
-      if (interior_u[ptv[idx2(ib, 1, dim_mult)]]) {
-        temp_coo.i_index = interior_u_nums[ptv[idx2(ib, 1, dim_mult)]];
-        temp_coo.j_index = interior_u_nums[ptv[idx2(ib, 1, dim_mult)]];
-        coo_array.push_back(temp_coo);
-      }
-
-      // v component
-      if (interior_v[ptv[idx2(ib, 2, dim_mult)]]) {
-        temp_coo.i_index = interior_v_nums[ptv[idx2(ib, 2, dim_mult)]] + n_u;
-        temp_coo.j_index = interior_v_nums[ptv[idx2(ib, 2, dim_mult)]] + n_u;
-        coo_array.push_back(temp_coo);
-      }
-      if (interior_v[ptv[idx2(ib, 3, dim_mult)]]) {
-        temp_coo.i_index = interior_v_nums[ptv[idx2(ib, 3, dim_mult)]] + n_u;
-        temp_coo.j_index = interior_v_nums[ptv[idx2(ib, 3, dim_mult)]] + n_u;
-        coo_array.push_back(temp_coo);
-      }
-
-      // w component
-      if (par.dimension == 3) {
-        if (interior_w[ptv[idx2(ib, 4, dim_mult)]]) {
-          temp_coo.i_index = interior_w_nums[ptv[idx2(ib, 4, dim_mult)]] + n_u + n_v;
-          temp_coo.j_index = interior_w_nums[ptv[idx2(ib, 4, dim_mult)]] + n_u + n_v;
-          coo_array.push_back(temp_coo);
-        }
-        if (interior_w[ptv[idx2(ib, 5, dim_mult)]]) {
-          temp_coo.i_index = interior_w_nums[ptv[idx2(ib, 5, dim_mult)]] + n_u + n_v;
-          temp_coo.j_index = interior_w_nums[ptv[idx2(ib, 5, dim_mult)]] + n_u + n_v;
-          coo_array.push_back(temp_coo);
-        }
-      }
-    }
+  for (int ib = 0; ib < (int)topology->pressure.size(); ib++) {
+    if (pressure_ib_list[ib] && ib_cell_penalty[ib] == 0) ib_cells.push_back(ib);
   }
 
+  // add the penalization to the linear system
+  add_immersed_boundary(ib_cells, eta);
+
 }
 
 /** \brief hgf::models::stokes::random_immersed_boundary generates random immersed boundary cells until vol_frac% of the domain is covered, and applies the associated immersed boundary to the Stokes linear system.
@@ -80,8 +189,8 @@ hgf::models::stokes::immersed_boundary(const parameters& par, double eta)
 void
 hgf::models::stokes::random_immersed_boundary(const parameters& par, double eta, double vol_frac)
 {
-  std::vector< unsigned long > temp_list;
-  int n_flow = (int)pressure.size();
+  std::vector< int > temp_list;
+  int n_flow = (int)topology->pressure.size();
 
   int n_switch = (int)((vol_frac / 100) * n_flow);
   // nothing to do if domain is too small to fill vol_frac% of flow cells with IB
@@ -99,54 +208,8 @@ new_ib_cell:
   temp_list.push_back(seed_cell);        // new ibs tracker
   if (n_switched < n_switch) goto new_ib_cell;
 
-  // add ibs to array
-  array_coo temp_coo;
-  temp_coo.value = (double)1 / eta;
-  int ib;
-  int dim_mult = 2 * par.dimension;
-  int n_u = std::accumulate(interior_u.begin(), interior_u.end(), 0);
-  int n_v = std::accumulate(interior_v.begin(), interior_v.end(), 0);
-
-  for (int ii = 0; ii < (int)temp_list.size(); ii++) {
-    ib = temp_list[ii];
-    // u component
-    if (interior_u[ptv[idx2(ib, 0, dim_mult)]]) {
-      temp_coo.i_index = interior_u_nums[ptv[idx2(ib, 0, dim_mult)]];
-      temp_coo.j_index = interior_u_nums[ptv[idx2(ib, 0, dim_mult)]];
-      coo_array.push_back(temp_coo);
-    }
-    if (interior_u[ptv[idx2(ib, 1, dim_mult)]]) {
-      temp_coo.i_index = interior_u_nums[ptv[idx2(ib, 1, dim_mult)]];
-      temp_coo.j_index = interior_u_nums[ptv[idx2(ib, 1, dim_mult)]];
-      coo_array.push_back(temp_coo);
-    }
-
-    // v component
-    if (interior_v[ptv[idx2(ib, 2, dim_mult)]]) {
-      temp_coo.i_index = interior_v_nums[ptv[idx2(ib, 2, dim_mult)]] + n_u;
-      temp_coo.j_index = interior_v_nums[ptv[idx2(ib, 2, dim_mult)]] + n_u;
-      coo_array.push_back(temp_coo);
-    }
-    if (interior_v[ptv[idx2(ib, 3, dim_mult)]]) {
-      temp_coo.i_index = interior_v_nums[ptv[idx2(ib, 3, dim_mult)]] + n_u;
-      temp_coo.j_index = interior_v_nums[ptv[idx2(ib, 3, dim_mult)]] + n_u;
-      coo_array.push_back(temp_coo);
-    }
-
-    // w component
-    if (par.dimension == 3) {
-      if (interior_w[ptv[idx2(ib, 4, dim_mult)]]) {
-        temp_coo.i_index = interior_w_nums[ptv[idx2(ib, 4, dim_mult)]] + n_u + n_v;
-        temp_coo.j_index = interior_w_nums[ptv[idx2(ib, 4, dim_mult)]] + n_u + n_v;
-        coo_array.push_back(temp_coo);
-      }
-      if (interior_w[ptv[idx2(ib, 5, dim_mult)]]) {
-        temp_coo.i_index = interior_w_nums[ptv[idx2(ib, 5, dim_mult)]] + n_u + n_v;
-        temp_coo.j_index = interior_w_nums[ptv[idx2(ib, 5, dim_mult)]] + n_u + n_v;
-        coo_array.push_back(temp_coo);
-      }
-    }
-  }
+  // add the penalization to the linear system
+  add_immersed_boundary(temp_list, eta);
 
 }
 
@@ -160,8 +223,8 @@ new_ib_cell:
 int
 hgf::models::stokes::random_immersed_boundary_clump(const parameters& par, double eta, double vol_frac, double likelihood)
 {
-  std::vector< unsigned long > temp_list;
-  int n_flow = (int)pressure.size();
+  std::vector< int > temp_list;
+  int n_flow = (int)topology->pressure.size();
   int FAIL_MAX = n_flow;
   int nfails = 0; // track failed attempts to plant ib cells. exits with failure after FAIL_MAX faklures
 
@@ -191,15 +254,15 @@ new_ib_cell:
 ib_clump_cell:
   seed_cell = rand() % temp_list.size(); // pick a current ib cell
   seed_nbr = rand() % par.dimension*2;
-  if (pressure[seed_cell].neighbors[seed_nbr] == -1) {
+  if (topology->pressure.neighbor(seed_cell, seed_nbr) == -1) {
     goto toss_coin; // the seed cell doesn't have the appropriate neighbor
   }
-  if (pressure_ib_list[pressure[seed_cell].neighbors[seed_nbr]]) {
+  if (pressure_ib_list[topology->pressure.neighbor(seed_cell, seed_nbr)]) {
     nfails++;
     goto toss_coin; // already an IB cell
   }
   n_switched++;
-  pressure_ib_list[pressure[seed_cell].neighbors[seed_nbr]] = 1;
+  pressure_ib_list[topology->pressure.neighbor(seed_cell, seed_nbr)] = 1;
   if (n_switched < n_switch) goto toss_coin;
   else goto set_ib;
 
@@ -210,54 +273,8 @@ toss_coin:
   else goto ib_clump_cell;
 
 set_ib:
-  // add ibs to array
-  array_coo temp_coo;
-  temp_coo.value = (double)1 / eta;
-  int ib;
-  int dim_mult = 2 * par.dimension;
-  int n_u = std::accumulate(interior_u.begin(), interior_u.end(), 0);
-  int n_v = std::accumulate(interior_v.begin(), interior_v.end(), 0);
-
-  for (int ii = 0; ii < (int)temp_list.size(); ii++) {
-    ib = temp_list[ii];
-    // u component
-    if (interior_u[ptv[idx2(ib, 0, dim_mult)]]) {
-      temp_coo.i_index = interior_u_nums[ptv[idx2(ib, 0, dim_mult)]];
-      temp_coo.j_index = interior_u_nums[ptv[idx2(ib, 0, dim_mult)]];
-      coo_array.push_back(temp_coo);
-    }
-    if (interior_u[ptv[idx2(ib, 1, dim_mult)]]) {
-      temp_coo.i_index = interior_u_nums[ptv[idx2(ib, 1, dim_mult)]];
-      temp_coo.j_index = interior_u_nums[ptv[idx2(ib, 1, dim_mult)]];
-      coo_array.push_back(temp_coo);
-    }
-
-    // v component
-    if (interior_v[ptv[idx2(ib, 2, dim_mult)]]) {
-      temp_coo.i_index = interior_v_nums[ptv[idx2(ib, 2, dim_mult)]] + n_u;
-      temp_coo.j_index = interior_v_nums[ptv[idx2(ib, 2, dim_mult)]] + n_u;
-      coo_array.push_back(temp_coo);
-    }
-    if (interior_v[ptv[idx2(ib, 3, dim_mult)]]) {
-      temp_coo.i_index = interior_v_nums[ptv[idx2(ib, 3, dim_mult)]] + n_u;
-      temp_coo.j_index = interior_v_nums[ptv[idx2(ib, 3, dim_mult)]] + n_u;
-      coo_array.push_back(temp_coo);
-    }
-
-    // w component
-    if (par.dimension == 3) {
-      if (interior_w[ptv[idx2(ib, 4, dim_mult)]]) {
-        temp_coo.i_index = interior_w_nums[ptv[idx2(ib, 4, dim_mult)]] + n_u + n_v;
-        temp_coo.j_index = interior_w_nums[ptv[idx2(ib, 4, dim_mult)]] + n_u + n_v;
-        coo_array.push_back(temp_coo);
-      }
-      if (interior_w[ptv[idx2(ib, 5, dim_mult)]]) {
-        temp_coo.i_index = interior_w_nums[ptv[idx2(ib, 5, dim_mult)]] + n_u + n_v;
-        temp_coo.j_index = interior_w_nums[ptv[idx2(ib, 5, dim_mult)]] + n_u + n_v;
-        coo_array.push_back(temp_coo);
-      }
-    }
-  }
+  // add the penalization to the linear system
+  add_immersed_boundary(temp_list, eta);
 
   return 0;
 }
@@ -271,54 +288,15 @@ set_ib:
 void
 hgf::models::stokes::import_immersed_boundary(parameters& par, std::vector< int >& input_ib, double eta)
 {
+  std::vector< int > ib_cells;
   pressure_ib_list = input_ib;
-  array_coo temp_coo;
-  temp_coo.value = (double)1 / eta;
-  int dim_mult = par.dimension * 2;
-  int n_u = std::accumulate(interior_u.begin(), interior_u.end(), 0);
-  int n_v = std::accumulate(interior_v.begin(), interior_v.end(), 0);
-
-  for (int ib = 0; ib < (int)pressure.size(); ib++) {
-    if (pressure_ib_list[ib]) {
-      // u component
-      if (interior_u[ptv[idx2(ib, 0, dim_mult)]]) {
-        temp_coo.i_index = interior_u_nums[ptv[idx2(ib, 0, dim_mult)]];
-        temp_coo.j_index = interior_u_nums[ptv[idx2(ib, 0, dim_mult)]];
-        coo_array.push_back(temp_coo);
-      }
-      if (interior_u[ptv[idx2(ib, 1, dim_mult)]]) {
-        temp_coo.i_index = interior_u_nums[ptv[idx2(ib, 1, dim_mult)]];
-        temp_coo.j_index = interior_u_nums[ptv[idx2(ib, 1, dim_mult)]];
-        coo_array.push_back(temp_coo);
-      }
+  for (int ib = 0; ib < (int)topology->pressure.size(); ib++) {
+    if (pressure_ib_list[ib] && ib_cell_penalty[ib] == 0) ib_cells.push_back(ib);
+  }
 
-      // v component
-      if (interior_v[ptv[idx2(ib, 2, dim_mult)]]) {
-        temp_coo.i_index = interior_v_nums[ptv[idx2(ib, 2, dim_mult)]] + n_u;
-        temp_coo.j_index = interior_v_nums[ptv[idx2(ib, 2, dim_mult)]] + n_u;
-        coo_array.push_back(temp_coo);
-      }
-      if (interior_v[ptv[idx2(ib, 3, dim_mult)]]) {
-        temp_coo.i_index = interior_v_nums[ptv[idx2(ib, 3, dim_mult)]] + n_u;
-        temp_coo.j_index = interior_v_nums[ptv[idx2(ib, 3, dim_mult)]] + n_u;
-        coo_array.push_back(temp_coo);
-      }
+  // add the penalization to the linear system
+  add_immersed_boundary(ib_cells, eta);
 
-      // w component
-      if (par.dimension == 3) {
-        if (interior_w[ptv[idx2(ib, 4, dim_mult)]]) {
-          temp_coo.i_index = interior_w_nums[ptv[idx2(ib, 4, dim_mult)]] + n_u + n_v;
-          temp_coo.j_index = interior_w_nums[ptv[idx2(ib, 4, dim_mult)]] + n_u + n_v;
-          coo_array.push_back(temp_coo);
-        }
-        if (interior_w[ptv[idx2(ib, 5, dim_mult)]]) {
-          temp_coo.i_index = interior_w_nums[ptv[idx2(ib, 5, dim_mult)]] + n_u + n_v;
-          temp_coo.j_index = interior_w_nums[ptv[idx2(ib, 5, dim_mult)]] + n_u + n_v;
-          coo_array.push_back(temp_coo);
-        }
-      }
-    }
-  }
 }
 
 /** \brief hgf::models::stokes::write_geometry saves the geometry from a flow simulation to a .dat file.
@@ -375,3 +353,157 @@ hgf::models::stokes::write_geometry(const parameters& par, std::string& file_nam
  
 }
 
+
+/** \brief hgf::models::stokes::eliminate_immersed_boundary removes immersed boundary unknowns from the linear system instead of penalizing them.
+ *
+ * Velocity degrees of freedom on faces between two immersed boundary cells, and the pressure of immersed boundary
+ * cells, are fixed at zero and their rows and columns are dropped from csr_array, rhs and solution_int. Faces between
+ * immersed boundary and fluid cells keep their penalty, and immersed boundary regions touching an inflow or outflow boundary are kept. Call after the boundary conditions are set
+ * and before solving; hgf::models::stokes::solution_build maps the reduced solution back to the full numbering, and
+ * hgf::models::stokes::block_sizes gives the block sizes of the reduced system for block preconditioners.
+ * The boundary condition, immersed boundary, Brinkman and reassembly functions, and the matrix-free hgf::models::stokes::apply
+ * and operator_diagonal, exit afterwards until the model is built again, since they act on the full numbering.
+ */
+void
+hgf::models::stokes::eliminate_immersed_boundary(void)
+{
+  if (!csr_array.n_rows) {
+    std::cout << "\nImmersed boundary elimination requires csr_array, build with assemble = 1. Exiting.\n";
+    exit(0);
+  }
+  if (reduced_rows.size()) return;
+
+  int n_comp = topology->velocity_u.dimension;
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index shift_w = shift_v + topology->interior_v.count();
+  hgf_index shift_p = (n_comp == 3) ? shift_w + topology->interior_w.count() : shift_w;
+  hgf_index n_rows = csr_array.n_rows;
+  const dof_store* dofs[3] = { &topology->velocity_u, &topology->velocity_v, &topology->velocity_w };
+  const std::vector< int >* nums[3] = { &topology->interior_u_nums, &topology->interior_v_nums, &topology->interior_w_nums };
+  hgf_index shift[4] = { 0, shift_v, shift_w, shift_p };
+
+  // immersed boundary cells that are eliminated. Cells with a face on an inflow or outflow boundary, and the
+  // immersed boundary cells connected to them, are kept so the flux through that face is balanced as before
+  int offset[3] = { 0, (int)dofs[0]->size(), (int)(dofs[0]->size() + dofs[1]->size()) };
+  std::vector< int > removed(pressure_ib_list.begin(), pressure_ib_list.end());
+  std::vector< int > kept_ib;
+  for (int ii = 0; ii < (int)topology->pressure.size(); ii++) {
+    if (!removed[ii] || !boundary.size()) continue;
+    for (int jj = 0; jj < 2 * n_comp; jj++) {
+      int dof = topology->ptv[idx2(ii, jj, 2 * n_comp)];
+      if ((*nums[jj / 2])[dof] != -1) continue;
+      const boundary_nodes& bnode = boundary[offset[jj / 2] + dof];
+      if (bnode.type != 1 || bnode.value != 0) {
+        removed[ii] = 0;
+        kept_ib.push_back(ii);
+        break;
+      }
+    }
+  }
+  while (kept_ib.size()) {
+    int cell = kept_ib.back();
+    kept_ib.pop_back();
+    for (int jj = 0; jj < topology->pressure.n_neighbors; jj++) {
+      int nbr = topology->pressure.neighbor(cell, jj);
+      if (nbr > -1 && removed[nbr]) {
+        removed[nbr] = 0;
+        kept_ib.push_back(nbr);
+      }
+    }
+  }
+
+  // flag the rows that are kept, velocities between two eliminated cells and the eliminated pressures are dropped
+  std::vector< int > keep(n_rows, 1);
+  for (int cc = 0; cc < n_comp; cc++) {
+#pragma omp parallel for schedule(static)
+    for (int ii = 0; ii < (int)dofs[cc]->size(); ii++) {
+      if ((*nums[cc])[ii] == -1) continue;
+      int lower = dofs[cc]->cell(ii, 0);
+      int upper = dofs[cc]->cell(ii, 1);
+      if (lower != -1 && upper != -1 && removed[lower] && removed[upper]) keep[shift[cc] + (*nums[cc])[ii]] = 0;
+    }
+  }
+#pragma omp parallel for schedule(static)
+  for (int ii = 0; ii < (int)topology->pressure.size(); ii++) {
+    if (removed[ii]) keep[shift_p + ii] = 0;
+  }
+
+  // new numbering, and the size of each block of the reduced system
+  reduced_rows.assign(n_rows, -1);
+  hgf_index n_kept = 0;
+  for (int bb = 0; bb < 4; bb++) {
+    hgf_index start = n_kept;
+    hgf_index end = (bb < 3) ? shift[bb + 1] : n_rows;
+    for (hgf_index row = shift[bb]; row < end; row++) {
+      if (keep[row]) reduced_rows[row] = n_kept++;
+    }
+    reduced_block[bb] = n_kept - start;
+  }
+
+  // compress the rows and columns of csr_array
+  std::vector< hgf_index > row_ptr(n_kept + 1, 0);
+#pragma omp parallel for schedule(static)
+  for (hgf_index row = 0; row < n_rows; row++) {
+    if (reduced_rows[row] == -1) continue;
+    int count = 0;
+    for (hgf_index jj = csr_array.row_ptr[row]; jj < csr_array.row_ptr[row + 1]; jj++) {
+      if (reduced_rows[csr_array.col_index[jj]] != -1) count++;
+    }
+    row_ptr[reduced_rows[row] + 1] = count;
+  }
+  for (hgf_index row = 0; row < n_kept; row++) row_ptr[row + 1] += row_ptr[row];
+
+  std::vector< hgf_index > col_index(row_ptr[n_kept]);
+  std::vector< double > value(row_ptr[n_kept]);
+  std::vector< unsigned char > source(row_ptr[n_kept]);
+  std::vector< double > new_rhs(n_kept), new_solution(n_kept);
+#pragma omp parallel for schedule(static)
+  for (hgf_index row = 0; row < n_rows; row++) {
+    hgf_index new_row = reduced_rows[row];
+    if (new_row == -1) continue;
+    hgf_index pos = row_ptr[new_row];
+    for (hgf_index jj = csr_array.row_ptr[row]; jj < csr_array.row_ptr[row + 1]; jj++) {
+      hgf_index col = reduced_rows[csr_array.col_index[jj]];
+      if (col == -1) continue;
+      col_index[pos] = col;
+      value[pos] = csr_array.value[jj];
+      source[pos++] = csr_source[jj];
+    }
+    new_rhs[new_row] = rhs[row];
+    new_solution[new_row] = solution_int[row];
+  }
+
+  csr_array.n_rows = n_kept;
+  csr_array.n_cols = n_kept;
+  csr_array.row_ptr.swap(row_ptr);
+  csr_array.col_index.swap(col_index);
+  csr_array.value.swap(value);
+  csr_source.swap(source);
+  rhs.swap(new_rhs);
+  solution_int.swap(new_solution);
+}
+
+/** \brief hgf::models::stokes::block_sizes gives the number of u, v, w and pressure unknowns of the linear system.
+ *
+ * These are the interior counts of the degrees of freedom, or the reduced counts after hgf::models::stokes::eliminate_immersed_boundary.
+ * @param[out] n_u - number of x-velocity unknowns.
+ * @param[out] n_v - number of y-velocity unknowns.
+ * @param[out] n_w - number of z-velocity unknowns, 0 in 2d.
+ * @param[out] n_p - number of pressure unknowns.
+ */
+void
+hgf::models::stokes::block_sizes(hgf_index& n_u, hgf_index& n_v, hgf_index& n_w, hgf_index& n_p) const
+{
+  if (reduced_rows.size()) {
+    n_u = reduced_block[0];
+    n_v = reduced_block[1];
+    n_w = reduced_block[2];
+    n_p = reduced_block[3];
+  }
+  else {
+    n_u = topology->interior_u.count();
+    n_v = topology->interior_v.count();
+    n_w = (topology->velocity_u.dimension == 3) ? topology->interior_w.count() : 0;
+    n_p = (int)topology->pressure.size();
+  }
+}
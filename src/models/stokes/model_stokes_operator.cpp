@@ -0,0 +1,282 @@
+/* stokes matrix-free operator source */
+
+// hgf includes
+#include "model_stokes.hpp"
+
+// 1d->2d index
+#define idx2(i, j, ldi) (((hgf_index)i * ldi) + j)
+
+// lattice axis crossed by each neighbor slot (y-, x+, y+, x-, z-, z+)
+static const int neighbor_axis[6] = { 1, 0, 1, 0, 2, 2 };
+
+// stencil of one velocity component on the uniform lattice, matching momentum_2d / momentum_3d.
+// coef[jj] is the coupling to neighbor slot jj, area the face area multiplying the pressure gradient.
+static void
+velocity_stencil(const dof_store& dofs, double viscosity, double coef[6], double& area)
+{
+  const double* h = dofs.spacing;
+  if (dofs.dimension == 2) {
+    area = h[1 - dofs.axis];
+    for (int jj = 0; jj < 4; jj++) coef[jj] = viscosity * h[1 - neighbor_axis[jj]] / h[neighbor_axis[jj]];
+  }
+  else {
+    // face areas are taken normal to the component, as in the assembled system
+    area = 1.0;
+    for (int kk = 0; kk < 3; kk++) if (kk != dofs.axis) area *= h[kk];
+    for (int jj = 0; jj < 6; jj++) coef[jj] = viscosity * area / h[neighbor_axis[jj]];
+  }
+}
+
+// momentum rows of one velocity component, y = A_c x_c + G_c p
+static void
+apply_momentum(const dof_store& dofs, const bit_flags& interior, const std::vector< int >& nums, \
+  hgf_index shift, hgf_index shift_p, double viscosity, const std::vector< double >& x, std::vector< double >& y)
+{
+  double coef[6], area;
+  velocity_stencil(dofs, viscosity, coef, area);
+  int n_nbrs = dofs.n_neighbors;
+
+#pragma omp for schedule(static) nowait
+  for (int ii = 0; ii < (int)dofs.size(); ii++) {
+    if (nums[ii] == -1) continue;
+    double xi = x[shift + nums[ii]];
+    double sum = 0;
+    for (int jj = 0; jj < n_nbrs; jj++) {
+      int nbr = dofs.neighbor(ii, jj);
+      if (nbr > -1 && interior[nbr]) sum += coef[jj] * (xi - x[shift + nums[nbr]]);
+    }
+    sum += area * (x[shift_p + dofs.cell(ii, 1)] - x[shift_p + dofs.cell(ii, 0)]);
+    y[shift + nums[ii]] = sum;
+  }
+}
+
+/** \brief hgf::models::stokes::apply computes y = A x for the Stokes linear system without storing A.
+ *
+ * The interior momentum and continuity stencils are evaluated from the degree of freedom neighbor tables,
+ * the lattice spacing and the viscosity, the immersed boundary and Brinkman drag from their per-row terms, while boundary
+ * condition contributions are taken from the entries recorded by the setup functions. The result equals multiplication by csr_array,
+ * up to rounding, and is available whether or not build assembled csr_array. It applies the full system, so it
+ * cannot be used after hgf::models::stokes::eliminate_immersed_boundary.
+ * @param[in] x - vector ordered like solution_int.
+ * @param[out] y - product of the Stokes operator with x, resized to the system size.
+ */
+void
+hgf::models::stokes::apply(const std::vector< double >& x, std::vector< double >& y) const
+{
+  if (reduced_rows.size()) {
+    std::cout << "\nMatrix-free apply is not available after eliminate_immersed_boundary, use csr_array. Exiting.\n";
+    exit(0);
+  }
+  int dim_mult = 2 * topology->velocity_u.dimension;
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index shift_w = shift_v + topology->interior_v.count();
+  hgf_index shift_p = (dim_mult == 6) ? shift_w + topology->interior_w.count() : shift_w;
+  const dof_store* dofs[3] = { &topology->velocity_u, &topology->velocity_v, &topology->velocity_w };
+  const std::vector< int >* nums[3] = { &topology->interior_u_nums, &topology->interior_v_nums, &topology->interior_w_nums };
+  hgf_index shift[3] = { 0, shift_v, shift_w };
+
+  y.resize(operator_delta.n_rows);
+
+#pragma omp parallel
+  {
+    apply_momentum(topology->velocity_u, topology->interior_u, topology->interior_u_nums, 0, shift_p, viscosity, x, y);
+    apply_momentum(topology->velocity_v, topology->interior_v, topology->interior_v_nums, shift_v, shift_p, viscosity, x, y);
+    if (dim_mult == 6) apply_momentum(topology->velocity_w, topology->interior_w, topology->interior_w_nums, shift_w, shift_p, viscosity, x, y);
+
+    // continuity rows, lower faces enter with a positive sign
+#pragma omp for schedule(static)
+    for (int ii = 0; ii < (int)topology->pressure.size(); ii++) {
+      double sum = 0;
+      for (int cc = 0; cc < dim_mult / 2; cc++) {
+        double coef[6], area;
+        velocity_stencil(*dofs[cc], viscosity, coef, area);
+        int lower = (*nums[cc])[topology->ptv[idx2(ii, 2 * cc, dim_mult)]];
+        int upper = (*nums[cc])[topology->ptv[idx2(ii, 2 * cc + 1, dim_mult)]];
+        if (lower != -1) sum += area * x[shift[cc] + lower];
+        if (upper != -1) sum -= area * x[shift[cc] + upper];
+      }
+      y[shift_p + ii] = sum;
+    }
+
+    // boundary condition and immersed boundary contributions
+#pragma omp for schedule(static)
+    for (hgf_index row = 0; row < operator_delta.n_rows; row++) {
+      for (hgf_index jj = operator_delta.row_ptr[row]; jj < operator_delta.row_ptr[row + 1]; jj++) {
+        y[row] += operator_delta.value[jj] * x[operator_delta.col_index[jj]];
+      }
+      if (row < shift_p) y[row] += ib_penalty[row] * x[row];
+      if (brinkman_drag.size() && row < shift_p) y[row] += viscosity * brinkman_drag[row] * x[row];
+    }
+  }
+}
+
+/** \brief hgf::models::stokes::operator_diagonal extracts the diagonal of the Stokes linear system without storing it.
+ *
+ * Intended for Jacobi type preconditioning of matrix-free solves. Pressure rows have a zero diagonal except where
+ * a boundary condition contributes one; those rows are given the diagonal of the Schur complement approximation
+ * -B diag(A)^-1 B^T instead, so the pressure is scaled as well. Like hgf::models::stokes::apply, it cannot be used after
+ * hgf::models::stokes::eliminate_immersed_boundary.
+ * @param[out] diagonal - diagonal of the operator applied by hgf::models::stokes::apply, with the Schur diagonal in zero pressure rows.
+ */
+void
+hgf::models::stokes::operator_diagonal(std::vector< double >& diagonal) const
+{
+  if (reduced_rows.size()) {
+    std::cout << "\nMatrix-free operator_diagonal is not available after eliminate_immersed_boundary, use csr_array. Exiting.\n";
+    exit(0);
+  }
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index shift_w = shift_v + topology->interior_v.count();
+  const dof_store* dofs[3] = { &topology->velocity_u, &topology->velocity_v, &topology->velocity_w };
+  const bit_flags* interior[3] = { &topology->interior_u, &topology->interior_v, &topology->interior_w };
+  const std::vector< int >* nums[3] = { &topology->interior_u_nums, &topology->interior_v_nums, &topology->interior_w_nums };
+  hgf_index shift[3] = { 0, shift_v, shift_w };
+
+  diagonal.assign(operator_delta.n_rows, 0);
+
+  for (int cc = 0; cc < topology->velocity_u.dimension; cc++) {
+    double coef[6], area;
+    velocity_stencil(*dofs[cc], viscosity, coef, area);
+#pragma omp parallel for schedule(static)
+    for (int ii = 0; ii < (int)dofs[cc]->size(); ii++) {
+      if ((*nums[cc])[ii] == -1) continue;
+      double sum = 0;
+      for (int jj = 0; jj < dofs[cc]->n_neighbors; jj++) {
+        int nbr = dofs[cc]->neighbor(ii, jj);
+        if (nbr > -1 && (*interior[cc])[nbr]) sum += coef[jj];
+      }
+      diagonal[shift[cc] + (*nums[cc])[ii]] = sum;
+    }
+  }
+
+#pragma omp parallel for schedule(static)
+  for (hgf_index row = 0; row < operator_delta.n_rows; row++) {
+    for (hgf_index jj = operator_delta.row_ptr[row]; jj < operator_delta.row_ptr[row + 1]; jj++) {
+      if (operator_delta.col_index[jj] == row) diagonal[row] += operator_delta.value[jj];
+    }
+    if (row < (hgf_index)ib_penalty.size()) diagonal[row] += ib_penalty[row];
+    if (row < (hgf_index)brinkman_drag.size()) diagonal[row] += viscosity * brinkman_drag[row];
+  }
+
+  // pressure scaling from the interior stencil, each face couples to the cell with +-area in both B and B^T
+  int dim_mult = 2 * topology->velocity_u.dimension;
+  hgf_index shift_p = (dim_mult == 6) ? shift_w + topology->interior_w.count() : shift_w;
+#pragma omp parallel for schedule(static)
+  for (int ii = 0; ii < (int)topology->pressure.size(); ii++) {
+    if (diagonal[shift_p + ii] != 0) continue;
+    double sum = 0;
+    for (int cc = 0; cc < dim_mult / 2; cc++) {
+      double coef[6], area;
+      velocity_stencil(*dofs[cc], viscosity, coef, area);
+      for (int face = 0; face < 2; face++) {
+        int num = (*nums[cc])[topology->ptv[idx2(ii, (2 * cc + face), dim_mult)]];
+        if (num != -1) sum -= area * area / diagonal[shift[cc] + num];
+      }
+    }
+    diagonal[shift_p + ii] = sum;
+  }
+}
+
+// exits if the system was reduced by eliminate_immersed_boundary, whose numbering the full system updates no longer match
+void
+hgf::models::stokes::require_full_system(const char* name) const
+{
+  if (reduced_rows.size()) {
+    std::cout << "\n" << name << " cannot change the linear system after eliminate_immersed_boundary, build the model again. Exiting.\n";
+    exit(0);
+  }
+}
+
+// records boundary condition entries for apply, and adds them to csr_array when it is assembled
+void
+hgf::models::stokes::add_operator_entries(const std::vector< array_coo >& entries)
+{
+  require_full_system("Boundary condition setup");
+  if (csr_array.n_rows) hgf::utility::csr_add_entries(csr_array, entries, &csr_source, SRC_NONE);
+  hgf::utility::csr_add_entries(operator_delta, entries);
+}
+
+// records boundary condition entries so clear_bc can remove them, and adds them to the operator
+void
+hgf::models::stokes::add_bc_entries(const std::vector< array_coo >& entries)
+{
+  active_bc.insert(active_bc.end(), entries.begin(), entries.end());
+  add_operator_entries(entries);
+}
+
+/** \brief hgf::models::stokes::reassemble recomputes the values of the linear system for a new viscosity and immersed boundary penalty.
+ *
+ * The sparsity pattern of csr_array and the stencil term behind each nonzero are recorded when the system is
+ * built, so this only runs a parallel pass over the values, adding the immersed boundary penalty to the
+ * diagonal along with the Brinkman drag at the new viscosity, then re-adds the boundary condition entries in place.
+ * Every immersed boundary cell takes the penalty 1/new_eta, replacing the eta it was added with. Boundary condition terms of the momentum equations, in csr_array and rhs, are
+ * rescaled from the current viscosity, so viscosity must hold the value they were set up with.
+ * @param[in] new_viscosity - viscosity of the fluid.
+ * @param[in] new_eta - penalization parameter for all immersed boundary cells, unused if no immersed boundary was applied.
+ */
+void
+hgf::models::stokes::reassemble(double new_viscosity, double new_eta)
+{
+  require_full_system("reassemble");
+  int n_comp = topology->velocity_u.dimension;
+  hgf_index shift_v = topology->interior_u.count();
+  hgf_index shift_w = shift_v + topology->interior_v.count();
+  hgf_index shift_p = (n_comp == 3) ? shift_w + topology->interior_w.count() : shift_w;
+  hgf_index shift[4] = { 0, shift_v, shift_w, shift_p };
+  const dof_store* dofs[3] = { &topology->velocity_u, &topology->velocity_v, &topology->velocity_w };
+
+  // boundary terms of the momentum equations are proportional to the viscosity, continuity terms are not
+  double scale = new_viscosity / viscosity;
+  for (hgf_index ii = 0; ii < (hgf_index)active_bc.size(); ii++) {
+    if (active_bc[ii].i_index >= 0 && active_bc[ii].i_index < shift_p) active_bc[ii].value *= scale;
+  }
+#pragma omp parallel for schedule(static)
+  for (hgf_index row = 0; row < shift_p; row++) rhs[row] *= scale;
+  viscosity = new_viscosity;
+
+  // every immersed boundary cell takes the new penalty, the diagonal values are recomputed below
+  std::vector< int > ib_cells;
+  for (int ii = 0; ii < (int)ib_cell_penalty.size(); ii++) {
+    if (ib_cell_penalty[ii] != 0) {
+      ib_cells.push_back(ii);
+      ib_cell_penalty[ii] = (double)1 / new_eta;
+    }
+  }
+  std::fill(ib_penalty.begin(), ib_penalty.end(), 0.0);
+  penalize_cells(ib_cells, 1);
+
+  if (csr_array.n_rows) {
+    double coef[3][6], area[3];
+    for (int cc = 0; cc < n_comp; cc++) velocity_stencil(*dofs[cc], viscosity, coef[cc], area[cc]);
+
+    // interior stencil values from the recorded source of each nonzero
+#pragma omp parallel for schedule(static)
+    for (hgf_index row = 0; row < csr_array.n_rows; row++) {
+      int cc = 0;
+      while (cc < n_comp && row >= shift[cc + 1]) cc++;
+      double diagonal = 0;
+      if (cc < n_comp) {
+        for (hgf_index jj = csr_array.row_ptr[row]; jj < csr_array.row_ptr[row + 1]; jj++) {
+          if (csr_source[jj] < SRC_DIAGONAL) diagonal += coef[cc][csr_source[jj]];
+        }
+      }
+      for (hgf_index jj = csr_array.row_ptr[row]; jj < csr_array.row_ptr[row + 1]; jj++) {
+        int src = csr_source[jj];
+        double value = 0;
+        if (src < SRC_DIAGONAL) value = -coef[cc][src];
+        else if (src == SRC_DIAGONAL) {
+          value = diagonal + ib_penalty[row];
+          if (brinkman_drag.size()) value += viscosity * brinkman_drag[row];
+        }
+        else if (src == SRC_PRESSURE_LOWER) value = -area[cc];
+        else if (src == SRC_PRESSURE_UPPER) value = area[cc];
+        else if (src != SRC_NONE) value = ((src - SRC_CONTINUITY) % 2) ? -area[(src - SRC_CONTINUITY) / 2] : area[(src - SRC_CONTINUITY) / 2];
+        csr_array.value[jj] = value;
+      }
+    }
+    hgf::utility::csr_add_entries(csr_array, active_bc, &csr_source, SRC_NONE);
+  }
+
+  std::fill(operator_delta.value.begin(), operator_delta.value.end(), 0.0);
+  hgf::utility::csr_add_entries(operator_delta, active_bc);
+}
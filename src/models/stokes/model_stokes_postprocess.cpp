@@ -5,98 +5,111 @@
 #include <iomanip>
 
 // 1d->2d index
-#define idx2(i, j, ldi) ((i * ldi) + j)
+#define idx2(i, j, ldi) (((hgf_index)i * ldi) + j)
 
 // NOTE: flux inserts currently assume a cartesian grid, e.g. flux's can be computed using single component distances. This should be extended.
 
 /** \brief hgf::models::stokes::solution_build builds the solution vector using boundary information and the Stokes interior solution, solution_int.
  *
+ * If hgf::models::stokes::eliminate_immersed_boundary reduced the system, solution_int is mapped back to the full
+ * numbering first, with the eliminated velocities and pressures set to zero.
  */
 void
 hgf::models::stokes::solution_build(void)
 {
   // Get sizes. In 2d, nW and velocity_w.size should both == 0]
-  int nU = std::accumulate(interior_u.begin(), interior_u.end(), 0);
-  int nV = std::accumulate(interior_v.begin(), interior_v.end(), 0);
-  int nW = std::accumulate(interior_w.begin(), interior_w.end(), 0);
-  int nVel = nU + nV + nW;
-  solution.resize(velocity_u.size() + velocity_v.size() + velocity_w.size() + pressure.size());
+  hgf_index nU = topology->interior_u.count();
+  hgf_index nV = topology->interior_v.count();
+  hgf_index nW = topology->interior_w.count();
+  hgf_index nVel = nU + nV + nW;
+  solution.resize(topology->velocity_u.size() + topology->velocity_v.size() + topology->velocity_w.size() + topology->pressure.size());
+
+  // degrees of freedom removed by eliminate_immersed_boundary are zero
+  std::vector< double > expanded;
+  if (reduced_rows.size()) {
+    expanded.assign(reduced_rows.size(), 0.0);
+#pragma omp parallel for schedule(static)
+    for (hgf_index row = 0; row < (hgf_index)reduced_rows.size(); row++) {
+      if (reduced_rows[row] != -1) expanded[row] = solution_int[reduced_rows[row]];
+    }
+  }
+  const std::vector< double >& sol_int = reduced_rows.size() ? expanded : solution_int;
 
   if (nW) {
 #pragma omp parallel
     {
 #pragma omp for schedule(static,1) nowait // u loop
-      for (int ii = 0; ii < velocity_u.size(); ii++) {
+      for (int ii = 0; ii < topology->velocity_u.size(); ii++) {
         double dx;
         // am i an interior node?
-        if (interior_u[ii]) solution[ii] = solution_int[interior_u_nums[ii]];
+        if (topology->interior_u[ii]) solution[ii] = sol_int[topology->interior_u_nums[ii]];
         // am i a dirichlet bc node?
         else if (boundary[ii].type == 1) solution[ii] = boundary[ii].value;
         // neumann bc node
         else {
           // check for a node to the right, if yes, calculate using prescribed flux and value to the right
-          if (velocity_u[ii].neighbors[1] != -1) {
-            dx = velocity_u[velocity_u[ii].neighbors[1]].coords[0] - velocity_u[ii].coords[0];
-            solution[ii] = solution_int[interior_u_nums[velocity_u[ii].neighbors[1]]] + \
-              (boundary[ii].value + solution_int[nU + nV + nW + velocity_u[ii].cell_numbers[1]]) * dx;
+          if (topology->velocity_u.neighbor(ii, 1) != -1) {
+            dx = topology->velocity_u.coord(topology->velocity_u.neighbor(ii, 1), 0) - topology->velocity_u.coord(ii, 0);
+            solution[ii] = sol_int[topology->interior_u_nums[topology->velocity_u.neighbor(ii, 1)]] + \
+              (boundary[ii].value + sol_int[nU + nV + nW + topology->velocity_u.cell(ii, 1)]) * dx;
           }
           // else left, calculate using prescribed flux and u value to left
           else {
-            dx = velocity_u[ii].coords[0] - velocity_u[velocity_u[ii].neighbors[3]].coords[0];
-            solution[ii] = solution_int[interior_u_nums[velocity_u[ii].neighbors[3]]] + \
-              (boundary[ii].value + solution_int[nU + nV + nW + velocity_u[ii].cell_numbers[0]]) * dx;
+            dx = topology->velocity_u.coord(ii, 0) - topology->velocity_u.coord(topology->velocity_u.neighbor(ii, 3), 0);
+            solution[ii] = sol_int[topology->interior_u_nums[topology->velocity_u.neighbor(ii, 3)]] + \
+              (boundary[ii].value + sol_int[nU + nV + nW + topology->velocity_u.cell(ii, 0)]) * dx;
           }
         }
       }
 #pragma omp for schedule(static,1) nowait // v loop
-      for (int ii = 0; ii < velocity_v.size(); ii++) {
+      for (int ii = 0; ii < topology->velocity_v.size(); ii++) {
         double dy;
         // am i an interior node?
-        if (interior_v[ii]) solution[velocity_u.size() + ii] = solution_int[nU + interior_v_nums[ii]];
+        if (topology->interior_v[ii]) solution[topology->velocity_u.size() + ii] = sol_int[nU + topology->interior_v_nums[ii]];
         // am i a dirichlet bc node?
-        else if (boundary[ii + velocity_u.size()].type == 1) solution[ii + velocity_u.size()] = boundary[ii + velocity_u.size()].value;
+        else if (boundary[ii + topology->velocity_u.size()].type == 1) solution[ii + topology->velocity_u.size()] = boundary[ii + topology->velocity_u.size()].value;
         // neumann bc node
         else {
           // check for a node in the y+ direction, if yes, calculate value using prescribed flux and y+ v value
-          if (velocity_v[ii].neighbors[2] != -1) {
-            dy = velocity_v[velocity_v[ii].neighbors[2]].coords[1] - velocity_v[ii].coords[1];
-            solution[ii + velocity_u.size()] = solution_int[nU + interior_v_nums[velocity_v[ii].neighbors[2]]] + \
-              (boundary[ii + velocity_u.size()].value + solution_int[nU + nV + nW + velocity_v[ii].cell_numbers[1]]) * dy;
+          if (topology->velocity_v.neighbor(ii, 2) != -1) {
+            dy = topology->velocity_v.coord(topology->velocity_v.neighbor(ii, 2), 1) - topology->velocity_v.coord(ii, 1);
+            solution[ii + topology->velocity_u.size()] = sol_int[nU + topology->interior_v_nums[topology->velocity_v.neighbor(ii, 2)]] + \
+              (boundary[ii + topology->velocity_u.size()].value + sol_int[nU + nV + nW + topology->velocity_v.cell(ii, 1)]) * dy;
           }
           // else y-, calculate using prescribed flux and v value to y- direction
           else {
-            dy = velocity_v[ii].coords[1] - velocity_v[velocity_v[ii].neighbors[0]].coords[1];
-            solution[ii + velocity_u.size()] = solution_int[nU + interior_v_nums[velocity_v[ii].neighbors[0]]] + \
-              (boundary[ii + velocity_u.size()].value + solution_int[nU + nV + nW + velocity_v[ii].cell_numbers[0]]) * dy;
+            dy = topology->velocity_v.coord(ii, 1) - topology->velocity_v.coord(topology->velocity_v.neighbor(ii, 0), 1);
+            solution[ii + topology->velocity_u.size()] = sol_int[nU + topology->interior_v_nums[topology->velocity_v.neighbor(ii, 0)]] + \
+              (boundary[ii + topology->velocity_u.size()].value + sol_int[nU + nV + nW + topology->velocity_v.cell(ii, 0)]) * dy;
           }
         }
       }
 #pragma omp for schedule(static,1) nowait // w loop
-      for (int ii = 0; ii < velocity_w.size(); ii++) {
+      for (int ii = 0; ii < topology->velocity_w.size(); ii++) {
         double dz;
         // am i an interior node?
-        if (interior_w[ii]) solution[velocity_u.size() + velocity_v.size() + ii] = solution_int[nU + nV + interior_w_nums[ii]];
+        if (topology->interior_w[ii]) solution[topology->velocity_u.size() + topology->velocity_v.size() + ii] = sol_int[nU + nV + topology->interior_w_nums[ii]];
         // am i a dirichlet boundary node?
-        else if (boundary[ii + velocity_u.size() + velocity_v.size()].type == 1) solution[ii + velocity_u.size() + velocity_v.size()] = boundary[ii + velocity_u.size() + velocity_v.size()].value;
+        else if (boundary[ii + topology->velocity_u.size() + topology->velocity_v.size()].type == 1) solution[ii + topology->velocity_u.size() + topology->velocity_v.size()] = boundary[ii + topology->velocity_u.size() + topology->velocity_v.size()].value;
         // neumann bc node
         else {
           // check for a node in the z+ direction, if yes, calculate value using prescribed flux and z+ w value
-          if (velocity_w[ii].neighbors[5] != -1) {
-            dz = velocity_w[velocity_w[ii].neighbors[5]].coords[2] - velocity_w[ii].coords[2];
-            solution[ii + velocity_u.size() + velocity_v.size()] = solution_int[nU + nV + interior_w_nums[velocity_w[ii].neighbors[5]]] + \
-              (boundary[ii + velocity_u.size() + velocity_v.size()].value + solution_int[nU + nV + nW + velocity_w[ii].cell_numbers[1]]) * dz;
+          if (topology->velocity_w.neighbor(ii, 5) != -1) {
+            dz = topology->velocity_w.coord(topology->velocity_w.neighbor(ii, 5), 2) - topology->velocity_w.coord(ii, 2);
+            solution[ii + topology->velocity_u.size() + topology->velocity_v.size()] = sol_int[nU + nV + topology->interior_w_nums[topology->velocity_w.neighbor(ii, 5)]] + \
+              (boundary[ii + topology->velocity_u.size() + topology->velocity_v.size()].value + sol_int[nU + nV + nW + topology->velocity_w.cell(ii, 1)]) * dz;
           }
           // else z-, calculate using prescribed flux and w value in z- direction
           else {
-            dz = velocity_w[ii].coords[2] - velocity_w[velocity_w[ii].neighbors[4]].coords[2];
-            solution[ii + velocity_u.size() + velocity_v.size()] = solution_int[nU + nV + interior_w_nums[velocity_w[ii].neighbors[4]]] + \
-              (boundary[ii + velocity_u.size() + velocity_v.size()].value + solution_int[nU + nV + nW + velocity_w[ii].cell_numbers[0]]) * dz;
+            dz = topology->velocity_w.coord(ii, 2) - topology->velocity_w.coord(topology->velocity_w.neighbor(ii, 4), 2);
+            solution[ii + topology->velocity_u.size() + topology->velocity_v.size()] = sol_int[nU + nV + topology->interior_w_nums[topology->velocity_w.neighbor(ii, 4)]] + \
+              (boundary[ii + topology->velocity_u.size() + topology->velocity_v.size()].value + sol_int[nU + nV + nW + topology->velocity_w.cell(ii, 0)]) * dz;
           }
         }
       }
 #pragma omp for schedule(static,1) nowait // pressure loop
-      for (int ii = 0; ii < pressure.size(); ii++) {
-        solution[velocity_u.size() + velocity_v.size() + velocity_w.size() + ii] = solution_int[nVel + ii];
+      for (int ii = 0; ii < topology->pressure.size(); ii++) {
+        solution[topology->velocity_u.size() + topology->velocity_v.size() + topology->velocity_w.size() + ii] = sol_int[nVel + ii];
       }
     }
   }
@@ -104,54 +117,54 @@ hgf::models::stokes::solution_build(void)
 #pragma omp parallel
     {
 #pragma omp for schedule(static,1) nowait
-      for (int ii = 0; ii < velocity_u.size(); ii++) {
+      for (int ii = 0; ii < topology->velocity_u.size(); ii++) {
         double dx;
         // am i an interior node?
-        if (interior_u[ii]) solution[ii] = solution_int[interior_u_nums[ii]];
+        if (topology->interior_u[ii]) solution[ii] = sol_int[topology->interior_u_nums[ii]];
         // am i a dirichlet bc node?
         else if (boundary[ii].type == 1) solution[ii] = boundary[ii].value;
         // neumann bc node
         else {
           // check for a node to the right, if yes, calculate value using prescribed flux and u value to the right
-          if (velocity_u[ii].neighbors[1] != -1) {
-            dx = velocity_u[velocity_u[ii].neighbors[1]].coords[0] - velocity_u[ii].coords[0];
-            solution[ii] = solution_int[interior_u_nums[velocity_u[ii].neighbors[1]]] + \
-              (boundary[ii].value + solution_int[nU + nV + velocity_u[ii].cell_numbers[1]]) * dx;
+          if (topology->velocity_u.neighbor(ii, 1) != -1) {
+            dx = topology->velocity_u.coord(topology->velocity_u.neighbor(ii, 1), 0) - topology->velocity_u.coord(ii, 0);
+            solution[ii] = sol_int[topology->interior_u_nums[topology->velocity_u.neighbor(ii, 1)]] + \
+              (boundary[ii].value + sol_int[nU + nV + topology->velocity_u.cell(ii, 1)]) * dx;
           }
           // else left, calculate value using prescribed flux and u value to left
           else {
-            dx = velocity_u[ii].coords[0] - velocity_u[velocity_u[ii].neighbors[3]].coords[0];
-            solution[ii] = solution_int[interior_u_nums[velocity_u[ii].neighbors[3]]] + \
-              (boundary[ii].value + solution_int[nU + nV + velocity_u[ii].cell_numbers[0]]) * dx;
+            dx = topology->velocity_u.coord(ii, 0) - topology->velocity_u.coord(topology->velocity_u.neighbor(ii, 3), 0);
+            solution[ii] = sol_int[topology->interior_u_nums[topology->velocity_u.neighbor(ii, 3)]] + \
+              (boundary[ii].value + sol_int[nU + nV + topology->velocity_u.cell(ii, 0)]) * dx;
           }
         }
       }
 #pragma omp for schedule(static,1) nowait
-      for (int ii = 0; ii < velocity_v.size(); ii++) {
+      for (int ii = 0; ii < topology->velocity_v.size(); ii++) {
         double dy;
         // am i an interior node?
-        if (interior_v[ii]) solution[velocity_u.size() + ii] = solution_int[nU + interior_v_nums[ii]];
+        if (topology->interior_v[ii]) solution[topology->velocity_u.size() + ii] = sol_int[nU + topology->interior_v_nums[ii]];
         // am i a dirichlet bc node?
-        else if (boundary[ii + velocity_u.size()].type == 1) solution[ii + velocity_u.size()] = boundary[ii + velocity_u.size()].value;
+        else if (boundary[ii + topology->velocity_u.size()].type == 1) solution[ii + topology->velocity_u.size()] = boundary[ii + topology->velocity_u.size()].value;
         // neumann bc node
         else {
           // check for a node above, if yes, calculate value using prescribed flux and v value above
-          if (velocity_v[ii].neighbors[2] != -1) {
-            dy = velocity_v[velocity_v[ii].neighbors[2]].coords[1] - velocity_v[ii].coords[1];
-            solution[ii + velocity_u.size()] = solution_int[nU + interior_v_nums[velocity_v[ii].neighbors[2]]] + \
-              (boundary[ii + velocity_u.size()].value + solution_int[nU + nV + velocity_v[ii].cell_numbers[1]]) * dy;
+          if (topology->velocity_v.neighbor(ii, 2) != -1) {
+            dy = topology->velocity_v.coord(topology->velocity_v.neighbor(ii, 2), 1) - topology->velocity_v.coord(ii, 1);
+            solution[ii + topology->velocity_u.size()] = sol_int[nU + topology->interior_v_nums[topology->velocity_v.neighbor(ii, 2)]] + \
+              (boundary[ii + topology->velocity_u.size()].value + sol_int[nU + nV + topology->velocity_v.cell(ii, 1)]) * dy;
           }
           // else below, calculate value using prescribed flux and v value below
           else {
-            dy = velocity_v[ii].coords[1] - velocity_v[velocity_v[ii].neighbors[0]].coords[1];
-            solution[ii + velocity_u.size()] = solution_int[nU + interior_v_nums[velocity_v[ii].neighbors[0]]] + \
-              (boundary[ii + velocity_u.size()].value + solution_int[nU + nV + velocity_v[ii].cell_numbers[0]]) * dy;
+            dy = topology->velocity_v.coord(ii, 1) - topology->velocity_v.coord(topology->velocity_v.neighbor(ii, 0), 1);
+            solution[ii + topology->velocity_u.size()] = sol_int[nU + topology->interior_v_nums[topology->velocity_v.neighbor(ii, 0)]] + \
+              (boundary[ii + topology->velocity_u.size()].value + sol_int[nU + nV + topology->velocity_v.cell(ii, 0)]) * dy;
           }
         }
       }
 #pragma omp for schedule(static,1) nowait
-      for (int ii = 0; ii < pressure.size(); ii++) {
-        solution[velocity_u.size() + velocity_v.size() + ii] = solution_int[nVel + ii];
+      for (int ii = 0; ii < topology->pressure.size(); ii++) {
+        solution[topology->velocity_u.size() + topology->velocity_v.size() + ii] = sol_int[nVel + ii];
       }
     }
   }
@@ -165,18 +178,20 @@ hgf::models::stokes::check_divergence(const parameters& par, const hgf::mesh::vo
 {
 
   double dxy[3];  
-  info.resize(pressure.size());
+  info.resize(topology->pressure.size());
 
-  if (velocity_w.size()) { // 3d
+  if (topology->velocity_w.size()) { // 3d
 #pragma omp parallel for private(dxy)
-    for (int ii = 0; ii < pressure.size(); ii++) {
+    for (int ii = 0; ii < topology->pressure.size(); ii++) {
       // dx, dy
-      dxy[0] = velocity_u[ptv[idx2(ii, 1, 6)]].coords[0] - velocity_u[ptv[idx2(ii, 0, 6)]].coords[0];
-      dxy[1] = velocity_v[ptv[idx2(ii, 3, 6)]].coords[1] - velocity_v[ptv[idx2(ii, 2, 6)]].coords[1];
-      dxy[2] = velocity_v[ptv[idx2(ii, 5, 6)]].coords[2] - velocity_v[ptv[idx2(ii, 4, 6)]].coords[2];
-      info[ii] = (solution[ptv[idx2(ii, 1, 6)]] - solution[ptv[idx2(ii,0,6)]]) / dxy[0] + \
-                 (solution[velocity_u.size() + ptv[idx2(ii, 3, 6)]] - solution[velocity_u.size() + ptv[idx2(ii, 2, 6)]]) / dxy[1] + \
-                 (solution[velocity_u.size() + velocity_v.size() + ptv[idx2(ii, 5, 6)]] - solution[velocity_u.size() + velocity_v.size() + ptv[idx2(ii, 4, 6)]]) / dxy[2];
+      dxy[0] = topology->velocity_u.coord(topology->ptv[idx2(ii, 1, 6)], 0) - topology->velocity_u.coord(topology->ptv[idx2(ii, 0, 6)], 0);
+      dxy[1] = topology->velocity_v.coord(topology->ptv[idx2(ii, 3, 6)], 1) - topology->velocity_v.coord(topology->ptv[idx2(ii, 2, 6)], 1);
+      dxy[2] = topology->velocity_w.coord(topology->ptv[idx2(ii, 5, 6)], 2) - topology->velocity_w.coord(topology->ptv[idx2(ii, 4, 6)], 2);
+      // the lower face of a cell on a periodic face is on the opposite side of the domain
+      for (int kk = 0; kk < 3; kk++) if (dxy[kk] < 0) dxy[kk] += topology->period[kk];
+      info[ii] = (solution[topology->ptv[idx2(ii, 1, 6)]] - solution[topology->ptv[idx2(ii,0,6)]]) / dxy[0] + \
+                 (solution[topology->velocity_u.size() + topology->ptv[idx2(ii, 3, 6)]] - solution[topology->velocity_u.size() + topology->ptv[idx2(ii, 2, 6)]]) / dxy[1] + \
+                 (solution[topology->velocity_u.size() + topology->velocity_v.size() + topology->ptv[idx2(ii, 5, 6)]] - solution[topology->velocity_u.size() + topology->velocity_v.size() + topology->ptv[idx2(ii, 4, 6)]]) / dxy[2];
     }    
     if (print == 1) {
       int nNodes = (int)msh.gtlNode.size() / 8;
@@ -276,12 +291,13 @@ hgf::models::stokes::check_divergence(const parameters& par, const hgf::mesh::vo
     }
   } else { // 2d
 #pragma omp parallel for private(dxy)
-    for (int ii = 0; ii < pressure.size(); ii++) {
+    for (int ii = 0; ii < topology->pressure.size(); ii++) {
       // dx, dy
-      dxy[0] = velocity_u[ptv[idx2(ii, 1, 4)]].coords[0] - velocity_u[ptv[idx2(ii, 0, 4)]].coords[0];
-      dxy[1] = velocity_v[ptv[idx2(ii, 3, 4)]].coords[1] - velocity_v[ptv[idx2(ii, 2, 4)]].coords[1];
-      info[ii] = (solution[ptv[idx2(ii, 1, 4)]] - solution[ptv[idx2(ii,0,4)]]) / dxy[0] + \
-                 (solution[velocity_u.size() + ptv[idx2(ii, 3, 4)]] - solution[velocity_u.size() + ptv[idx2(ii, 2, 4)]]) / dxy[1];
+      dxy[0] = topology->velocity_u.coord(topology->ptv[idx2(ii, 1, 4)], 0) - topology->velocity_u.coord(topology->ptv[idx2(ii, 0, 4)], 0);
+      dxy[1] = topology->velocity_v.coord(topology->ptv[idx2(ii, 3, 4)], 1) - topology->velocity_v.coord(topology->ptv[idx2(ii, 2, 4)], 1);
+      for (int kk = 0; kk < 2; kk++) if (dxy[kk] < 0) dxy[kk] += topology->period[kk];
+      info[ii] = (solution[topology->ptv[idx2(ii, 1, 4)]] - solution[topology->ptv[idx2(ii,0,4)]]) / dxy[0] + \
+                 (solution[topology->velocity_u.size() + topology->ptv[idx2(ii, 3, 4)]] - solution[topology->velocity_u.size() + topology->ptv[idx2(ii, 2, 4)]]) / dxy[1];
     }    
     if (print == 1) {
       int nNodes = (int)msh.gtlNode.size() / 4;
@@ -364,9 +380,9 @@ hgf::models::stokes::output_vtk(const parameters& par, const hgf::mesh::voxel& m
     int nNodes = (int)msh.gtlNode.size() / 8;
     int nEls = (int)msh.els.size();
     uzero = 0;
-    vzero = uzero + (int)velocity_u.size();
-    wzero = vzero + (int)velocity_v.size();
-    pzero = wzero + (int)velocity_w.size();
+    vzero = uzero + (int)topology->velocity_u.size();
+    wzero = vzero + (int)topology->velocity_v.size();
+    pzero = wzero + (int)topology->velocity_w.size();
     // build an exclusive nodes vector
     std::vector<double> nodes(nNodes * 3);
 #pragma omp parallel for
@@ -453,7 +469,7 @@ hgf::models::stokes::output_vtk(const parameters& par, const hgf::mesh::voxel& m
     }
     outstream << "\n";
     outstream << "CELL_DATA " << nEls << "\n";
-    outstream << "SCALARS pressure double\n";
+    outstream << "SCALARS topology->pressure double\n";
     outstream << "LOOKUP_TABLE default\n";
     for (int row = 0; row < nEls; row++) {
       outstream << solution[pzero + row] << "\n";
@@ -461,12 +477,12 @@ hgf::models::stokes::output_vtk(const parameters& par, const hgf::mesh::voxel& m
     outstream << "\n";
     outstream << "VECTORS velocity double\n";
     for (int row = 0; row < nEls; row++) {
-      uval = 0.5 * (solution[uzero+ptv[idx2(row, 0, 6)]] \
-                    + solution[uzero + ptv[idx2(row, 1, 6)]]);
-      vval = 0.5 * (solution[vzero + ptv[idx2(row, 2, 6)]] \
-                    + solution[vzero + ptv[idx2(row, 3, 6)]]);
-      wval = 0.5 * (solution[wzero + ptv[idx2(row, 4, 6)]] \
-                    + solution[wzero + ptv[idx2(row, 5, 6)]]);
+      uval = 0.5 * (solution[uzero+topology->ptv[idx2(row, 0, 6)]] \
+                    + solution[uzero + topology->ptv[idx2(row, 1, 6)]]);
+      vval = 0.5 * (solution[vzero + topology->ptv[idx2(row, 2, 6)]] \
+                    + solution[vzero + topology->ptv[idx2(row, 3, 6)]]);
+      wval = 0.5 * (solution[wzero + topology->ptv[idx2(row, 4, 6)]] \
+                    + solution[wzero + topology->ptv[idx2(row, 5, 6)]]);
       outstream << uval << "\t" << vval << "\t" << wval << "\n";
     }
     outstream << "\n";
@@ -483,8 +499,8 @@ hgf::models::stokes::output_vtk(const parameters& par, const hgf::mesh::voxel& m
     int nNodes = (int)msh.gtlNode.size() / 4;
     int nEls = (int)msh.els.size();
     uzero = 0;
-    vzero = uzero + (int)velocity_u.size();
-    pzero = vzero + (int)velocity_v.size();
+    vzero = uzero + (int)topology->velocity_u.size();
+    pzero = vzero + (int)topology->velocity_v.size();
     // build an exclusive nodes vector
     std::vector<double> nodes(nNodes * 2);
 #pragma omp parallel for
@@ -537,7 +553,7 @@ hgf::models::stokes::output_vtk(const parameters& par, const hgf::mesh::voxel& m
     }
     outstream << "\n";
     outstream << "CELL_DATA " << nEls << "\n";
-    outstream << "SCALARS pressure double\n";
+    outstream << "SCALARS topology->pressure double\n";
     outstream << "LOOKUP_TABLE default\n";
     for (int row = 0; row < nEls; row++) {
       outstream << solution[pzero + row] << "\n";
@@ -545,10 +561,10 @@ hgf::models::stokes::output_vtk(const parameters& par, const hgf::mesh::voxel& m
     outstream << "\n";
     outstream << "VECTORS velocity double\n";
     for (int row = 0; row < nEls; row++) {
-      uval = 0.5 * (solution[uzero+ptv[idx2(row, 0, 4)]] \
-                    + solution[uzero + ptv[idx2(row, 1, 4)]]);
-      vval = 0.5 * (solution[vzero + ptv[idx2(row, 2, 4)]] \
-                    + solution[vzero + ptv[idx2(row, 3, 4)]]);
+      uval = 0.5 * (solution[uzero+topology->ptv[idx2(row, 0, 4)]] \
+                    + solution[uzero + topology->ptv[idx2(row, 1, 4)]]);
+      vval = 0.5 * (solution[vzero + topology->ptv[idx2(row, 2, 4)]] \
+                    + solution[vzero + topology->ptv[idx2(row, 3, 4)]]);
       outstream << uval << "\t" << vval << "\t" << 0 << "\n";
     }
     outstream << "\n";
@@ -572,9 +588,9 @@ hgf::models::stokes::write_state(const parameters& par, const hgf::mesh::voxel&
 {
   if (par.dimension == 3) { // 3d output
     int uzero = 0;
-    int vzero = uzero + (int)velocity_u.size();
-    int wzero = vzero + (int)velocity_v.size();
-    int pzero = wzero + (int)velocity_w.size();
+    int vzero = uzero + (int)topology->velocity_u.size();
+    int wzero = vzero + (int)topology->velocity_v.size();
+    int pzero = wzero + (int)topology->velocity_w.size();
 
     bfs::path output_path( par.problem_path / file_name.c_str() );
     output_path += ".dat";
@@ -589,33 +605,33 @@ hgf::models::stokes::write_state(const parameters& par, const hgf::mesh::voxel&
 
     // PRESSURE
     outstream << "\n## PRESSURE DEGREES OF FREEDOM ##";
-    for (int i = 0; i < pressure.size(); i++) {
+    for (int i = 0; i < topology->pressure.size(); i++) {
       outstream << "\nPRESSURE DOF " << i << "\n";
-      outstream << pressure[i].coords[0] << "\t" << pressure[i].coords[1] << "\t" << pressure[i].coords[2] << "\n";
+      outstream << topology->pressure.coord(i, 0) << "\t" << topology->pressure.coord(i, 1) << "\t" << topology->pressure.coord(i, 2) << "\n";
       outstream << solution[i + pzero] << "\n";
     }
 
     // X VELOCITY
     outstream << "\n## X VELOCITY COMPONENT DEGREES OF FREEDOM ##";
-    for (int i = 0; i < velocity_u.size(); i++) {
+    for (int i = 0; i < topology->velocity_u.size(); i++) {
       outstream << "\nX VELOCITY DOF " << i << "\n";
-      outstream << velocity_u[i].coords[0] << "\t" << velocity_u[i].coords[1] << "\t" << velocity_u[i].coords[2] << "\n";
+      outstream << topology->velocity_u.coord(i, 0) << "\t" << topology->velocity_u.coord(i, 1) << "\t" << topology->velocity_u.coord(i, 2) << "\n";
       outstream << solution[i + uzero] << "\n"; 
     }
 
     // Y VELOCITY
     outstream << "\n## Y VELOCITY COMPONENT DEGREES OF FREEDOM ##";
-    for (int i = 0; i < velocity_v.size(); i++) {
+    for (int i = 0; i < topology->velocity_v.size(); i++) {
       outstream << "\nY VELOCITY DOF " << i << "\n";
-      outstream << velocity_v[i].coords[0] << "\t" << velocity_v[i].coords[1] << "\t" << velocity_v[i].coords[2] << "\n";
+      outstream << topology->velocity_v.coord(i, 0) << "\t" << topology->velocity_v.coord(i, 1) << "\t" << topology->velocity_v.coord(i, 2) << "\n";
       outstream << solution[i + vzero] << "\n";  
     }
 
     // Z VELOCITY
     outstream << "\n## Z VELOCITY COMPONENT DEGREES OF FREEDOM ##";
-    for (int i = 0; i < velocity_w.size(); i++) {
+    for (int i = 0; i < topology->velocity_w.size(); i++) {
       outstream << "\nZ VELOCITY DOF " << i << "\n";
-      outstream << velocity_w[i].coords[0] << "\t" << velocity_w[i].coords[1] << "\t" << velocity_w[i].coords[2] << "\n";
+      outstream << topology->velocity_w.coord(i, 0) << "\t" << topology->velocity_w.coord(i, 1) << "\t" << topology->velocity_w.coord(i, 2) << "\n";
       outstream << solution[i + wzero] << "\n";
     }
 
@@ -630,8 +646,8 @@ hgf::models::stokes::write_state(const parameters& par, const hgf::mesh::voxel&
 
   } else { // 2d output
     int uzero = 0;
-    int vzero = uzero + (int)velocity_u.size();
-    int pzero = vzero + (int)velocity_v.size();
+    int vzero = uzero + (int)topology->velocity_u.size();
+    int pzero = vzero + (int)topology->velocity_v.size();
     bfs::path output_path( par.problem_path / file_name.c_str() );
     output_path += ".dat";
     std::ofstream outstream;
@@ -645,25 +661,25 @@ hgf::models::stokes::write_state(const parameters& par, const hgf::mesh::voxel&
 
     // PRESSURE
     outstream << "\n## PRESSURE DEGREES OF FREEDOM ##";
-    for (int i = 0; i < pressure.size(); i++) {
+    for (int i = 0; i < topology->pressure.size(); i++) {
       outstream << "\nPRESSURE DOF " << i << "\n";
-      outstream << pressure[i].coords[0] << "\t" << pressure[i].coords[1] << "\n";
+      outstream << topology->pressure.coord(i, 0) << "\t" << topology->pressure.coord(i, 1) << "\n";
       outstream << solution[i + pzero] << "\n";
     }
 
     // X VELOCITY
     outstream << "\n## X VELOCITY COMPONENT DEGREES OF FREEDOM ##";
-    for (int i = 0; i < velocity_u.size(); i++) {
+    for (int i = 0; i < topology->velocity_u.size(); i++) {
       outstream << "\nX VELOCITY DOF " << i << "\n";
-      outstream << velocity_u[i].coords[0] << "\t" << velocity_u[i].coords[1] << "\n";
+      outstream << topology->velocity_u.coord(i, 0) << "\t" << topology->velocity_u.coord(i, 1) << "\n";
       outstream << solution[i + uzero] << "\n";
     }
 
     // Y VELOCITY
     outstream << "\n## Y VELOCITY COMPONENT DEGREES OF FREEDOM ##";
-    for (int i = 0; i < velocity_v.size(); i++) {
+    for (int i = 0; i < topology->velocity_v.size(); i++) {
       outstream << "\nY VELOCITY DOF " << i << "\n";
-      outstream << velocity_v[i].coords[0] << "\t" << velocity_v[i].coords[1] << "\n";
+      outstream << topology->velocity_v.coord(i, 0) << "\t" << topology->velocity_v.coord(i, 1) << "\n";
       outstream << solution[i + vzero] << "\n";
     }
 
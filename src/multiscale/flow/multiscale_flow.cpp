@@ -78,11 +78,31 @@ solve_9x9( double *mat, double *v )
   }
 }
 
+// averages of a periodic flow solution over the whole domain, velocity from the face dofs of one component
+// starting at offset in solution. The mean pressure gradient is the drive of the periodic boundary conditions.
+static void
+periodic_averages(const parameters& par, const std::vector< int >& pressure_ib_list, const dof_store& velocity, \
+                  int offset, const std::vector< double >& solution, double& v, double& g)
+{
+  int v_count = 0;
+  v = 0;
+  for (int ii = 0; ii < velocity.size(); ii++) {
+    int p1_idx = velocity.cell(ii, 0);
+    int p2_idx = velocity.cell(ii, 1);
+    if (p1_idx != -1 && p2_idx != -1 && !pressure_ib_list[p1_idx] && !pressure_ib_list[p2_idx]) {
+      v += solution[offset + ii];
+      v_count++;
+    }
+  }
+  v /= v_count;
+  g = par.periodic_drive;
+}
+
 void
 compute_averages_x(const parameters& par, const std::vector< int >& pressure_ib_list, \
-                                          const std::vector< degree_of_freedom >& velocity_u, \
-                                          const std::vector< degree_of_freedom >& velocity_v, \
-                                          const std::vector< degree_of_freedom >& velocity_w, \
+                                          const dof_store& velocity_u, \
+                                          const dof_store& velocity_v, \
+                                          const dof_store& velocity_w, \
                                           const std::vector< double > solution, double& v, double& g)
 {
   double min_x, max_x, mid_x, midrange_x, min_y, max_y, min_z, max_z, pressure;
@@ -96,6 +116,12 @@ compute_averages_x(const parameters& par, const std::vector< int >& pressure_ib_
   int v_count = 0;
   int n_velocity;
 
+  // periodic problems use the whole domain, there are no inflow and outflow regions to trim
+  if (par.periodic) {
+    periodic_averages(par, pressure_ib_list, velocity_u, 0, solution, v, g);
+    return;
+  }
+
   g = 0;
   v = 0;
 
@@ -120,23 +146,23 @@ compute_averages_x(const parameters& par, const std::vector< int >& pressure_ib_
     midrange_x = 0.5 * (max_x + mid_x) - 0.5 * (mid_x + min_x);
     // compute averages
     for (int ii = 0; ii < velocity_u.size(); ii++) {
-      p1_idx = velocity_u[ii].cell_numbers[0];
-      p2_idx = velocity_u[ii].cell_numbers[1];
+      p1_idx = velocity_u.cell(ii, 0);
+      p2_idx = velocity_u.cell(ii, 1);
       if (p1_idx != -1 && p2_idx != -1 && !pressure_ib_list[p1_idx] && !pressure_ib_list[p2_idx]) {
-        if (velocity_u[ii].coords[0] > min_x) {
-          if (velocity_u[ii].coords[0] < max_x) {
-            if (velocity_u[ii].coords[1] > min_y) {
-              if (velocity_u[ii].coords[1] < max_y) {
-                if (velocity_u[ii].coords[2] > min_z) {
-                  if (velocity_u[ii].coords[2] < max_z) {
+        if (velocity_u.coord(ii, 0) > min_x) {
+          if (velocity_u.coord(ii, 0) < max_x) {
+            if (velocity_u.coord(ii, 1) > min_y) {
+              if (velocity_u.coord(ii, 1) < max_y) {
+                if (velocity_u.coord(ii, 2) > min_z) {
+                  if (velocity_u.coord(ii, 2) < max_z) {
                     pressure = 0.5 * (solution[n_velocity + p1_idx] + solution[n_velocity + p2_idx]);
-                    if (velocity_u[ii].coords[0] < mid_x) {
+                    if (velocity_u.coord(ii, 0) < mid_x) {
                       p1 += pressure;
                       p1_count++;
                       v += solution[ii];
                       v_count++;
                     }
-                    else if (velocity_u[ii].coords[0] >= mid_x) {
+                    else if (velocity_u.coord(ii, 0) >= mid_x) {
                       p2 += pressure;
                       p2_count++;
                       v += solution[ii];
@@ -168,21 +194,21 @@ compute_averages_x(const parameters& par, const std::vector< int >& pressure_ib_
     midrange_x = 0.5 * (max_x + mid_x) - 0.5 * (mid_x + min_x);
     // compute averages
     for (int ii = 0; ii < velocity_u.size(); ii++) {
-      p1_idx = velocity_u[ii].cell_numbers[0];
-      p2_idx = velocity_u[ii].cell_numbers[1];
+      p1_idx = velocity_u.cell(ii, 0);
+      p2_idx = velocity_u.cell(ii, 1);
       if (p1_idx != -1 && p2_idx != -1 && !pressure_ib_list[p1_idx] && !pressure_ib_list[p2_idx]) {
-        if (velocity_u[ii].coords[0] > min_x) {
-          if (velocity_u[ii].coords[0] < max_x) {
-            if (velocity_u[ii].coords[1] > min_y) {
-              if (velocity_u[ii].coords[1] < max_y) {
+        if (velocity_u.coord(ii, 0) > min_x) {
+          if (velocity_u.coord(ii, 0) < max_x) {
+            if (velocity_u.coord(ii, 1) > min_y) {
+              if (velocity_u.coord(ii, 1) < max_y) {
                 pressure = 0.5 * (solution[n_velocity + p1_idx] + solution[n_velocity + p2_idx]);
-                if (velocity_u[ii].coords[0] < mid_x) {
+                if (velocity_u.coord(ii, 0) < mid_x) {
                   p1 += pressure;
                   p1_count++;
                   v += solution[ii];
                   v_count++;
                 }
-                else if (velocity_u[ii].coords[0] >= mid_x) {
+                else if (velocity_u.coord(ii, 0) >= mid_x) {
                   p2 += pressure;
                   p2_count++;
                   v += solution[ii];
@@ -203,9 +229,9 @@ compute_averages_x(const parameters& par, const std::vector< int >& pressure_ib_
 
 void
 compute_averages_y(const parameters& par, const std::vector< int >& pressure_ib_list, \
-                                          const std::vector< degree_of_freedom >& velocity_u, \
-                                          const std::vector< degree_of_freedom >& velocity_v, \
-                                          const std::vector< degree_of_freedom >& velocity_w, \
+                                          const dof_store& velocity_u, \
+                                          const dof_store& velocity_v, \
+                                          const dof_store& velocity_w, \
                                           const std::vector< double > solution, double& v, double& g)
 {
   double min_x, max_x, min_y, max_y, mid_y, midrange_y, min_z, max_z, pressure;
@@ -219,6 +245,12 @@ compute_averages_y(const parameters& par, const std::vector< int >& pressure_ib_
   int v_count = 0;
   int n_velocity;
 
+  // periodic problems use the whole domain, there are no inflow and outflow regions to trim
+  if (par.periodic) {
+    periodic_averages(par, pressure_ib_list, velocity_v, (int)velocity_u.size(), solution, v, g);
+    return;
+  }
+
   g = 0;
   v = 0;
 
@@ -243,23 +275,23 @@ compute_averages_y(const parameters& par, const std::vector< int >& pressure_ib_
     midrange_y = 0.5 * (max_y + mid_y) - 0.5 * (mid_y + min_y);
     // compute averages
     for (int ii = 0; ii < velocity_v.size(); ii++) {
-      p1_idx = velocity_v[ii].cell_numbers[0];
-      p2_idx = velocity_v[ii].cell_numbers[1];
+      p1_idx = velocity_v.cell(ii, 0);
+      p2_idx = velocity_v.cell(ii, 1);
       if (p1_idx != -1 && p2_idx != -1 && !pressure_ib_list[p1_idx] && !pressure_ib_list[p2_idx]) {
-        if (velocity_v[ii].coords[0] > min_x) {
-          if (velocity_v[ii].coords[0] < max_x) {
-            if (velocity_v[ii].coords[1] > min_y) {
-              if (velocity_v[ii].coords[1] < max_y) {
-                if (velocity_v[ii].coords[2] > min_z) {
-                  if (velocity_v[ii].coords[2] < max_z) {
+        if (velocity_v.coord(ii, 0) > min_x) {
+          if (velocity_v.coord(ii, 0) < max_x) {
+            if (velocity_v.coord(ii, 1) > min_y) {
+              if (velocity_v.coord(ii, 1) < max_y) {
+                if (velocity_v.coord(ii, 2) > min_z) {
+                  if (velocity_v.coord(ii, 2) < max_z) {
                     pressure = 0.5 * (solution[n_velocity + p1_idx] + solution[n_velocity + p2_idx]);
-                    if (velocity_v[ii].coords[1] < mid_y) {
+                    if (velocity_v.coord(ii, 1) < mid_y) {
                       p1 += pressure;
                       p1_count++;
                       v += solution[velocity_u.size() + ii];
                       v_count++;
                     }
-                    else if (velocity_v[ii].coords[1] >= mid_y) {
+                    else if (velocity_v.coord(ii, 1) >= mid_y) {
                       p2 += pressure;
                       p2_count++;
                       v += solution[velocity_u.size() + ii];
@@ -291,21 +323,21 @@ compute_averages_y(const parameters& par, const std::vector< int >& pressure_ib_
     midrange_y = 0.5 * (max_y + mid_y) - 0.5 * (mid_y + min_y);
     // compute averages
     for (int ii = 0; ii < velocity_v.size(); ii++) {
-      p1_idx = velocity_v[ii].cell_numbers[0];
-      p2_idx = velocity_v[ii].cell_numbers[1];
+      p1_idx = velocity_v.cell(ii, 0);
+      p2_idx = velocity_v.cell(ii, 1);
       if (p1_idx != -1 && p2_idx != -1 && !pressure_ib_list[p1_idx] && !pressure_ib_list[p2_idx]) {
-        if (velocity_v[ii].coords[0] > min_x) {
-          if (velocity_v[ii].coords[0] < max_x) {
-            if (velocity_v[ii].coords[1] > min_y) {
-              if (velocity_v[ii].coords[1] < max_y) {
+        if (velocity_v.coord(ii, 0) > min_x) {
+          if (velocity_v.coord(ii, 0) < max_x) {
+            if (velocity_v.coord(ii, 1) > min_y) {
+              if (velocity_v.coord(ii, 1) < max_y) {
                 pressure = 0.5 * (solution[n_velocity + p1_idx] + solution[n_velocity + p2_idx]);
-                if (velocity_v[ii].coords[1] < mid_y) {
+                if (velocity_v.coord(ii, 1) < mid_y) {
                   p1 += pressure;
                   p1_count++;
                   v += solution[velocity_u.size() + ii];
                   v_count++;
                 }
-                else if (velocity_v[ii].coords[1] >= mid_y) {
+                else if (velocity_v.coord(ii, 1) >= mid_y) {
                   p2 += pressure;
                   p2_count++;
                   v += solution[velocity_u.size() + ii];
@@ -326,9 +358,9 @@ compute_averages_y(const parameters& par, const std::vector< int >& pressure_ib_
 
 void
 compute_averages_z(const parameters& par, const std::vector< int >& pressure_ib_list, \
-                                          const std::vector< degree_of_freedom >& velocity_u, \
-                                          const std::vector< degree_of_freedom >& velocity_v, \
-                                          const std::vector< degree_of_freedom >& velocity_w, \
+                                          const dof_store& velocity_u, \
+                                          const dof_store& velocity_v, \
+                                          const dof_store& velocity_w, \
                                           const std::vector< double > solution, double& v, double& g)
 {
   double min_x, max_x, min_y, max_y, min_z, max_z, mid_z, midrange_z, pressure;
@@ -342,6 +374,12 @@ compute_averages_z(const parameters& par, const std::vector< int >& pressure_ib_
   int v_count = 0;
   int n_velocity;
 
+  // periodic problems use the whole domain, there are no inflow and outflow regions to trim
+  if (par.periodic) {
+    periodic_averages(par, pressure_ib_list, velocity_w, (int)(velocity_u.size() + velocity_v.size()), solution, v, g);
+    return;
+  }
+
   g = 0;
   v = 0;
 
@@ -365,23 +403,23 @@ compute_averages_z(const parameters& par, const std::vector< int >& pressure_ib_
   midrange_z = 0.5 * (max_z + mid_z) - 0.5 * (mid_z + min_z);
   // compute averages
   for (int ii = 0; ii < velocity_w.size(); ii++) {
-    p1_idx = velocity_w[ii].cell_numbers[0];
-    p2_idx = velocity_w[ii].cell_numbers[1];
+    p1_idx = velocity_w.cell(ii, 0);
+    p2_idx = velocity_w.cell(ii, 1);
     if (p1_idx != -1 && p2_idx != -1 && !pressure_ib_list[p1_idx] && !pressure_ib_list[p2_idx]) {
-      if (velocity_w[ii].coords[0] > min_x) {
-        if (velocity_w[ii].coords[0] < max_x) {
-          if (velocity_w[ii].coords[1] > min_y) {
-            if (velocity_w[ii].coords[1] < max_y) {
-              if (velocity_w[ii].coords[2] > min_z) {
-                if (velocity_w[ii].coords[2] < max_z) {
+      if (velocity_w.coord(ii, 0) > min_x) {
+        if (velocity_w.coord(ii, 0) < max_x) {
+          if (velocity_w.coord(ii, 1) > min_y) {
+            if (velocity_w.coord(ii, 1) < max_y) {
+              if (velocity_w.coord(ii, 2) > min_z) {
+                if (velocity_w.coord(ii, 2) < max_z) {
                   pressure = 0.5 * (solution[n_velocity + p1_idx] + solution[n_velocity + p2_idx]);
-                  if (velocity_w[ii].coords[2] < mid_z) {
+                  if (velocity_w.coord(ii, 2) < mid_z) {
                     p1 += pressure;
                     p1_count++;
                     v += solution[velocity_u.size() + velocity_v.size() + ii];
                     v_count++;
                   }
-                  else if (velocity_w[ii].coords[2] >= mid_z) {
+                  else if (velocity_w.coord(ii, 2) >= mid_z) {
                     p2 += pressure;
                     p2_count++;
                     v += solution[velocity_u.size() + velocity_v.size() + ii];
@@ -414,9 +452,9 @@ compute_averages_z(const parameters& par, const std::vector< int >& pressure_ib_
  */
 double
 hgf::multiscale::flow::compute_permeability_x(const parameters& par, const std::vector< int >& pressure_ib_list, \
-                                                                     const std::vector< degree_of_freedom >& velocity_u, \
-                                                                     const std::vector< degree_of_freedom >& velocity_v, \
-                                                                     const std::vector< degree_of_freedom >& velocity_w, \
+                                                                     const dof_store& velocity_u, \
+                                                                     const dof_store& velocity_v, \
+                                                                     const dof_store& velocity_w, \
                                                                      const std::vector< double > solution)
 {
   // quick exit
@@ -453,9 +491,9 @@ hgf::multiscale::flow::compute_permeability_x(const parameters& par, const std::
  */
 double
 hgf::multiscale::flow::compute_permeability_y(const parameters& par, const std::vector< int >& pressure_ib_list, \
-                                                                     const std::vector< degree_of_freedom >& velocity_u, \
-                                                                     const std::vector< degree_of_freedom >& velocity_v, \
-                                                                     const std::vector< degree_of_freedom >& velocity_w, \
+                                                                     const dof_store& velocity_u, \
+                                                                     const dof_store& velocity_v, \
+                                                                     const dof_store& velocity_w, \
   const std::vector< double > solution)
 {
   // quick exit
@@ -492,9 +530,9 @@ hgf::multiscale::flow::compute_permeability_y(const parameters& par, const std::
  */
 double
 hgf::multiscale::flow::compute_permeability_z(const parameters& par, const std::vector< int >& pressure_ib_list, \
-                                                                     const std::vector< degree_of_freedom >& velocity_u, \
-                                                                     const std::vector< degree_of_freedom >& velocity_v, \
-                                                                     const std::vector< degree_of_freedom >& velocity_w, \
+                                                                     const dof_store& velocity_u, \
+                                                                     const dof_store& velocity_v, \
+                                                                     const dof_store& velocity_w, \
                                                                      const std::vector< double > solution)
 {
   // quick exit
@@ -533,9 +571,9 @@ hgf::multiscale::flow::compute_permeability_z(const parameters& par, const std::
  */
 void
 hgf::multiscale::flow::compute_permeability_tensor(const parameters& par, const std::vector< int >& pressure_ib_list, \
-                                                                          const std::vector< degree_of_freedom >& velocity_u, \
-                                                                          const std::vector< degree_of_freedom >& velocity_v, \
-                                                                          const std::vector< degree_of_freedom >& velocity_w, \
+                                                                          const dof_store& velocity_u, \
+                                                                          const dof_store& velocity_v, \
+                                                                          const dof_store& velocity_w, \
                                                                           const std::vector< double > solution_xflow, \
                                                                           const std::vector< double > solution_yflow, \
                                                                           const std::vector< double > solution_zflow, \
@@ -582,6 +620,11 @@ hgf::multiscale::flow::compute_permeability_tensor(const parameters& par, const
     compute_averages_y(par, pressure_ib_list, velocity_u, velocity_v, velocity_w, solution_zflow, vel[7], g_val[7]);
     compute_averages_z(par, pressure_ib_list, velocity_u, velocity_v, velocity_w, solution_zflow, vel[8], g_val[8]);
 
+    // periodic flows are driven along the flow axis only
+    if (par.periodic) {
+      for (int i = 0; i < 9; i++) if (i / 3 != i % 3) g_val[i] = 0;
+    }
+
     for (int i = 0; i < 9; i++) {
       g_val[i + 9] = g_val[i];
       g_val[i + 18] = g_val[i];
@@ -635,6 +678,11 @@ hgf::multiscale::flow::compute_permeability_tensor(const parameters& par, const
     compute_averages_x(par, pressure_ib_list, velocity_u, velocity_v, velocity_w, solution_yflow, vel[2], g_val[2]);
     compute_averages_y(par, pressure_ib_list, velocity_u, velocity_v, velocity_w, solution_yflow, vel[3], g_val[3]);
 
+    // periodic flows are driven along the flow axis only
+    if (par.periodic) {
+      for (int i = 0; i < 4; i++) if (i / 2 != i % 2) g_val[i] = 0;
+    }
+
     for (int i = 0; i < 4; i++) {
       g_val[i + 4] = g_val[i];
     }
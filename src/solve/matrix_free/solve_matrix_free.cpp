@@ -0,0 +1,128 @@
+#include "solve_matrix_free.hpp"
+
+// 1d->2d index
+#define idx2(i, j, ldi) ((i * ldi) + j)
+
+static double
+dot(const std::vector< double >& a, const std::vector< double >& b)
+{
+  double sum = 0;
+#pragma omp parallel for schedule(static) reduction(+:sum)
+  for (hgf_index ii = 0; ii < (hgf_index)a.size(); ii++) sum += a[ii] * b[ii];
+  return sum;
+}
+
+/** \brief hgf::solve::matrix_free::gmres solves a linear system with restarted, right preconditioned GMRES.
+ *
+ * The matrix is only accessed through op, e.g. a lambda calling hgf::models::stokes::apply, so no sparse storage is needed.
+ * Tolerances, the iteration limit and console output are taken from the solver controls in par.
+ * @param[in] par - parameters struct containig basic problem information.
+ * @param[in] op - computes the product of the system matrix with a vector.
+ * @param[in] diagonal - diagonal of the system matrix used for Jacobi preconditioning, e.g. from hgf::models::stokes::operator_diagonal, which scales the
+ * pressure rows by a Schur complement diagonal; zero entries are left unscaled, pass an empty vector for no preconditioning.
+ * @param[in] rhs - right hand side vector for the linear system to be solved.
+ * @param[in,out] solution - initial guess if sized like rhs, otherwise zero is used; the solution of the system is stored here.
+ * @param[in] restart - number of Krylov basis vectors kept between restarts. The basis and three work vectors take 8 (restart + 4) bytes
+ * per unknown, about 270 bytes at the default of 30, more than the assembled Stokes matrix, so keep restart small on large systems.
+ * @return number of iterations performed.
+ */
+int
+hgf::solve::matrix_free::gmres(const parameters& par, \
+  const linear_operator& op, \
+  const std::vector< double >& diagonal, \
+  const std::vector< double >& rhs, \
+  std::vector< double >& solution, \
+  int restart)
+{
+  hgf_index n = (hgf_index)rhs.size();
+  if (solution.size() != rhs.size()) solution.assign(n, 0);
+
+  std::vector< double > inv_diag(n, 1.0);
+  if ((hgf_index)diagonal.size() == n) {
+    for (hgf_index ii = 0; ii < n; ii++) if (diagonal[ii] != 0) inv_diag[ii] = 1.0 / diagonal[ii];
+  }
+
+  std::vector< std::vector< double > > basis(restart + 1, std::vector< double >(n));
+  std::vector< double > hess((restart + 1) * restart), cs(restart), sn(restart), g(restart + 1), y(restart);
+  std::vector< double > z(n), w(n);
+
+  double tol = std::max(par.solver_absolute_tolerance, par.solver_relative_tolerance * sqrt(dot(rhs, rhs)));
+
+  // initial residual
+  op(solution, w);
+#pragma omp parallel for schedule(static)
+  for (hgf_index ii = 0; ii < n; ii++) w[ii] = rhs[ii] - w[ii];
+  double beta = sqrt(dot(w, w));
+
+  int iter = 0;
+  while (beta > tol && iter < par.solver_max_iterations) {
+
+#pragma omp parallel for schedule(static)
+    for (hgf_index ii = 0; ii < n; ii++) basis[0][ii] = w[ii] / beta;
+    std::fill(g.begin(), g.end(), 0.0);
+    g[0] = beta;
+
+    int k = 0;
+    for (int jj = 0; jj < restart; jj++) {
+#pragma omp parallel for schedule(static)
+      for (hgf_index ii = 0; ii < n; ii++) z[ii] = inv_diag[ii] * basis[jj][ii];
+      op(z, w);
+
+      // modified Gram-Schmidt
+      for (int ii = 0; ii <= jj; ii++) {
+        double h = dot(w, basis[ii]);
+        hess[idx2(ii, jj, restart)] = h;
+#pragma omp parallel for schedule(static)
+        for (hgf_index ll = 0; ll < n; ll++) w[ll] -= h * basis[ii][ll];
+      }
+      double h_next = sqrt(dot(w, w));
+      if (h_next > 0) {
+#pragma omp parallel for schedule(static)
+        for (hgf_index ll = 0; ll < n; ll++) basis[jj + 1][ll] = w[ll] / h_next;
+      }
+
+      // Givens rotations reduce the Hessenberg column to upper triangular form
+      for (int ii = 0; ii < jj; ii++) {
+        double temp = cs[ii] * hess[idx2(ii, jj, restart)] + sn[ii] * hess[idx2((ii + 1), jj, restart)];
+        hess[idx2((ii + 1), jj, restart)] = -sn[ii] * hess[idx2(ii, jj, restart)] + cs[ii] * hess[idx2((ii + 1), jj, restart)];
+        hess[idx2(ii, jj, restart)] = temp;
+      }
+      double rr = sqrt(hess[idx2(jj, jj, restart)] * hess[idx2(jj, jj, restart)] + h_next * h_next);
+      cs[jj] = (rr > 0) ? hess[idx2(jj, jj, restart)] / rr : 1.0;
+      sn[jj] = (rr > 0) ? h_next / rr : 0.0;
+      hess[idx2(jj, jj, restart)] = rr;
+      g[jj + 1] = -sn[jj] * g[jj];
+      g[jj] = cs[jj] * g[jj];
+
+      iter++;
+      k = jj + 1;
+      if (par.solver_verbose > 1) std::cout << "GMRES iteration " << iter << ", residual = " << fabs(g[jj + 1]) << "\n";
+      if (fabs(g[jj + 1]) <= tol || iter >= par.solver_max_iterations || h_next == 0) break;
+    }
+
+    // update the solution with the least squares combination of the basis
+    for (int ii = k - 1; ii >= 0; ii--) {
+      y[ii] = g[ii];
+      for (int ll = ii + 1; ll < k; ll++) y[ii] -= hess[idx2(ii, ll, restart)] * y[ll];
+      y[ii] /= hess[idx2(ii, ii, restart)];
+    }
+#pragma omp parallel for schedule(static)
+    for (hgf_index ll = 0; ll < n; ll++) {
+      double sum = 0;
+      for (int ii = 0; ii < k; ii++) sum += y[ii] * basis[ii][ll];
+      solution[ll] += inv_diag[ll] * sum;
+    }
+
+    // true residual
+    op(solution, w);
+#pragma omp parallel for schedule(static)
+    for (hgf_index ii = 0; ii < n; ii++) w[ii] = rhs[ii] - w[ii];
+    beta = sqrt(dot(w, w));
+  }
+
+  if (par.solver_verbose) {
+    std::cout << "GMRES (matrix-free) " << ((beta <= tol) ? "converged" : "stopped") << " after " << iter \
+              << " iterations, residual = " << beta << "\n";
+  }
+  return iter;
+}
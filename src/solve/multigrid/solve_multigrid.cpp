@@ -0,0 +1,462 @@
+#include "solve_multigrid.hpp"
+
+// 1d->2d index
+#define idx2(i, j, ldi) ((i * ldi) + j)
+
+// levels with at most this many unknowns are solved directly
+static const int coarsest_size = 512;
+
+// red-black Gauss-Seidel sweeps before and after each coarse grid correction
+static const int smoothing_sweeps = 2;
+
+// coarse operators are scaled by one half, matching the rediscretization of a 5 or 7-point stencil on a doubled lattice
+static const double coarse_scale = 0.5;
+
+static double
+dot(const std::vector< double >& a, const std::vector< double >& b)
+{
+  double sum = 0;
+#pragma omp parallel for schedule(static) reduction(+:sum)
+  for (hgf_index ii = 0; ii < (hgf_index)a.size(); ii++) sum += a[ii] * b[ii];
+  return sum;
+}
+
+// y = A x
+static void
+multiply(const array_csr& array, const std::vector< double >& x, std::vector< double >& y)
+{
+#pragma omp parallel for schedule(static)
+  for (hgf_index row = 0; row < array.n_rows; row++) {
+    double sum = 0;
+    for (hgf_index pos = array.row_ptr[row]; pos < array.row_ptr[row + 1]; pos++) sum += array.value[pos] * x[array.col_index[pos]];
+    y[row] = sum;
+  }
+}
+
+// r = b - A x
+static void
+residual(const array_csr& array, const std::vector< double >& b, const std::vector< double >& x, std::vector< double >& r)
+{
+#pragma omp parallel for schedule(static)
+  for (hgf_index row = 0; row < array.n_rows; row++) {
+    double sum = b[row];
+    for (hgf_index pos = array.row_ptr[row]; pos < array.row_ptr[row + 1]; pos++) sum -= array.value[pos] * x[array.col_index[pos]];
+    r[row] = sum;
+  }
+}
+
+// sorts the entries of each row by column and merges repeated columns, rows are independent
+static void
+merge_rows(std::vector< hgf_index >& row_ptr, std::vector< std::pair< hgf_index, double > >& entries, array_csr& csr)
+{
+  hgf_index n = (hgf_index)row_ptr.size() - 1;
+  std::vector< hgf_index > row_size(n + 1, 0);
+#pragma omp parallel for schedule(static)
+  for (hgf_index row = 0; row < n; row++) {
+    std::sort(entries.begin() + row_ptr[row], entries.begin() + row_ptr[row + 1]);
+    hgf_index last = row_ptr[row];
+    for (hgf_index pos = row_ptr[row]; pos < row_ptr[row + 1]; pos++) {
+      if (last > row_ptr[row] && entries[last - 1].first == entries[pos].first) entries[last - 1].second += entries[pos].second;
+      else entries[last++] = entries[pos];
+    }
+    row_size[row + 1] = last - row_ptr[row];
+  }
+
+  csr.n_rows = n;
+  csr.n_cols = n;
+  csr.row_ptr.resize(n + 1);
+  csr.row_ptr[0] = 0;
+  for (hgf_index row = 0; row < n; row++) csr.row_ptr[row + 1] = csr.row_ptr[row] + row_size[row + 1];
+  csr.col_index.resize(csr.row_ptr[n]);
+  csr.value.resize(csr.row_ptr[n]);
+#pragma omp parallel for schedule(static)
+  for (hgf_index row = 0; row < n; row++) {
+    for (hgf_index kk = 0; kk < csr.row_ptr[row + 1] - csr.row_ptr[row]; kk++) {
+      csr.col_index[csr.row_ptr[row] + kk] = entries[row_ptr[row] + kk].first;
+      csr.value[csr.row_ptr[row] + kk] = entries[row_ptr[row] + kk].second;
+    }
+  }
+}
+
+// converts a coo array with repeated entries to csr with a counting sort by row
+static void
+coo_to_csr(const std::vector< array_coo >& array, hgf_index n, array_csr& csr)
+{
+  std::vector< hgf_index > row_ptr(n + 1, 0);
+  for (hgf_index ii = 0; ii < (hgf_index)array.size(); ii++) {
+    if (array[ii].i_index < 0 || array[ii].i_index >= n || array[ii].j_index < 0 || array[ii].j_index >= n) {
+      std::cout << "\nEntry (" << array[ii].i_index << ", " << array[ii].j_index << ") is outside the " << n << " unknowns of the multigrid hierarchy. Exiting.\n";
+      exit(0);
+    }
+    row_ptr[array[ii].i_index + 1]++;
+  }
+  for (hgf_index row = 0; row < n; row++) row_ptr[row + 1] += row_ptr[row];
+  std::vector< std::pair< hgf_index, double > > entries(array.size());
+  std::vector< hgf_index > next(row_ptr.begin(), row_ptr.end() - 1);
+  for (hgf_index ii = 0; ii < (hgf_index)array.size(); ii++) {
+    entries[next[array[ii].i_index]++] = std::make_pair(array[ii].j_index, array[ii].value);
+  }
+  merge_rows(row_ptr, entries, csr);
+}
+
+// lattice coordinates of a lattice index
+static inline void
+lattice_coords(int32_t p, const int lattice[3], int c[3])
+{
+  c[0] = p % lattice[0];
+  c[1] = (p / lattice[0]) % lattice[1];
+  c[2] = p / (lattice[0] * lattice[1]);
+}
+
+/** \brief hgf::solve::multigrid::hierarchy::build builds the multigrid hierarchy of a system given in COO format, such as hgf::models::poisson::coo_array.
+ *
+ * Repeated entries are summed. The unknowns must be the non-solid voxels of par.voxel_geometry, in voxel order.
+ * @param[in] par - parameters struct containing the voxel geometry.
+ * @param[in] array - linear system of the finest level.
+ */
+void
+hgf::solve::multigrid::hierarchy::build(const parameters& par, const std::vector< array_coo >& array)
+{
+  clear();
+  hgf_index n = 0;
+  for (hgf_index ii = 0; ii < (hgf_index)par.voxel_geometry.size(); ii++) if (par.voxel_geometry[ii] != 1) n++;
+  grid.resize(1);
+  coo_to_csr(array, n, grid[0].op);
+  setup(par);
+}
+
+/** \brief hgf::solve::multigrid::hierarchy::build builds the multigrid hierarchy of a system given in CSR format.
+ *
+ * The unknowns must be the non-solid voxels of par.voxel_geometry, in voxel order.
+ * @param[in] par - parameters struct containing the voxel geometry.
+ * @param[in] array - linear system of the finest level.
+ */
+void
+hgf::solve::multigrid::hierarchy::build(const parameters& par, const array_csr& array)
+{
+  clear();
+  grid.resize(1);
+  grid[0].op = array;
+  // rows are sorted by column for the coarse operators
+#pragma omp parallel for schedule(static)
+  for (hgf_index row = 0; row < array.n_rows; row++) {
+    std::vector< std::pair< hgf_index, double > > entries;
+    for (hgf_index pos = array.row_ptr[row]; pos < array.row_ptr[row + 1]; pos++) {
+      entries.push_back(std::make_pair(array.col_index[pos], array.value[pos]));
+    }
+    std::sort(entries.begin(), entries.end());
+    for (hgf_index kk = 0; kk < (hgf_index)entries.size(); kk++) {
+      grid[0].op.col_index[array.row_ptr[row] + kk] = entries[kk].first;
+      grid[0].op.value[array.row_ptr[row] + kk] = entries[kk].second;
+    }
+  }
+  setup(par);
+}
+
+// builds the levels below the finest operator in grid[0]
+void
+hgf::solve::multigrid::hierarchy::setup(const parameters& par)
+{
+  // unknowns of the finest level
+  grid[0].lattice[0] = par.nx;
+  grid[0].lattice[1] = par.ny;
+  grid[0].lattice[2] = (par.dimension == 3) ? par.nz : 1;
+  for (int32_t ii = 0; ii < (int32_t)par.voxel_geometry.size(); ii++) {
+    if (par.voxel_geometry[ii] != 1) grid[0].position.push_back(ii);
+  }
+  if ((hgf_index)grid[0].position.size() != grid[0].op.n_rows) {
+    std::cout << "\nThe linear system has " << grid[0].op.n_rows << " rows, but the geometry has " << grid[0].position.size() \
+              << " non-solid voxels. Multigrid requires one unknown per non-solid voxel. Exiting.\n";
+    exit(0);
+  }
+
+  for (int depth = 0; ; depth++) {
+    int n = (int)grid[depth].op.n_rows;
+    const int* lattice = grid[depth].lattice;
+
+    // smoother colors: lattice parity, which separates the unknowns of a 5 or 7-point stencil, except across periodic
+    // faces of odd length, where the first color free among the coupled unknowns already colored is taken instead
+    {
+      level& lvl = grid[depth];
+      const array_csr& op = lvl.op;
+      std::vector< int > color(n, 0);
+      std::vector< char > used;
+      int n_colors = 2;
+      for (int ii = 0; ii < n; ii++) {
+        int c[3];
+        lattice_coords(lvl.position[ii], lattice, c);
+        used.assign(n_colors + 1, 0);
+        for (hgf_index pos = op.row_ptr[ii]; pos < op.row_ptr[ii + 1]; pos++) {
+          int jj = (int)op.col_index[pos];
+          if (jj < ii && op.value[pos] != 0) used[color[jj]] = 1;
+        }
+        int pick = (c[0] + c[1] + c[2]) % 2;
+        if (used[pick]) {
+          pick = 0;
+          while (used[pick]) pick++;
+        }
+        color[ii] = pick;
+        n_colors = std::max(n_colors, pick + 1);
+      }
+      lvl.colors.assign(n_colors, std::vector< int >());
+      for (int ii = 0; ii < n; ii++) lvl.colors[color[ii]].push_back(ii);
+
+      lvl.inv_diag.assign(n, 0.0);
+#pragma omp parallel for schedule(static)
+      for (int ii = 0; ii < n; ii++) {
+        for (hgf_index pos = op.row_ptr[ii]; pos < op.row_ptr[ii + 1]; pos++) {
+          if (op.col_index[pos] == ii && op.value[pos] != 0) lvl.inv_diag[ii] = 1.0 / op.value[pos];
+        }
+      }
+      lvl.rhs.assign(n, 0.0);
+      lvl.sol.assign(n, 0.0);
+      lvl.res.assign(n, 0.0);
+    }
+    if (n <= coarsest_size || (lattice[0] == 1 && lattice[1] == 1 && lattice[2] == 1)) break;
+
+    // coarse cells are 2x2(x2) blocks of the lattice holding at least one unknown, numbered in lattice order
+    int coarse_lattice[3];
+    for (int kk = 0; kk < 3; kk++) coarse_lattice[kk] = (lattice[kk] + 1) / 2;
+    std::vector< int > coarse_map((size_t)coarse_lattice[0] * coarse_lattice[1] * coarse_lattice[2], -1);
+    std::vector< int32_t > coarse_position(n);
+#pragma omp parallel for schedule(static)
+    for (int ii = 0; ii < n; ii++) {
+      int c[3];
+      lattice_coords(grid[depth].position[ii], lattice, c);
+      coarse_position[ii] = (c[0] / 2) + coarse_lattice[0] * ((c[1] / 2) + coarse_lattice[1] * (c[2] / 2));
+    }
+    for (int ii = 0; ii < n; ii++) coarse_map[coarse_position[ii]] = 0;
+    level next;
+    for (int kk = 0; kk < 3; kk++) next.lattice[kk] = coarse_lattice[kk];
+    for (int32_t pp = 0; pp < (int32_t)coarse_map.size(); pp++) {
+      if (coarse_map[pp] == 0) {
+        coarse_map[pp] = (int)next.position.size();
+        next.position.push_back(pp);
+      }
+    }
+    int n_coarse = (int)next.position.size();
+
+    // aggregates of each coarse unknown
+    level& fine = grid[depth];
+    fine.coarse.resize(n);
+    fine.aggregate_ptr.assign(n_coarse + 1, 0);
+    fine.aggregate.resize(n);
+    for (int ii = 0; ii < n; ii++) {
+      fine.coarse[ii] = coarse_map[coarse_position[ii]];
+      fine.aggregate_ptr[fine.coarse[ii] + 1]++;
+    }
+    for (int cc = 0; cc < n_coarse; cc++) fine.aggregate_ptr[cc + 1] += fine.aggregate_ptr[cc];
+    std::vector< int > fill(fine.aggregate_ptr.begin(), fine.aggregate_ptr.end() - 1);
+    for (int ii = 0; ii < n; ii++) fine.aggregate[fill[fine.coarse[ii]]++] = ii;
+
+    // Galerkin coarse operator, one row per aggregate
+    std::vector< hgf_index > row_ptr(n_coarse + 1, 0);
+    for (int cc = 0; cc < n_coarse; cc++) {
+      row_ptr[cc + 1] = row_ptr[cc];
+      for (int kk = fine.aggregate_ptr[cc]; kk < fine.aggregate_ptr[cc + 1]; kk++) {
+        int ii = fine.aggregate[kk];
+        row_ptr[cc + 1] += fine.op.row_ptr[ii + 1] - fine.op.row_ptr[ii];
+      }
+    }
+    std::vector< std::pair< hgf_index, double > > entries(row_ptr[n_coarse]);
+#pragma omp parallel for schedule(static)
+    for (int cc = 0; cc < n_coarse; cc++) {
+      hgf_index pos = row_ptr[cc];
+      for (int kk = fine.aggregate_ptr[cc]; kk < fine.aggregate_ptr[cc + 1]; kk++) {
+        int ii = fine.aggregate[kk];
+        for (hgf_index ll = fine.op.row_ptr[ii]; ll < fine.op.row_ptr[ii + 1]; ll++) {
+          entries[pos++] = std::make_pair((hgf_index)fine.coarse[fine.op.col_index[ll]], coarse_scale * fine.op.value[ll]);
+        }
+      }
+    }
+    merge_rows(row_ptr, entries, next.op);
+    grid.push_back(next);
+  }
+
+  // dense LU factors with partial pivoting of the coarsest operator
+  const array_csr& op = grid.back().op;
+  int n = (int)op.n_rows;
+  lu.assign((size_t)n * n, 0.0);
+  pivot.resize(n);
+  for (int ii = 0; ii < n; ii++) {
+    for (hgf_index pos = op.row_ptr[ii]; pos < op.row_ptr[ii + 1]; pos++) lu[idx2(ii, op.col_index[pos], n)] += op.value[pos];
+  }
+  for (int kk = 0; kk < n; kk++) {
+    int pp = kk;
+    for (int ii = kk + 1; ii < n; ii++) if (fabs(lu[idx2(ii, kk, n)]) > fabs(lu[idx2(pp, kk, n)])) pp = ii;
+    pivot[kk] = pp;
+    if (pp != kk) for (int jj = 0; jj < n; jj++) std::swap(lu[idx2(kk, jj, n)], lu[idx2(pp, jj, n)]);
+    // a zero pivot is left in place, its unknown is set to zero by the solve
+    if (lu[idx2(kk, kk, n)] == 0) continue;
+#pragma omp parallel for schedule(static)
+    for (int ii = kk + 1; ii < n; ii++) {
+      double factor = lu[idx2(ii, kk, n)] / lu[idx2(kk, kk, n)];
+      lu[idx2(ii, kk, n)] = factor;
+      for (int jj = kk + 1; jj < n; jj++) lu[idx2(ii, jj, n)] -= factor * lu[idx2(kk, jj, n)];
+    }
+  }
+}
+
+// one red-black Gauss-Seidel sweep of lvl.sol, visiting the colors in reverse order when not forward
+void
+hgf::solve::multigrid::hierarchy::smooth(level& lvl, bool forward)
+{
+  const array_csr& op = lvl.op;
+  int n_colors = (int)lvl.colors.size();
+  for (int kk = 0; kk < n_colors; kk++) {
+    const std::vector< int >& rows = lvl.colors[forward ? kk : n_colors - 1 - kk];
+#pragma omp parallel for schedule(static)
+    for (int ll = 0; ll < (int)rows.size(); ll++) {
+      int ii = rows[ll];
+      double sum = lvl.rhs[ii];
+      for (hgf_index pos = op.row_ptr[ii]; pos < op.row_ptr[ii + 1]; pos++) sum -= op.value[pos] * lvl.sol[op.col_index[pos]];
+      lvl.sol[ii] += lvl.inv_diag[ii] * sum;
+    }
+  }
+}
+
+// V-cycle for grid[depth].sol from a zero initial guess
+void
+hgf::solve::multigrid::hierarchy::cycle(int depth)
+{
+  level& lvl = grid[depth];
+  int n = (int)lvl.op.n_rows;
+
+  // direct solve on the coarsest level
+  if (depth == (int)grid.size() - 1) {
+    for (int ii = 0; ii < n; ii++) lvl.sol[ii] = lvl.rhs[ii];
+    for (int kk = 0; kk < n; kk++) std::swap(lvl.sol[kk], lvl.sol[pivot[kk]]);
+    for (int ii = 0; ii < n; ii++) {
+      for (int jj = 0; jj < ii; jj++) lvl.sol[ii] -= lu[idx2(ii, jj, n)] * lvl.sol[jj];
+    }
+    for (int ii = n - 1; ii >= 0; ii--) {
+      if (lu[idx2(ii, ii, n)] == 0) {
+        lvl.sol[ii] = 0;
+        continue;
+      }
+      for (int jj = ii + 1; jj < n; jj++) lvl.sol[ii] -= lu[idx2(ii, jj, n)] * lvl.sol[jj];
+      lvl.sol[ii] /= lu[idx2(ii, ii, n)];
+    }
+    return;
+  }
+
+  std::fill(lvl.sol.begin(), lvl.sol.end(), 0.0);
+  for (int ss = 0; ss < smoothing_sweeps; ss++) smooth(lvl, true);
+
+  // restrict the residual, summing over each aggregate
+  level& next = grid[depth + 1];
+  residual(lvl.op, lvl.rhs, lvl.sol, lvl.res);
+#pragma omp parallel for schedule(static)
+  for (int cc = 0; cc < (int)next.op.n_rows; cc++) {
+    double sum = 0;
+    for (int kk = lvl.aggregate_ptr[cc]; kk < lvl.aggregate_ptr[cc + 1]; kk++) sum += lvl.res[lvl.aggregate[kk]];
+    next.rhs[cc] = sum;
+  }
+  cycle(depth + 1);
+
+  // interpolate the correction, constant on each aggregate
+#pragma omp parallel for schedule(static)
+  for (int ii = 0; ii < n; ii++) lvl.sol[ii] += next.sol[lvl.coarse[ii]];
+  for (int ss = 0; ss < smoothing_sweeps; ss++) smooth(lvl, false);
+}
+
+/** \brief hgf::solve::multigrid::hierarchy::vcycle applies one V-cycle to a residual, for use as a preconditioner.
+ *
+ * The cycle is symmetric, so it may precondition conjugate gradients when the system is symmetric.
+ * @param[in] residual - residual on the finest level.
+ * @param[out] correction - approximate solution of the system with the residual as right-hand side, resized if needed.
+ */
+void
+hgf::solve::multigrid::hierarchy::vcycle(const std::vector< double >& residual, std::vector< double >& correction)
+{
+  level& lvl = grid[0];
+  std::copy(residual.begin(), residual.end(), lvl.rhs.begin());
+  cycle(0);
+  correction = lvl.sol;
+}
+
+/** \brief hgf::solve::multigrid::hierarchy::solve solves the finest level system with conjugate gradients preconditioned by a V-cycle.
+ *
+ * Requires a symmetric system, as assembled by the Poisson model. The number of iterations is close to independent of
+ * the lattice size. Tolerances, the iteration limit and console output are taken from the solver controls in par.
+ * @param[in] par - parameters struct containig basic problem information.
+ * @param[in] rhs - right hand side vector for the linear system to be solved.
+ * @param[in,out] solution - initial guess if sized like rhs, otherwise zero is used; the solution of the system is stored here.
+ * @return number of iterations performed.
+ */
+int
+hgf::solve::multigrid::hierarchy::solve(const parameters& par, const std::vector< double >& rhs, std::vector< double >& solution)
+{
+  const array_csr& op = grid[0].op;
+  hgf_index n = op.n_rows;
+  if ((hgf_index)solution.size() != n) solution.assign(n, 0);
+
+  std::vector< double > r(n), z(n), p(n), q(n);
+  double tol = std::max(par.solver_absolute_tolerance, par.solver_relative_tolerance * sqrt(dot(rhs, rhs)));
+
+  residual(op, rhs, solution, r);
+  double norm = sqrt(dot(r, r));
+  int iter = 0;
+  if (norm > tol) {
+    vcycle(r, z);
+    p = z;
+  }
+  double rz = dot(r, z);
+  while (norm > tol && iter < par.solver_max_iterations) {
+    multiply(op, p, q);
+    double alpha = rz / dot(p, q);
+#pragma omp parallel for schedule(static)
+    for (hgf_index ii = 0; ii < n; ii++) {
+      solution[ii] += alpha * p[ii];
+      r[ii] -= alpha * q[ii];
+    }
+    norm = sqrt(dot(r, r));
+    iter++;
+    if (par.solver_verbose > 1) std::cout << "CG iteration " << iter << ", residual = " << norm << "\n";
+    if (norm <= tol) break;
+
+    vcycle(r, z);
+    double rz_next = dot(r, z);
+    double beta = rz_next / rz;
+    rz = rz_next;
+#pragma omp parallel for schedule(static)
+    for (hgf_index ii = 0; ii < n; ii++) p[ii] = z[ii] + beta * p[ii];
+  }
+
+  if (par.solver_verbose) {
+    std::cout << "CG (multigrid, " << grid.size() << " levels) " << ((norm <= tol) ? "converged" : "stopped") << " after " << iter \
+              << " iterations, residual = " << norm << "\n";
+  }
+  return iter;
+}
+
+/** \brief hgf::solve::multigrid::hierarchy::clear releases all levels of the hierarchy.
+ *
+ */
+void
+hgf::solve::multigrid::hierarchy::clear(void)
+{
+  grid.clear();
+  lu.clear();
+  pivot.clear();
+}
+
+/** \brief hgf::solve::multigrid::solve solves a cell-centered voxel system, such as the Poisson model, with multigrid preconditioned conjugate gradients.
+ *
+ * Builds a hierarchy for a single solve; keep a hgf::solve::multigrid::hierarchy to solve repeatedly with the same system.
+ * @param[in] par - parameters struct containig basic problem information.
+ * @param[in] array - linear system in COO format with one unknown per non-solid voxel of par.voxel_geometry, repeated entries are summed.
+ * @param[in] rhs - right hand side vector for the linear system to be solved.
+ * @param[in,out] solution - initial guess if sized like rhs, otherwise zero is used; the solution of the system is stored here.
+ * @return number of iterations performed.
+ */
+int
+hgf::solve::multigrid::solve(const parameters& par, \
+  const std::vector< array_coo >& array, \
+  const std::vector< double >& rhs, \
+  std::vector< double >& solution)
+{
+  hierarchy mg;
+  mg.build(par, array);
+  return mg.solve(par, rhs, solution);
+}
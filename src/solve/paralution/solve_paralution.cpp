@@ -14,86 +14,657 @@ hgf::solve::paralution::init_solver(void)
   init_paralution();
 }
 
-/** \brief hgf::solve::paralution::solve solves a linear system with a simple GMRES + ILU preconditioning strategy.
- * 
- * @param[in] par - parameters struct containig basic problem information.
- * @param[in] array - linear system matrix stored in coordinate sparse format.
- * @param[in] rhs - right hand side vector for the linear system to be solved.
- * @param[out] solution - solution of the system is stored here.
- */
-void
-hgf::solve::paralution::solve(const parameters& par, \
-  const std::vector< array_coo >& array, \
-  const std::vector< double >& rhs, std::vector< double >& solution)
+typedef IterativeLinearSolver<LocalMatrix<double>, LocalVector<double>, double> double_solver;
+
+/* Velocity block sizes of a Stokes system and the approximation of its pressure Schur complement, stored in CSR
+   with the int indices of PARALUTION, with the inverse of the scaled pressure mass matrix added to its inverse when
+   inverse_mass is not empty. The Schur complement approximation is left empty for ps_flow_ilu. */
+struct saddle_point
 {
-  set_omp_threads_paralution(omp_get_max_threads());
+  hgf_index blocks[3];
+  std::vector< int > row_ptr;
+  std::vector< int > col_index;
+  std::vector< double > value;
+  std::vector< double > inverse_mass;
+};
+
+/* Pressure block solver of ps_flow for the additive Schur complement approximation: one AMG V-cycle on the operator,
+   the wall friction Schur complement of schur_approximation, plus the inverse of the scaled pressure mass matrix.
+   The first term carries the walls of porous domains, the second the open fluid, where the operator is weak. */
+template< typename ValueType >
+class additive_schur : public Preconditioner<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType>
+{
+public:
+  void Set(const std::vector< double >& inverse_mass)
+  {
+    mass.assign(inverse_mass.begin(), inverse_mass.end());
+  }
+
+  void Print(void) const
+  {
+    std::cout << "Additive Schur complement preconditioner, AMG and scaled pressure mass matrix\n";
+  }
+
+  void Build(void)
+  {
+    if (this->build_) Clear();
+    amg.SetInterpolation(SmoothedAggregation);
+    amg.InitMaxIter(1);
+    amg.Verbose(0);
+    amg.SetOperator(*this->op_);
+    amg.Build();
+    inv_mass.Allocate("inverse mass", (int)mass.size());
+    inv_mass.CopyFromData(mass.data());
+    tmp.Allocate("additive schur", (int)mass.size());
+    this->build_ = true;
+  }
+
+  void Clear(void)
+  {
+    amg.Clear();
+    inv_mass.Clear();
+    tmp.Clear();
+    this->build_ = false;
+  }
+
+  void Solve(const LocalVector<ValueType>& rhs, LocalVector<ValueType>* x)
+  {
+    amg.SolveZeroSol(rhs, x);
+    tmp.PointWiseMult(inv_mass, rhs);
+    x->AddScale(tmp, 1.0);
+  }
+
+  void SolveZeroSol(const LocalVector<ValueType>& rhs, LocalVector<ValueType>* x) { Solve(rhs, x); }
+
+  ~additive_schur() { Clear(); }
+
+protected:
+  void MoveToHostLocalData_(void)
+  {
+    amg.MoveToHost();
+    inv_mass.MoveToHost();
+    tmp.MoveToHost();
+  }
+
+  void MoveToAcceleratorLocalData_(void)
+  {
+    amg.MoveToAccelerator();
+    inv_mass.MoveToAccelerator();
+    tmp.MoveToAccelerator();
+  }
+
+private:
+  std::vector< ValueType > mass;
+  AMG<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType> amg;
+  LocalVector<ValueType> inv_mass;
+  LocalVector<ValueType> tmp;
+};
+
+/* GMRES + ILU(2) in the precision of ValueType. The solver is declared last so it is cleared before its preconditioner. */
+template< typename ValueType >
+struct gmres_ilu
+{
+  ILU<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType> p;
+  GMRES<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType> ls;
+
+  void setup(const parameters& par, double relative_tolerance, const saddle_point*)
+  {
+    ls.Init(par.solver_absolute_tolerance, relative_tolerance, 1e8, par.solver_max_iterations);
+    ls.Verbose(par.solver_verbose);
+    p.Set(2);
+    ls.SetPreconditioner(p);
+  }
+  ~gmres_ilu() { ls.Clear(); }
+};
+
+/* FGMRES with a block lower triangular preconditioner for Stokes systems, in the precision of ValueType:
+   one AMG V-cycle on each velocity block, followed by the pressure block with the Schur complement approximation
+   of system, inverted exactly when it is diagonal and with additive_schur otherwise. The block sizes, Schur matrix
+   and block solvers are owned here, ahead of the preconditioner referencing them, so they are released after it. */
+template< typename ValueType >
+struct ps_flow
+{
+  std::vector< int > size;
+  LocalMatrix<ValueType> schur;
+  std::vector< std::unique_ptr< AMG<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType> > > blocks;
+  std::vector< Solver<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType>* > block_solvers;
+  Jacobi<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType> p_s;
+  additive_schur<ValueType> p_a;
+  BlockPreconditioner<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType> p;
+  FGMRES<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType> ls;
+
+  void add_amg(void)
+  {
+    blocks.push_back(std::unique_ptr< AMG<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType> >( \
+      new AMG<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType>));
+    blocks.back()->SetInterpolation(SmoothedAggregation);
+    blocks.back()->InitMaxIter(1);
+    blocks.back()->Verbose(0);
+    block_solvers.push_back(blocks.back().get());
+  }
 
+  void setup(const parameters& par, double relative_tolerance, const saddle_point* system)
+  {
+    ls.Init(par.solver_absolute_tolerance, relative_tolerance, 1e8, par.solver_max_iterations);
+    ls.Verbose(par.solver_verbose);
+    ls.SetBasisSize(100);
+
+    // velocity blocks
+    for (int ii = 0; ii < par.dimension; ii++) {
+      size.push_back((int)system->blocks[ii]);
+      add_amg();
+    }
+
+    // pressure block, on the Schur complement approximation instead of the zero block of the system
+    int n_p = (int)system->row_ptr.size() - 1;
+    int nnz = (int)system->value.size();
+    std::vector< ValueType > value(system->value.begin(), system->value.end());
+    schur.AllocateCSR("schur complement", nnz, n_p, n_p);
+    schur.CopyFromCSR(system->row_ptr.data(), system->col_index.data(), value.data());
+    size.push_back(n_p);
+    if (system->inverse_mass.empty()) block_solvers.push_back(&p_s);
+    else {
+      p_a.Set(system->inverse_mass);
+      block_solvers.push_back(&p_a);
+    }
+
+    p.Set(par.dimension + 1, size.data(), block_solvers.data());
+    p.SetLSolver();
+    p.SetExternalLastMatrix(schur);
+
+    ls.SetPreconditioner(p);
+  }
+  ~ps_flow()
+  {
+    ls.Clear();
+    p.Clear();
+    schur.Clear();
+  }
+};
+
+/* FGMRES with the saddle point preconditioner of earlier versions, in the precision of ValueType: multi-colored
+   ILU(3) on each velocity block and Jacobi on the Schur complement. The block sizes and solvers are owned here,
+   ahead of the preconditioners referencing them, so they are released after them. */
+template< typename ValueType >
+struct ps_flow_ilu
+{
+  std::vector< int > size;
+  std::vector< std::unique_ptr< MultiColoredILU<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType> > > blocks;
+  std::vector< Solver<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType>* > block_solvers;
+  Jacobi<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType> p_s;
+  BlockPreconditioner<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType> p_k;
+  DiagJacobiSaddlePointPrecond<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType> p;
+  FGMRES<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType> ls;
+
+  void setup(const parameters& par, double relative_tolerance, const saddle_point* system)
+  {
+    ls.Init(par.solver_absolute_tolerance, relative_tolerance, 1e8, par.solver_max_iterations);
+    ls.Verbose(par.solver_verbose);
+    ls.SetBasisSize(100);
+
+    // Upper preconditioner is a block preconditioner broken up for velocity components
+    for (int ii = 0; ii < par.dimension; ii++) {
+      size.push_back((int)system->blocks[ii]);
+      blocks.push_back(std::unique_ptr< MultiColoredILU<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType> >( \
+        new MultiColoredILU<LocalMatrix<ValueType>, LocalVector<ValueType>, ValueType>));
+      blocks.back()->Set(3);
+      block_solvers.push_back(blocks.back().get());
+    }
+    p_k.Set(par.dimension, size.data(), block_solvers.data());
+
+    // lower preconditioner
+    p.Set(p_k, p_s);
+
+    ls.SetPreconditioner(p);
+  }
+  ~ps_flow_ilu()
+  {
+    ls.Clear();
+    p.Clear();
+  }
+};
+
+/* A built solver for a double precision operator, released with its preconditioner when deleted. */
+struct solver_stack
+{
+  virtual ~solver_stack() {}
+  virtual double_solver& solver(void) = 0;
+};
+
+template< template< typename > class STACK >
+struct double_stack : solver_stack
+{
+  STACK< double > stack;
+  double_solver& solver(void) { return stack.ls; }
+};
+
+template< template< typename > class STACK >
+struct mixed_stack : solver_stack
+{
+  STACK< float > stack;
+  MixedPrecisionDC<LocalMatrix<double>, LocalVector<double>, double, \
+    LocalMatrix<float>, LocalVector<float>, float> dc;
+  double_solver& solver(void) { return dc; }
+  ~mixed_stack() { dc.Clear(); }
+};
+
+/* Sets up and builds STACK for mat. With par.solver_mixed_precision set, STACK runs on a single precision copy of mat
+   inside a double precision defect correction, trading inner precision for speed: the SpMV and preconditioner sweeps of
+   the inner solve move half the bytes. The double precision mat is kept for the residuals, so the copy and the single
+   precision preconditioner add to peak memory rather than replacing anything.
+   system gives the blocks and Schur complement approximation of Stokes systems. */
+template< template< typename > class STACK >
+static solver_stack*
+build_stack(const parameters& par, LocalMatrix<double>& mat, const saddle_point* system)
+{
+  if (par.solver_mixed_precision) {
+    mixed_stack< STACK >* mixed = new mixed_stack< STACK >;
+    mixed->stack.setup(par, 1e-3, system);
+    mixed->dc.Init(par.solver_absolute_tolerance, par.solver_relative_tolerance, 1e8, par.solver_max_iterations);
+    mixed->dc.SetOperator(mat);
+    mixed->dc.Set(mixed->stack.ls);
+    mixed->dc.Verbose(par.solver_verbose);
+    mixed->dc.Build();
+    return mixed;
+  }
+  double_stack< STACK >* plain = new double_stack< STACK >;
+  plain->stack.setup(par, par.solver_relative_tolerance, system);
+  plain->stack.ls.SetOperator(mat);
+  plain->stack.ls.Build();
+  return plain;
+}
+
+/* Solves mat * sol = force with GMRES + ILU preconditioning, shared by the coo and csr interfaces. */
+static void
+solve_matrix(const parameters& par, LocalMatrix<double>& mat, \
+  LocalVector<double>& force, LocalVector<double>& sol)
+{
+#ifdef _PARALUTION_MATRIX_DEBUG
+  mat.WriteFileMTX("MatrixCheck.dat");
+  force.WriteFileASCII("RHS.dat");
+#endif
+
+  std::unique_ptr< solver_stack > stack(build_stack< gmres_ilu >(par, mat, NULL));
+  stack->solver().Solve(force, &sol);
+
+#ifdef _PARALUTION_SOLUTION_DEBUG
+  sol.WriteFileASCII("SOL.dat");
+#endif
+}
+
+/* Builds the Stokes preconditioner selected by par.solver_stokes_preconditioner for mat. */
+static solver_stack*
+build_ps_flow_stack(const parameters& par, LocalMatrix<double>& mat, const saddle_point& system)
+{
+  if (par.solver_stokes_preconditioner == 2) return build_stack< ps_flow_ilu >(par, mat, &system);
+  return build_stack< ps_flow >(par, mat, &system);
+}
+
+/* Solves a Stokes saddle point system held in mat, shared by the coo and csr interfaces. */
+static void
+solve_ps_flow_matrix(const parameters& par, LocalMatrix<double>& mat, \
+  LocalVector<double>& force, LocalVector<double>& sol, const saddle_point& system)
+{
+  std::unique_ptr< solver_stack > stack(build_ps_flow_stack(par, mat, system));
+  stack->solver().Solve(force, &sol);
+}
+
+/* PARALUTION indexes with int, so HGF_INDEX_64 does not extend these solvers; systems are checked to fit before they
+   are handed over, larger Stokes systems need hgf::solve::matrix_free::gmres. */
+static void
+check_paralution_size(hgf_index n_rows, hgf_index nnz)
+{
+  if (n_rows > INT_MAX || nnz > INT_MAX) {
+    std::cout << "\nLinear system with " << n_rows << " rows and " << nnz \
+              << " nonzeros exceeds the 32-bit indices of PARALUTION. Use hgf::solve::matrix_free::gmres instead.\n";
+    exit(0);
+  }
+}
+
+/* Copies a coo array into the arrays expected by LocalMatrix::Assemble. */
+static void
+assemble_coo(LocalMatrix<double>& mat, const std::vector< array_coo >& array, hgf_index n)
+{
   int *i_index, *j_index;
   double *value;
 
+  check_paralution_size(n, (hgf_index)array.size());
+
   i_index = (int *)malloc(array.size() * sizeof(int));
   j_index = (int *)malloc(array.size() * sizeof(int));
   value = (double *)malloc(array.size() * sizeof(double));
 
-  for (int ii = 0; ii < array.size(); ii++) {
+  for (int ii = 0; ii < (int)array.size(); ii++) {
     i_index[ii] = array[ii].i_index;
     j_index[ii] = array[ii].j_index;
     value[ii] = array[ii].value;
   }
 
-  LocalVector<double> sol;
-  LocalVector<double> force;
-  LocalMatrix<double> mat;
+  mat.Assemble(i_index, j_index, value, (int)array.size(), "operator", (int)n, (int)n);
 
-  force.Allocate("force vector", (int)rhs.size());
-  for (int ii = 0; ii < rhs.size(); ii++) {
-    force[ii] = rhs[ii];
+  free(i_index);
+  free(j_index);
+  free(value);
+}
+
+/* Copies a csr array into a LocalMatrix, no sorting or duplicate merging is needed.
+   With HGF_INDEX_64 the indices are narrowed to int copies. */
+static void
+assemble_csr(LocalMatrix<double>& mat, const array_csr& array)
+{
+#ifdef HGF_INDEX_64
+  check_paralution_size(array.n_rows, (hgf_index)array.value.size());
+  std::vector< int > row_ptr(array.row_ptr.begin(), array.row_ptr.end());
+  std::vector< int > col_index(array.col_index.begin(), array.col_index.end());
+  mat.AllocateCSR("operator", (int)array.value.size(), (int)array.n_rows, (int)array.n_cols);
+  mat.CopyFromCSR(row_ptr.data(), col_index.data(), array.value.data());
+#else
+  mat.AllocateCSR("operator", (int)array.value.size(), array.n_rows, array.n_cols);
+  mat.CopyFromCSR(array.row_ptr.data(), array.col_index.data(), array.value.data());
+#endif
+}
+
+/* Merged entries of one row of the Schur complement approximation C - B K^-1 B^T for the diagonal velocity matrix K
+   given in diagonal, sorted by column, or only its diagonal entry. A pressure coupled to nothing gets a unit diagonal. */
+static void
+schur_row(const array_csr& array, const std::vector< double >& diagonal, hgf_index n_vel, hgf_index row, \
+  bool diagonal_only, std::vector< std::pair< int, double > >& entries)
+{
+  hgf_index ii = n_vel + row;
+  entries.clear();
+  for (hgf_index pos = array.row_ptr[ii]; pos < array.row_ptr[ii + 1]; pos++) {
+    hgf_index jj = array.col_index[pos];
+    if (jj >= n_vel) {
+      if (!diagonal_only || jj == ii) entries.push_back(std::make_pair((int)(jj - n_vel), array.value[pos]));
+    }
+    else if (diagonal[jj] != 0) {
+      for (hgf_index ll = array.row_ptr[jj]; ll < array.row_ptr[jj + 1]; ll++) {
+        hgf_index kk = array.col_index[ll];
+        if (kk < n_vel || (diagonal_only && kk != ii)) continue;
+        entries.push_back(std::make_pair((int)(kk - n_vel), -array.value[pos] * array.value[ll] / diagonal[jj]));
+      }
+    }
+  }
+  std::sort(entries.begin(), entries.end());
+  hgf_index n = 0;
+  for (hgf_index kk = 0; kk < (hgf_index)entries.size(); kk++) {
+    if (n && entries[n - 1].first == entries[kk].first) entries[n - 1].second += entries[kk].second;
+    else entries[n++] = entries[kk];
   }
+  entries.resize(n);
+  if (diagonal_only && (n == 0 || entries[0].second == 0)) entries.assign(1, std::make_pair((int)row, 1.0));
+}
 
+/* Fraction of the velocity diagonal added to the wall friction of the additive Schur complement approximation.
+   Smaller values weaken S_K in open fluid and cost iterations in porous domains. */
+static const double schur_friction_floor = 0.05;
+
+/* Approximates the pressure Schur complement C - B A^-1 B^T of a Stokes system [A B^T; B C], velocities first.
+   With par.solver_stokes_preconditioner = 0 the approximation is additive, S^-1 = S_K^-1 + M^-1, and stays mesh
+   independent in open and porous domains. M = diag(C - B diag(A)^-1 B^T) is the pressure mass matrix scaled by the
+   velocity diagonal, minus the cell volume over the viscosity in the fluid interior. S_K = C - B K^-1 B^T uses the
+   wall friction of A: the part of each velocity diagonal in excess of its off-diagonal velocity entries, which comes
+   from walls, immersed boundaries and Brinkman drag, plus schur_friction_floor of the diagonal. S_K is a Darcy like
+   operator that carries the pore geometry, M takes over in open fluid where S_K is weak.
+   With 1 only M is kept, which converges well in open geometries but degrades quickly in porous ones.
+   With 2 only the block sizes are set, the saddle point preconditioner of ps_flow_ilu needs no approximation. */
+static void
+schur_approximation(const parameters& par, const array_csr& array, \
+  hgf_index n_u, hgf_index n_v, hgf_index n_w, hgf_index n_p, saddle_point& system)
+{
+  hgf_index n_vel = n_u + n_v + n_w;
+  bool diagonal_only = (par.solver_stokes_preconditioner == 1);
+  if (par.solver_stokes_preconditioner < 0 || par.solver_stokes_preconditioner > 2) {
+    std::cout << "\n" << par.solver_stokes_preconditioner << " is not a valid Stokes preconditioner. See include/types.hpp. Exiting.\n";
+    exit(0);
+  }
+  system.blocks[0] = n_u;
+  system.blocks[1] = n_v;
+  system.blocks[2] = n_w;
+  if (n_vel + n_p != array.n_rows) {
+    std::cout << "\nBlock sizes " << n_u << ", " << n_v << ", " << n_w << ", " << n_p << " do not add up to the " \
+              << array.n_rows << " rows of the Stokes system. Exiting.\n";
+    exit(0);
+  }
+  system.row_ptr.clear();
+  system.col_index.clear();
+  system.value.clear();
+  system.inverse_mass.clear();
+  if (par.solver_stokes_preconditioner == 2) return;
+
+  // velocity diagonal, and the wall friction of each velocity for the additive approximation
+  std::vector< double > diagonal(n_vel, 0.0);
+  std::vector< double > friction(diagonal_only ? 0 : n_vel, 0.0);
+#pragma omp parallel for schedule(static)
+  for (hgf_index row = 0; row < n_vel; row++) {
+    double off_diagonal = 0;
+    for (hgf_index pos = array.row_ptr[row]; pos < array.row_ptr[row + 1]; pos++) {
+      if (array.col_index[pos] == row) diagonal[row] += array.value[pos];
+      else if (array.col_index[pos] < n_vel) off_diagonal += std::abs(array.value[pos]);
+    }
+    if (!diagonal_only) {
+      friction[row] = std::max(diagonal[row] - off_diagonal, 0.0) + schur_friction_floor * diagonal[row];
+    }
+  }
+  const std::vector< double >& scaling = diagonal_only ? diagonal : friction;
+
+  // row sizes, then entries
+  std::vector< int > row_size(n_p + 1, 0);
+#pragma omp parallel
+  {
+    std::vector< std::pair< int, double > > entries;
+#pragma omp for schedule(static)
+    for (hgf_index row = 0; row < n_p; row++) {
+      schur_row(array, scaling, n_vel, row, diagonal_only, entries);
+      row_size[row + 1] = (int)entries.size();
+    }
+  }
+  hgf_index nnz = 0;
+  for (hgf_index row = 0; row < n_p; row++) nnz += row_size[row + 1];
+  check_paralution_size(n_p, nnz);
+  system.row_ptr.resize(n_p + 1);
+  system.row_ptr[0] = 0;
+  for (hgf_index row = 0; row < n_p; row++) system.row_ptr[row + 1] = system.row_ptr[row] + row_size[row + 1];
+  system.col_index.resize(system.row_ptr[n_p]);
+  system.value.resize(system.row_ptr[n_p]);
+  if (!diagonal_only) system.inverse_mass.resize(n_p);
+#pragma omp parallel
+  {
+    std::vector< std::pair< int, double > > entries;
+#pragma omp for schedule(static)
+    for (hgf_index row = 0; row < n_p; row++) {
+      schur_row(array, scaling, n_vel, row, diagonal_only, entries);
+      for (int kk = 0; kk < (int)entries.size(); kk++) {
+        system.col_index[system.row_ptr[row] + kk] = entries[kk].first;
+        system.value[system.row_ptr[row] + kk] = entries[kk].second;
+      }
+      if (!diagonal_only) {
+        schur_row(array, diagonal, n_vel, row, true, entries);
+        system.inverse_mass[row] = 1.0 / entries[0].second;
+      }
+    }
+  }
+}
+
+/* Schur complement approximation of a Stokes system given in coo format, through a merged csr copy. */
+static void
+schur_approximation(const parameters& par, const std::vector< array_coo >& array, hgf_index n_rows, \
+  hgf_index n_u, hgf_index n_v, hgf_index n_w, hgf_index n_p, saddle_point& system)
+{
+  array_csr merged;
+  merged.n_rows = n_rows;
+  merged.n_cols = n_rows;
+  merged.row_ptr.assign(n_rows + 1, 0);
+  hgf::utility::csr_add_entries(merged, array);
+  schur_approximation(par, merged, n_u, n_v, n_w, n_p, system);
+}
+
+/* Copies rhs into force and allocates a zero initial guess in sol, for the interfaces taking const inputs. */
+static void
+copy_vectors(LocalVector<double>& force, LocalVector<double>& sol, const std::vector< double >& rhs)
+{
+  force.Allocate("force vector", (int)rhs.size());
+  force.CopyFromData(rhs.data());
   sol.Allocate("solution", (int)rhs.size());
   sol.Zeros();
+}
 
-  mat.Assemble(i_index, j_index, value, (int)array.size(), \
-    "operator", (int)rhs.size(), (int)rhs.size());
+/* Checks that PARALUTION handed back the array it was lent. The storage belongs to a std::vector, so it must never be
+   reallocated or freed by PARALUTION; the solvers here keep the operator on the host in CSR format, and any other
+   pointer means that broke, leaving the vector invalid. */
+template< typename DataType >
+static void
+take_back(const DataType* ptr, const DataType* original, hgf_index n, const char* name)
+{
+  if (ptr == original || n == 0) return;
+  std::cout << "\nPARALUTION replaced the lent " << name << " array, which is owned by the caller. Exiting.\n";
+  exit(0);
+}
 
-#ifdef _PARALUTION_MATRIX_DEBUG
-  mat.WriteFileMTX("MatrixCheck.dat");
-  force.WriteFileASCII("RHS.dat");
-#endif
+/* Lends the storage of data to vec without copying, until reclaim_vector. */
+static void
+lend_vector(LocalVector<double>& vec, std::vector< double >& data, const char* name)
+{
+  double* ptr = data.data();
+  vec.SetDataPtr(&ptr, name, (int)data.size());
+}
 
-  GMRES<LocalMatrix<double>, LocalVector<double>, double> ls;
-  ls.Init(par.solver_absolute_tolerance, par.solver_relative_tolerance, 1e8, par.solver_max_iterations);
-  ls.SetOperator(mat);
-  ls.Verbose(par.solver_verbose);
+static void
+reclaim_vector(LocalVector<double>& vec, std::vector< double >& data)
+{
+  double* ptr = NULL;
+  vec.LeaveDataPtr(&ptr);
+  take_back(ptr, data.data(), (hgf_index)data.size(), "vector");
+}
 
-  ILU<LocalMatrix<double>, LocalVector<double>, double> p;
-  p.Set(2);
-  ls.SetPreconditioner(p);
+/* Index arrays lent to PARALUTION by lend_csr. With HGF_INDEX_64 the indices are narrowed into row_ptr and col_index,
+   otherwise row and col point into the csr array itself. */
+struct csr_loan
+{
+  std::vector< int > row_ptr;
+  std::vector< int > col_index;
+  int* row = NULL;
+  int* col = NULL;
+};
+
+/* Lends the arrays of a csr array to mat without copying, until reclaim_csr. With HGF_INDEX_64 only the values
+   are lent, and loan must stay alive until reclaim_csr. */
+static void
+lend_csr(LocalMatrix<double>& mat, array_csr& array, csr_loan& loan)
+{
+  double* val = array.value.data();
+  check_paralution_size(array.n_rows, (hgf_index)array.value.size());
+#ifdef HGF_INDEX_64
+  loan.row_ptr.assign(array.row_ptr.begin(), array.row_ptr.end());
+  loan.col_index.assign(array.col_index.begin(), array.col_index.end());
+  loan.row = loan.row_ptr.data();
+  loan.col = loan.col_index.data();
+#else
+  loan.row = array.row_ptr.data();
+  loan.col = array.col_index.data();
+#endif
+  int* row = loan.row;
+  int* col = loan.col;
+  mat.SetDataPtrCSR(&row, &col, &val, "operator", (int)array.value.size(), (int)array.n_rows, (int)array.n_cols);
+}
 
-  ls.Build();
-  ls.Solve(force, &sol);
+static void
+reclaim_csr(LocalMatrix<double>& mat, array_csr& array, const csr_loan& loan)
+{
+  int *row = NULL, *col = NULL;
+  double* val = NULL;
+  mat.LeaveDataPtrCSR(&row, &col, &val);
+  take_back(row, loan.row, (hgf_index)array.row_ptr.size(), "row pointer");
+  take_back(col, loan.col, (hgf_index)array.col_index.size(), "column index");
+  take_back(val, array.value.data(), (hgf_index)array.value.size(), "value");
+}
 
-#ifdef _PARALUTION_SOLUTION_DEBUG
-  sol.WriteFileASCII("SOL.dat");
-#endif
+/** \brief hgf::solve::paralution::solve solves a linear system with a simple GMRES + ILU preconditioning strategy.
+ * 
+ * @param[in] par - parameters struct containig basic problem information.
+ * @param[in] array - linear system matrix stored in coordinate sparse format.
+ * @param[in] rhs - right hand side vector for the linear system to be solved.
+ * @param[out] solution - solution of the system is stored here.
+ */
+void
+hgf::solve::paralution::solve(const parameters& par, \
+  const std::vector< array_coo >& array, \
+  const std::vector< double >& rhs, std::vector< double >& solution)
+{
+  set_omp_threads_paralution(omp_get_max_threads());
 
-  for (int ii = 0; ii < solution.size(); ii++) {
-    solution[ii] = sol[ii];
-  }
+  LocalMatrix<double> mat;
+  LocalVector<double> force, sol;
+  assemble_coo(mat, array, (hgf_index)rhs.size());
+  copy_vectors(force, sol, rhs);
+  solve_matrix(par, mat, force, sol);
+  solution.resize(rhs.size());
+  sol.CopyToData(solution.data());
+  mat.Clear();
+  force.Clear();
+  sol.Clear();
+}
+
+/** \brief hgf::solve::paralution::solve solves a linear system with a simple GMRES + ILU preconditioning strategy.
+ * 
+ * @param[in] par - parameters struct containig basic problem information.
+ * @param[in] array - linear system matrix stored in compressed sparse row format.
+ * @param[in] rhs - right hand side vector for the linear system to be solved.
+ * @param[out] solution - solution of the system is stored here.
+ */
+void
+hgf::solve::paralution::solve(const parameters& par, \
+  const array_csr& array, \
+  const std::vector< double >& rhs, std::vector< double >& solution)
+{
+  set_omp_threads_paralution(omp_get_max_threads());
 
-  ls.Clear();
+  LocalMatrix<double> mat;
+  LocalVector<double> force, sol;
+  assemble_csr(mat, array);
+  copy_vectors(force, sol, rhs);
+  solve_matrix(par, mat, force, sol);
+  solution.resize(rhs.size());
+  sol.CopyToData(solution.data());
   mat.Clear();
   force.Clear();
   sol.Clear();
+}
 
-  free(i_index);
-  free(j_index);
-  free(value);
+/** \brief hgf::solve::paralution::solve solves a linear system with a simple GMRES + ILU preconditioning strategy, without copying the system.
+ *
+ * The arrays of array, rhs and solution are lent to PARALUTION for the solve and taken back before returning, so the
+ * matrix and vectors are not duplicated. array and rhs are unchanged on return.
+ * @param[in] par - parameters struct containig basic problem information.
+ * @param[in] array - linear system matrix stored in compressed sparse row format.
+ * @param[in] rhs - right hand side vector for the linear system to be solved.
+ * @param[out] solution - solution of the system is stored here, resized to the size of rhs.
+ */
+void
+hgf::solve::paralution::solve(const parameters& par, \
+  array_csr& array, \
+  std::vector< double >& rhs, std::vector< double >& solution)
+{
+  set_omp_threads_paralution(omp_get_max_threads());
 
+  LocalMatrix<double> mat;
+  LocalVector<double> force, sol;
+  csr_loan loan;
+  solution.assign(rhs.size(), 0.0);
+  lend_csr(mat, array, loan);
+  lend_vector(force, rhs, "force vector");
+  lend_vector(sol, solution, "solution");
+  solve_matrix(par, mat, force, sol);
+  reclaim_csr(mat, array, loan);
+  reclaim_vector(force, rhs);
+  reclaim_vector(sol, solution);
 }
 
 /** \brief hgf::solve::paralution::solve_ps_flow solves a linear system with a strategy designed for complex flow problems.
  * 
+ * FGMRES with the preconditioner selected by par.solver_stokes_preconditioner. By default it is block lower triangular:
+ * an AMG V-cycle on each velocity component, then on the pressure block an AMG V-cycle on a wall friction Schur
+ * complement approximation added to the inverse of the scaled pressure mass matrix, which stays mesh independent.
  * @param[in] par - parameters struct containig basic problem information.
  * @param[in] array - linear system matrix stored in coordinate sparse format.
  * @param[in] rhs - right hand side vector for the linear system to be solved.
@@ -108,93 +679,272 @@ hgf::solve::paralution::solve_ps_flow(const parameters& par, \
   const std::vector< array_coo >& array, \
   const std::vector< double >& rhs, \
   std::vector<double>& solution, \
-  int n_u, int n_v, int n_w, int n_p)
+  hgf_index n_u, hgf_index n_v, hgf_index n_w, hgf_index n_p)
 {
   set_omp_threads_paralution(omp_get_max_threads());
 
-  int *i_index, *j_index;
-  double *value;
+  LocalMatrix<double> mat;
+  LocalVector<double> force, sol;
+  saddle_point system;
+  schur_approximation(par, array, (hgf_index)rhs.size(), n_u, n_v, n_w, n_p, system);
+  assemble_coo(mat, array, (hgf_index)rhs.size());
+  copy_vectors(force, sol, rhs);
+  solve_ps_flow_matrix(par, mat, force, sol, system);
+  solution.resize(rhs.size());
+  sol.CopyToData(solution.data());
+  mat.Clear();
+  force.Clear();
+  sol.Clear();
+}
 
-  i_index = (int *)malloc(array.size() * sizeof(int));
-  j_index = (int *)malloc(array.size() * sizeof(int));
-  value = (double *)malloc(array.size() * sizeof(double));
+/** \brief hgf::solve::paralution::solve_ps_flow solves a linear system with a strategy designed for complex flow problems.
+ * 
+ * FGMRES with the preconditioner selected by par.solver_stokes_preconditioner. By default it is block lower triangular:
+ * an AMG V-cycle on each velocity component, then on the pressure block an AMG V-cycle on a wall friction Schur
+ * complement approximation added to the inverse of the scaled pressure mass matrix, which stays mesh independent.
+ * @param[in] par - parameters struct containig basic problem information.
+ * @param[in] array - linear system matrix stored in compressed sparse row format.
+ * @param[in] rhs - right hand side vector for the linear system to be solved.
+ * @param[out] solution - solution of the system is stored here.
+ * @param[in] n_u - number of x-component of velocity degrees of freedom in the system.
+ * @param[in] n_v - number of y-component of velocity degrees of freedom in the system.
+ * @param[in] n_w - number of z-component of velocity degrees of freedom in the system.
+ * @param[in] n_p - number of pressure degrees of freedom in the system.
+ */
+void 
+hgf::solve::paralution::solve_ps_flow(const parameters& par, \
+  const array_csr& array, \
+  const std::vector< double >& rhs, \
+  std::vector<double>& solution, \
+  hgf_index n_u, hgf_index n_v, hgf_index n_w, hgf_index n_p)
+{
+  set_omp_threads_paralution(omp_get_max_threads());
 
-  for (int ii = 0; ii < array.size(); ii++) {
-    i_index[ii] = array[ii].i_index;
-    j_index[ii] = array[ii].j_index;
-    value[ii] = array[ii].value;
-  }
+  LocalMatrix<double> mat;
+  LocalVector<double> force, sol;
+  saddle_point system;
+  schur_approximation(par, array, n_u, n_v, n_w, n_p, system);
+  assemble_csr(mat, array);
+  copy_vectors(force, sol, rhs);
+  solve_ps_flow_matrix(par, mat, force, sol, system);
+  solution.resize(rhs.size());
+  sol.CopyToData(solution.data());
+  mat.Clear();
+  force.Clear();
+  sol.Clear();
+}
+
+/** \brief hgf::solve::paralution::solve_ps_flow solves a linear system with a strategy designed for complex flow problems, without copying the system.
+ *
+ * Uses the block lower triangular preconditioner of the other solve_ps_flow interfaces.
+ * The arrays of array, rhs and solution are lent to PARALUTION for the solve and taken back before returning, so the
+ * matrix and vectors are not duplicated. array and rhs are unchanged on return.
+ * @param[in] par - parameters struct containig basic problem information.
+ * @param[in] array - linear system matrix stored in compressed sparse row format.
+ * @param[in] rhs - right hand side vector for the linear system to be solved.
+ * @param[out] solution - solution of the system is stored here, resized to the size of rhs.
+ * @param[in] n_u - number of x-component of velocity degrees of freedom in the system.
+ * @param[in] n_v - number of y-component of velocity degrees of freedom in the system.
+ * @param[in] n_w - number of z-component of velocity degrees of freedom in the system.
+ * @param[in] n_p - number of pressure degrees of freedom in the system.
+ */
+void
+hgf::solve::paralution::solve_ps_flow(const parameters& par, \
+  array_csr& array, \
+  std::vector< double >& rhs, \
+  std::vector<double>& solution, \
+  hgf_index n_u, hgf_index n_v, hgf_index n_w, hgf_index n_p)
+{
+  set_omp_threads_paralution(omp_get_max_threads());
 
-  LocalVector<double> sol;
-  LocalVector<double> force;
   LocalMatrix<double> mat;
+  LocalVector<double> force, sol;
+  csr_loan loan;
+  saddle_point system;
+  schur_approximation(par, array, n_u, n_v, n_w, n_p, system);
+  solution.assign(rhs.size(), 0.0);
+  lend_csr(mat, array, loan);
+  lend_vector(force, rhs, "force vector");
+  lend_vector(sol, solution, "solution");
+  solve_ps_flow_matrix(par, mat, force, sol, system);
+  reclaim_csr(mat, array, loan);
+  reclaim_vector(force, rhs);
+  reclaim_vector(sol, solution);
+}
 
-  force.Allocate("force vector", (int)rhs.size());
-  for (int ii = 0; ii < rhs.size(); ii++) {
-    force[ii] = rhs[ii];
+// operator, vectors and built solver of a solver_session. The solver is declared last so it is released first.
+// The solver controls, and the block sizes of Stokes sessions, are kept to rebuild the preconditioner on new values.
+struct hgf::solve::paralution::solver_session::state
+{
+  LocalMatrix<double> mat;
+  LocalVector<double> force;
+  LocalVector<double> sol;
+  hgf_index n_rows;
+  hgf_index nnz;
+  bool ps_flow = false;
+  parameters controls;
+  hgf_index blocks[4];
+  std::unique_ptr< solver_stack > stack;
+};
+
+/* The solver controls of par, without the geometry. */
+static parameters
+solver_controls(const parameters& par)
+{
+  parameters controls;
+  controls.dimension = par.dimension;
+  controls.solver_max_iterations = par.solver_max_iterations;
+  controls.solver_absolute_tolerance = par.solver_absolute_tolerance;
+  controls.solver_relative_tolerance = par.solver_relative_tolerance;
+  controls.solver_verbose = par.solver_verbose;
+  controls.solver_mixed_precision = par.solver_mixed_precision;
+  controls.solver_stokes_preconditioner = par.solver_stokes_preconditioner;
+  return controls;
+}
+
+hgf::solve::paralution::solver_session::solver_session(void)
+{
+}
+
+hgf::solve::paralution::solver_session::~solver_session(void)
+{
+  clear();
+}
+
+/** \brief hgf::solve::paralution::solver_session::setup copies a linear system into the session and builds GMRES + ILU preconditioning for it.
+ *
+ * Uses the strategy of hgf::solve::paralution::solve, including the mixed precision mode; any previous setup is released.
+ * @param[in] par - parameters struct containig basic problem information.
+ * @param[in] array - linear system matrix stored in compressed sparse row format.
+ */
+void
+hgf::solve::paralution::solver_session::setup(const parameters& par, const array_csr& array)
+{
+  set_omp_threads_paralution(omp_get_max_threads());
+
+  clear();
+  current.reset(new state);
+  assemble_csr(current->mat, array);
+  current->n_rows = array.n_rows;
+  current->nnz = (hgf_index)array.value.size();
+  current->controls = solver_controls(par);
+  current->force.Allocate("force vector", (int)array.n_rows);
+  current->sol.Allocate("solution", (int)array.n_rows);
+  current->stack.reset(build_stack< gmres_ilu >(par, current->mat, NULL));
+}
+
+/** \brief hgf::solve::paralution::solver_session::setup_ps_flow copies a Stokes linear system into the session and builds the flow preconditioner for it.
+ *
+ * Uses the strategy of hgf::solve::paralution::solve_ps_flow, including the mixed precision mode; any previous setup is released.
+ * @param[in] par - parameters struct containig basic problem information.
+ * @param[in] array - linear system matrix stored in compressed sparse row format.
+ * @param[in] n_u - number of x-component of velocity degrees of freedom in the system.
+ * @param[in] n_v - number of y-component of velocity degrees of freedom in the system.
+ * @param[in] n_w - number of z-component of velocity degrees of freedom in the system.
+ * @param[in] n_p - number of pressure degrees of freedom in the system.
+ */
+void
+hgf::solve::paralution::solver_session::setup_ps_flow(const parameters& par, const array_csr& array, \
+  hgf_index n_u, hgf_index n_v, hgf_index n_w, hgf_index n_p)
+{
+  set_omp_threads_paralution(omp_get_max_threads());
+
+  saddle_point system;
+  schur_approximation(par, array, n_u, n_v, n_w, n_p, system);
+  clear();
+  current.reset(new state);
+  assemble_csr(current->mat, array);
+  current->n_rows = array.n_rows;
+  current->nnz = (hgf_index)array.value.size();
+  current->ps_flow = true;
+  current->controls = solver_controls(par);
+  current->blocks[0] = n_u;
+  current->blocks[1] = n_v;
+  current->blocks[2] = n_w;
+  current->blocks[3] = n_p;
+  current->force.Allocate("force vector", (int)array.n_rows);
+  current->sol.Allocate("solution", (int)array.n_rows);
+  current->stack.reset(build_ps_flow_stack(par, current->mat, system));
+}
+
+/** \brief hgf::solve::paralution::solver_session::update_values replaces the values of the operator and rebuilds the preconditioner numerically.
+ *
+ * The sparsity pattern of array must be the one the session was set up with, only the values are copied.
+ * The symbolic analysis of the preconditioner, e.g. the coloring and fill pattern of the ILU factors, is kept.
+ * Sessions set up with setup_ps_flow recompute their Schur complement approximation, which depends on the values,
+ * and rebuild the block preconditioner in full, unless they use the saddle point preconditioner of earlier versions.
+ * Sessions in the mixed precision mode are rebuilt in full as well, since their single precision copy of the operator
+ * is only made when the solver is built.
+ * @param[in] array - linear system matrix with the values to use, stored in compressed sparse row format.
+ */
+void
+hgf::solve::paralution::solver_session::update_values(const array_csr& array)
+{
+  if (!current) {
+    std::cout << "\nSolver session used before setup. Exiting.\n";
+    exit(0);
+  }
+  if (array.n_rows != current->n_rows || (hgf_index)array.value.size() != current->nnz) {
+    std::cout << "\nSolver session values update changes the sparsity pattern, use setup instead. Exiting.\n";
+    exit(0);
   }
 
-  sol.Allocate("solution", (int)rhs.size());
-  sol.Zeros();
+  // UpdateValuesCSR copies the values, it does not keep or modify them
+  current->mat.UpdateValuesCSR(const_cast< double* >(array.value.data()));
+  bool schur = current->ps_flow && current->controls.solver_stokes_preconditioner != 2;
+  if (!schur && !current->controls.solver_mixed_precision) {
+    current->stack->solver().ReBuildNumeric();
+    return;
+  }
+  current->stack.reset();
+  if (current->ps_flow) {
+    saddle_point system;
+    schur_approximation(current->controls, array, current->blocks[0], current->blocks[1], current->blocks[2], \
+      current->blocks[3], system);
+    current->stack.reset(build_ps_flow_stack(current->controls, current->mat, system));
+  }
+  else current->stack.reset(build_stack< gmres_ilu >(current->controls, current->mat, NULL));
+}
 
-  mat.Assemble(i_index, j_index, value, (int)array.size(), \
-    "operator", (int)rhs.size(), (int)rhs.size());
-
-  // GMRES object
-  FGMRES<LocalMatrix<double>, LocalVector<double>, double> ls;
-  ls.Init(par.solver_absolute_tolerance, par.solver_relative_tolerance, 1e8, par.solver_max_iterations);
-  ls.SetOperator(mat);
-  ls.Verbose(par.solver_verbose);
-  ls.SetBasisSize(100);
-
-  // preconditioning
-  DiagJacobiSaddlePointPrecond<LocalMatrix<double>, LocalVector<double>, double> p;
-  // Upper preconditioner is a block preconditioner broken up for velocity components
-  BlockPreconditioner<LocalMatrix<double>, LocalVector<double>, double> p_k;
-  Solver<LocalMatrix<double>, LocalVector<double>, double> **p2;
-  int n = par.dimension;
-  int *size;
-  size = new int[n];
-  size[0] = n_u;
-  size[1] = n_v;
-  if (par.dimension == 3) {
-    size[2] = n_w;
-  }
-  p2 = new Solver<LocalMatrix<double>, LocalVector<double>, double> *[n];
-  for (int i = 0; i < n; ++i) {
-    MultiColoredILU<LocalMatrix<double>, LocalVector<double>, double> *mc;
-    mc = new MultiColoredILU<LocalMatrix<double>, LocalVector<double>, double>;
-    mc->Set(3);
-    p2[i] = mc;
-  }
-  p_k.Set(n, size, p2);
-
-  // lower preconditioner
-  Jacobi<LocalMatrix<double>, LocalVector<double>, double> p_s;
-  p.Set(p_k, p_s);
-
-  //  ILU<LocalMatrix<double>, LocalVector<double>, double> p;
-  ls.SetPreconditioner(p);
-
-  // build
-  ls.Build();
-
-  // solve the system
-  ls.Solve(force, &sol);
-
-  int dof_total = (par.dimension == 3) ? n_u + n_v + n_w + n_p : n_u + n_v + n_p;
-  // pass solution from paralution object to std vector input
-  for (int cl = 0; cl < dof_total; cl++) {
-    solution[cl] = sol[cl];
-  }
-
-  // clear paralution objects
-  ls.Clear();
-  mat.Clear();
-  p.Clear();
-  force.Clear();
-  sol.Clear();
+/** \brief hgf::solve::paralution::solver_session::solve solves the linear system of the session for a right-hand side, reusing the built preconditioner.
+ *
+ * @param[in] rhs - right hand side vector for the linear system to be solved.
+ * @param[in,out] solution - initial guess if sized like rhs, otherwise zero is used; the solution of the system is stored here.
+ */
+void
+hgf::solve::paralution::solver_session::solve(const std::vector< double >& rhs, std::vector< double >& solution)
+{
+  if (!current) {
+    std::cout << "\nSolver session used before setup. Exiting.\n";
+    exit(0);
+  }
+  if ((hgf_index)rhs.size() != current->n_rows) {
+    std::cout << "\nRight-hand side of size " << rhs.size() << " does not match the " << current->n_rows << " rows of the solver session. Exiting.\n";
+    exit(0);
+  }
+
+  current->force.CopyFromData(rhs.data());
+  if (solution.size() == rhs.size()) current->sol.CopyFromData(solution.data());
+  else {
+    current->sol.Zeros();
+    solution.resize(rhs.size());
+  }
+  current->stack->solver().Solve(current->force, &current->sol);
+  current->sol.CopyToData(solution.data());
+}
 
+/** \brief hgf::solve::paralution::solver_session::clear releases the operator, vectors and preconditioner of the session.
+ *
+ */
+void
+hgf::solve::paralution::solver_session::clear(void)
+{
+  if (!current) return;
+  current->stack.reset();
+  current->mat.Clear();
+  current->force.Clear();
+  current->sol.Clear();
+  current.reset();
 }
 
 /** \brief hgf::solve::paralution::finalize_solver closes the paralution library.
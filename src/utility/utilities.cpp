@@ -66,6 +66,9 @@ hgf::utility::find_file(const bfs::path& problem_path, \
 
 /** \brief Loads parameters into a parameters struct from Parameters.dat file.
  *
+ * The first seven lines are required and read in order. They may be followed by optional lines, in any order,
+ * each starting with its key: solver_mixed_precision=, periodic= or solver_stokes_preconditioner=. Other lines are
+ * ignored with a warning, as older Parameters.dat files may carry lines this version does not read.
  * @param[in,out] par - parameters struct, parameters will be set from data in Parameters.dat located in problem_path.
  * @param[in] problem_path - path containing Parameters.dat.
  */
@@ -152,6 +155,16 @@ hgf::utility::load_parameters(parameters& par, const bfs::path& problem_path)
   std::istringstream isolver_verbose(line);
   isolver_verbose >> str >> par.solver_verbose;
 
+  //--- optional parameters, identified by key in any order ---//
+  while (std::getline(ifs, line)) {
+    std::istringstream ioptional(line);
+    if (!(ioptional >> str)) continue;
+    if (str == "solver_mixed_precision=") ioptional >> par.solver_mixed_precision;
+    else if (str == "periodic=") ioptional >> par.periodic;
+    else if (str == "solver_stokes_preconditioner=") ioptional >> par.solver_stokes_preconditioner;
+    else std::cout << "\nWarning, unknown parameter " << str << " in Parameters.dat is ignored.\n";
+  }
+
 }
 
 /** \brief Prints parameters from par parameter.
@@ -169,6 +182,9 @@ hgf::utility::print_parameters(parameters& par)
   std::cout << "Solver absolute tolerance= " << par.solver_absolute_tolerance << "\n";
   std::cout << "Solver relative tolerance= " << par.solver_relative_tolerance << "\n";
   std::cout << "Solver verbose= " << par.solver_verbose << "\n";
+  std::cout << "Solver mixed precision= " << par.solver_mixed_precision << "\n";
+  std::cout << "Periodic= " << par.periodic << "\n";
+  std::cout << "Solver Stokes preconditioner= " << par.solver_stokes_preconditioner << "\n";
   std::cout << "Problem path= " << par.problem_path.string() << "\n";
 }
 
@@ -276,6 +292,54 @@ hgf::utility::import_voxel_geometry(parameters& par, const bfs::path& problem_pa
 
 }
 
+/** \brief Imports a field with one value per voxel from a file in the problem folder, e.g. a sub-resolution permeability map.
+ *
+ * The file has the layout of Geometry.dat: nx, ny and nz header lines followed by the values, x fastest, with an
+ * empty line between z slices in 3d. The header must match the geometry loaded in par.
+ * @param[in] par - parameters struct containing the voxel geometry the field belongs to.
+ * @param[in] problem_path - path containing the field file.
+ * @param[in] file_name - name of the field file.
+ * @param[out] field - one value per voxel, ordered as par.voxel_geometry.
+ */
+void
+hgf::utility::import_voxel_field(const parameters& par, const bfs::path& problem_path, const std::string& file_name, std::vector< double >& field)
+{
+  bfs::path field_path;
+  bool isField = hgf::utility::find_file(problem_path, file_name, field_path);
+
+  // error and exit if the field file is missing
+  if (!isField) {
+    std::cout << "\n" << file_name << " not present and a voxel field was requested. Exiting.\n";
+    exit(0);
+  }
+
+  std::string line;
+  std::string str;
+  bfs::ifstream ifs(field_path);
+
+  // the nx, ny and nz header lines must match the geometry
+  int dims[3] = { 0, 0, 0 };
+  for (int kk = 0; kk < 3; kk++) {
+    if (ifs.good()) std::getline(ifs, line);
+    std::istringstream idim(line);
+    idim >> str >> dims[kk];
+  }
+  if (dims[0] != par.nx || dims[1] != par.ny || dims[2] != par.nz) {
+    std::cout << "\n" << file_name << " dimensions do not match the voxel geometry. Exiting.\n";
+    exit(0);
+  }
+
+  // remaining values in voxel order, empty lines between slices are skipped by the stream
+  field.clear();
+  field.reserve(par.voxel_geometry.size());
+  double value;
+  while (ifs >> value) field.push_back(value);
+  if (field.size() != par.voxel_geometry.size()) {
+    std::cout << "\n" << file_name << " holds " << field.size() << " values for " << par.voxel_geometry.size() << " voxels. Exiting.\n";
+    exit(0);
+  }
+}
+
 /** \brief Checks if a coordinate sparse matrix is symmetric. Returns 1 for symmetry and 0 for non-symmetry.
  *
  * @param[in] array - coordinate sparse matrix input that is checked for symmetry.
@@ -381,3 +445,80 @@ hgf::utility::unique_array(std::vector< array_coo >& array)
   
 }
 
+
+/** \brief Adds COO entries into a CSR array, summing entries that share an index.
+ *
+ * Entries already in the sparsity pattern are added in place. Rows receiving entries outside the pattern
+ * are rebuilt with the new columns merged in order, so the array stays sorted and free of duplicates.
+ * Entries with a negative row or column index are ignored.
+ * @param[in,out] array - compressed sparse row array the entries are added to.
+ * @param[in] entries - coordinate sparse entries to add.
+ * @param[in,out] tags - optional per-nonzero tags kept aligned with array when rows are rebuilt.
+ * @param[in] new_tag - tag given to nonzeros inserted outside the pattern.
+ */
+void
+hgf::utility::csr_add_entries(array_csr& array, const std::vector< array_coo >& entries, \
+                              std::vector< unsigned char >* tags, unsigned char new_tag)
+{
+  // in place additions, entries outside the pattern are set aside
+  std::vector< array_coo > new_entries;
+  for (hgf_index ii = 0; ii < (hgf_index)entries.size(); ii++) {
+    hgf_index row = entries[ii].i_index;
+    hgf_index col = entries[ii].j_index;
+    if (row < 0 || col < 0) continue;
+    hgf_index pos = array.row_ptr[row];
+    while (pos < array.row_ptr[row + 1] && array.col_index[pos] != col) pos++;
+    if (pos < array.row_ptr[row + 1]) array.value[pos] += entries[ii].value;
+    else new_entries.push_back(entries[ii]);
+  }
+  if (!new_entries.size()) return;
+
+  // merge repeated new entries
+  std::sort(new_entries.begin(), new_entries.end(), byIbyJ());
+  hgf_index n_new = 0;
+  for (hgf_index ii = 0; ii < (hgf_index)new_entries.size(); ii++) {
+    if (n_new && new_entries[n_new - 1].i_index == new_entries[ii].i_index && new_entries[n_new - 1].j_index == new_entries[ii].j_index) {
+      new_entries[n_new - 1].value += new_entries[ii].value;
+    }
+    else new_entries[n_new++] = new_entries[ii];
+  }
+  new_entries.resize(n_new);
+
+  // grown row pointers, and the first new entry of each row
+  std::vector< hgf_index > row_ptr(array.n_rows + 1);
+  std::vector< hgf_index > new_ptr(array.n_rows + 1, 0);
+  for (hgf_index ii = 0; ii < n_new; ii++) new_ptr[new_entries[ii].i_index + 1]++;
+  row_ptr[0] = 0;
+  for (hgf_index row = 0; row < array.n_rows; row++) {
+    row_ptr[row + 1] = row_ptr[row] + (array.row_ptr[row + 1] - array.row_ptr[row]) + new_ptr[row + 1];
+    new_ptr[row + 1] += new_ptr[row];
+  }
+
+  // merge each old row with its new entries
+  std::vector< hgf_index > col_index(row_ptr[array.n_rows]);
+  std::vector< double > value(row_ptr[array.n_rows]);
+  std::vector< unsigned char > new_tags(tags ? row_ptr[array.n_rows] : 0);
+#pragma omp parallel for schedule(static)
+  for (hgf_index row = 0; row < array.n_rows; row++) {
+    hgf_index pos = row_ptr[row];
+    hgf_index old_pos = array.row_ptr[row];
+    hgf_index new_pos = new_ptr[row];
+    while (old_pos < array.row_ptr[row + 1] || new_pos < new_ptr[row + 1]) {
+      if (new_pos == new_ptr[row + 1] || \
+        (old_pos < array.row_ptr[row + 1] && array.col_index[old_pos] < new_entries[new_pos].j_index)) {
+        if (tags) new_tags[pos] = (*tags)[old_pos];
+        col_index[pos] = array.col_index[old_pos];
+        value[pos++] = array.value[old_pos++];
+      }
+      else {
+        if (tags) new_tags[pos] = new_tag;
+        col_index[pos] = new_entries[new_pos].j_index;
+        value[pos++] = new_entries[new_pos++].value;
+      }
+    }
+  }
+  array.row_ptr.swap(row_ptr);
+  array.col_index.swap(col_index);
+  array.value.swap(value);
+  if (tags) tags->swap(new_tags);
+}